@@ -161,16 +161,14 @@ bool RayAABBIntersectionTest(Ray ray, float3 aabb[2], out float tmin, out float
     int3 sign3 = ray.direction > 0;
 
     // Handle rays parallel to any x|y|z slabs of the AABB.
-    // If a ray is within the parallel slabs, 
-    //  the tmin, tmax will get set to -inf and +inf
-    //  which will get ignored on tmin/tmax = max/min.
-    // If a ray is outside the parallel slabs, -inf/+inf will
-    //  make tmax > tmin fail (i.e. no intersection).
-    // TODO: handle cases where ray origin is within a slab 
-    //  that a ray direction is parallel to. In that case
-    //  0 * INF => NaN
-    const float FLT_INFINITY = 1.#INF;
-    float3 invRayDirection = select(ray.direction != 0, 1 / ray.direction, select(ray.direction > 0, FLT_INFINITY, -FLT_INFINITY));
+    // Direction components closer to zero than MIN_SLAB_DIRECTION are clamped to it, keeping the sign used by sign3.
+    // The inverse stays finite, so a ray within the parallel slabs gets tmin, tmax of about -1e20 and +1e20,
+    //  which get ignored on tmin/tmax = max/min, and a ray outside of them makes tmax > tmin fail.
+    // A ray origin lying exactly on such a slab gives 0 * 1e20 = 0, instead of 0 * INF = NaN.
+    const float MIN_SLAB_DIRECTION = 1e-20;
+    float3 safeRayDirection = select(abs(ray.direction) > MIN_SLAB_DIRECTION, ray.direction,
+                                     select(ray.direction > 0, MIN_SLAB_DIRECTION, -MIN_SLAB_DIRECTION));
+    float3 invRayDirection = 1 / safeRayDirection;
 
     tmin3.x = (aabb[1 - sign3.x].x - ray.origin.x) * invRayDirection.x;
     tmax3.x = (aabb[sign3.x].x - ray.origin.x) * invRayDirection.x;
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "CPU/RaytracingShaderHelper.h"
+#include "CPU/ShaderMath.h"
+
+namespace CPU
+{
+
+// Axis-aligned bounding box. Default constructed boxes are empty (inverted), so growing them by anything yields that thing.
+struct AABB
+{
+    float3 min = {INFINITY_F, INFINITY_F, INFINITY_F};
+    float3 max = {-INFINITY_F, -INFINITY_F, -INFINITY_F};
+
+    void grow(float3 const point)
+    {
+        min = CPU::min(min, point);
+        max = CPU::max(max, point);
+    }
+
+    void grow(AABB const& aabb)
+    {
+        min = CPU::min(min, aabb.min);
+        max = CPU::max(max, aabb.max);
+    }
+
+    [[nodiscard]] bool is_empty() const
+    {
+        return min.x > max.x || min.y > max.y || min.z > max.z;
+    }
+
+    [[nodiscard]] float3 extent() const
+    {
+        return max - min;
+    }
+
+    [[nodiscard]] float3 centroid() const
+    {
+        return 0.5f * (min + max);
+    }
+
+    // Empty boxes have no area, which keeps them from skewing SAH costs.
+    [[nodiscard]] float surface_area() const
+    {
+        if (is_empty())
+        {
+            return 0.0f;
+        }
+
+        float3 const e = extent();
+        return 2.0f * (e.x * e.y + e.y * e.z + e.z * e.x);
+    }
+};
+
+// Bounds of an AABB transformed by an affine row-major matrix, e.g. an instance's object to world transform.
+// Ref: Arvo, "Transforming Axis-Aligned Bounding Boxes", Graphics Gems, 1990
+inline AABB transform_aabb(AABB const& aabb, float4x4 const& m)
+{
+    if (aabb.is_empty())
+    {
+        return {};
+    }
+
+    AABB result = {};
+    for (u32 j = 0; j < 3; j++)
+    {
+        result.min[j] = m.m[3][j];
+        result.max[j] = m.m[3][j];
+
+        for (u32 i = 0; i < 3; i++)
+        {
+            float const a = m.m[i][j] * aabb.min[i];
+            float const b = m.m[i][j] * aabb.max[i];
+            result.min[j] += std::min(a, b);
+            result.max[j] += std::max(a, b);
+        }
+    }
+
+    return result;
+}
+
+}
@@ -0,0 +1,228 @@
+#pragma once
+
+#include "ConstantBuffers.h"
+#include "CPU/RaytracingShaderHelper.h"
+
+// CPU counterpart of AnalyticPrimitives.hlsli.
+// Set of ray vs analytic primitive intersection tests.
+namespace CPU
+{
+
+// Solve a quadratic equation.
+// Ref: https://www.scratchapixel.com/lessons/3d-basic-rendering/minimal-ray-tracer-rendering-simple-shapes/ray-sphere-intersection
+inline bool solve_quadratic_eqn(float const a, float const b, float const c, float& x0, float& x1)
+{
+    float const discr = b * b - 4 * a * c;
+    if (discr < 0)
+    {
+        return false;
+    }
+
+    if (discr == 0)
+    {
+        x0 = x1 = -0.5f * b / a;
+    }
+    else
+    {
+        float const q = (b > 0) ? -0.5f * (b + std::sqrt(discr)) : -0.5f * (b - std::sqrt(discr));
+        x0 = q / a;
+        x1 = c / q;
+    }
+
+    if (x0 > x1)
+    {
+        std::swap(x0, x1);
+    }
+
+    return true;
+}
+
+// Calculate a normal for a hit point on a sphere.
+inline float3 calculate_normal_for_a_ray_sphere_hit(Ray const& ray, float const thit, float3 const center)
+{
+    float3 const hit_position = ray.origin + thit * ray.direction;
+    return normalize(hit_position - center);
+}
+
+// Analytic solution of an unbounded ray sphere intersection points.
+// Ref: https://www.scratchapixel.com/lessons/3d-basic-rendering/minimal-ray-tracer-rendering-simple-shapes/ray-sphere-intersection
+inline bool solve_ray_sphere_intersection_equation(Ray const& ray, float& tmin, float& tmax, float3 const center, float const radius)
+{
+    float3 const l = ray.origin - center;
+    float const a = dot(ray.direction, ray.direction);
+    float const b = 2 * dot(ray.direction, l);
+    float const c = dot(l, l) - radius * radius;
+    return solve_quadratic_eqn(a, b, c, tmin, tmax);
+}
+
+// Test if a ray with RayFlags and segment <RayTMin(), RayTCurrent()> intersects a hollow sphere.
+inline bool ray_sphere_intersection_test(Ray const& ray, float& thit, float& tmax, ProceduralPrimitiveAttributes& attr,
+                                         RayState const& state, float3 const center = {0, 0, 0}, float const radius = 1)
+{
+    float t0, t1; // solutions for t if the ray intersects
+
+    if (!solve_ray_sphere_intersection_equation(ray, t0, t1, center, radius))
+    {
+        return false;
+    }
+    tmax = t1;
+
+    float3 normal;
+    if (t0 < state.t_min)
+    {
+        // t0 is before RayTMin, let's use t1 instead .
+        if (t1 < state.t_min)
+        {
+            return false; // both t0 and t1 are before RayTMin
+        }
+
+        normal = calculate_normal_for_a_ray_sphere_hit(ray, t1, center);
+        if (is_a_valid_hit(ray, t1, normal, state))
+        {
+            thit = t1;
+            attr.normal = {normal.x, normal.y, normal.z};
+            return true;
+        }
+    }
+    else
+    {
+        normal = calculate_normal_for_a_ray_sphere_hit(ray, t0, center);
+        if (is_a_valid_hit(ray, t0, normal, state))
+        {
+            thit = t0;
+            attr.normal = {normal.x, normal.y, normal.z};
+            return true;
+        }
+
+        normal = calculate_normal_for_a_ray_sphere_hit(ray, t1, center);
+        if (is_a_valid_hit(ray, t1, normal, state))
+        {
+            thit = t1;
+            attr.normal = {normal.x, normal.y, normal.z};
+            return true;
+        }
+    }
+    return false;
+}
+
+// Test if a ray segment <RayTMin(), RayTCurrent()> intersects a solid sphere.
+// Limitation: this test does not take RayFlags into consideration and does not calculate a surface normal.
+inline bool ray_solid_sphere_intersection_test(Ray const& ray, float& thit, float& tmax, RayState const& state,
+                                               float3 const center = {0, 0, 0}, float const radius = 1)
+{
+    float t0, t1; // solutions for t if the ray intersects
+
+    if (!solve_ray_sphere_intersection_equation(ray, t0, t1, center, radius))
+    {
+        return false;
+    }
+
+    // Since it's a solid sphere, clip intersection points to ray extents.
+    thit = std::max(t0, state.t_min);
+    tmax = std::min(t1, state.t_current);
+
+    return true;
+}
+
+// Test if a ray with RayFlags and segment <RayTMin(), RayTCurrent()> intersects multiple hollow spheres.
+inline bool ray_spheres_intersection_test(Ray const& ray, float& thit, ProceduralPrimitiveAttributes& attr, RayState const& state)
+{
+    u32 constexpr n = 3;
+    float3 constexpr centers[n] = {
+        {-0.3f, -0.3f, -0.3f},
+        {0.1f, 0.1f, 0.4f},
+        {0.35f, 0.35f, 0.0f},
+    };
+    float constexpr radii[n] = {0.6f, 0.3f, 0.15f};
+    bool hit_found = false;
+
+    //
+    // Test for intersection against all spheres and take the closest hit.
+    //
+    thit = state.t_current;
+
+    // test against all spheres
+    for (u32 i = 0; i < n; i++)
+    {
+        float _thit;
+        float _tmax;
+        ProceduralPrimitiveAttributes _attr = {};
+        if (ray_sphere_intersection_test(ray, _thit, _tmax, _attr, state, centers[i], radii[i]))
+        {
+            if (_thit < thit)
+            {
+                thit = _thit;
+                attr = _attr;
+                hit_found = true;
+            }
+        }
+    }
+    return hit_found;
+}
+
+// Test if a ray segment <RayTMin(), RayTCurrent()> intersects an AABB.
+// Limitation: this test does not take RayFlags into consideration and does not calculate a surface normal.
+// Ref: https://www.scratchapixel.com/lessons/3d-basic-rendering/minimal-ray-tracer-rendering-simple-shapes/ray-box-intersection
+inline bool ray_aabb_intersection_test(Ray const& ray, float3 const aabb[2], float& tmin, float& tmax, RayState const& state)
+{
+    float3 tmin3, tmax3;
+    u32 const sign3[3] = {ray.direction.x > 0, ray.direction.y > 0, ray.direction.z > 0};
+
+    // Handle rays parallel to any x|y|z slabs of the AABB, see safe_inverse().
+    float3 const inv_ray_direction = safe_inverse(ray.direction);
+
+    for (u32 i = 0; i < 3; i++)
+    {
+        tmin3[i] = (aabb[1 - sign3[i]][i] - ray.origin[i]) * inv_ray_direction[i];
+        tmax3[i] = (aabb[sign3[i]][i] - ray.origin[i]) * inv_ray_direction[i];
+    }
+
+    tmin = std::max(std::max(tmin3.x, tmin3.y), tmin3.z);
+    tmax = std::min(std::min(tmax3.x, tmax3.y), tmax3.z);
+
+    return tmax > tmin && tmax >= state.t_min && tmin <= state.t_current;
+}
+
+// Test if a ray with RayFlags and segment <RayTMin(), RayTCurrent()> intersects a hollow AABB.
+inline bool ray_aabb_intersection_test(Ray const& ray, float3 const aabb[2], float& thit, ProceduralPrimitiveAttributes& attr,
+                                       RayState const& state)
+{
+    float tmin, tmax;
+    if (ray_aabb_intersection_test(ray, aabb, tmin, tmax, state))
+    {
+        // Only consider intersections crossing the surface from the outside.
+        if (tmin < state.t_min || tmin > state.t_current)
+        {
+            return false;
+        }
+
+        thit = tmin;
+
+        // Set a normal to the normal of a face the hit point lays on.
+        float3 const hit_position = ray.origin + thit * ray.direction;
+        float3 const distance_to_bounds[2] = {
+            abs(aabb[0] - hit_position),
+            abs(aabb[1] - hit_position),
+        };
+        float constexpr eps = 0.0001f;
+        float3 normal = {attr.normal.x, attr.normal.y, attr.normal.z};
+        if (distance_to_bounds[0].x < eps)
+            normal = {-1, 0, 0};
+        else if (distance_to_bounds[0].y < eps)
+            normal = {0, -1, 0};
+        else if (distance_to_bounds[0].z < eps)
+            normal = {0, 0, -1};
+        else if (distance_to_bounds[1].x < eps)
+            normal = {1, 0, 0};
+        else if (distance_to_bounds[1].y < eps)
+            normal = {0, 1, 0};
+        else if (distance_to_bounds[1].z < eps)
+            normal = {0, 0, 1};
+        attr.normal = {normal.x, normal.y, normal.z};
+
+        return is_a_valid_hit(ray, thit, normal, state);
+    }
+    return false;
+}
+
+}
@@ -0,0 +1,344 @@
+#include "CPU/BVH.h"
+
+#include "RaytracingScene.h"
+
+#include <algorithm>
+#include <array>
+#include <numeric>
+
+namespace CPU
+{
+
+namespace
+{
+
+// Below this depth splits stop following SAH and halve the primitives instead,
+// so the tree depth stays within BVH::MAX_DEPTH even for degenerate inputs.
+u32 constexpr MEDIAN_SPLIT_DEPTH = BVH::MAX_DEPTH - 32;
+
+struct BuildTask
+{
+    u32 node_index = 0;
+    u32 begin = 0;
+    u32 end = 0;
+    u32 depth = 0;
+};
+
+struct Bin
+{
+    AABB bounds = {};
+    u32 primitive_count = 0;
+};
+
+struct Split
+{
+    float cost = INFINITY_F;
+    u32 axis = 0;
+    u32 bin = 0; // Primitives in bins below this one go to the left child.
+};
+
+u32 largest_axis(float3 const extent)
+{
+    if (extent.x >= extent.y && extent.x >= extent.z)
+    {
+        return 0;
+    }
+
+    return extent.y >= extent.z ? 1 : 2;
+}
+
+u32 bin_index(float const centroid, float const centroid_min, float const bin_scale, u32 const bin_count)
+{
+    return std::min(bin_count - 1, static_cast<u32>((centroid - centroid_min) * bin_scale));
+}
+
+}
+
+void BVH::build(std::span<AABB const> const primitive_bounds, BVHBuildSettings const& settings)
+{
+    m_settings = settings;
+    m_settings.max_leaf_size = std::max(1u, m_settings.max_leaf_size);
+    m_settings.bin_count = std::clamp(m_settings.bin_count, 2u, MAX_BIN_COUNT);
+
+    u32 const primitive_count = static_cast<u32>(primitive_bounds.size());
+
+    m_nodes.clear();
+    m_primitive_indices.resize(primitive_count);
+    std::iota(m_primitive_indices.begin(), m_primitive_indices.end(), 0);
+    m_sah_cost = 0.0f;
+    m_built_sah_cost = 0.0f;
+
+    if (primitive_count == 0)
+    {
+        return;
+    }
+
+    std::vector<float3> centroids(primitive_count);
+    for (u32 i = 0; i < primitive_count; i++)
+    {
+        centroids[i] = primitive_bounds[i].centroid();
+    }
+
+    // Every leaf holds at least one primitive, so a binary tree never has more nodes than this.
+    m_nodes.reserve(2 * primitive_count - 1);
+    m_nodes.emplace_back();
+
+    std::vector<BuildTask> tasks = {{0, 0, primitive_count, 0}};
+    std::array<Bin, MAX_BIN_COUNT> bins = {};
+    std::array<float, MAX_BIN_COUNT> right_costs = {};
+
+    while (!tasks.empty())
+    {
+        BuildTask const task = tasks.back();
+        tasks.pop_back();
+
+        auto const first = m_primitive_indices.begin() + task.begin;
+        auto const last = m_primitive_indices.begin() + task.end;
+        u32 const count = task.end - task.begin;
+
+        AABB bounds = {};
+        AABB centroid_bounds = {};
+        for (auto it = first; it != last; ++it)
+        {
+            bounds.grow(primitive_bounds[*it]);
+            centroid_bounds.grow(centroids[*it]);
+        }
+
+        m_nodes[task.node_index].aabb_min = bounds.min;
+        m_nodes[task.node_index].aabb_max = bounds.max;
+
+        auto const make_leaf = [&] {
+            m_nodes[task.node_index].index = task.begin;
+            m_nodes[task.node_index].primitive_count = count;
+        };
+
+        if (count == 1)
+        {
+            make_leaf();
+            continue;
+        }
+
+        float3 const centroid_extent = centroid_bounds.extent();
+        bool const are_centroids_coincident = centroid_extent.x <= 0.0f && centroid_extent.y <= 0.0f && centroid_extent.z <= 0.0f;
+        if (are_centroids_coincident && count <= m_settings.max_leaf_size)
+        {
+            make_leaf();
+            continue;
+        }
+
+        auto mid = first;
+
+        if (!are_centroids_coincident && task.depth < MEDIAN_SPLIT_DEPTH)
+        {
+            // Find the cheapest bin boundary on all axes.
+            float const parent_area = bounds.surface_area();
+            float const inv_parent_area = parent_area > 0.0f ? 1.0f / parent_area : 0.0f;
+            Split best_split = {};
+
+            for (u32 axis = 0; axis < 3; axis++)
+            {
+                if (centroid_extent[axis] <= 0.0f)
+                {
+                    continue;
+                }
+
+                float const bin_scale = static_cast<float>(m_settings.bin_count) / centroid_extent[axis];
+                std::fill_n(bins.begin(), m_settings.bin_count, Bin {});
+
+                for (auto it = first; it != last; ++it)
+                {
+                    Bin& bin = bins[bin_index(centroids[*it][axis], centroid_bounds.min[axis], bin_scale, m_settings.bin_count)];
+                    bin.bounds.grow(primitive_bounds[*it]);
+                    bin.primitive_count++;
+                }
+
+                // right_costs[i] is the area-weighted primitive count of bins i and above.
+                AABB right_bounds = {};
+                u32 right_count = 0;
+                for (u32 i = m_settings.bin_count - 1; i > 0; i--)
+                {
+                    right_bounds.grow(bins[i].bounds);
+                    right_count += bins[i].primitive_count;
+                    right_costs[i] = right_bounds.surface_area() * static_cast<float>(right_count);
+                }
+
+                AABB left_bounds = {};
+                u32 left_count = 0;
+                for (u32 i = 1; i < m_settings.bin_count; i++)
+                {
+                    left_bounds.grow(bins[i - 1].bounds);
+                    left_count += bins[i - 1].primitive_count;
+
+                    float const cost = m_settings.traversal_cost
+                                     + m_settings.intersection_cost * inv_parent_area
+                                           * (left_bounds.surface_area() * static_cast<float>(left_count) + right_costs[i]);
+                    if (cost < best_split.cost)
+                    {
+                        best_split = {cost, axis, i};
+                    }
+                }
+            }
+
+            float const leaf_cost = m_settings.intersection_cost * static_cast<float>(count);
+            if (count <= m_settings.max_leaf_size && leaf_cost <= best_split.cost)
+            {
+                make_leaf();
+                continue;
+            }
+
+            u32 const axis = best_split.axis;
+            float const bin_scale = static_cast<float>(m_settings.bin_count) / centroid_extent[axis];
+            mid = std::partition(first, last, [&](u32 const primitive_index) {
+                return bin_index(centroids[primitive_index][axis], centroid_bounds.min[axis], bin_scale, m_settings.bin_count)
+                     < best_split.bin;
+            });
+        }
+
+        // Median split when SAH is not used or could not separate the primitives.
+        if (mid == first || mid == last)
+        {
+            u32 const axis = largest_axis(centroid_extent);
+            mid = first + count / 2;
+            std::nth_element(first, mid, last, [&](u32 const a, u32 const b) {
+                return centroids[a][axis] < centroids[b][axis];
+            });
+        }
+
+        u32 const left_index = static_cast<u32>(m_nodes.size());
+        m_nodes.emplace_back();
+        m_nodes.emplace_back();
+        m_nodes[task.node_index].index = left_index;
+
+        u32 const split = static_cast<u32>(mid - m_primitive_indices.begin());
+        tasks.push_back({left_index + 1, split, task.end, task.depth + 1});
+        tasks.push_back({left_index, task.begin, split, task.depth + 1});
+    }
+
+    m_sah_cost = calculate_sah_cost();
+    m_built_sah_cost = m_sah_cost;
+}
+
+void BVH::refit(std::span<AABB const> const primitive_bounds)
+{
+    // Children follow their parents, so walking backwards visits both children before their parent.
+    for (u32 node_index = static_cast<u32>(m_nodes.size()); node_index-- > 0;)
+    {
+        Node& node = m_nodes[node_index];
+        AABB bounds = {};
+
+        if (node.is_leaf())
+        {
+            for (u32 i = node.index; i < node.index + node.primitive_count; i++)
+            {
+                bounds.grow(primitive_bounds[m_primitive_indices[i]]);
+            }
+        }
+        else
+        {
+            bounds = {m_nodes[node.index].aabb_min, m_nodes[node.index].aabb_max};
+            bounds.grow(AABB {m_nodes[node.index + 1].aabb_min, m_nodes[node.index + 1].aabb_max});
+        }
+
+        node.aabb_min = bounds.min;
+        node.aabb_max = bounds.max;
+    }
+
+    m_sah_cost = calculate_sah_cost();
+}
+
+bool BVH::update(std::span<AABB const> const primitive_bounds, float const max_sah_cost_growth)
+{
+    if (primitive_bounds.size() != m_primitive_indices.size())
+    {
+        build(primitive_bounds, m_settings);
+        return true;
+    }
+
+    refit(primitive_bounds);
+
+    if (get_sah_cost_growth() > max_sah_cost_growth)
+    {
+        build(primitive_bounds, m_settings);
+        return true;
+    }
+
+    return false;
+}
+
+float BVH::get_sah_cost() const
+{
+    return m_sah_cost;
+}
+
+float BVH::get_sah_cost_growth() const
+{
+    if (m_built_sah_cost <= 0.0f)
+    {
+        return 0.0f;
+    }
+
+    return m_sah_cost / m_built_sah_cost - 1.0f;
+}
+
+float BVH::calculate_sah_cost() const
+{
+    if (m_nodes.empty())
+    {
+        return 0.0f;
+    }
+
+    float cost = 0.0f;
+    for (Node const& node : m_nodes)
+    {
+        float const area = AABB {node.aabb_min, node.aabb_max}.surface_area();
+        cost += area
+              * (node.is_leaf() ? m_settings.intersection_cost * static_cast<float>(node.primitive_count) : m_settings.traversal_cost);
+    }
+
+    float const root_area = get_bounds().surface_area();
+    return root_area > 0.0f ? cost / root_area : cost;
+}
+
+bool BVH::is_empty() const
+{
+    return m_nodes.empty();
+}
+
+AABB BVH::get_bounds() const
+{
+    if (m_nodes.empty())
+    {
+        return {};
+    }
+
+    return {m_nodes[0].aabb_min, m_nodes[0].aabb_max};
+}
+
+u32 BVH::get_primitive_count() const
+{
+    return static_cast<u32>(m_primitive_indices.size());
+}
+
+std::vector<BVH::Node> const& BVH::get_nodes() const
+{
+    return m_nodes;
+}
+
+std::vector<u32> const& BVH::get_primitive_indices() const
+{
+    return m_primitive_indices;
+}
+
+std::vector<AABB> calculate_primitive_bounds(std::span<RaytracingAABB const> const aabbs)
+{
+    std::vector<AABB> bounds(aabbs.size());
+
+    for (u32 i = 0; i < bounds.size(); i++)
+    {
+        bounds[i] = {{aabbs[i].min.x, aabbs[i].min.y, aabbs[i].min.z}, {aabbs[i].max.x, aabbs[i].max.y, aabbs[i].max.z}};
+    }
+
+    return bounds;
+}
+
+}
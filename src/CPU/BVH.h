@@ -0,0 +1,342 @@
+#pragma once
+
+#include "AK/Types.h"
+#include "ConstantBuffers.h"
+#include "CPU/AABB.h"
+#include "CPU/RayPacket.h"
+#include "CPU/RaytracingShaderHelper.h"
+#include "CPU/ShaderMath.h"
+
+#include <bit>
+#include <span>
+#include <vector>
+
+struct RaytracingAABB;
+
+namespace CPU
+{
+
+struct BVHBuildSettings
+{
+    // Nodes with at most this many primitives become leaves once splitting them stops paying off in SAH cost.
+    u32 max_leaf_size = 4;
+
+    // Number of centroid bins evaluated per axis and node. Clamped to <2, BVH::MAX_BIN_COUNT>.
+    u32 bin_count = 16;
+
+    // SAH cost of visiting a node and of intersecting a single primitive.
+    float traversal_cost = 1.0f;
+    float intersection_cost = 1.0f;
+};
+
+// Bounding volume hierarchy over primitive bounds, built with binned SAH.
+// CPU counterpart of a bottom-level acceleration structure: primitives are identified by their index in the build input,
+// which for procedural geometry is also the geometry index used for hit group indexing.
+// Ref: Wald, "On fast Construction of SAH-based Bounding Volume Hierarchies", 2007
+class BVH
+{
+public:
+    // Deepest tree the traversal stack can hold. Builds switch to median splits well before reaching it.
+    static u32 constexpr MAX_DEPTH = 64;
+    static u32 constexpr MAX_BIN_COUNT = 64;
+
+    struct Node
+    {
+        float3 aabb_min;
+        // First child for interior nodes, the second child follows it. Children are always stored after their parent.
+        // First primitive for leaves.
+        u32 index = 0;
+        float3 aabb_max;
+        u32 primitive_count = 0; // Zero for interior nodes.
+
+        [[nodiscard]] bool is_leaf() const
+        {
+            return primitive_count > 0;
+        }
+    };
+
+    static_assert(sizeof(Node) == 32, "Two nodes should share a cache line.");
+
+    void build(std::span<AABB const> const primitive_bounds, BVHBuildSettings const& settings = {});
+
+    // Recomputes node bounds bottom-up from new primitive bounds in O(n), keeping the tree topology and primitive order.
+    // The primitives have to be the ones of the last build(), in the same order. Cheap, but the tree degrades
+    // as primitives move away from where they were when it was built, see get_sah_cost_growth().
+    void refit(std::span<AABB const> const primitive_bounds);
+
+    // Refits, and rebuilds with the last build settings instead once refitting has grown the SAH cost by more than
+    // max_sah_cost_growth over the last build, e.g. 0.25 for 25%. Returns true if it rebuilt.
+    bool update(std::span<AABB const> const primitive_bounds, float const max_sah_cost_growth);
+
+    // Expected cost of tracing a ray through the tree, relative to the root's surface area.
+    [[nodiscard]] float get_sah_cost() const;
+
+    // Relative SAH cost change since the last build, 0 right after it.
+    [[nodiscard]] float get_sah_cost_growth() const;
+
+    // Closest hit query. intersect_primitive(primitive_index, state) tests a primitive within <state.t_min, state.t_current>,
+    // shrinks state.t_current when it accepts a hit and returns whether it did. Nodes beyond state.t_current are skipped,
+    // and nearer children are visited first. Returns true if any primitive accepted a hit.
+    template<typename IntersectPrimitive>
+    bool intersect_closest(Ray const& ray, RayState& state, IntersectPrimitive&& intersect_primitive) const;
+
+    // Any hit query, same as intersect_closest(), but returns as soon as a primitive accepts a hit.
+    template<typename IntersectPrimitive>
+    bool intersect_any(Ray const& ray, RayState& state, IntersectPrimitive&& intersect_primitive) const;
+
+    // Closest hit query for the rays of a packet whose lanes are set in lane_mask, traced together so every node is tested
+    // against all of them at once. intersect_primitive(primitive_index, lane_mask) tests a primitive against the rays in
+    // lane_mask within <packet.t_min, packet.t_max> of their lanes, shrinks packet.t_max of the lanes that accept a hit and
+    // returns their mask. Nodes are visited while any of the rays still overlaps them, in the order the first of them
+    // would reach them. Returns the mask of the lanes that accepted any hit.
+    template<u32 N, typename IntersectPrimitive>
+    u32 intersect_closest(RayPacket<N>& packet, u32 const lane_mask, IntersectPrimitive&& intersect_primitive) const;
+
+    // Any hit query for a packet, same as above, but rays stop being traced once they accepted a hit.
+    template<u32 N, typename IntersectPrimitive>
+    u32 intersect_any(RayPacket<N>& packet, u32 const lane_mask, IntersectPrimitive&& intersect_primitive) const;
+
+    [[nodiscard]] bool is_empty() const;
+
+    // Bounds of all primitives, empty if there are none.
+    [[nodiscard]] AABB get_bounds() const;
+    [[nodiscard]] u32 get_primitive_count() const;
+    [[nodiscard]] std::vector<Node> const& get_nodes() const;
+
+    // Primitive indices in leaf order. Leaves reference ranges of this array.
+    [[nodiscard]] std::vector<u32> const& get_primitive_indices() const;
+
+private:
+    template<bool any_hit, typename IntersectPrimitive>
+    bool traverse(Ray const& ray, RayState& state, IntersectPrimitive& intersect_primitive) const;
+
+    template<bool any_hit, u32 N, typename IntersectPrimitive>
+    u32 traverse(RayPacket<N>& packet, u32 const lane_mask, IntersectPrimitive& intersect_primitive) const;
+
+    [[nodiscard]] float calculate_sah_cost() const;
+
+    BVHBuildSettings m_settings = {};
+    float m_sah_cost = 0.0f;
+    float m_built_sah_cost = 0.0f;
+
+    std::vector<Node> m_nodes = {};
+    std::vector<u32> m_primitive_indices = {};
+};
+
+// Bounds of procedural geometry, one primitive per D3D12_RAYTRACING_AABB.
+std::vector<AABB> calculate_primitive_bounds(std::span<RaytracingAABB const> const aabbs);
+
+// Bounds of indexed triangle geometry, one primitive per three indices.
+template<typename Index>
+std::vector<AABB> calculate_primitive_bounds(std::span<Vertex const> const vertices, std::span<Index const> const indices)
+{
+    std::vector<AABB> bounds(indices.size() / 3);
+
+    for (u32 i = 0; i < bounds.size(); i++)
+    {
+        for (u32 j = 0; j < 3; j++)
+        {
+            XMFLOAT3 const& position = vertices[indices[3 * i + j]].position;
+            bounds[i].grow(float3 {position.x, position.y, position.z});
+        }
+    }
+
+    return bounds;
+}
+
+template<typename IntersectPrimitive>
+bool BVH::intersect_closest(Ray const& ray, RayState& state, IntersectPrimitive&& intersect_primitive) const
+{
+    return traverse<false>(ray, state, intersect_primitive);
+}
+
+template<typename IntersectPrimitive>
+bool BVH::intersect_any(Ray const& ray, RayState& state, IntersectPrimitive&& intersect_primitive) const
+{
+    return traverse<true>(ray, state, intersect_primitive);
+}
+
+template<u32 N, typename IntersectPrimitive>
+u32 BVH::intersect_closest(RayPacket<N>& packet, u32 const lane_mask, IntersectPrimitive&& intersect_primitive) const
+{
+    return traverse<false>(packet, lane_mask, intersect_primitive);
+}
+
+template<u32 N, typename IntersectPrimitive>
+u32 BVH::intersect_any(RayPacket<N>& packet, u32 const lane_mask, IntersectPrimitive&& intersect_primitive) const
+{
+    return traverse<true>(packet, lane_mask, intersect_primitive);
+}
+
+template<bool any_hit, typename IntersectPrimitive>
+bool BVH::traverse(Ray const& ray, RayState& state, IntersectPrimitive& intersect_primitive) const
+{
+    if (m_nodes.empty())
+    {
+        return false;
+    }
+
+    struct StackEntry
+    {
+        u32 node_index;
+        float t_near;
+    };
+
+    SlabRay slab_ray = make_slab_ray(ray, state.t_min, state.t_current);
+
+    StackEntry stack[MAX_DEPTH];
+    u32 stack_size = 0;
+    bool hit_found = false;
+
+    float t_near = 0.0f;
+    if (!ray_aabb_intersection_test(slab_ray, m_nodes[0].aabb_min, m_nodes[0].aabb_max, t_near))
+    {
+        return false;
+    }
+
+    u32 node_index = 0;
+    while (true)
+    {
+        Node const& node = m_nodes[node_index];
+
+        if (node.is_leaf())
+        {
+            for (u32 i = node.index; i < node.index + node.primitive_count; i++)
+            {
+                if (intersect_primitive(m_primitive_indices[i], state))
+                {
+                    hit_found = true;
+
+                    if constexpr (any_hit)
+                    {
+                        return true;
+                    }
+                }
+            }
+
+            slab_ray.t_max = state.t_current;
+        }
+        else
+        {
+            Node const& left = m_nodes[node.index];
+            Node const& right = m_nodes[node.index + 1];
+
+            float t_left = 0.0f;
+            float t_right = 0.0f;
+            bool const hit_left = ray_aabb_intersection_test(slab_ray, left.aabb_min, left.aabb_max, t_left);
+            bool const hit_right = ray_aabb_intersection_test(slab_ray, right.aabb_min, right.aabb_max, t_right);
+
+            if (hit_left && hit_right)
+            {
+                // Visit the nearer child first, its hits can cull the farther one.
+                bool const left_first = t_left <= t_right;
+                stack[stack_size++] = left_first ? StackEntry {node.index + 1, t_right} : StackEntry {node.index, t_left};
+                node_index = left_first ? node.index : node.index + 1;
+                continue;
+            }
+
+            if (hit_left || hit_right)
+            {
+                node_index = hit_left ? node.index : node.index + 1;
+                continue;
+            }
+        }
+
+        // Pop the next node that can still contain a hit closer than the current one.
+        bool found_next = false;
+        while (stack_size > 0)
+        {
+            StackEntry const entry = stack[--stack_size];
+            if (entry.t_near <= slab_ray.t_max)
+            {
+                node_index = entry.node_index;
+                found_next = true;
+                break;
+            }
+        }
+
+        if (!found_next)
+        {
+            break;
+        }
+    }
+
+    return hit_found;
+}
+
+template<bool any_hit, u32 N, typename IntersectPrimitive>
+u32 BVH::traverse(RayPacket<N>& packet, u32 const lane_mask, IntersectPrimitive& intersect_primitive) const
+{
+    if (m_nodes.empty() || lane_mask == 0)
+    {
+        return 0;
+    }
+
+    // Lanes that were active when the node got pushed. Nodes are tested when popped, against the rays' current t_max,
+    // so hits found in the meantime still cull them.
+    struct StackEntry
+    {
+        u32 node_index;
+        u32 lane_mask;
+    };
+
+    StackEntry stack[MAX_DEPTH + 1];
+    u32 stack_size = 0;
+    stack[stack_size++] = {0, lane_mask};
+
+    u32 active_mask = lane_mask;
+    u32 hit_mask = 0;
+
+    while (stack_size > 0)
+    {
+        StackEntry const entry = stack[--stack_size];
+        Node const& node = m_nodes[entry.node_index];
+
+        float3 const aabb[2] = {node.aabb_min, node.aabb_max};
+        float t_near[N];
+        u32 const mask = ray_packet_aabb_intersection_test(packet, aabb, t_near) & entry.lane_mask & active_mask;
+        if (mask == 0)
+        {
+            continue;
+        }
+
+        if (node.is_leaf())
+        {
+            for (u32 i = node.index; i < node.index + node.primitive_count; i++)
+            {
+                u32 const hits = intersect_primitive(m_primitive_indices[i], mask & active_mask);
+                hit_mask |= hits;
+
+                if constexpr (any_hit)
+                {
+                    active_mask &= ~hits;
+                    if ((mask & active_mask) == 0)
+                    {
+                        break;
+                    }
+                }
+            }
+
+            continue;
+        }
+
+        // Order the children along the axis they are furthest apart on, by the direction of the first active ray.
+        // Coherent rays mostly agree on it, and a shared order keeps the packet together.
+        Node const& left = m_nodes[node.index];
+        Node const& right = m_nodes[node.index + 1];
+        float3 const separation = (right.aabb_min + right.aabb_max) - (left.aabb_min + left.aabb_max);
+        float3 const distance = abs(separation);
+        u32 const axis = distance.x > distance.y ? (distance.x > distance.z ? 0 : 2) : (distance.y > distance.z ? 1 : 2);
+
+        u32 const lane = static_cast<u32>(std::countr_zero(mask));
+        float const* inv_direction[3] = {packet.inv_direction_x, packet.inv_direction_y, packet.inv_direction_z};
+        bool const left_first = (separation[axis] >= 0.0f) == (inv_direction[axis][lane] >= 0.0f);
+
+        stack[stack_size++] = {left_first ? node.index + 1 : node.index, mask};
+        stack[stack_size++] = {left_first ? node.index : node.index + 1, mask};
+    }
+
+    return hit_mask;
+}
+
+}
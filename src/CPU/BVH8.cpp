@@ -0,0 +1,226 @@
+#include "CPU/BVH8.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace CPU
+{
+
+namespace
+{
+
+struct CollapseTask
+{
+    u32 node_index = 0;
+    u32 bvh_node_index = 0;
+
+    // Non-zero for a leaf of the binary BVH with more primitives than a leaf child holds. The node gets leaf children
+    // over slices of the primitives instead, all with the leaf's bounds.
+    u32 first_primitive = 0;
+    u32 primitive_count = 0;
+};
+
+AABB node_bounds(BVH::Node const& node)
+{
+    return {node.aabb_min, node.aabb_max};
+}
+
+// Smallest exponent whose 255 steps starting at origin reach max, so every child bound fits in a byte.
+i8 quantization_exponent(float const origin, float const max)
+{
+    float const extent = max - origin;
+    i32 exponent = -126;
+    if (extent > 0.0f)
+    {
+        exponent = std::clamp(static_cast<i32>(std::ceil(std::log2(extent / 255.0f))), -126, 127);
+    }
+
+    // log2() may round down, and origin + 255 * scale rounds too.
+    while (exponent < 127 && Detail::dequantize(255, origin, Detail::quantization_scale(static_cast<i8>(exponent))) < max)
+    {
+        exponent++;
+    }
+
+    return static_cast<i8>(exponent);
+}
+
+// Quantized bounds of a child, rounded outwards so the decoded box always contains the child.
+void quantize(float const origin, float const scale, float const min, float const max, u8& q_min, u8& q_max)
+{
+    i32 lo = std::clamp(static_cast<i32>(std::floor((min - origin) / scale)), 0, 255);
+    while (lo > 0 && Detail::dequantize(static_cast<u8>(lo), origin, scale) > min)
+    {
+        lo--;
+    }
+
+    i32 hi = std::clamp(static_cast<i32>(std::ceil((max - origin) / scale)), 0, 255);
+    while (hi < 255 && Detail::dequantize(static_cast<u8>(hi), origin, scale) < max)
+    {
+        hi++;
+    }
+
+    q_min = static_cast<u8>(lo);
+    q_max = static_cast<u8>(hi);
+}
+
+// Node with child_count children within bounds, with the unused children masked out.
+BVH8::Node make_node(AABB const& bounds, u32 const child_count)
+{
+    BVH8::Node node = {};
+    node.origin = bounds.min;
+    node.child_count = static_cast<u8>(child_count);
+
+    for (u32 axis = 0; axis < 3; axis++)
+    {
+        node.exponent[axis] = quantization_exponent(bounds.min[axis], bounds.max[axis]);
+        for (u32 i = child_count; i < BVH8::WIDTH; i++)
+        {
+            node.q_min[axis][i] = 1;
+            node.q_max[axis][i] = 0;
+        }
+    }
+
+    return node;
+}
+
+// Quantizes the bounds of a child relative to the node's.
+void set_child_bounds(BVH8::Node& node, u32 const child, AABB const& bounds)
+{
+    for (u32 axis = 0; axis < 3; axis++)
+    {
+        float const scale = Detail::quantization_scale(node.exponent[axis]);
+        quantize(node.origin[axis], scale, bounds.min[axis], bounds.max[axis], node.q_min[axis][child], node.q_max[axis][child]);
+    }
+}
+
+}
+
+void BVH8::build(BVH const& bvh)
+{
+    m_nodes.clear();
+    m_primitive_indices = bvh.get_primitive_indices();
+
+    if (bvh.is_empty())
+    {
+        return;
+    }
+
+    std::vector<BVH::Node> const& bvh_nodes = bvh.get_nodes();
+
+    m_nodes.emplace_back();
+    std::vector<CollapseTask> tasks = {{0, 0}};
+
+    while (!tasks.empty())
+    {
+        CollapseTask const task = tasks.back();
+        tasks.pop_back();
+
+        BVH::Node const& bvh_node = bvh_nodes[task.bvh_node_index];
+
+        // Leaf children over primitives, split up further through another node if there are too many for one.
+        auto const set_leaf_child = [&](Node& node, u32 const i, u32 const first_primitive, u32 const primitive_count) {
+            if (primitive_count <= MAX_LEAF_SIZE)
+            {
+                node.child_index[i] = first_primitive;
+                node.child_primitive_count[i] = static_cast<u8>(primitive_count);
+                return;
+            }
+
+            node.child_index[i] = static_cast<u32>(m_nodes.size());
+            m_nodes.emplace_back();
+            tasks.push_back({node.child_index[i], task.bvh_node_index, first_primitive, primitive_count});
+        };
+
+        if (task.primitive_count > 0)
+        {
+            u32 const child_count = std::min(WIDTH, (task.primitive_count + MAX_LEAF_SIZE - 1) / MAX_LEAF_SIZE);
+            Node node = make_node(node_bounds(bvh_node), child_count);
+            for (u32 i = 0; i < child_count; i++)
+            {
+                u32 const begin = static_cast<u32>(static_cast<u64>(task.primitive_count) * i / child_count);
+                u32 const end = static_cast<u32>(static_cast<u64>(task.primitive_count) * (i + 1) / child_count);
+                set_child_bounds(node, i, node_bounds(bvh_node));
+                set_leaf_child(node, i, task.first_primitive + begin, end - begin);
+            }
+
+            m_nodes[task.node_index] = node;
+            continue;
+        }
+
+        // Pull grandchildren up until the node is full, always opening the largest interior child,
+        // since it is the one most rays would otherwise visit.
+        u32 children[WIDTH] = {};
+        u32 child_count = 0;
+        if (bvh_node.is_leaf())
+        {
+            children[child_count++] = task.bvh_node_index;
+        }
+        else
+        {
+            children[child_count++] = bvh_node.index;
+            children[child_count++] = bvh_node.index + 1;
+        }
+
+        while (child_count < WIDTH)
+        {
+            u32 largest = WIDTH;
+            float largest_area = -1.0f;
+            for (u32 i = 0; i < child_count; i++)
+            {
+                BVH::Node const& child = bvh_nodes[children[i]];
+                float const area = node_bounds(child).surface_area();
+                if (!child.is_leaf() && area > largest_area)
+                {
+                    largest = i;
+                    largest_area = area;
+                }
+            }
+
+            if (largest == WIDTH)
+            {
+                break;
+            }
+
+            u32 const first_grandchild = bvh_nodes[children[largest]].index;
+            children[largest] = first_grandchild;
+            children[child_count++] = first_grandchild + 1;
+        }
+
+        Node node = make_node(node_bounds(bvh_node), child_count);
+        for (u32 i = 0; i < child_count; i++)
+        {
+            BVH::Node const& child = bvh_nodes[children[i]];
+            set_child_bounds(node, i, node_bounds(child));
+
+            if (child.is_leaf())
+            {
+                set_leaf_child(node, i, child.index, child.primitive_count);
+            }
+            else
+            {
+                node.child_index[i] = static_cast<u32>(m_nodes.size());
+                m_nodes.emplace_back();
+                tasks.push_back({node.child_index[i], children[i]});
+            }
+        }
+
+        m_nodes[task.node_index] = node;
+    }
+}
+
+bool BVH8::is_empty() const
+{
+    return m_nodes.empty();
+}
+
+std::vector<BVH8::Node> const& BVH8::get_nodes() const
+{
+    return m_nodes;
+}
+
+std::vector<u32> const& BVH8::get_primitive_indices() const
+{
+    return m_primitive_indices;
+}
+
+}
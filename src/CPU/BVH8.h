@@ -0,0 +1,210 @@
+#pragma once
+
+#include "AK/Types.h"
+#include "CPU/BVH.h"
+#include "CPU/RayPacket.h"
+#include "CPU/RaytracingShaderHelper.h"
+#include "CPU/SIMD.h"
+#include "CPU/ShaderMath.h"
+
+#include <bit>
+#include <vector>
+
+namespace CPU
+{
+
+// 8-wide BVH collapsed from a binary one, with child bounds quantized to 8 bits per axis relative to the parent's bounds.
+// A node fits in two cache lines, where the eight binary nodes it replaces take four, and all of its children
+// are tested against a ray at once, with AVX2 when the target enables it.
+// Ref: Ylitie et al., "Efficient Incoherent Ray Traversal on GPUs Through Compressed Wide BVHs", HPG 2017
+class BVH8
+{
+public:
+    static u32 constexpr WIDTH = 8;
+
+    // Leaf primitive counts are stored in a byte. Larger leaves of the binary BVH become nodes of leaves over their bounds.
+    static u32 constexpr MAX_LEAF_SIZE = 255;
+
+    struct alignas(64) Node
+    {
+        // Child bounds along an axis are origin + q * 2^exponent, rounded outwards when quantizing.
+        float3 origin;
+        i8 exponent[3] = {};
+        u8 child_count = 0;
+
+        // Children past child_count are masked out of hit tests and hold an inverted box.
+        u8 q_min[3][WIDTH] = {};
+        u8 q_max[3][WIDTH] = {};
+
+        u32 child_index[WIDTH] = {}; // Node index of interior children, first primitive of leaf children.
+        u8 child_primitive_count[WIDTH] = {}; // Zero for interior children.
+    };
+
+    static_assert(sizeof(Node) == 128, "A node should take two cache lines.");
+
+    // Collapses a built binary BVH.
+    void build(BVH const& bvh);
+
+    // Same queries and callback contract as BVH::intersect_closest() and BVH::intersect_any().
+    template<typename IntersectPrimitive>
+    bool intersect_closest(Ray const& ray, RayState& state, IntersectPrimitive&& intersect_primitive) const;
+
+    template<typename IntersectPrimitive>
+    bool intersect_any(Ray const& ray, RayState& state, IntersectPrimitive&& intersect_primitive) const;
+
+    [[nodiscard]] bool is_empty() const;
+    [[nodiscard]] std::vector<Node> const& get_nodes() const;
+    [[nodiscard]] std::vector<u32> const& get_primitive_indices() const;
+
+private:
+    template<bool any_hit, typename IntersectPrimitive>
+    bool traverse(Ray const& ray, RayState& state, IntersectPrimitive& intersect_primitive) const;
+
+    std::vector<Node> m_nodes = {};
+    std::vector<u32> m_primitive_indices = {};
+};
+
+namespace Detail
+{
+
+// 2^exponent, built from its bits. Exponents stay within the normal float range, <-126, 127>.
+inline float quantization_scale(i8 const exponent)
+{
+    return std::bit_cast<float>(static_cast<u32>(exponent + 127) << 23);
+}
+
+inline float dequantize(u8 const q, float const origin, float const scale)
+{
+    // q * scale is exact for a power of two scale, so this rounds once, the same way the SIMD decoding does.
+    return static_cast<float>(q) * scale + origin;
+}
+
+// Dequantizes the bounds of all N children along one axis.
+template<u32 N>
+void dequantize_children(u8 const q[N], float const origin, float const scale, float values[N])
+{
+    if constexpr (SIMD::has_float<N>)
+    {
+        using F = SIMD::Float<N>;
+        F::store(values, F::add(F::mul(F::load_u8(q), F::set1(scale)), F::set1(origin)));
+    }
+    else
+    {
+        for (u32 lane = 0; lane < N; lane++)
+        {
+            values[lane] = dequantize(q[lane], origin, scale);
+        }
+    }
+}
+
+}
+
+// Decodes the quantized bounds of all children of a node, the unused ones into inverted boxes.
+inline void decode_bvh8_children(BVH8::Node const& node, AABBPacket<BVH8::WIDTH>& children)
+{
+    float* const mins[3] = {children.min_x, children.min_y, children.min_z};
+    float* const maxs[3] = {children.max_x, children.max_y, children.max_z};
+
+    for (u32 axis = 0; axis < 3; axis++)
+    {
+        float const scale = Detail::quantization_scale(node.exponent[axis]);
+        Detail::dequantize_children<BVH8::WIDTH>(node.q_min[axis], node.origin[axis], scale, mins[axis]);
+        Detail::dequantize_children<BVH8::WIDTH>(node.q_max[axis], node.origin[axis], scale, maxs[axis]);
+    }
+}
+
+// Tests a ray against all children of a node. Returns a bit mask of the hit children and writes their entry distances,
+// clamped to the ray's t_min, into t_near, the same as ray_aabb_packet_intersection_test(), which it decodes the children for.
+inline u32 ray_bvh8_node_intersection_test(SlabRay const& ray, BVH8::Node const& node, float t_near[BVH8::WIDTH])
+{
+    AABBPacket<BVH8::WIDTH> children;
+    decode_bvh8_children(node, children);
+    return ray_aabb_packet_intersection_test(ray, children, t_near) & ((1u << node.child_count) - 1);
+}
+
+template<typename IntersectPrimitive>
+bool BVH8::intersect_closest(Ray const& ray, RayState& state, IntersectPrimitive&& intersect_primitive) const
+{
+    return traverse<false>(ray, state, intersect_primitive);
+}
+
+template<typename IntersectPrimitive>
+bool BVH8::intersect_any(Ray const& ray, RayState& state, IntersectPrimitive&& intersect_primitive) const
+{
+    return traverse<true>(ray, state, intersect_primitive);
+}
+
+template<bool any_hit, typename IntersectPrimitive>
+bool BVH8::traverse(Ray const& ray, RayState& state, IntersectPrimitive& intersect_primitive) const
+{
+    if (m_nodes.empty())
+    {
+        return false;
+    }
+
+    struct StackEntry
+    {
+        u32 index; // Node index, or first primitive of a leaf.
+        u32 primitive_count; // Zero for nodes.
+        float t_near;
+    };
+
+    // Every level replaces one entry with at most WIDTH of them.
+    StackEntry stack[BVH::MAX_DEPTH * (WIDTH - 1) + 1];
+    u32 stack_size = 0;
+    stack[stack_size++] = {0, 0, state.t_min};
+
+    SlabRay slab_ray = make_slab_ray(ray, state.t_min, state.t_current);
+    bool hit_found = false;
+
+    while (stack_size > 0)
+    {
+        StackEntry const entry = stack[--stack_size];
+        if (entry.t_near > slab_ray.t_max)
+        {
+            continue;
+        }
+
+        if (entry.primitive_count > 0)
+        {
+            for (u32 i = entry.index; i < entry.index + entry.primitive_count; i++)
+            {
+                if (intersect_primitive(m_primitive_indices[i], state))
+                {
+                    hit_found = true;
+
+                    if constexpr (any_hit)
+                    {
+                        return true;
+                    }
+                }
+            }
+
+            slab_ray.t_max = state.t_current;
+            continue;
+        }
+
+        Node const& node = m_nodes[entry.index];
+        float t_near[WIDTH];
+        u32 mask = ray_bvh8_node_intersection_test(slab_ray, node, t_near);
+
+        // Push hit children from the farthest to the nearest, so the nearest one gets popped first.
+        u32 const first_entry = stack_size;
+        for (; mask != 0; mask &= mask - 1)
+        {
+            u32 const child = static_cast<u32>(std::countr_zero(mask));
+            StackEntry const child_entry = {node.child_index[child], node.child_primitive_count[child], t_near[child]};
+
+            u32 i = stack_size++;
+            for (; i > first_entry && stack[i - 1].t_near < child_entry.t_near; i--)
+            {
+                stack[i] = stack[i - 1];
+            }
+            stack[i] = child_entry;
+        }
+    }
+
+    return hit_found;
+}
+
+}
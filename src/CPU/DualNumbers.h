@@ -0,0 +1,246 @@
+#pragma once
+
+#include "CPU/ShaderMath.h"
+
+#include <algorithm>
+#include <cmath>
+
+// Forward mode automatic differentiation with respect to a position, on top of the HLSL-like vector library.
+// A dual carries a value along with its gradient, so a function written over duals returns both from a single evaluation.
+// Piecewise functions, like min(), max() and abs(), differentiate the branch their value takes.
+// Ref: Griewank and Walther, "Evaluating Derivatives", SIAM 2008
+namespace CPU
+{
+
+struct dual
+{
+    float value = 0.0f;
+    float3 gradient;
+};
+
+struct dual2
+{
+    dual x;
+    dual y;
+};
+
+struct dual3
+{
+    dual x;
+    dual y;
+    dual z;
+
+    [[nodiscard]] dual2 xz() const
+    {
+        return {x, z};
+    }
+};
+
+// Seeds the position everything gets differentiated with respect to.
+inline dual3 make_dual3(float3 const p)
+{
+    return {{p.x, {1, 0, 0}}, {p.y, {0, 1, 0}}, {p.z, {0, 0, 1}}};
+}
+
+// dual
+
+inline dual operator+(dual const a, dual const b)
+{
+    return {a.value + b.value, a.gradient + b.gradient};
+}
+
+inline dual operator-(dual const a, dual const b)
+{
+    return {a.value - b.value, a.gradient - b.gradient};
+}
+
+inline dual operator*(dual const a, dual const b)
+{
+    return {a.value * b.value, a.gradient * b.value + a.value * b.gradient};
+}
+
+inline dual operator+(dual const a, float const b)
+{
+    return {a.value + b, a.gradient};
+}
+
+inline dual operator-(dual const a, float const b)
+{
+    return {a.value - b, a.gradient};
+}
+
+inline dual operator+(float const a, dual const b)
+{
+    return {a + b.value, b.gradient};
+}
+
+inline dual operator*(dual const a, float const b)
+{
+    return {a.value * b, a.gradient * b};
+}
+
+inline dual operator*(float const a, dual const b)
+{
+    return {a * b.value, a * b.gradient};
+}
+
+inline dual operator/(dual const a, float const b)
+{
+    return a * (1.0f / b);
+}
+
+inline dual operator-(dual const a)
+{
+    return {-a.value, -a.gradient};
+}
+
+inline dual min(dual const a, dual const b)
+{
+    return a.value <= b.value ? a : b;
+}
+
+inline dual max(dual const a, dual const b)
+{
+    return a.value >= b.value ? a : b;
+}
+
+inline dual min(dual const a, float const b)
+{
+    return a.value <= b ? a : dual {b, {}};
+}
+
+inline dual max(dual const a, float const b)
+{
+    return a.value >= b ? a : dual {b, {}};
+}
+
+inline dual abs(dual const a)
+{
+    return a.value < 0.0f ? -a : a;
+}
+
+// The derivative is infinite at 0, where the gradient is left at zero.
+inline dual sqrt(dual const a)
+{
+    float const value = std::sqrt(a.value);
+    return {value, value > 0.0f ? a.gradient * (0.5f / value) : float3 {}};
+}
+
+inline dual pow(dual const a, float const b)
+{
+    float const value = std::pow(a.value, b);
+    return {value, a.value != 0.0f ? a.gradient * (b * value / a.value) : float3 {}};
+}
+
+inline dual sin(dual const a)
+{
+    return {std::sin(a.value), a.gradient * std::cos(a.value)};
+}
+
+inline dual cos(dual const a)
+{
+    return {std::cos(a.value), a.gradient * -std::sin(a.value)};
+}
+
+inline dual atan2(dual const y, dual const x)
+{
+    float const r2 = x.value * x.value + y.value * y.value;
+    return {std::atan2(y.value, x.value), r2 > 0.0f ? (x.value * y.gradient - y.value * x.gradient) / r2 : float3 {}};
+}
+
+// Subtracts a piecewise constant, so the gradient passes through unchanged.
+inline dual fmod(dual const a, float const b)
+{
+    return {std::fmod(a.value, b), a.gradient};
+}
+
+// dual2
+
+inline dual2 operator-(dual2 const a, float2 const b)
+{
+    return {a.x - b.x, a.y - b.y};
+}
+
+inline dual2 operator*(dual2 const a, dual2 const b)
+{
+    return {a.x * b.x, a.y * b.y};
+}
+
+inline dual2 abs(dual2 const a)
+{
+    return {abs(a.x), abs(a.y)};
+}
+
+inline dual2 max(dual2 const a, float const b)
+{
+    return {max(a.x, b), max(a.y, b)};
+}
+
+inline dual dot(dual2 const a, dual2 const b)
+{
+    return a.x * b.x + a.y * b.y;
+}
+
+inline dual dot(dual2 const a, float2 const b)
+{
+    return a.x * b.x + a.y * b.y;
+}
+
+inline dual length(dual2 const a)
+{
+    return sqrt(dot(a, a));
+}
+
+// dual3
+
+inline dual3 operator+(dual3 const a, float3 const b)
+{
+    return {a.x + b.x, a.y + b.y, a.z + b.z};
+}
+
+inline dual3 operator-(dual3 const a, float3 const b)
+{
+    return {a.x - b.x, a.y - b.y, a.z - b.z};
+}
+
+inline dual3 operator+(dual3 const a, float const b)
+{
+    return {a.x + b, a.y + b, a.z + b};
+}
+
+inline dual3 operator*(float const a, dual3 const b)
+{
+    return {a * b.x, a * b.y, a * b.z};
+}
+
+inline dual3 abs(dual3 const a)
+{
+    return {abs(a.x), abs(a.y), abs(a.z)};
+}
+
+inline dual3 max(dual3 const a, float const b)
+{
+    return {max(a.x, b), max(a.y, b), max(a.z, b)};
+}
+
+inline dual3 fmod(dual3 const a, float3 const b)
+{
+    return {fmod(a.x, b.x), fmod(a.y, b.y), fmod(a.z, b.z)};
+}
+
+inline dual dot(dual3 const a, dual3 const b)
+{
+    return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+inline dual length(dual3 const a)
+{
+    return sqrt(dot(a, a));
+}
+
+inline dual length_to_pow2(dual3 const p)
+{
+    return dot(p, p);
+}
+
+}
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+
+// Interval arithmetic, bounding the values a function takes over ranges of its arguments by evaluating it on the ranges
+// themselves. The bounds always hold, but can be loose, as every operation treats its operands as independent of each other.
+// Bounds get rounded to the nearest float like any value, so they can be off by an ulp or so.
+// Ref: Moore, "Interval Analysis", Prentice-Hall 1966
+namespace CPU
+{
+
+struct interval
+{
+    float lower = 0.0f;
+    float upper = 0.0f;
+};
+
+inline interval operator+(interval const a, interval const b)
+{
+    return {a.lower + b.lower, a.upper + b.upper};
+}
+
+inline interval operator-(interval const a, interval const b)
+{
+    return {a.lower - b.upper, a.upper - b.lower};
+}
+
+inline interval operator-(interval const a)
+{
+    return {-a.upper, -a.lower};
+}
+
+inline interval operator*(interval const a, interval const b)
+{
+    float const p0 = a.lower * b.lower;
+    float const p1 = a.lower * b.upper;
+    float const p2 = a.upper * b.lower;
+    float const p3 = a.upper * b.upper;
+    return {std::min(std::min(p0, p1), std::min(p2, p3)), std::max(std::max(p0, p1), std::max(p2, p3))};
+}
+
+// Unbounded when b contains zero.
+inline interval operator/(interval const a, interval const b)
+{
+    if (b.lower <= 0.0f && b.upper >= 0.0f)
+    {
+        return {-INFINITY, INFINITY};
+    }
+    return a * interval {1.0f / b.upper, 1.0f / b.lower};
+}
+
+inline interval min(interval const a, interval const b)
+{
+    return {std::min(a.lower, b.lower), std::min(a.upper, b.upper)};
+}
+
+inline interval max(interval const a, interval const b)
+{
+    return {std::max(a.lower, b.lower), std::max(a.upper, b.upper)};
+}
+
+inline interval abs(interval const a)
+{
+    if (a.lower >= 0.0f)
+    {
+        return a;
+    }
+    if (a.upper <= 0.0f)
+    {
+        return -a;
+    }
+    return {0.0f, std::max(-a.lower, a.upper)};
+}
+
+// Negative values have no square root, and get left out.
+inline interval sqrt(interval const a)
+{
+    return {std::sqrt(std::max(a.lower, 0.0f)), std::sqrt(std::max(a.upper, 0.0f))};
+}
+
+// The values at the ends, extended to 1 and -1 where the interval contains a peak, at pi/2 + 2k pi, or a trough, at -pi/2 + 2k pi.
+inline interval sin(interval const a)
+{
+    float constexpr pi = std::numbers::pi_v<float>;
+    if (!(a.upper - a.lower < 2.0f * pi))
+    {
+        return {-1.0f, 1.0f};
+    }
+
+    float const sin_lower = std::sin(a.lower);
+    float const sin_upper = std::sin(a.upper);
+    float const peak = std::ceil((a.lower - 0.5f * pi) / (2.0f * pi)) * (2.0f * pi) + 0.5f * pi;
+    float const trough = std::ceil((a.lower + 0.5f * pi) / (2.0f * pi)) * (2.0f * pi) - 0.5f * pi;
+    return {trough <= a.upper ? -1.0f : std::min(sin_lower, sin_upper), peak <= a.upper ? 1.0f : std::max(sin_lower, sin_upper)};
+}
+
+inline interval cos(interval const a)
+{
+    float constexpr half_pi = 0.5f * std::numbers::pi_v<float>;
+    return sin(interval {a.lower + half_pi, a.upper + half_pi});
+}
+
+// fmod() has the sign of a and a magnitude below both |a|'s and |b|'s. Where all of a divides by a constant b into the same
+// whole number, it is a minus a constant, and the ends bound it exactly.
+inline interval fmod(interval const a, interval const b)
+{
+    if (b.lower == b.upper && b.lower != 0.0f && std::trunc(a.lower / b.lower) == std::trunc(a.upper / b.lower))
+    {
+        return {std::fmod(a.lower, b.lower), std::fmod(a.upper, b.lower)};
+    }
+
+    float const magnitude = std::max(std::abs(b.lower), std::abs(b.upper));
+    return {a.lower >= 0.0f ? 0.0f : std::max(a.lower, -magnitude), a.upper <= 0.0f ? 0.0f : std::min(a.upper, magnitude)};
+}
+
+// Where x is positive, atan2() is atan(y / x), which only grows with y / x. Elsewhere, anything in <-pi, pi>.
+inline interval atan2(interval const y, interval const x)
+{
+    float constexpr pi = std::numbers::pi_v<float>;
+    if (x.lower <= 0.0f)
+    {
+        return {-pi, pi};
+    }
+
+    interval const ratio = y / x;
+    return {std::atan(ratio.lower), std::atan(ratio.upper)};
+}
+
+}
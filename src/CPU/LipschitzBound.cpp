@@ -0,0 +1,83 @@
+#include "CPU/LipschitzBound.h"
+
+#include "CPU/ProceduralPrimitivesLibrary.h"
+
+#include <cmath>
+
+namespace CPU
+{
+
+namespace
+{
+
+u32 constexpr SAMPLES_PER_AXIS = 32;
+float constexpr DIFFERENCE_STEP = 0.001f;
+
+template<SignedDistancePrimitive::Enum sd_primitive>
+float gradient_magnitude(float3 const position, float const h)
+{
+    auto const difference = [&](float3 const offset) {
+        return get_distance_from_signed_distance_primitive<sd_primitive>(position + offset)
+             - get_distance_from_signed_distance_primitive<sd_primitive>(position - offset);
+    };
+
+    float3 const gradient = {difference({h, 0.0f, 0.0f}), difference({0.0f, h, 0.0f}), difference({0.0f, 0.0f, h})};
+    return length(gradient) / (2.0f * h);
+}
+
+template<SignedDistancePrimitive::Enum sd_primitive>
+float estimate_lipschitz_bound()
+{
+    float bound = 0.0f;
+
+    for (u32 z = 0; z < SAMPLES_PER_AXIS; z++)
+    {
+        for (u32 y = 0; y < SAMPLES_PER_AXIS; y++)
+        {
+            for (u32 x = 0; x < SAMPLES_PER_AXIS; x++)
+            {
+                float3 const position = float3 {x + 0.5f, y + 0.5f, z + 0.5f} * (2.0f / SAMPLES_PER_AXIS) - 1.0f;
+
+                // Across a jump, a difference grows inversely to its step, while a slope stays the same.
+                float const magnitude = gradient_magnitude<sd_primitive>(position, DIFFERENCE_STEP);
+                float const coarse_magnitude = gradient_magnitude<sd_primitive>(position, 2.0f * DIFFERENCE_STEP);
+                if (std::abs(magnitude - coarse_magnitude) > 0.1f * std::max(magnitude, coarse_magnitude))
+                {
+                    continue;
+                }
+
+                bound = std::max(bound, magnitude);
+            }
+        }
+    }
+
+    return bound;
+}
+
+}
+
+float estimate_lipschitz_bound(SignedDistancePrimitive::Enum const sd_primitive)
+{
+    using namespace SignedDistancePrimitive;
+    switch (sd_primitive)
+    {
+    case MiniSpheres:
+        return estimate_lipschitz_bound<MiniSpheres>();
+    case IntersectedRoundCube:
+        return estimate_lipschitz_bound<IntersectedRoundCube>();
+    case SquareTorus:
+        return estimate_lipschitz_bound<SquareTorus>();
+    case TwistedTorus:
+        return estimate_lipschitz_bound<TwistedTorus>();
+    case Cog:
+        return estimate_lipschitz_bound<Cog>();
+    case Cylinder:
+        return estimate_lipschitz_bound<Cylinder>();
+    case FractalPyramid:
+        return estimate_lipschitz_bound<FractalPyramid>();
+    default:
+        return 1.0f;
+    }
+}
+
+}
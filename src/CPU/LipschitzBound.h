@@ -0,0 +1,15 @@
+#pragma once
+
+#include "RaytracingSceneDefines.h"
+
+namespace CPU
+{
+
+// Estimates a Lipschitz bound of a signed distance primitive's distance function, the largest rate it changes at,
+// over its AABB, <-1,1> in local space. Sphere tracing by distance / bound never steps over the surface.
+// The bound is the largest gradient magnitude found on a grid of samples, so it can miss the narrowest peaks.
+// Distance functions with jumps, like the fractal's folds, have no bound across them. Samples whose gradient changes
+// with the central differences' step straddle such a jump and are left out.
+float estimate_lipschitz_bound(SignedDistancePrimitive::Enum const sd_primitive);
+
+}
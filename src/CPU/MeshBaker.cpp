@@ -0,0 +1,340 @@
+#include "CPU/MeshBaker.h"
+
+#include "CPU/AABB.h"
+#include "CPU/ProceduralPrimitivesLibrary.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+namespace CPU
+{
+
+namespace
+{
+
+// Pulls each vertex towards the mean of its cell's surface crossings, where their tangent planes alone leave it free
+// to go anywhere, e.g. along a flat or a cylindrical part of the surface.
+float constexpr MASS_POINT_WEIGHT = 0.05f;
+
+u32 constexpr NO_VERTEX = ~0u;
+
+// Cube cells over the bounds, and one more layer of cells past them on every side, so a surface touching the bounds
+// still closes up.
+struct Grid
+{
+    float3 origin;
+    float cell_size = 0.0f;
+    std::array<u32, 3> cell_count = {};
+
+    Grid(AABB const& bounds, u32 const resolution)
+    {
+        float3 const extent = bounds.extent();
+        cell_size = std::max({extent.x, extent.y, extent.z, 1e-6f}) / static_cast<float>(std::max(resolution, 1u));
+        origin = bounds.min - cell_size;
+        for (u32 axis = 0; axis < 3; axis++)
+        {
+            cell_count[axis] = static_cast<u32>(std::max(std::ceil(extent[axis] / cell_size), 1.0f)) + 2;
+        }
+    }
+
+    [[nodiscard]] u32 get_corner_count() const
+    {
+        return (cell_count[0] + 1) * (cell_count[1] + 1) * (cell_count[2] + 1);
+    }
+
+    [[nodiscard]] u32 get_corner_index(u32 const x, u32 const y, u32 const z) const
+    {
+        return (z * (cell_count[1] + 1) + y) * (cell_count[0] + 1) + x;
+    }
+
+    [[nodiscard]] u32 get_cell_index(u32 const x, u32 const y, u32 const z) const
+    {
+        return (z * cell_count[1] + y) * cell_count[0] + x;
+    }
+
+    [[nodiscard]] float3 get_corner_position(u32 const x, u32 const y, u32 const z) const
+    {
+        return origin + float3 {static_cast<float>(x), static_cast<float>(y), static_cast<float>(z)} * cell_size;
+    }
+};
+
+// Point minimizing the squared distances to the tangent planes at the crossings, plus MASS_POINT_WEIGHT times the squared
+// distance to their mean, solved around the mean by Cramer's rule. The weight keeps the system positive definite.
+float3 solve_qef(float3 const (&ata)[3], float3 const atb, float3 const mass_point)
+{
+    float3 const m0 = ata[0] + float3 {MASS_POINT_WEIGHT, 0.0f, 0.0f};
+    float3 const m1 = ata[1] + float3 {0.0f, MASS_POINT_WEIGHT, 0.0f};
+    float3 const m2 = ata[2] + float3 {0.0f, 0.0f, MASS_POINT_WEIGHT};
+    float3 const rhs = atb - float3 {dot(ata[0], mass_point), dot(ata[1], mass_point), dot(ata[2], mass_point)};
+
+    float const det = dot(m0, cross(m1, m2));
+    return mass_point + (cross(m1, m2) * rhs.x + cross(m2, m0) * rhs.y + cross(m0, m1) * rhs.z) / det;
+}
+
+// Dual contouring of field samples on the grid's corners, negative inside. Every cell the surface passes through gets
+// a vertex where the tangent planes at the surface's crossings of its edges come closest to meeting, which keeps
+// the sharp edges and corners marching cubes would cut off. Every edge the surface crosses gets a quad between
+// the vertices of its four cells. gradient(position) points out of the surface.
+// Ref: Ju et al., "Dual Contouring of Hermite Data", SIGGRAPH 2002
+template<typename Gradient>
+BakedMesh dual_contour(Grid const& grid, std::vector<float> const& values, Gradient&& gradient)
+{
+    BakedMesh mesh = {};
+    std::vector<u32> cell_vertices(grid.cell_count[0] * grid.cell_count[1] * grid.cell_count[2], NO_VERTEX);
+
+    for (u32 z = 0; z < grid.cell_count[2]; z++)
+    {
+        for (u32 y = 0; y < grid.cell_count[1]; y++)
+        {
+            for (u32 x = 0; x < grid.cell_count[0]; x++)
+            {
+                // Corner i of a cell is offset by bit 0 of i along x, bit 1 along y and bit 2 along z.
+                float corner_values[8];
+                float3 corner_positions[8];
+                u32 inside_mask = 0;
+                for (u32 i = 0; i < 8; i++)
+                {
+                    u32 const cx = x + (i & 1);
+                    u32 const cy = y + ((i >> 1) & 1);
+                    u32 const cz = z + ((i >> 2) & 1);
+                    corner_values[i] = values[grid.get_corner_index(cx, cy, cz)];
+                    corner_positions[i] = grid.get_corner_position(cx, cy, cz);
+                    inside_mask |= (corner_values[i] < 0.0f ? 1u : 0u) << i;
+                }
+
+                if (inside_mask == 0 || inside_mask == 0xFF)
+                {
+                    continue;
+                }
+
+                float3 ata[3] = {};
+                float3 atb = {};
+                float3 mass_point = {};
+                u32 crossing_count = 0;
+                for (u32 i = 0; i < 8; i++)
+                {
+                    for (u32 axis_bit = 1; axis_bit < 8; axis_bit <<= 1)
+                    {
+                        u32 const j = i | axis_bit;
+                        if ((i & axis_bit) || ((inside_mask >> i) & 1) == ((inside_mask >> j) & 1))
+                        {
+                            continue;
+                        }
+
+                        float const s = corner_values[i] / (corner_values[i] - corner_values[j]);
+                        float3 const crossing = lerp(corner_positions[i], corner_positions[j], s);
+                        float3 normal = gradient(crossing);
+                        float const normal_length = length(normal);
+                        normal = normal_length > 0.0f ? normal / normal_length : float3 {};
+
+                        ata[0] += normal * normal.x;
+                        ata[1] += normal * normal.y;
+                        ata[2] += normal * normal.z;
+                        atb += normal * dot(normal, crossing);
+                        mass_point += crossing;
+                        crossing_count++;
+                    }
+                }
+                mass_point = mass_point / static_cast<float>(crossing_count);
+
+                // Planes meeting at a shallow angle can put the vertex far away, keep it within its cell.
+                float3 position = solve_qef(ata, atb, mass_point);
+                position = min(max(position, corner_positions[0]), corner_positions[7]);
+
+                float3 normal = gradient(position);
+                float const normal_length = length(normal);
+                normal = normal_length > 0.0f ? normal / normal_length : float3 {0.0f, 1.0f, 0.0f};
+
+                cell_vertices[grid.get_cell_index(x, y, z)] = static_cast<u32>(mesh.vertices.size());
+                mesh.vertices.push_back({XMFLOAT3(position.x, position.y, position.z), XMFLOAT3(normal.x, normal.y, normal.z)});
+            }
+        }
+    }
+
+    // Edges along axis a, with the other two axes b and c following it cyclically, so that a = cross(b, c).
+    // Listed counterclockwise around the edge in the (b, c) plane, the four cells make a quad facing +a,
+    // which is its outside when the edge leaves the surface, and has to be flipped otherwise.
+    for (u32 z = 0; z <= grid.cell_count[2]; z++)
+    {
+        for (u32 y = 0; y <= grid.cell_count[1]; y++)
+        {
+            for (u32 x = 0; x <= grid.cell_count[0]; x++)
+            {
+                u32 const corner[3] = {x, y, z};
+                bool const is_inside = values[grid.get_corner_index(x, y, z)] < 0.0f;
+
+                for (u32 a = 0; a < 3; a++)
+                {
+                    u32 const b = (a + 1) % 3;
+                    u32 const c = (a + 2) % 3;
+                    if (corner[a] >= grid.cell_count[a] || corner[b] == 0 || corner[b] >= grid.cell_count[b] || corner[c] == 0
+                        || corner[c] >= grid.cell_count[c])
+                    {
+                        continue;
+                    }
+
+                    u32 next[3] = {x, y, z};
+                    next[a]++;
+                    if (is_inside == (values[grid.get_corner_index(next[0], next[1], next[2])] < 0.0f))
+                    {
+                        continue;
+                    }
+
+                    auto const get_cell_vertex = [&](u32 const db, u32 const dc) {
+                        u32 cell[3] = {x, y, z};
+                        cell[b] -= db;
+                        cell[c] -= dc;
+                        return cell_vertices[grid.get_cell_index(cell[0], cell[1], cell[2])];
+                    };
+
+                    u32 const quad[4] = {get_cell_vertex(1, 1), get_cell_vertex(0, 1), get_cell_vertex(0, 0), get_cell_vertex(1, 0)};
+                    if (is_inside)
+                    {
+                        mesh.indices.insert(mesh.indices.end(), {quad[0], quad[1], quad[2], quad[0], quad[2], quad[3]});
+                    }
+                    else
+                    {
+                        mesh.indices.insert(mesh.indices.end(), {quad[0], quad[2], quad[1], quad[0], quad[3], quad[2]});
+                    }
+                }
+            }
+        }
+    }
+
+    return mesh;
+}
+
+template<SignedDistancePrimitive::Enum sd_primitive>
+BakedMesh bake_signed_distance_primitive(u32 const resolution)
+{
+    Grid const grid({{-1.0f, -1.0f, -1.0f}, {1.0f, 1.0f, 1.0f}}, resolution);
+
+    std::vector<float> distances(grid.get_corner_count());
+    for (u32 z = 0; z <= grid.cell_count[2]; z++)
+    {
+        for (u32 y = 0; y <= grid.cell_count[1]; y++)
+        {
+            for (u32 x = 0; x <= grid.cell_count[0]; x++)
+            {
+                distances[grid.get_corner_index(x, y, z)] =
+                    get_distance_from_signed_distance_primitive<sd_primitive>(grid.get_corner_position(x, y, z));
+            }
+        }
+    }
+
+    return dual_contour(grid, distances, [](float3 const position) {
+        return sd_calculate_gradient<sd_primitive>(position);
+    });
+}
+
+}
+
+BakedMesh bake_signed_distance_primitive(SignedDistancePrimitive::Enum const sd_primitive, u32 const resolution)
+{
+    using namespace SignedDistancePrimitive;
+    switch (sd_primitive)
+    {
+    case MiniSpheres:
+        return bake_signed_distance_primitive<MiniSpheres>(resolution);
+    case IntersectedRoundCube:
+        return bake_signed_distance_primitive<IntersectedRoundCube>(resolution);
+    case SquareTorus:
+        return bake_signed_distance_primitive<SquareTorus>(resolution);
+    case TwistedTorus:
+        return bake_signed_distance_primitive<TwistedTorus>(resolution);
+    case Cog:
+        return bake_signed_distance_primitive<Cog>(resolution);
+    case Cylinder:
+        return bake_signed_distance_primitive<Cylinder>(resolution);
+    case FractalPyramid:
+        return bake_signed_distance_primitive<FractalPyramid>(resolution);
+    default:
+        return {};
+    }
+}
+
+// Each metaball only adds to the corners within its radius, so baking takes time linear in the metaballs and the corners
+// they cover, not their product. Summing every metaball at each crossing would be just as slow, so gradients get
+// accumulated on the corners the same way, and interpolated between them.
+BakedMesh bake_metaballs(std::span<Metaball const> const metaballs, u32 const resolution)
+{
+    AABB bounds = {};
+    for (Metaball const& blob : metaballs)
+    {
+        if (blob.radius > 0.0f)
+        {
+            bounds.grow(blob.center - blob.radius);
+            bounds.grow(blob.center + blob.radius);
+        }
+    }
+
+    if (bounds.is_empty())
+    {
+        return {};
+    }
+
+    Grid const grid(bounds, resolution);
+    std::vector<float> potentials(grid.get_corner_count(), 0.0f);
+    std::vector<float3> gradients(grid.get_corner_count());
+    for (Metaball const& blob : metaballs)
+    {
+        if (blob.radius <= 0.0f)
+        {
+            continue;
+        }
+
+        u32 first[3];
+        u32 last[3];
+        for (u32 axis = 0; axis < 3; axis++)
+        {
+            float const max_corner = static_cast<float>(grid.cell_count[axis]);
+            float const lower = (blob.center[axis] - blob.radius - grid.origin[axis]) / grid.cell_size;
+            float const upper = (blob.center[axis] + blob.radius - grid.origin[axis]) / grid.cell_size;
+            first[axis] = static_cast<u32>(std::clamp(std::ceil(lower), 0.0f, max_corner));
+            last[axis] = static_cast<u32>(std::clamp(std::floor(upper), 0.0f, max_corner));
+        }
+
+        for (u32 z = first[2]; z <= last[2]; z++)
+        {
+            for (u32 y = first[1]; y <= last[1]; y++)
+            {
+                for (u32 x = first[0]; x <= last[0]; x++)
+                {
+                    float3 const position = grid.get_corner_position(x, y, z);
+                    u32 const i = grid.get_corner_index(x, y, z);
+                    float distance;
+                    potentials[i] += calculate_metaball_potential(position, blob, distance);
+                    gradients[i] += calculate_metaball_potential_gradient(position, blob);
+                }
+            }
+        }
+    }
+
+    // The potential grows inwards, the opposite of a signed distance.
+    std::vector<float> values(potentials.size());
+    for (u32 i = 0; i < values.size(); i++)
+    {
+        values[i] = METABALLS_THRESHOLD - potentials[i];
+    }
+
+    return dual_contour(grid, values, [&](float3 const position) {
+        float3 const p = (position - grid.origin) / grid.cell_size;
+        u32 cell[3];
+        float3 f;
+        for (u32 axis = 0; axis < 3; axis++)
+        {
+            float const max_cell = static_cast<float>(grid.cell_count[axis] - 1);
+            cell[axis] = static_cast<u32>(std::clamp(std::floor(p[axis]), 0.0f, max_cell));
+            f[axis] = std::clamp(p[axis] - static_cast<float>(cell[axis]), 0.0f, 1.0f);
+        }
+
+        auto const lerp_x = [&](u32 const dy, u32 const dz) {
+            return lerp(gradients[grid.get_corner_index(cell[0], cell[1] + dy, cell[2] + dz)],
+                        gradients[grid.get_corner_index(cell[0] + 1, cell[1] + dy, cell[2] + dz)], f.x);
+        };
+        return -lerp(lerp(lerp_x(0, 0), lerp_x(1, 0), f.y), lerp(lerp_x(0, 1), lerp_x(1, 1), f.y), f.z);
+    });
+}
+
+}
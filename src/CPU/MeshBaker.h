@@ -0,0 +1,32 @@
+#pragma once
+
+#include "AK/Types.h"
+#include "ConstantBuffers.h"
+#include "CPU/VolumetricPrimitives.h"
+#include "RaytracingSceneDefines.h"
+
+#include <span>
+#include <vector>
+
+namespace CPU
+{
+
+// Indexed triangle mesh in the scene's Vertex format, so it can go into a triangle bottom-level AS as it is.
+// Triangles are front facing when clockwise, as in DXR, and vertex normals come from the gradient of the baked field.
+// Indices are 32-bit, meshes of any useful resolution have more vertices than RaytracingScene::Index can address.
+struct BakedMesh
+{
+    std::vector<Vertex> vertices = {};
+    std::vector<u32> indices = {};
+};
+
+// Bakes the surface of a signed distance primitive in its AABB's local space into a mesh, with resolution cells
+// across the <-1,1> cube along every axis. Detail finer than a cell is lost, and the mesh has on the order of
+// resolution^2 triangles. Only depends on the primitive, so a mesh can be baked once and reused.
+BakedMesh bake_signed_distance_primitive(SignedDistancePrimitive::Enum const sd_primitive, u32 const resolution);
+
+// Bakes the isosurface of a snapshot of metaballs, with resolution cells along the longest side of their bounds.
+// The mesh is only valid for as long as the metaballs stay where they are.
+BakedMesh bake_metaballs(std::span<Metaball const> const metaballs, u32 const resolution);
+
+}
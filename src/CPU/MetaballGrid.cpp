@@ -0,0 +1,193 @@
+#include "CPU/MetaballGrid.h"
+
+#include "CPU/RayPacket.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace CPU
+{
+
+void MetaballGrid::build(std::span<Metaball const> const metaballs)
+{
+    m_bounds = {};
+    m_resolution = {};
+    m_cell_offsets.clear();
+    m_cell_metaballs.clear();
+    m_metaball_count = 0;
+
+    // Metaballs without a radius have no influence anywhere.
+    float mean_radius = 0.0f;
+    for (Metaball const& blob : metaballs)
+    {
+        if (blob.radius > 0.0f)
+        {
+            m_bounds.grow(blob.center - blob.radius);
+            m_bounds.grow(blob.center + blob.radius);
+            mean_radius += blob.radius;
+            m_metaball_count++;
+        }
+    }
+
+    if (m_metaball_count == 0)
+    {
+        return;
+    }
+
+    // Cells about as wide as an influence sphere, so each overlaps only a handful of metaballs even in a dense field.
+    mean_radius /= static_cast<float>(m_metaball_count);
+    float3 const extent = m_bounds.extent();
+    for (u32 axis = 0; axis < 3; axis++)
+    {
+        float const cell_count = std::ceil(extent[axis] / (2.0f * mean_radius));
+        m_resolution[axis] = static_cast<u32>(std::clamp(cell_count, 1.0f, static_cast<float>(MAX_RESOLUTION)));
+        m_cell_size[axis] = extent[axis] / static_cast<float>(m_resolution[axis]);
+    }
+
+    // Calls visit(cell_index, blob) for every cell the influence sphere of blob overlaps.
+    auto const for_each_overlapped_cell = [&](Metaball const& blob, auto&& visit) {
+        u32 first[3];
+        u32 last[3];
+        for (u32 axis = 0; axis < 3; axis++)
+        {
+            float const max_cell = static_cast<float>(m_resolution[axis] - 1);
+            float const lower = (blob.center[axis] - blob.radius - m_bounds.min[axis]) / m_cell_size[axis];
+            float const upper = (blob.center[axis] + blob.radius - m_bounds.min[axis]) / m_cell_size[axis];
+            first[axis] = static_cast<u32>(std::clamp(std::floor(lower), 0.0f, max_cell));
+            last[axis] = static_cast<u32>(std::clamp(std::floor(upper), 0.0f, max_cell));
+        }
+
+        for (u32 z = first[2]; z <= last[2]; z++)
+        {
+            for (u32 y = first[1]; y <= last[1]; y++)
+            {
+                for (u32 x = first[0]; x <= last[0]; x++)
+                {
+                    // The sphere's bounding box overlaps more cells than the sphere does, at the corners.
+                    float3 const cell = {static_cast<float>(x), static_cast<float>(y), static_cast<float>(z)};
+                    float3 const cell_min = m_bounds.min + cell * m_cell_size;
+                    float3 const closest = min(max(blob.center, cell_min), cell_min + m_cell_size);
+                    if (length_to_pow2(closest - blob.center) <= blob.radius * blob.radius)
+                    {
+                        visit(get_cell_index(x, y, z), blob);
+                    }
+                }
+            }
+        }
+    };
+
+    // Count the metaballs of every cell, turn the counts into offsets, then fill the cells in.
+    m_cell_offsets.assign(m_resolution[0] * m_resolution[1] * m_resolution[2] + 1, 0);
+    for (Metaball const& blob : metaballs)
+    {
+        if (blob.radius > 0.0f)
+        {
+            for_each_overlapped_cell(blob, [&](u32 const cell_index, Metaball const&) {
+                m_cell_offsets[cell_index + 1]++;
+            });
+        }
+    }
+
+    for (u32 i = 1; i < m_cell_offsets.size(); i++)
+    {
+        m_cell_offsets[i] += m_cell_offsets[i - 1];
+    }
+
+    std::vector<u32> cell_ends(m_cell_offsets.begin(), m_cell_offsets.end() - 1);
+    m_cell_metaballs.resize(m_cell_offsets.back());
+    for (Metaball const& blob : metaballs)
+    {
+        if (blob.radius > 0.0f)
+        {
+            for_each_overlapped_cell(blob, [&](u32 const cell_index, Metaball const& overlapping_blob) {
+                m_cell_metaballs[cell_ends[cell_index]++] = overlapping_blob;
+            });
+        }
+    }
+}
+
+bool MetaballGrid::intersect(Ray const& ray, float& thit, ProceduralPrimitiveAttributes& attr, RayState const& state) const
+{
+    if (is_empty())
+    {
+        return false;
+    }
+
+    SlabRay const slab_ray = make_slab_ray(ray, state.t_min, state.t_current);
+    float t_entry = 0.0f;
+    if (!ray_aabb_intersection_test(slab_ray, m_bounds.min, m_bounds.max, t_entry))
+    {
+        return false;
+    }
+
+    // Cell the ray enters the grid in, clamped in case the entry point rounds to just outside of the grid.
+    float3 const entry = ray.origin + t_entry * ray.direction;
+    i32 cell[3];
+    i32 step[3];
+    float t_next[3]; // Distance to the next cell boundary along each axis.
+    float t_delta[3]; // Distance between cell boundaries along each axis.
+    for (u32 axis = 0; axis < 3; axis++)
+    {
+        float const position = (entry[axis] - m_bounds.min[axis]) / m_cell_size[axis];
+        cell[axis] = std::clamp(static_cast<i32>(std::floor(position)), 0, static_cast<i32>(m_resolution[axis]) - 1);
+        step[axis] = ray.direction[axis] > 0.0f ? 1 : -1;
+
+        float const boundary = m_bounds.min[axis] + static_cast<float>(cell[axis] + (step[axis] > 0 ? 1 : 0)) * m_cell_size[axis];
+        t_next[axis] = (boundary - ray.origin[axis]) * slab_ray.inv_direction[axis];
+        t_delta[axis] = m_cell_size[axis] * std::abs(slab_ray.inv_direction[axis]);
+    }
+
+    // Cells are visited front to back, so the first hit in any of them is the closest.
+    float t0 = t_entry;
+    for (;;)
+    {
+        u32 const axis = t_next[0] < t_next[1] ? (t_next[0] < t_next[2] ? 0 : 2) : (t_next[1] < t_next[2] ? 1 : 2);
+        float const t1 = std::min(t_next[axis], state.t_current);
+
+        u32 const cell_index = get_cell_index(static_cast<u32>(cell[0]), static_cast<u32>(cell[1]), static_cast<u32>(cell[2]));
+        u32 const begin = m_cell_offsets[cell_index];
+        u32 const end = m_cell_offsets[cell_index + 1];
+        if (begin != end
+            && ray_metaballs_segment_intersection_test(ray, t0, t1, std::span(m_cell_metaballs).subspan(begin, end - begin), thit, attr,
+                                                       state))
+        {
+            return true;
+        }
+
+        if (t_next[axis] >= state.t_current)
+        {
+            return false;
+        }
+
+        cell[axis] += step[axis];
+        if (cell[axis] < 0 || cell[axis] >= static_cast<i32>(m_resolution[axis]))
+        {
+            return false;
+        }
+
+        t0 = t_next[axis];
+        t_next[axis] += t_delta[axis];
+    }
+}
+
+bool MetaballGrid::is_empty() const
+{
+    return m_metaball_count == 0;
+}
+
+u32 MetaballGrid::get_metaball_count() const
+{
+    return m_metaball_count;
+}
+
+AABB const& MetaballGrid::get_bounds() const
+{
+    return m_bounds;
+}
+
+u32 MetaballGrid::get_cell_index(u32 const x, u32 const y, u32 const z) const
+{
+    return (z * m_resolution[1] + y) * m_resolution[0] + x;
+}
+
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "AK/Types.h"
+#include "CPU/AABB.h"
+#include "CPU/RaytracingShaderHelper.h"
+#include "CPU/ShaderMath.h"
+#include "CPU/VolumetricPrimitives.h"
+
+#include <array>
+#include <span>
+#include <vector>
+
+namespace CPU
+{
+
+// Uniform grid over the influence spheres of any number of metaballs, so a point's potential only sums the metaballs
+// whose spheres overlap its cell instead of all of them. Every cell keeps its own copy of those metaballs, contiguous
+// in memory. Rays walk the cells front to back with a 3D-DDA and search each cell's part of the ray on its own.
+// Ref: Amanatides and Woo, "A Fast Voxel Traversal Algorithm for Ray Tracing", Eurographics 1987
+class MetaballGrid
+{
+public:
+    // Metaballs are in the AABB's local space. Rebuilding takes time linear in the metaballs and the cells they overlap,
+    // so a simulation can rebuild the grid every frame.
+    void build(std::span<Metaball const> const metaballs);
+
+    // Same contract as ray_metaballs_intersection_test().
+    bool intersect(Ray const& ray, float& thit, ProceduralPrimitiveAttributes& attr, RayState const& state) const;
+
+    [[nodiscard]] bool is_empty() const;
+    [[nodiscard]] u32 get_metaball_count() const;
+    [[nodiscard]] AABB const& get_bounds() const;
+
+private:
+    static u32 constexpr MAX_RESOLUTION = 64; // Cells per axis.
+
+    [[nodiscard]] u32 get_cell_index(u32 const x, u32 const y, u32 const z) const;
+
+    AABB m_bounds = {};
+    std::array<u32, 3> m_resolution = {};
+    float3 m_cell_size;
+
+    // Metaballs of cell i are m_cell_metaballs[m_cell_offsets[i], m_cell_offsets[i + 1]).
+    std::vector<u32> m_cell_offsets = {};
+    std::vector<Metaball> m_cell_metaballs = {};
+    u32 m_metaball_count = 0;
+};
+
+}
@@ -0,0 +1,638 @@
+#pragma once
+
+#include "ConstantBuffers.h"
+#include "CPU/AnalyticPrimitives.h"
+#include "CPU/RaytracingShaderHelper.h"
+#include "CPU/SignedDistanceDual.h"
+#include "CPU/SignedDistanceFractals.h"
+#include "CPU/SignedDistancePrimitives.h"
+#include "CPU/SignedDistanceProgram.h"
+#include "CPU/SparseDistanceField.h"
+#include "CPU/VolumetricPrimitives.h"
+
+#include <optional>
+#include <span>
+
+// CPU counterpart of ProceduralPrimitivesLibrary.hlsli.
+// An interface to call per geometry intersection tests based on as primitive type.
+namespace CPU
+{
+
+// Analytic geometry intersection test.
+// AABB local space dimensions: <-1,1>.
+inline bool ray_analytic_geometry_intersection_test(Ray const& ray, AnalyticPrimitive::Enum const analytic_primitive, float& thit,
+                                                    ProceduralPrimitiveAttributes& attr, RayState const& state)
+{
+    float3 constexpr aabb[2] = {
+        {-1, -1, -1},
+        {1, 1, 1},
+    };
+
+    switch (analytic_primitive)
+    {
+    case AnalyticPrimitive::AABB:
+        return ray_aabb_intersection_test(ray, aabb, thit, attr, state);
+    case AnalyticPrimitive::Spheres:
+        return ray_spheres_intersection_test(ray, thit, attr, state);
+    default:
+        return false;
+    }
+}
+
+// Volumetric geometry intersection test.
+// AABB local space dimensions: <-1,1>.
+inline bool ray_volumetric_geometry_intersection_test(Ray const& ray, VolumetricPrimitive::Enum const volumetric_primitive, float& thit,
+                                                      ProceduralPrimitiveAttributes& attr, float const elapsed_time, RayState const& state)
+{
+    switch (volumetric_primitive)
+    {
+    case VolumetricPrimitive::Metaballs:
+        return ray_metaballs_intersection_test(ray, thit, attr, elapsed_time, state);
+    default:
+        return false;
+    }
+}
+
+// Signed distance functions use a shared ray signed distance test.
+// The test, instead, calls into this function to retrieve a distance for a primitive.
+// The primitive is a template parameter, so each primitive gets its own sphere tracing loop with its distance function
+// inlined, and the switch over primitives runs once per ray instead of at every step.
+// Fractals pick their iterations from the fractal detail at every position.
+// AABB local space dimensions: <-1,1>.
+// Ref: http://www.iquilezles.org/www/articles/distfunctions/distfunctions.htm
+template<SignedDistancePrimitive::Enum sd_primitive>
+float get_distance_from_signed_distance_primitive(float3 const position, FractalDetail const& fractal_detail = {})
+{
+    if constexpr (sd_primitive == SignedDistancePrimitive::MiniSpheres)
+    {
+        return op_i(sd_sphere(op_rep(position + 1.0f, float3 {0.5f, 0.5f, 0.5f}), 0.65f / 4), sd_box(position, float3 {1, 1, 1}));
+    }
+    else if constexpr (sd_primitive == SignedDistancePrimitive::IntersectedRoundCube)
+    {
+        return op_s(op_s(ud_round_box(position, float3 {0.75f, 0.75f, 0.75f}, 0.2f), sd_sphere(position, 1.20f)),
+                    -sd_sphere(position, 1.32f));
+    }
+    else if constexpr (sd_primitive == SignedDistancePrimitive::SquareTorus)
+    {
+        return sd_torus82(position, float2 {0.75f, 0.15f});
+    }
+    else if constexpr (sd_primitive == SignedDistancePrimitive::TwistedTorus)
+    {
+        return sd_torus(op_twist(position), float2 {0.6f, 0.2f});
+    }
+    else if constexpr (sd_primitive == SignedDistancePrimitive::Cog)
+    {
+        return op_s(sd_torus82(position, float2 {0.60f, 0.3f}),
+                    sd_cylinder(op_rep(float3 {std::atan2(position.z, position.x) / 6.2831f, 1, 0.015f + 0.25f * length(position)} + 1.0f,
+                                       float3 {0.05f, 1, 0.075f}),
+                                float2 {0.02f, 0.8f}));
+    }
+    else if constexpr (sd_primitive == SignedDistancePrimitive::Cylinder)
+    {
+        return op_i(sd_cylinder(op_rep(position + float3 {1, 1, 1}, float3 {1, 2, 1}), float2 {0.3f, 2}),
+                    sd_box(position + float3 {1, 1, 1}, float3 {2, 2, 2}));
+    }
+    else
+    {
+        static_assert(sd_primitive == SignedDistancePrimitive::FractalPyramid, "Unknown signed distance primitive.");
+
+        // Let pyramid have a base at y == -1 of AABB => position + float3(0,1,0)
+        // Pyramid: 63.435 degrees at base, height 2
+        float const iterations = calculate_fractal_iterations(position, fractal_detail, 2.0f, 2.0f);
+        return sd_fractal_pyramid(position + float3 {0, 1, 0}, float3 {0.894f, 0.447f, 2.0f}, 2.0f, iterations);
+    }
+}
+
+// Distance along with its gradient, from a single evaluation of the distance function over dual numbers.
+// Mirrors get_distance_from_signed_distance_primitive(), and has to be kept in sync with it.
+template<SignedDistancePrimitive::Enum sd_primitive>
+dual get_distance_and_gradient_from_signed_distance_primitive(float3 const pos, FractalDetail const& fractal_detail = {})
+{
+    dual3 const position = make_dual3(pos);
+    if constexpr (sd_primitive == SignedDistancePrimitive::MiniSpheres)
+    {
+        return op_i(sd_sphere(op_rep(position + 1.0f, float3 {0.5f, 0.5f, 0.5f}), 0.65f / 4), sd_box(position, float3 {1, 1, 1}));
+    }
+    else if constexpr (sd_primitive == SignedDistancePrimitive::IntersectedRoundCube)
+    {
+        return op_s(op_s(ud_round_box(position, float3 {0.75f, 0.75f, 0.75f}, 0.2f), sd_sphere(position, 1.20f)),
+                    -sd_sphere(position, 1.32f));
+    }
+    else if constexpr (sd_primitive == SignedDistancePrimitive::SquareTorus)
+    {
+        return sd_torus82(position, float2 {0.75f, 0.15f});
+    }
+    else if constexpr (sd_primitive == SignedDistancePrimitive::TwistedTorus)
+    {
+        return sd_torus(op_twist(position), float2 {0.6f, 0.2f});
+    }
+    else if constexpr (sd_primitive == SignedDistancePrimitive::Cog)
+    {
+        // The 1 is a constant, with no gradient.
+        dual3 const cog_position = {atan2(position.z, position.x) / 6.2831f, dual {1.0f, float3 {0.0f, 0.0f, 0.0f}},
+                                    0.015f + 0.25f * length(position)};
+        return op_s(sd_torus82(position, float2 {0.60f, 0.3f}),
+                    sd_cylinder(op_rep(cog_position + 1.0f, float3 {0.05f, 1, 0.075f}), float2 {0.02f, 0.8f}));
+    }
+    else if constexpr (sd_primitive == SignedDistancePrimitive::Cylinder)
+    {
+        return op_i(sd_cylinder(op_rep(position + float3 {1, 1, 1}, float3 {1, 2, 1}), float2 {0.3f, 2}),
+                    sd_box(position + float3 {1, 1, 1}, float3 {2, 2, 2}));
+    }
+    else
+    {
+        static_assert(sd_primitive == SignedDistancePrimitive::FractalPyramid, "Unknown signed distance primitive.");
+        float const iterations = calculate_fractal_iterations(pos, fractal_detail, 2.0f, 2.0f);
+        return sd_fractal_pyramid(position + float3 {0, 1, 0}, float3 {0.894f, 0.447f, 2.0f}, 2.0f, iterations);
+    }
+}
+
+// Gradient of the distance. The shaders estimate it with the tetrahedron technique, from four more distance evaluations,
+// which dual numbers replace with a single one.
+template<SignedDistancePrimitive::Enum sd_primitive>
+float3 sd_calculate_gradient(float3 const pos, FractalDetail const& fractal_detail = {})
+{
+    return get_distance_and_gradient_from_signed_distance_primitive<sd_primitive>(pos, fractal_detail).gradient;
+}
+
+template<SignedDistancePrimitive::Enum sd_primitive>
+float3 sd_calculate_normal(float3 const pos, FractalDetail const& fractal_detail = {})
+{
+    return normalize(sd_calculate_gradient<sd_primitive>(pos, fractal_detail));
+}
+
+// Central difference of the distance along a direction. It has the sign of dot(direction, normal),
+// which is all culling needs, for 2 distance evaluations instead of the 4 of sd_calculate_normal().
+template<SignedDistancePrimitive::Enum sd_primitive>
+float sd_calculate_directional_derivative(float3 const pos, float3 const direction, FractalDetail const& fractal_detail = {})
+{
+    float constexpr e = 0.0001f;
+    float3 const offset = e * normalize(direction);
+    return get_distance_from_signed_distance_primitive<sd_primitive>(pos + offset, fractal_detail)
+         - get_distance_from_signed_distance_primitive<sd_primitive>(pos - offset, fractal_detail);
+}
+
+// Part of a sphere traced ray's path that no surface comes within clearance of: the segment from origin to position,
+// where the ray stopped one step short of its hit, along with the sphere tracing state there.
+struct SphereTraceWarmStart
+{
+    float3 origin;
+    float3 position;
+    float clearance = -1.0f; // Negative if there is no such segment.
+    float origin_radius = -1.0f; // No surface comes within it of origin either, negative until the first step.
+
+    float t = 0.0f;
+    float previous_radius = 0.0f;
+    float step_length = 0.0f;
+    float slope = -1.0f;
+};
+
+inline float distance_to_segment(float3 const point, float3 const a, float3 const b)
+{
+    float3 const ab = b - a;
+    float const ab_length_pow2 = dot(ab, ab);
+    float const s = ab_length_pow2 > 0.0f ? std::clamp(dot(point - a, ab) / ab_length_pow2, 0.0f, 1.0f) : 0.0f;
+    return length(point - (a + s * ab));
+}
+
+// A ray that has not changed carries on sphere tracing exactly where the warm start's ray left off, and finds the same hit.
+// Any other ray can skip straight to the point closest to the warm start's position if no surface comes within the hit distance
+// of its path up to there. At a fraction s of the way along the warm start's segment, no surface is within the clearance, nor
+// within the origin's radius less the way travelled from the origin, whichever is larger. The path's point at the same fraction
+// is at most the offsets between the ends of the path and the segment, interpolated, away from it, which leaves a bound for the
+// path. The bound is piecewise linear in s, so its minimum is at either end or where the two bounds along the segment meet.
+// Fills start in with where to start and the clearance left around the path.
+inline bool try_sphere_trace_warm_start(Ray const& ray, RayState const& state, SphereTraceWarmStart const& warm_start,
+                                        float const threshold, RayCone const& cone, SphereTraceWarmStart& start)
+{
+    if (warm_start.clearance <= 0.0f)
+    {
+        return false;
+    }
+
+    float3 const origin = ray.origin + state.t_min * ray.direction;
+    float3 const position = ray.origin + warm_start.t * ray.direction;
+    if (origin.x == warm_start.origin.x && origin.y == warm_start.origin.y && origin.z == warm_start.origin.z
+        && position.x == warm_start.position.x && position.y == warm_start.position.y && position.z == warm_start.position.z)
+    {
+        start = warm_start;
+        return warm_start.t <= state.t_current;
+    }
+
+    float const t_start = dot(warm_start.position - ray.origin, ray.direction) / dot(ray.direction, ray.direction);
+    if (t_start <= state.t_min || t_start > state.t_current)
+    {
+        return false;
+    }
+
+    float const origin_offset = length(origin - warm_start.origin);
+    float const position_offset = length(ray.origin + t_start * ray.direction - warm_start.position);
+    float const segment_length = length(warm_start.position - warm_start.origin);
+    auto const get_clearance = [&](float const s) {
+        return std::max(warm_start.clearance, warm_start.origin_radius - s * segment_length)
+             - ((1.0f - s) * origin_offset + s * position_offset);
+    };
+
+    float const s_meet =
+        segment_length > 0.0f ? std::clamp((warm_start.origin_radius - warm_start.clearance) / segment_length, 0.0f, 1.0f) : 0.0f;
+    float const clearance = std::min(std::min(get_clearance(0.0f), get_clearance(s_meet)), get_clearance(1.0f));
+    float const hit_distance = std::max(threshold * t_start, cone.width + cone.spread_angle * t_start);
+    if (clearance <= hit_distance)
+    {
+        return false;
+    }
+
+    start = {};
+    start.clearance = clearance;
+    start.origin_radius = get_clearance(0.0f);
+    start.t = t_start;
+    return true;
+}
+
+// Distance function of a built-in signed distance primitive, for sphere_trace().
+template<SignedDistancePrimitive::Enum sd_primitive>
+struct SignedDistancePrimitiveFunction
+{
+    FractalDetail const& fractal_detail;
+
+    float get_distance(float3 const position) const
+    {
+        return get_distance_from_signed_distance_primitive<sd_primitive>(position, fractal_detail);
+    }
+
+    float3 calculate_gradient(float3 const position) const
+    {
+        return sd_calculate_gradient<sd_primitive>(position, fractal_detail);
+    }
+
+    float calculate_directional_derivative(float3 const position, float3 const direction) const
+    {
+        return sd_calculate_directional_derivative<sd_primitive>(position, direction, fractal_detail);
+    }
+};
+
+// Sphere tracing of a ray against a signed distance function, which provides get_distance(), calculate_gradient() and
+// calculate_directional_derivative() the way SignedDistancePrimitiveFunction does. It is split at the distance evaluations:
+// next() moves on to the next position whose distance the ray needs, and step() takes that distance, so the rays of a packet
+// can get theirs evaluated together. Lookups in the distance field and tests of the hits happen in between.
+// The ray's pixel cone is in the primitive's local space. Without one, the test resolves the surface down to a fixed fraction of t.
+// A distance field of the primitive, if given, stands in for its distance function away from the surface.
+// A warm start, if given, lets the ray skip the part of its path a previous ray has shown to be empty, and gets replaced
+// with the part of this ray's path that is, once it hits.
+// Ref: https://www.scratchapixel.com/lessons/advanced-rendering/rendering-distance-fields/basic-sphere-tracer
+// Ref: Amanatides, "Ray Tracing with Cones", SIGGRAPH 1984
+// Ref: Keinert et al., "Enhanced Sphere Tracing", STAG 2014
+// Ref: Balint and Valasek, "Accelerating Sphere Tracing", Eurographics 2018 Short Papers
+template<typename DistanceFunction>
+class SphereTracer
+{
+public:
+    SphereTracer(DistanceFunction const& function, Ray const& ray, RayState const& state, float const step_scale,
+                 float const over_relaxation, RayCone const& cone, SparseDistanceField const* distance_field,
+                 SphereTraceWarmStart* warm_start)
+        : m_function(function)
+        , m_ray(ray)
+        , m_state(state)
+        , m_step_scale(step_scale)
+        , m_over_relaxation(over_relaxation)
+        , m_cone(cone)
+        , m_distance_field(distance_field)
+        , m_warm_start(warm_start)
+    {
+        SphereTraceWarmStart start = {};
+        start.t = state.t_min;
+        start.clearance = INFINITY_F;
+        start.origin_radius = -1.0f;
+        m_is_warm_started = warm_start && try_sphere_trace_warm_start(ray, state, *warm_start, THRESHOLD, cone, start);
+
+        m_t = start.t;
+        m_previous_radius = start.previous_radius;
+        m_step_length = start.step_length;
+        m_slope = start.slope;
+        m_clearance = start.clearance;
+        m_origin_radius = start.origin_radius;
+
+        float3 const origin = ray.origin + state.t_min * ray.direction;
+        m_next_warm_start = {origin, origin, -1.0f, -1.0f, state.t_min, 0.0f, 0.0f, -1.0f};
+    }
+
+    // Moves on to the next position the distance function has to be evaluated at. Returns false once the ray has hit,
+    // left the AABB or run out of steps.
+    bool next()
+    {
+        while (!m_is_hit && m_step_count++ < MAX_STEPS && m_t <= m_state.t_current)
+        {
+            m_position = m_ray.origin + m_t * m_ray.direction;
+
+            // Anything closer than the pixel cone's radius is below the pixel's footprint and counts as a hit.
+            m_cone_radius = m_cone.width + m_cone.spread_angle * m_t;
+            m_hit_distance = std::max(THRESHOLD * m_t, m_cone_radius);
+
+            // Away from the surface, the distance field bounds the distance closely enough to step by. It only has to be too large
+            // to be mistaken for a hit.
+            float const distance = m_distance_field ? m_distance_field->get_distance(m_position) : 0.0f;
+            if (distance <= std::max(SparseDistanceField::REFINE_DISTANCE, m_hit_distance))
+            {
+                return true;
+            }
+            step(distance);
+        }
+        return false;
+    }
+
+    // Position next() stopped at.
+    [[nodiscard]] float3 get_position() const
+    {
+        return m_position;
+    }
+
+    // Steps by the distance at the position next() stopped at.
+    void step(float const distance)
+    {
+        float const radius = m_step_scale * distance;
+
+        // The surface can only be behind a warm start if its clearance was wrong. Trace the ray from its start instead.
+        if (m_is_warm_started && m_is_first_step && distance < 0.0f)
+        {
+            m_t = m_state.t_min;
+            m_previous_radius = 0.0f;
+            m_step_length = 0.0f;
+            m_slope = -1.0f;
+            m_clearance = INFINITY_F;
+            m_origin_radius = -1.0f;
+            m_is_first_step = false;
+            return;
+        }
+        m_is_first_step = false;
+
+        // A step past the previous unbounding sphere is safe only if the spheres at both of its ends overlap,
+        // leaving no gap along the ray for the surface to hide in. Otherwise, go back and take the plain step instead.
+        if (m_step_length > m_previous_radius && (radius < 0.0f || m_previous_radius + radius < m_step_length))
+        {
+            m_t += m_previous_radius - m_step_length;
+            m_step_length = m_previous_radius;
+            m_slope = -1.0f;
+            return;
+        }
+
+        m_clearance = std::min(m_clearance, m_step_length > 0.0f ? 0.5f * (m_previous_radius + radius - m_step_length) : radius);
+        if (m_origin_radius < 0.0f)
+        {
+            // Step scales above 1 make up for distances that are too short near the surface, far from it they can overshoot.
+            m_origin_radius = std::min(radius, distance);
+        }
+
+        // Has the ray intersected the primitive?
+        if (distance <= m_hit_distance)
+        {
+            if (is_occlusion_ray(m_state))
+            {
+                if (is_in_range(m_t, m_state.t_min, m_state.t_current)
+                    && !is_culled(m_function.calculate_directional_derivative(m_position, m_ray.direction), m_state))
+                {
+                    m_is_hit = true;
+                    return;
+                }
+            }
+            else
+            {
+                // Distance functions built on domain warps, like the Cog's, underestimate the distance to the surface.
+                // Near the surface, distance / |gradient| is close to the true distance, so the cone is tested against that.
+                float3 const gradient = m_function.calculate_gradient(m_position);
+                if (distance <= std::max(THRESHOLD * m_t, m_cone_radius * length(gradient)))
+                {
+                    float3 const hit_surface_normal = normalize(gradient);
+                    if (is_a_valid_hit(m_ray, m_t, hit_surface_normal, m_state))
+                    {
+                        m_is_hit = true;
+                        m_normal = hit_surface_normal;
+                        if (m_warm_start)
+                        {
+                            *m_warm_start = m_next_warm_start;
+                        }
+                        return;
+                    }
+                }
+            }
+        }
+
+        m_next_warm_start.position = m_position;
+        m_next_warm_start.clearance = m_clearance;
+        m_next_warm_start.origin_radius = m_origin_radius;
+        m_next_warm_start.t = m_t;
+        m_next_warm_start.previous_radius = m_previous_radius;
+        m_next_warm_start.step_length = m_step_length;
+        m_next_warm_start.slope = m_slope;
+
+        // Since distance is the minimum distance to the primitive,
+        // we can safely jump by that amount without intersecting the primitive.
+        // We allow for scaling of steps per primitive type due to any pre-applied
+        // transformations that don't preserve true distances.
+        // Steps get over-relaxed by up to over_relaxation, depending on the slope: a ray heading straight at the surface
+        // takes plain steps, one running along it steps further. Relaxed steps stop at t_current, not to miss a hit just before it.
+        // The slope lags a step behind, so its divisions overlap with the next distance evaluation instead of delaying it.
+        float relaxation = 1.0f;
+        if (m_over_relaxation > 1.0f)
+        {
+            relaxation = std::clamp(2.0f / (1.0f - m_slope), 1.0f, m_over_relaxation);
+            if (m_step_length > 0.0f)
+            {
+                m_slope = 0.5f * (m_slope + std::clamp((radius - m_previous_radius) / m_step_length, -1.0f, 1.0f));
+            }
+        }
+        m_previous_radius = radius;
+        m_step_length = std::max(radius, std::min(relaxation * radius, m_state.t_current - m_t));
+        m_t += m_step_length;
+    }
+
+    // Once next() returns false. Occlusion rays get no normal.
+    bool get_hit(float& thit, ProceduralPrimitiveAttributes& attr) const
+    {
+        if (!m_is_hit)
+        {
+            return false;
+        }
+
+        thit = m_t;
+        if (!is_occlusion_ray(m_state))
+        {
+            attr.normal = {m_normal.x, m_normal.y, m_normal.z};
+        }
+        return true;
+    }
+
+private:
+    static float constexpr THRESHOLD = 0.0001f;
+    static u32 constexpr MAX_STEPS = 512;
+
+    DistanceFunction const& m_function;
+    Ray m_ray;
+    RayState m_state;
+    float m_step_scale = 1.0f;
+    float m_over_relaxation = 1.0f;
+    RayCone m_cone;
+    SparseDistanceField const* m_distance_field = nullptr;
+    SphereTraceWarmStart* m_warm_start = nullptr;
+    bool m_is_warm_started = false;
+
+    float m_t = 0.0f;
+    float m_previous_radius = 0.0f;
+    float m_step_length = 0.0f;
+    float m_slope = -1.0f; // Running estimate of the rate the distance changes at along the ray.
+
+    // No surface comes within clearance of the path up to t. Between two samples, it is at least half of how much
+    // their unbounding spheres overlap by.
+    float m_clearance = INFINITY_F;
+    float m_origin_radius = -1.0f;
+    // Empty until the first step past the start.
+    SphereTraceWarmStart m_next_warm_start = {};
+    bool m_is_first_step = true;
+    u32 m_step_count = 0;
+
+    float3 m_position;
+    float m_cone_radius = 0.0f;
+    float m_hit_distance = 0.0f;
+
+    bool m_is_hit = false;
+    float3 m_normal;
+};
+
+// Test ray against a signed distance function, with SphereTracer stepping it a distance evaluation at a time.
+template<typename DistanceFunction>
+bool sphere_trace(DistanceFunction const& function, Ray const& ray, float& thit, ProceduralPrimitiveAttributes& attr, RayState const& state,
+                  float const step_scale, float const over_relaxation, RayCone const& cone, SparseDistanceField const* distance_field,
+                  SphereTraceWarmStart* warm_start)
+{
+    SphereTracer<DistanceFunction> tracer(function, ray, state, step_scale, over_relaxation, cone, distance_field, warm_start);
+    while (tracer.next())
+    {
+        tracer.step(function.get_distance(tracer.get_position()));
+    }
+    return tracer.get_hit(thit, attr);
+}
+
+// Test ray against a signed distance primitive. Fractals resolve as much detail as the fractal detail asks for,
+// which has to be in the same local space as the ray.
+template<SignedDistancePrimitive::Enum sd_primitive>
+bool ray_signed_distance_primitive_test(Ray const& ray, float& thit, ProceduralPrimitiveAttributes& attr, RayState const& state,
+                                        float const step_scale = 1.0f, float const over_relaxation = 1.0f, RayCone const& cone = {},
+                                        SparseDistanceField const* distance_field = nullptr,
+                                        FractalDetail const& fractal_detail = {}, SphereTraceWarmStart* warm_start = nullptr)
+{
+    return sphere_trace(SignedDistancePrimitiveFunction<sd_primitive> {fractal_detail}, ray, thit, attr, state, step_scale, over_relaxation,
+                        cone, distance_field, warm_start);
+}
+
+// Test ray against a signed distance program, which stands in for a primitive's built-in distance function,
+// or against a SignedDistanceProgramOctree of programs pruned to where they decide the distance.
+// A single ray's steps go through get_distance() a position at a time, decoding every instruction for just it.
+// ray_signed_distance_program_packet_test() spreads that over the rays of a packet.
+template<typename Program>
+bool ray_signed_distance_program_test(Ray const& ray, Program const& program, float& thit, ProceduralPrimitiveAttributes& attr,
+                                      RayState const& state, float const step_scale = 1.0f, float const over_relaxation = 1.0f,
+                                      RayCone const& cone = {}, SparseDistanceField const* distance_field = nullptr,
+                                      SphereTraceWarmStart* warm_start = nullptr)
+{
+    return sphere_trace(program, ray, thit, attr, state, step_scale, over_relaxation, cone, distance_field, warm_start);
+}
+
+// Packet counterpart of ray_signed_distance_program_test() for the rays in lane_mask, which all step at once. The distances
+// they need at a step get evaluated as a single batch through the program's evaluate(), which decodes every instruction once
+// for all of them. Rays drop out of the batches as they hit or leave. Returns the mask of the lanes that hit, and fills their
+// thit and attr in.
+template<typename Program, u32 N>
+u32 ray_signed_distance_program_packet_test(Ray const (&rays)[N], u32 const lane_mask, Program const& program, float (&thits)[N],
+                                            ProceduralPrimitiveAttributes (&attrs)[N], RayState const (&states)[N],
+                                            float const step_scale, float const over_relaxation, RayCone const (&cones)[N],
+                                            SparseDistanceField const* distance_field, SphereTraceWarmStart* const (&warm_starts)[N])
+{
+    std::optional<SphereTracer<Program>> tracers[N];
+    for (u32 lane = 0; lane < N; lane++)
+    {
+        if ((lane_mask & (1u << lane)) != 0)
+        {
+            tracers[lane].emplace(program, rays[lane], states[lane], step_scale, over_relaxation, cones[lane], distance_field,
+                                  warm_starts[lane]);
+        }
+    }
+
+    u32 active_lane_mask = lane_mask;
+    while (active_lane_mask != 0)
+    {
+        float3 positions[N];
+        u32 lanes[N];
+        u32 count = 0;
+        for (u32 lane = 0; lane < N; lane++)
+        {
+            if ((active_lane_mask & (1u << lane)) == 0)
+            {
+                continue;
+            }
+
+            if (tracers[lane]->next())
+            {
+                positions[count] = tracers[lane]->get_position();
+                lanes[count++] = lane;
+            }
+            else
+            {
+                active_lane_mask &= ~(1u << lane);
+            }
+        }
+
+        float distances[N];
+        program.evaluate(std::span<float3 const>(positions, count), std::span<float>(distances, count));
+        for (u32 i = 0; i < count; i++)
+        {
+            tracers[lanes[i]]->step(distances[i]);
+        }
+    }
+
+    u32 hit_mask = 0;
+    for (u32 lane = 0; lane < N; lane++)
+    {
+        if ((lane_mask & (1u << lane)) != 0 && tracers[lane]->get_hit(thits[lane], attrs[lane]))
+        {
+            hit_mask |= 1u << lane;
+        }
+    }
+    return hit_mask;
+}
+
+// Picks the sphere tracing loop of a primitive.
+inline bool ray_signed_distance_primitive_test(Ray const& ray, SignedDistancePrimitive::Enum const sd_primitive, float& thit,
+                                               ProceduralPrimitiveAttributes& attr, RayState const& state, float const step_scale = 1.0f,
+                                               float const over_relaxation = 1.0f, RayCone const& cone = {},
+                                               SparseDistanceField const* distance_field = nullptr,
+                                               FractalDetail const& fractal_detail = {}, SphereTraceWarmStart* warm_start = nullptr)
+{
+    using namespace SignedDistancePrimitive;
+    switch (sd_primitive)
+    {
+    case MiniSpheres:
+        return ray_signed_distance_primitive_test<MiniSpheres>(ray, thit, attr, state, step_scale, over_relaxation, cone, distance_field,
+                                                               fractal_detail, warm_start);
+    case IntersectedRoundCube:
+        return ray_signed_distance_primitive_test<IntersectedRoundCube>(ray, thit, attr, state, step_scale, over_relaxation, cone,
+                                                                        distance_field, fractal_detail, warm_start);
+    case SquareTorus:
+        return ray_signed_distance_primitive_test<SquareTorus>(ray, thit, attr, state, step_scale, over_relaxation, cone, distance_field,
+                                                               fractal_detail, warm_start);
+    case TwistedTorus:
+        return ray_signed_distance_primitive_test<TwistedTorus>(ray, thit, attr, state, step_scale, over_relaxation, cone, distance_field,
+                                                                fractal_detail, warm_start);
+    case Cog:
+        return ray_signed_distance_primitive_test<Cog>(ray, thit, attr, state, step_scale, over_relaxation, cone, distance_field,
+                                                       fractal_detail, warm_start);
+    case Cylinder:
+        return ray_signed_distance_primitive_test<Cylinder>(ray, thit, attr, state, step_scale, over_relaxation, cone, distance_field,
+                                                            fractal_detail, warm_start);
+    case FractalPyramid:
+        return ray_signed_distance_primitive_test<FractalPyramid>(ray, thit, attr, state, step_scale, over_relaxation, cone,
+                                                                  distance_field, fractal_detail, warm_start);
+    default:
+        return false;
+    }
+}
+
+}
@@ -0,0 +1,287 @@
+#pragma once
+
+#include "AK/Types.h"
+#include "CPU/RaytracingShaderHelper.h"
+#include "CPU/SIMD.h"
+#include "CPU/ShaderMath.h"
+
+#include <bit>
+
+namespace CPU
+{
+
+// Slab exit distances get scaled by 1 + 2 * gamma(3), so float rounding can never turn a grazing hit into a miss.
+// Ref: Ize, "Robust BVH Ray Traversal", JCGT 2013
+float constexpr SLAB_EXIT_SCALE = 1.00000036f;
+
+// Up to N rays in SoA layout, one ray per lane, for testing them against the same box at once.
+template<u32 N>
+struct alignas(N * sizeof(float)) RayPacket
+{
+    static_assert(std::has_single_bit(N), "Packet width has to be a power of two.");
+
+    static u32 constexpr width = N;
+
+    float origin_x[N];
+    float origin_y[N];
+    float origin_z[N];
+    float inv_direction_x[N];
+    float inv_direction_y[N];
+    float inv_direction_z[N];
+    float t_min[N];
+    float t_max[N];
+
+    void set_ray(u32 const lane, Ray const& ray, float const ray_t_min, float const ray_t_max)
+    {
+        float3 const inv_direction = safe_inverse(ray.direction);
+
+        origin_x[lane] = ray.origin.x;
+        origin_y[lane] = ray.origin.y;
+        origin_z[lane] = ray.origin.z;
+        inv_direction_x[lane] = inv_direction.x;
+        inv_direction_y[lane] = inv_direction.y;
+        inv_direction_z[lane] = inv_direction.z;
+        t_min[lane] = ray_t_min;
+        t_max[lane] = ray_t_max;
+    }
+
+    // Inactive lanes have an empty <t_min, t_max> range and never report a hit.
+    void set_inactive(u32 const lane)
+    {
+        set_ray(lane, {{0.0f, 0.0f, 0.0f}, {1.0f, 1.0f, 1.0f}}, INFINITY_F, -INFINITY_F);
+    }
+};
+
+// Up to N boxes in SoA layout, one box per lane, for testing a single ray against all of them at once.
+template<u32 N>
+struct alignas(N * sizeof(float)) AABBPacket
+{
+    static_assert(std::has_single_bit(N), "Packet width has to be a power of two.");
+
+    static u32 constexpr width = N;
+
+    AABBPacket()
+    {
+        for (u32 lane = 0; lane < N; lane++)
+        {
+            set_empty(lane);
+        }
+    }
+
+    float min_x[N];
+    float min_y[N];
+    float min_z[N];
+    float max_x[N];
+    float max_y[N];
+    float max_z[N];
+
+    void set_aabb(u32 const lane, float3 const aabb_min, float3 const aabb_max)
+    {
+        min_x[lane] = aabb_min.x;
+        min_y[lane] = aabb_min.y;
+        min_z[lane] = aabb_min.z;
+        max_x[lane] = aabb_max.x;
+        max_y[lane] = aabb_max.y;
+        max_z[lane] = aabb_max.z;
+    }
+
+    // Empty lanes hold an inverted box, which never gets hit.
+    void set_empty(u32 const lane)
+    {
+        set_aabb(lane, {INFINITY_F, INFINITY_F, INFINITY_F}, {-INFINITY_F, -INFINITY_F, -INFINITY_F});
+    }
+};
+
+// Single ray prepared for slab tests against many boxes.
+struct SlabRay
+{
+    float3 origin;
+    float3 inv_direction;
+    float t_min = 0.0f;
+    float t_max = INFINITY_F;
+};
+
+inline SlabRay make_slab_ray(Ray const& ray, float const t_min, float const t_max)
+{
+    return {ray.origin, safe_inverse(ray.direction), t_min, t_max};
+}
+
+// Slab tests below return a bit mask with bit i set if lane i hits, and write the entry distance of every lane,
+// clamped to the ray's t_min, into t_near. A lane hits if its <t_min, t_max> range overlaps the box.
+// Accumulators are always passed as the second min/max operand, so a NaN from a slab, e.g. a NaN ray, can never
+// replace them. Together with safe_inverse() this keeps the tests NaN-free.
+
+namespace Detail
+{
+
+// Max/min the way SSE does them: b is returned if either operand is NaN.
+inline float sse_max(float const a, float const b)
+{
+    return a > b ? a : b;
+}
+
+inline float sse_min(float const a, float const b)
+{
+    return a < b ? a : b;
+}
+
+inline void slab_scalar(float const origin, float const inv_direction, float const aabb_min, float const aabb_max, float& t_entry,
+                        float& t_exit)
+{
+    float const t0 = (aabb_min - origin) * inv_direction;
+    float const t1 = (aabb_max - origin) * inv_direction;
+    t_entry = sse_max(sse_min(t0, t1), t_entry);
+    t_exit = sse_min(sse_max(t0, t1) * SLAB_EXIT_SCALE, t_exit);
+}
+
+// Picks the entry and exit planes from the sign of the direction, so an inverted (empty) box always misses.
+inline void slab_scalar_ordered(float const origin, float const inv_direction, float const aabb_min, float const aabb_max,
+                                float& t_entry, float& t_exit)
+{
+    float const entry_plane = inv_direction < 0.0f ? aabb_max : aabb_min;
+    float const exit_plane = inv_direction < 0.0f ? aabb_min : aabb_max;
+    t_entry = sse_max((entry_plane - origin) * inv_direction, t_entry);
+    t_exit = sse_min((exit_plane - origin) * inv_direction * SLAB_EXIT_SCALE, t_exit);
+}
+
+template<u32 N>
+u32 ray_packet_aabb_intersection_test_scalar(RayPacket<N> const& packet, float3 const aabb[2], float t_near[N])
+{
+    u32 mask = 0;
+
+    for (u32 lane = 0; lane < N; lane++)
+    {
+        float t_entry = packet.t_min[lane];
+        float t_exit = packet.t_max[lane];
+        slab_scalar(packet.origin_x[lane], packet.inv_direction_x[lane], aabb[0].x, aabb[1].x, t_entry, t_exit);
+        slab_scalar(packet.origin_y[lane], packet.inv_direction_y[lane], aabb[0].y, aabb[1].y, t_entry, t_exit);
+        slab_scalar(packet.origin_z[lane], packet.inv_direction_z[lane], aabb[0].z, aabb[1].z, t_entry, t_exit);
+
+        t_near[lane] = t_entry;
+        mask |= static_cast<u32>(t_entry <= t_exit) << lane;
+    }
+
+    return mask;
+}
+
+template<u32 N>
+u32 ray_packet_aabb_intersection_test_simd(RayPacket<N> const& packet, float3 const aabb[2], float t_near[N])
+{
+    using F = SIMD::Float<N>;
+    using V = typename F::Type;
+
+    V t_entry = F::load(packet.t_min);
+    V t_exit = F::load(packet.t_max);
+    V const exit_scale = F::set1(SLAB_EXIT_SCALE);
+
+    // Per-lane min/max of the two slab distances replaces the sign-based plane selection of the scalar test.
+    auto const slab = [&](float const* origin, float const* inv_direction, float const aabb_min, float const aabb_max) {
+        V const o = F::load(origin);
+        V const inv = F::load(inv_direction);
+        V const t0 = F::mul(F::sub(F::set1(aabb_min), o), inv);
+        V const t1 = F::mul(F::sub(F::set1(aabb_max), o), inv);
+        t_entry = F::max(F::min(t0, t1), t_entry);
+        t_exit = F::min(F::mul(F::max(t0, t1), exit_scale), t_exit);
+    };
+
+    slab(packet.origin_x, packet.inv_direction_x, aabb[0].x, aabb[1].x);
+    slab(packet.origin_y, packet.inv_direction_y, aabb[0].y, aabb[1].y);
+    slab(packet.origin_z, packet.inv_direction_z, aabb[0].z, aabb[1].z);
+
+    F::store(t_near, t_entry);
+    return F::less_equal_mask(t_entry, t_exit);
+}
+
+template<u32 N>
+u32 ray_aabb_packet_intersection_test_scalar(SlabRay const& ray, AABBPacket<N> const& aabbs, float t_near[N])
+{
+    u32 mask = 0;
+
+    for (u32 lane = 0; lane < N; lane++)
+    {
+        float t_entry = ray.t_min;
+        float t_exit = ray.t_max;
+        slab_scalar_ordered(ray.origin.x, ray.inv_direction.x, aabbs.min_x[lane], aabbs.max_x[lane], t_entry, t_exit);
+        slab_scalar_ordered(ray.origin.y, ray.inv_direction.y, aabbs.min_y[lane], aabbs.max_y[lane], t_entry, t_exit);
+        slab_scalar_ordered(ray.origin.z, ray.inv_direction.z, aabbs.min_z[lane], aabbs.max_z[lane], t_entry, t_exit);
+
+        t_near[lane] = t_entry;
+        mask |= static_cast<u32>(t_entry <= t_exit) << lane;
+    }
+
+    return mask;
+}
+
+template<u32 N>
+u32 ray_aabb_packet_intersection_test_simd(SlabRay const& ray, AABBPacket<N> const& aabbs, float t_near[N])
+{
+    using F = SIMD::Float<N>;
+    using V = typename F::Type;
+
+    V t_entry = F::set1(ray.t_min);
+    V t_exit = F::set1(ray.t_max);
+    V const exit_scale = F::set1(SLAB_EXIT_SCALE);
+
+    // With a single ray the entry and exit planes are picked once per axis from the sign of its direction,
+    // which also makes inverted (empty) boxes miss.
+    auto const slab = [&](float const origin, float const inv_direction, float const* aabb_min, float const* aabb_max) {
+        float const* entry_planes = inv_direction < 0.0f ? aabb_max : aabb_min;
+        float const* exit_planes = inv_direction < 0.0f ? aabb_min : aabb_max;
+        V const o = F::set1(origin);
+        V const inv = F::set1(inv_direction);
+        t_entry = F::max(F::mul(F::sub(F::load(entry_planes), o), inv), t_entry);
+        t_exit = F::min(F::mul(F::mul(F::sub(F::load(exit_planes), o), inv), exit_scale), t_exit);
+    };
+
+    slab(ray.origin.x, ray.inv_direction.x, aabbs.min_x, aabbs.max_x);
+    slab(ray.origin.y, ray.inv_direction.y, aabbs.min_y, aabbs.max_y);
+    slab(ray.origin.z, ray.inv_direction.z, aabbs.min_z, aabbs.max_z);
+
+    F::store(t_near, t_entry);
+    return F::less_equal_mask(t_entry, t_exit);
+}
+
+}
+
+// Tests one ray against one box, e.g. a node of a binary BVH.
+inline bool ray_aabb_intersection_test(SlabRay const& ray, float3 const aabb_min, float3 const aabb_max, float& t_near)
+{
+    float t_entry = ray.t_min;
+    float t_exit = ray.t_max;
+    Detail::slab_scalar_ordered(ray.origin.x, ray.inv_direction.x, aabb_min.x, aabb_max.x, t_entry, t_exit);
+    Detail::slab_scalar_ordered(ray.origin.y, ray.inv_direction.y, aabb_min.y, aabb_max.y, t_entry, t_exit);
+    Detail::slab_scalar_ordered(ray.origin.z, ray.inv_direction.z, aabb_min.z, aabb_max.z, t_entry, t_exit);
+
+    t_near = t_entry;
+    return t_entry <= t_exit;
+}
+
+// Tests N rays against one box. Uses SSE for 4, AVX2 for 8 and AVX-512 for 16 rays when the target enables them.
+template<u32 N>
+u32 ray_packet_aabb_intersection_test(RayPacket<N> const& packet, float3 const aabb[2], float t_near[N])
+{
+    if constexpr (SIMD::has_float<N>)
+    {
+        return Detail::ray_packet_aabb_intersection_test_simd(packet, aabb, t_near);
+    }
+    else
+    {
+        return Detail::ray_packet_aabb_intersection_test_scalar(packet, aabb, t_near);
+    }
+}
+
+// Tests one ray against N boxes, e.g. the children of a wide BVH node.
+template<u32 N>
+u32 ray_aabb_packet_intersection_test(SlabRay const& ray, AABBPacket<N> const& aabbs, float t_near[N])
+{
+    if constexpr (SIMD::has_float<N>)
+    {
+        return Detail::ray_aabb_packet_intersection_test_simd(ray, aabbs, t_near);
+    }
+    else
+    {
+        return Detail::ray_aabb_packet_intersection_test_scalar(ray, aabbs, t_near);
+    }
+}
+
+}
@@ -0,0 +1,49 @@
+#include "CPU/RayQueue.h"
+
+namespace CPU
+{
+
+void RayQueue::clear()
+{
+    m_origin_x.clear();
+    m_origin_y.clear();
+    m_origin_z.clear();
+    m_direction_x.clear();
+    m_direction_y.clear();
+    m_direction_z.clear();
+    m_path_indices.clear();
+}
+
+void RayQueue::push(Ray const& ray, u32 const path_index)
+{
+    m_origin_x.push_back(ray.origin.x);
+    m_origin_y.push_back(ray.origin.y);
+    m_origin_z.push_back(ray.origin.z);
+    m_direction_x.push_back(ray.direction.x);
+    m_direction_y.push_back(ray.direction.y);
+    m_direction_z.push_back(ray.direction.z);
+    m_path_indices.push_back(path_index);
+}
+
+u32 RayQueue::size() const
+{
+    return static_cast<u32>(m_path_indices.size());
+}
+
+bool RayQueue::is_empty() const
+{
+    return m_path_indices.empty();
+}
+
+Ray RayQueue::get_ray(u32 const ray_index) const
+{
+    return {{m_origin_x[ray_index], m_origin_y[ray_index], m_origin_z[ray_index]},
+            {m_direction_x[ray_index], m_direction_y[ray_index], m_direction_z[ray_index]}};
+}
+
+u32 RayQueue::get_path_index(u32 const ray_index) const
+{
+    return m_path_indices[ray_index];
+}
+
+}
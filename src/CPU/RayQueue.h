@@ -0,0 +1,36 @@
+#pragma once
+
+#include "AK/Types.h"
+#include "CPU/RaytracingShaderHelper.h"
+#include "CPU/ShaderMath.h"
+
+#include <vector>
+
+namespace CPU
+{
+
+// Rays of a single ray type waiting to be traced, in SoA layout. Every ray carries the index of the path it continues,
+// so whatever it finds can be added back to the right pixel once the whole queue has been traced.
+class RayQueue
+{
+public:
+    void clear();
+    void push(Ray const& ray, u32 const path_index);
+
+    [[nodiscard]] u32 size() const;
+    [[nodiscard]] bool is_empty() const;
+
+    [[nodiscard]] Ray get_ray(u32 const ray_index) const;
+    [[nodiscard]] u32 get_path_index(u32 const ray_index) const;
+
+private:
+    std::vector<float> m_origin_x = {};
+    std::vector<float> m_origin_y = {};
+    std::vector<float> m_origin_z = {};
+    std::vector<float> m_direction_x = {};
+    std::vector<float> m_direction_y = {};
+    std::vector<float> m_direction_z = {};
+    std::vector<u32> m_path_indices = {};
+};
+
+}
@@ -0,0 +1,1611 @@
+#include "CPU/Raytracer.h"
+
+#include "CPU/MeshBaker.h"
+#include "CPU/ProceduralPrimitivesLibrary.h"
+
+#include <DirectXMath.h>
+
+#include <algorithm>
+#include <utility>
+
+using namespace DirectX;
+
+namespace CPU
+{
+
+namespace
+{
+
+// Primitives whose distance functions cost more than a distance field lookup.
+std::array constexpr CACHED_SIGNED_DISTANCE_PRIMITIVES = {SignedDistancePrimitive::Cog, SignedDistancePrimitive::FractalPyramid};
+
+// Cells across a primitive's AABB along every axis of its baked mesh. Swapped in only far from the camera,
+// where a cell is about a pixel wide.
+u32 constexpr BAKED_MESH_RESOLUTION = 64;
+
+// Refitting acceleration structures stops paying off once it has grown their SAH cost by more than this, and they get rebuilt.
+float constexpr MAX_SAH_COST_GROWTH = 0.25f;
+
+u32 constexpr METABALLS_PRIMITIVE_INDEX = static_cast<u32>(AnalyticPrimitive::Count) + static_cast<u32>(VolumetricPrimitive::Metaballs);
+u32 constexpr FIRST_SIGNED_DISTANCE_PRIMITIVE_INDEX = static_cast<u32>(AnalyticPrimitive::Count) + static_cast<u32>(VolumetricPrimitive::Count);
+
+float3 to_float3(XMFLOAT3 const& v)
+{
+    return {v.x, v.y, v.z};
+}
+
+float3 to_float3(XMVECTOR const& v)
+{
+    XMFLOAT3 f;
+    XMStoreFloat3(&f, v);
+    return to_float3(f);
+}
+
+float4 to_float4(XMFLOAT4 const& v)
+{
+    return {v.x, v.y, v.z, v.w};
+}
+
+float4 to_float4(XMVECTOR const& v)
+{
+    XMFLOAT4 f;
+    XMStoreFloat4(&f, v);
+    return to_float4(f);
+}
+
+float4x4 to_float4x4(XMMATRIX const& m)
+{
+    XMFLOAT4X4 f;
+    XMStoreFloat4x4(&f, m);
+
+    float4x4 result = {};
+    for (u32 i = 0; i < 4; i++)
+    {
+        for (u32 j = 0; j < 4; j++)
+        {
+            result.m[i][j] = f.m[i][j];
+        }
+    }
+    return result;
+}
+
+}
+
+Raytracer::Raytracer(RaytracingScene const& scene) : m_scene(scene)
+{
+}
+
+void Raytracer::build()
+{
+    // Triangle geometry.
+    m_triangles.clear();
+    {
+        auto const& indices = m_scene.get_plane_indices();
+        auto const& vertices = m_scene.get_plane_vertices();
+        for (u32 i = 0; i + 2 < indices.size(); i += 3)
+        {
+            Triangle triangle = {};
+            triangle.v0 = to_float3(vertices[indices[i]].position);
+            triangle.v1 = to_float3(vertices[indices[i + 1]].position);
+            triangle.v2 = to_float3(vertices[indices[i + 2]].position);
+            triangle.normal = to_float3(vertices[indices[i]].normal);
+            m_triangles.push_back(triangle);
+        }
+    }
+
+    // AABB geometry, one AABB per geometry.
+    m_aabbs = calculate_primitive_bounds(m_scene.get_aabbs());
+
+    // Bottom-level acceleration structures. Primitive indices match m_triangles and m_aabbs.
+    m_bottom_level_as[BottomLevelASType::Triangle].build(
+        calculate_primitive_bounds<RaytracingScene::Index>(m_scene.get_plane_vertices(), m_scene.get_plane_indices()));
+    m_bottom_level_as[BottomLevelASType::AABB].build(m_aabbs);
+
+    // Top-level acceleration structure.
+    {
+        std::vector<Instance> instances = {};
+        for (auto const& instance_desc : m_scene.get_instance_descs())
+        {
+            XMMATRIX const object_to_world = XMLoadFloat3x4(&instance_desc.transform);
+
+            Instance instance = {};
+            instance.object_to_world = to_float4x4(object_to_world);
+            instance.world_to_object = to_float4x4(XMMatrixInverse(nullptr, object_to_world));
+            instance.instance_mask = instance_desc.instance_mask;
+            instance.instance_contribution_to_hit_group_index = instance_desc.instance_contribution_to_hit_group_index;
+            instance.bottom_level_as_index = instance_desc.bottom_level_as_type;
+            instances.push_back(instance);
+        }
+
+        m_top_level_as.build(std::move(instances), m_bottom_level_as);
+    }
+
+    if (m_grid_enabled)
+    {
+        m_aabb_grid.build(m_aabbs);
+        update_top_level_as();
+    }
+
+    if (m_wide_bvh_enabled)
+    {
+        for (u32 i = 0; i < BottomLevelASType::Count; i++)
+        {
+            m_wide_bottom_level_as[i].build(m_bottom_level_as[i]);
+        }
+    }
+
+    // Cached occluders index the previous instances and geometry.
+    m_last_occluders.clear();
+
+    // Hit group shader table, laid out the same way as on the GPU.
+    m_hit_group_shader_table.clear();
+    {
+        // Triangle geometry hit groups.
+        for (u32 ray_type = 0; ray_type < RayType::Count; ray_type++)
+        {
+            HitGroupRecord record = {};
+            record.geometry_type = GeometryType::Triangle;
+            record.has_closest_hit_shader = ray_type == RayType::Radiance;
+            record.material_cb = m_scene.get_plane_material_cb();
+            m_hit_group_shader_table.push_back(record);
+        }
+
+        // AABB geometry hit groups.
+        for (u32 i_shader = 0, instance_index = 0; i_shader < IntersectionShaderType::Count; i_shader++)
+        {
+            u32 const num_primitive_types =
+                IntersectionShaderType::per_primitive_type_count(static_cast<IntersectionShaderType::Enum>(i_shader));
+
+            for (u32 primitive_index = 0; primitive_index < num_primitive_types; primitive_index++, instance_index++)
+            {
+                for (u32 ray_type = 0; ray_type < RayType::Count; ray_type++)
+                {
+                    HitGroupRecord record = {};
+                    record.geometry_type = GeometryType::AABB;
+                    record.intersection_shader_type = static_cast<IntersectionShaderType::Enum>(i_shader);
+                    record.has_closest_hit_shader = ray_type == RayType::Radiance;
+                    record.material_cb = m_scene.get_aabb_material_cb(instance_index);
+                    record.aabb_cb.instance_index = instance_index;
+                    record.aabb_cb.primitive_type = primitive_index;
+                    m_hit_group_shader_table.push_back(record);
+                }
+            }
+        }
+    }
+}
+
+void Raytracer::dispatch_rays(RenderTarget& render_target)
+{
+    uint2 const dimensions = {render_target.get_width(), render_target.get_height()};
+    update_frame_constants(dimensions);
+    update_acceleration_structures();
+    update_baked_meshes();
+    update_warm_starts(dimensions);
+    m_last_occluders.resize(m_tile_scheduler.get_thread_count());
+
+    if (m_wavefront_enabled)
+    {
+        m_wavefronts.resize(m_tile_scheduler.get_thread_count());
+        m_tile_scheduler.dispatch(dimensions, [&](TileScheduler::Tile const& tile, u32 const thread_index) {
+            render_tile_wavefront(tile, dimensions, thread_index, m_wavefronts[thread_index], render_target);
+        });
+        return;
+    }
+
+    // Tiles are handed out with work stealing, which keeps threads busy even though some tiles are far more expensive than others.
+    m_tile_scheduler.dispatch(dimensions, [&](TileScheduler::Tile const& tile, u32 const thread_index) {
+        for (u32 y = tile.origin.y; y < tile.origin.y + tile.size.y; y++)
+        {
+            for (u32 x = tile.origin.x; x < tile.origin.x + tile.size.x; x++)
+            {
+                DispatchContext const context = {{x, y}, dimensions, thread_index};
+                render_target.set_pixel(x, y, raygen_shader(context));
+            }
+        }
+    });
+}
+
+void Raytracer::set_thread_count(u32 const thread_count)
+{
+    m_tile_scheduler.set_thread_count(thread_count);
+}
+
+u32 Raytracer::get_thread_count() const
+{
+    return m_tile_scheduler.get_thread_count();
+}
+
+void Raytracer::set_tile_size(u32 const tile_size)
+{
+    m_tile_scheduler.set_tile_size(tile_size);
+}
+
+u32 Raytracer::get_tile_size() const
+{
+    return m_tile_scheduler.get_tile_size();
+}
+
+void Raytracer::set_wavefront_enabled(bool const enabled)
+{
+    m_wavefront_enabled = enabled;
+}
+
+bool Raytracer::is_wavefront_enabled() const
+{
+    return m_wavefront_enabled;
+}
+
+void Raytracer::set_distance_field_cache_enabled(bool const enabled)
+{
+    m_distance_field_cache_enabled = enabled;
+    if (!enabled)
+    {
+        return;
+    }
+
+    for (SignedDistancePrimitive::Enum const sd_primitive : CACHED_SIGNED_DISTANCE_PRIMITIVES)
+    {
+        if (m_distance_fields[sd_primitive].is_empty() && m_signed_distance_programs[sd_primitive].is_empty())
+        {
+            m_distance_fields[sd_primitive].build(sd_primitive);
+        }
+    }
+}
+
+bool Raytracer::is_distance_field_cache_enabled() const
+{
+    return m_distance_field_cache_enabled;
+}
+
+void Raytracer::set_metaballs(std::span<Metaball const> const metaballs)
+{
+    m_metaball_grid.build(metaballs);
+    m_metaballs.assign(metaballs.begin(), metaballs.end());
+}
+
+void Raytracer::set_warm_start_enabled(bool const enabled)
+{
+    m_warm_start_enabled = enabled;
+    m_warm_starts.clear();
+}
+
+bool Raytracer::is_warm_start_enabled() const
+{
+    return m_warm_start_enabled;
+}
+
+void Raytracer::set_baked_mesh_distance(float const distance)
+{
+    m_baked_mesh_distance = distance;
+    if (distance == INFINITY_F)
+    {
+        return;
+    }
+
+    for (u32 i = 0; i < SignedDistancePrimitive::Count; i++)
+    {
+        TriangleMesh& baked_mesh = m_baked_meshes[FIRST_SIGNED_DISTANCE_PRIMITIVE_INDEX + i];
+        if (baked_mesh.is_empty() && m_signed_distance_programs[i].is_empty())
+        {
+            baked_mesh.build(bake_signed_distance_primitive(static_cast<SignedDistancePrimitive::Enum>(i), BAKED_MESH_RESOLUTION));
+        }
+    }
+}
+
+float Raytracer::get_baked_mesh_distance() const
+{
+    return m_baked_mesh_distance;
+}
+
+bool Raytracer::set_signed_distance_expression(SignedDistancePrimitive::Enum const sd_primitive,
+                                               SignedDistanceExpression const& expression)
+{
+    SignedDistanceProgramOctree programs = {};
+    if (!programs.build(expression))
+    {
+        return false;
+    }
+
+    m_signed_distance_programs[sd_primitive] = std::move(programs);
+    m_distance_fields[sd_primitive] = {};
+    m_baked_meshes[FIRST_SIGNED_DISTANCE_PRIMITIVE_INDEX + sd_primitive] = {};
+    return true;
+}
+
+void Raytracer::set_signed_distance_pruning_enabled(bool const enabled)
+{
+    m_signed_distance_pruning_enabled = enabled;
+}
+
+bool Raytracer::is_signed_distance_pruning_enabled() const
+{
+    return m_signed_distance_pruning_enabled;
+}
+
+void Raytracer::set_grid_enabled(bool const enabled)
+{
+    m_grid_enabled = enabled;
+    if (enabled)
+    {
+        m_aabb_grid.build(m_aabbs);
+    }
+    else
+    {
+        // The BVH got left as it was while the grid was in use.
+        m_aabb_grid = {};
+        m_bottom_level_as[BottomLevelASType::AABB].build(m_aabbs);
+        if (m_wide_bvh_enabled)
+        {
+            m_wide_bottom_level_as[BottomLevelASType::AABB].build(m_bottom_level_as[BottomLevelASType::AABB]);
+        }
+    }
+    update_top_level_as();
+}
+
+bool Raytracer::is_grid_enabled() const
+{
+    return m_grid_enabled;
+}
+
+void Raytracer::set_wide_bvh_enabled(bool const enabled)
+{
+    m_wide_bvh_enabled = enabled;
+    for (u32 i = 0; i < BottomLevelASType::Count; i++)
+    {
+        m_wide_bottom_level_as[i] = {};
+        if (enabled)
+        {
+            m_wide_bottom_level_as[i].build(m_bottom_level_as[i]);
+        }
+    }
+}
+
+bool Raytracer::is_wide_bvh_enabled() const
+{
+    return m_wide_bvh_enabled;
+}
+
+void Raytracer::update_frame_constants(uint2 const dimensions)
+{
+    SceneConstantBuffer const& scene_cb = m_scene.get_scene_cb();
+    m_frame_constants.projection_to_world = to_float4x4(scene_cb.projection_to_world);
+    m_frame_constants.camera_position = to_float3(scene_cb.camera_position);
+    m_frame_constants.light_position = to_float3(scene_cb.light_position);
+    m_frame_constants.light_ambient_color = to_float4(scene_cb.light_ambient_color);
+    m_frame_constants.light_diffuse_color = to_float4(scene_cb.light_diffuse_color);
+    m_frame_constants.elapsed_time = scene_cb.elapsed_time;
+    m_frame_constants.pixel_spread_angle =
+        calculate_pixel_spread_angle(dimensions, m_frame_constants.camera_position, m_frame_constants.projection_to_world);
+
+    for (u32 i = 0; i < IntersectionShaderType::TOTAL_PRIMITIVE_COUNT; i++)
+    {
+        PrimitiveInstancePerFrameBuffer const& attributes = m_scene.get_aabb_primitive_attributes(i);
+        m_frame_constants.aabb_primitive_attributes[i].local_space_to_bottom_level_as =
+            to_float4x4(attributes.local_space_to_bottom_level_as);
+        m_frame_constants.aabb_primitive_attributes[i].bottom_level_as_to_local_space =
+            to_float4x4(attributes.bottom_level_as_to_local_space);
+    }
+}
+
+void Raytracer::update_acceleration_structures()
+{
+    m_aabbs = calculate_primitive_bounds(m_scene.get_aabbs());
+
+    // The scene only bounds its own metaballs.
+    if (!m_metaball_grid.is_empty())
+    {
+        float4x4 const& local_space_to_bottom_level_as =
+            m_frame_constants.aabb_primitive_attributes[METABALLS_PRIMITIVE_INDEX].local_space_to_bottom_level_as;
+        m_aabbs[METABALLS_PRIMITIVE_INDEX] = transform_aabb(m_metaball_grid.get_bounds(), local_space_to_bottom_level_as);
+    }
+
+    // Only a few primitives move, and not far, so refitting rarely loses much. The grid builds in linear time anyway.
+    if (m_grid_enabled)
+    {
+        m_aabb_grid.build(m_aabbs);
+    }
+    else
+    {
+        m_bottom_level_as[BottomLevelASType::AABB].update(m_aabbs, MAX_SAH_COST_GROWTH);
+        if (m_wide_bvh_enabled)
+        {
+            m_wide_bottom_level_as[BottomLevelASType::AABB].build(m_bottom_level_as[BottomLevelASType::AABB]);
+        }
+    }
+    update_top_level_as();
+}
+
+void Raytracer::update_top_level_as()
+{
+    if (!m_grid_enabled)
+    {
+        m_top_level_as.update(m_bottom_level_as, MAX_SAH_COST_GROWTH);
+        return;
+    }
+
+    std::array<AABB, BottomLevelASType::Count> bottom_level_as_bounds = {};
+    bottom_level_as_bounds[BottomLevelASType::Triangle] = m_bottom_level_as[BottomLevelASType::Triangle].get_bounds();
+    bottom_level_as_bounds[BottomLevelASType::AABB] = m_aabb_grid.get_bounds();
+    m_top_level_as.update(bottom_level_as_bounds, MAX_SAH_COST_GROWTH);
+}
+
+void Raytracer::update_baked_meshes()
+{
+    m_frame_constants.use_baked_mesh = {};
+    if (m_baked_mesh_distance == INFINITY_F)
+    {
+        return;
+    }
+
+    // A primitive is far once the camera is farther than the distance from it in world space, in every instance of the AABBs.
+    float3 const camera_position = m_frame_constants.camera_position;
+    auto const is_far = [&](u32 const primitive_index) {
+        for (Instance const& instance : m_top_level_as.get_instances())
+        {
+            if (instance.bottom_level_as_index != BottomLevelASType::AABB)
+            {
+                continue;
+            }
+
+            AABB const aabb = transform_aabb(m_aabbs[primitive_index], instance.object_to_world);
+            if (length(min(max(camera_position, aabb.min), aabb.max) - camera_position) <= m_baked_mesh_distance)
+            {
+                return false;
+            }
+        }
+        return true;
+    };
+
+    for (u32 i = FIRST_SIGNED_DISTANCE_PRIMITIVE_INDEX; i < IntersectionShaderType::TOTAL_PRIMITIVE_COUNT; i++)
+    {
+        m_frame_constants.use_baked_mesh[i] = !m_baked_meshes[i].is_empty() && is_far(i);
+    }
+
+    // The scene's animated metaballs move every frame, and baking them that often costs more than tracing them, so only
+    // the ones of set_metaballs() get baked, again whenever they have been replaced.
+    if (m_metaball_grid.is_empty() || !is_far(METABALLS_PRIMITIVE_INDEX))
+    {
+        return;
+    }
+
+    bool const have_moved = !std::equal(m_metaballs.begin(), m_metaballs.end(), m_baked_metaballs.begin(), m_baked_metaballs.end(),
+                                        [](Metaball const& a, Metaball const& b) {
+                                            return a.center.x == b.center.x && a.center.y == b.center.y && a.center.z == b.center.z
+                                                && a.radius == b.radius;
+                                        });
+    if (have_moved || m_baked_meshes[METABALLS_PRIMITIVE_INDEX].is_empty())
+    {
+        m_baked_meshes[METABALLS_PRIMITIVE_INDEX].build(bake_metaballs(m_metaballs, BAKED_MESH_RESOLUTION));
+        m_baked_metaballs = m_metaballs;
+    }
+
+    m_frame_constants.use_baked_mesh[METABALLS_PRIMITIVE_INDEX] = !m_baked_meshes[METABALLS_PRIMITIVE_INDEX].is_empty();
+}
+
+// When the camera moves, or the dimensions change, each warm start moves to the pixel its position now projects to. The ray there
+// only starts from it if its path runs within the warm start's clearance, and traces from its start if the surface turns out to be
+// behind it, the same as for a primitive that has moved. Fractal detail depends on where the camera is and on the pixel size,
+// so the empty space found in the fractal only stays empty for the same camera, and the fractal's warm starts get dropped.
+void Raytracer::update_warm_starts(uint2 const dimensions)
+{
+    if (!m_warm_start_enabled)
+    {
+        return;
+    }
+
+    float const* const projection_to_world = &m_frame_constants.projection_to_world.m[0][0];
+    bool const is_camera_unchanged =
+        std::equal(projection_to_world, projection_to_world + 16, &m_warm_start_projection_to_world.m[0][0])
+        && m_frame_constants.camera_position.x == m_warm_start_camera_position.x
+        && m_frame_constants.camera_position.y == m_warm_start_camera_position.y
+        && m_frame_constants.camera_position.z == m_warm_start_camera_position.z;
+    bool const have_warm_starts = m_warm_starts.size() == m_warm_start_dimensions.x * m_warm_start_dimensions.y;
+    if (is_camera_unchanged && dimensions.x == m_warm_start_dimensions.x && dimensions.y == m_warm_start_dimensions.y
+        && have_warm_starts)
+    {
+        return;
+    }
+
+    std::vector<PixelWarmStart> previous_warm_starts = {};
+    if (have_warm_starts)
+    {
+        previous_warm_starts.swap(m_warm_starts);
+    }
+    m_warm_starts.assign(dimensions.x * dimensions.y, {});
+    m_warm_start_dimensions = dimensions;
+    m_warm_start_camera_position = m_frame_constants.camera_position;
+    m_warm_start_projection_to_world = m_frame_constants.projection_to_world;
+
+    // Where several warm starts land in the same pixel, the one nearest to the camera is the one its ray can reach.
+    float4x4 const world_to_projection = to_float4x4(XMMatrixInverse(nullptr, m_scene.get_scene_cb().projection_to_world));
+    std::vector<float> distances(m_warm_starts.size(), INFINITY_F);
+    for (PixelWarmStart const& warm_start : previous_warm_starts)
+    {
+        if (warm_start.trace.clearance <= 0.0f)
+        {
+            continue;
+        }
+
+        HitGroupRecord const& record = m_hit_group_shader_table[warm_start.hit_group_index];
+        if (record.intersection_shader_type == IntersectionShaderType::SignedDistancePrimitive
+            && record.aabb_cb.primitive_type == SignedDistancePrimitive::FractalPyramid)
+        {
+            continue;
+        }
+
+        Instance const& instance = m_top_level_as.get_instance(warm_start.instance_index);
+        AABBPrimitiveTransforms const& aabb_attribute = m_frame_constants.aabb_primitive_attributes[record.aabb_cb.instance_index];
+        float3 const position =
+            mul_position(mul_position(warm_start.trace.position, aabb_attribute.local_space_to_bottom_level_as), instance.object_to_world);
+
+        // Inverse of generate_camera_ray()'s unprojection.
+        float4 const projected = mul(float4 {position.x, position.y, position.z, 1.0f}, world_to_projection);
+        if (projected.w <= 0.0f)
+        {
+            continue;
+        }
+
+        float const x = (0.5f * projected.x / projected.w + 0.5f) * static_cast<float>(dimensions.x);
+        float const y = (-0.5f * projected.y / projected.w + 0.5f) * static_cast<float>(dimensions.y);
+        if (!(x >= 0.0f && x < static_cast<float>(dimensions.x) && y >= 0.0f && y < static_cast<float>(dimensions.y)))
+        {
+            continue;
+        }
+
+        u32 const pixel_index = static_cast<u32>(y) * dimensions.x + static_cast<u32>(x);
+        float const distance = length(position - m_frame_constants.camera_position);
+        if (distance < distances[pixel_index])
+        {
+            distances[pixel_index] = distance;
+            m_warm_starts[pixel_index] = warm_start;
+        }
+    }
+}
+
+Raytracer::PixelWarmStart* Raytracer::get_warm_start(uint2 const pixel, uint2 const dimensions, u32 const current_ray_recursion_depth) const
+{
+    if (!m_warm_start_enabled || current_ray_recursion_depth != 0)
+    {
+        return nullptr;
+    }
+
+    return &m_warm_starts[pixel.y * dimensions.x + pixel.x];
+}
+
+bool Raytracer::trace_ray(Ray const& ray, u32 const ray_flags, u32 const ray_contribution_to_hit_group_index,
+                          u32 const multiplier_for_geometry_contribution_to_hit_group_index, float const t_min, float const t_max,
+                          Hit& hit, PixelWarmStart* warm_start) const
+{
+    RayState state = {t_min, t_max, ray_flags};
+
+    auto const intersect_instance = [&](u32 const instance_index, Instance const& instance, Ray const& object_ray, RayState& state) {
+        if (instance.bottom_level_as_index == BottomLevelASType::Triangle)
+        {
+            return intersect_triangles(object_ray, instance_index, instance, ray_contribution_to_hit_group_index, state, hit);
+        }
+
+        return intersect_aabbs(object_ray, instance_index, instance, ray_contribution_to_hit_group_index,
+                               multiplier_for_geometry_contribution_to_hit_group_index, state, hit, warm_start);
+    };
+
+    if (ray_flags & RayFlag::AcceptFirstHitAndEndSearch)
+    {
+        return m_top_level_as.intersect_any(ray, TraceRayParameters::INSTANCE_MASK, state, intersect_instance);
+    }
+
+    bool const is_hit = m_top_level_as.intersect_closest(ray, TraceRayParameters::INSTANCE_MASK, state, intersect_instance);
+    if (warm_start)
+    {
+        *warm_start = {};
+        if (is_hit && hit.warm_start.clearance > 0.0f)
+        {
+            *warm_start = {hit.instance_index, hit.hit_group_index, hit.warm_start};
+        }
+    }
+    return is_hit;
+}
+
+u32 Raytracer::trace_ray_packet(Ray const (&rays)[PACKET_WIDTH], u32 const lane_mask, u32 const ray_flags,
+                                u32 const ray_contribution_to_hit_group_index,
+                                u32 const multiplier_for_geometry_contribution_to_hit_group_index, float const t_min, float const t_max,
+                                Hit (&hits)[PACKET_WIDTH], PixelWarmStart* const (&warm_starts)[PACKET_WIDTH]) const
+{
+    RayPacket<PACKET_WIDTH> packet;
+    for (u32 lane = 0; lane < PACKET_WIDTH; lane++)
+    {
+        if ((lane_mask & (1u << lane)) != 0)
+        {
+            packet.set_ray(lane, rays[lane], t_min, t_max);
+        }
+        else
+        {
+            packet.set_inactive(lane);
+        }
+    }
+
+    auto const intersect_instance = [&](u32 const instance_index, Instance const& instance, Ray const (&object_rays)[PACKET_WIDTH],
+                                        RayPacket<PACKET_WIDTH>& object_packet, u32 const instance_lane_mask) {
+        u32 const hit_group_index =
+            calculate_hit_group_index(instance.instance_contribution_to_hit_group_index, ray_contribution_to_hit_group_index, 0, 0);
+
+        auto const intersect_primitive = [&](u32 const primitive_index, u32 const primitive_lane_mask, RayState (&states)[PACKET_WIDTH]) {
+            if (instance.bottom_level_as_index != BottomLevelASType::Triangle)
+            {
+                return intersect_aabb_geometry(object_rays, primitive_lane_mask, instance_index, instance,
+                                               ray_contribution_to_hit_group_index, multiplier_for_geometry_contribution_to_hit_group_index,
+                                               primitive_index, states, hits, warm_starts);
+            }
+
+            u32 hit_mask = 0;
+            for (u32 lane = 0; lane < PACKET_WIDTH; lane++)
+            {
+                if ((primitive_lane_mask & (1u << lane)) != 0
+                    && intersect_triangle_primitive(object_rays[lane], instance_index, hit_group_index, primitive_index, states[lane],
+                                                    hits[lane]))
+                {
+                    hit_mask |= 1u << lane;
+                }
+            }
+            return hit_mask;
+        };
+
+        return intersect_bottom_level_as(instance.bottom_level_as_index, object_rays, object_packet, instance_lane_mask, ray_flags,
+                                         intersect_primitive);
+    };
+
+    if (ray_flags & RayFlag::AcceptFirstHitAndEndSearch)
+    {
+        return m_top_level_as.intersect_any(rays, packet, lane_mask, TraceRayParameters::INSTANCE_MASK, intersect_instance);
+    }
+
+    u32 const hit_mask = m_top_level_as.intersect_closest(rays, packet, lane_mask, TraceRayParameters::INSTANCE_MASK, intersect_instance);
+    for (u32 lane = 0; lane < PACKET_WIDTH; lane++)
+    {
+        if (warm_starts[lane])
+        {
+            *warm_starts[lane] = {};
+            if ((hit_mask & (1u << lane)) != 0 && hits[lane].warm_start.clearance > 0.0f)
+            {
+                *warm_starts[lane] = {hits[lane].instance_index, hits[lane].hit_group_index, hits[lane].warm_start};
+            }
+        }
+    }
+    return hit_mask;
+}
+
+template<typename IntersectPrimitive>
+bool Raytracer::intersect_bottom_level_as(u32 const bottom_level_as_index, Ray const& object_ray, RayState& state,
+                                          IntersectPrimitive&& intersect_primitive) const
+{
+    bool const any_hit = state.flags & RayFlag::AcceptFirstHitAndEndSearch;
+    if (m_grid_enabled && bottom_level_as_index == BottomLevelASType::AABB)
+    {
+        return any_hit ? m_aabb_grid.intersect_any(object_ray, state, intersect_primitive)
+                       : m_aabb_grid.intersect_closest(object_ray, state, intersect_primitive);
+    }
+
+    if (m_wide_bvh_enabled)
+    {
+        BVH8 const& wide_bvh = m_wide_bottom_level_as[bottom_level_as_index];
+        return any_hit ? wide_bvh.intersect_any(object_ray, state, intersect_primitive)
+                       : wide_bvh.intersect_closest(object_ray, state, intersect_primitive);
+    }
+
+    BVH const& bvh = m_bottom_level_as[bottom_level_as_index];
+    return any_hit ? bvh.intersect_any(object_ray, state, intersect_primitive)
+                   : bvh.intersect_closest(object_ray, state, intersect_primitive);
+}
+
+template<typename IntersectPrimitive>
+u32 Raytracer::intersect_bottom_level_as(u32 const bottom_level_as_index, Ray const (&object_rays)[PACKET_WIDTH],
+                                         RayPacket<PACKET_WIDTH>& packet, u32 const lane_mask, u32 const ray_flags,
+                                         IntersectPrimitive&& intersect_primitive) const
+{
+    auto const intersect_lanes = [&](u32 const primitive_index, u32 const primitive_lane_mask) {
+        RayState states[PACKET_WIDTH];
+        for (u32 lane = 0; lane < PACKET_WIDTH; lane++)
+        {
+            states[lane] = {packet.t_min[lane], packet.t_max[lane], ray_flags};
+        }
+
+        u32 const hit_mask = intersect_primitive(primitive_index, primitive_lane_mask, states);
+        for (u32 lane = 0; lane < PACKET_WIDTH; lane++)
+        {
+            if ((hit_mask & (1u << lane)) != 0)
+            {
+                packet.t_max[lane] = states[lane].t_current;
+            }
+        }
+        return hit_mask;
+    };
+
+    bool const any_hit = ray_flags & RayFlag::AcceptFirstHitAndEndSearch;
+    if (m_wide_bvh_enabled || (m_grid_enabled && bottom_level_as_index == BottomLevelASType::AABB))
+    {
+        // Neither the grid nor the wide BVHs trace packets, their rays go through them one by one.
+        u32 hit_mask = 0;
+        for (u32 lane = 0; lane < PACKET_WIDTH; lane++)
+        {
+            if ((lane_mask & (1u << lane)) == 0)
+            {
+                continue;
+            }
+
+            RayState state = {packet.t_min[lane], packet.t_max[lane], ray_flags};
+            auto const intersect_lane = [&](u32 const primitive_index, RayState& state) {
+                RayState states[PACKET_WIDTH];
+                states[lane] = state;
+                bool const is_hit = intersect_primitive(primitive_index, 1u << lane, states) != 0;
+                state = states[lane];
+                return is_hit;
+            };
+            if (intersect_bottom_level_as(bottom_level_as_index, object_rays[lane], state, intersect_lane))
+            {
+                packet.t_max[lane] = state.t_current;
+                hit_mask |= 1u << lane;
+            }
+        }
+        return hit_mask;
+    }
+
+    BVH const& bvh = m_bottom_level_as[bottom_level_as_index];
+    return any_hit ? bvh.intersect_any(packet, lane_mask, intersect_lanes) : bvh.intersect_closest(packet, lane_mask, intersect_lanes);
+}
+
+bool Raytracer::intersect_triangles(Ray const& object_ray, u32 const instance_index, Instance const& instance,
+                                    u32 const ray_contribution_to_hit_group_index, RayState& state, Hit& hit) const
+{
+    // Triangle BLAS has a single geometry.
+    u32 const hit_group_index =
+        calculate_hit_group_index(instance.instance_contribution_to_hit_group_index, ray_contribution_to_hit_group_index, 0, 0);
+
+    auto const intersect_primitive = [&](u32 const primitive_index, RayState& state) {
+        return intersect_triangle_primitive(object_ray, instance_index, hit_group_index, primitive_index, state, hit);
+    };
+
+    return intersect_bottom_level_as(BottomLevelASType::Triangle, object_ray, state, intersect_primitive);
+}
+
+bool Raytracer::intersect_triangle_primitive(Ray const& object_ray, u32 const instance_index, u32 const hit_group_index,
+                                             u32 const primitive_index, RayState& state, Hit& hit) const
+{
+    float thit = 0.0f;
+    if (!intersect_triangle(object_ray, primitive_index, state, thit))
+    {
+        return false;
+    }
+
+    state.t_current = thit;
+    hit = {thit, instance_index, hit_group_index, primitive_index, {}};
+    return true;
+}
+
+// Each AABB is its own geometry, so its primitive index is also the geometry index of the hit group.
+bool Raytracer::intersect_aabbs(Ray const& object_ray, u32 const instance_index, Instance const& instance,
+                                u32 const ray_contribution_to_hit_group_index,
+                                u32 const multiplier_for_geometry_contribution_to_hit_group_index, RayState& state, Hit& hit,
+                                PixelWarmStart const* warm_start) const
+{
+    auto const intersect_geometry = [&](u32 const geometry_index, RayState& state) {
+        return intersect_aabb_geometry(object_ray, instance_index, instance, ray_contribution_to_hit_group_index,
+                                       multiplier_for_geometry_contribution_to_hit_group_index, geometry_index, state, hit, warm_start);
+    };
+
+    return intersect_bottom_level_as(BottomLevelASType::AABB, object_ray, state, intersect_geometry);
+}
+
+bool Raytracer::intersect_aabb_geometry(Ray const& object_ray, u32 const instance_index, Instance const& instance,
+                                        u32 const ray_contribution_to_hit_group_index,
+                                        u32 const multiplier_for_geometry_contribution_to_hit_group_index, u32 const geometry_index,
+                                        RayState& state, Hit& hit, PixelWarmStart const* warm_start) const
+{
+    u32 const hit_group_index =
+        calculate_hit_group_index(instance.instance_contribution_to_hit_group_index, ray_contribution_to_hit_group_index,
+                                  multiplier_for_geometry_contribution_to_hit_group_index, geometry_index);
+
+    // Every geometry the ray hits gets its warm start, so the closest hit has one too. Only the geometry of the previous
+    // closest hit can start from the previous one.
+    SphereTraceWarmStart trace_warm_start = {};
+    if (warm_start && warm_start->instance_index == instance_index && warm_start->hit_group_index == hit_group_index)
+    {
+        trace_warm_start = warm_start->trace;
+    }
+
+    float thit = 0.0f;
+    ProceduralPrimitiveAttributes attr = {};
+    if (!intersect_aabb(object_ray, instance, m_hit_group_shader_table[hit_group_index], geometry_index, state, thit, attr,
+                        warm_start ? &trace_warm_start : nullptr))
+    {
+        return false;
+    }
+
+    state.t_current = thit;
+    hit = {thit, instance_index, hit_group_index, 0, attr, trace_warm_start};
+    return true;
+}
+
+// Moller-Trumbore ray/triangle test with DXR's winding rules: triangles are front facing when clockwise.
+bool Raytracer::intersect_triangle(Ray const& object_ray, u32 const primitive_index, RayState const& state, float& thit) const
+{
+    Triangle const& triangle = m_triangles[primitive_index];
+    float3 const e1 = triangle.v1 - triangle.v0;
+    float3 const e2 = triangle.v2 - triangle.v0;
+    float3 const p = cross(object_ray.direction, e2);
+
+    // det > 0 for front facing (clockwise) triangles, det < 0 for back facing ones.
+    float const det = dot(e1, p);
+    if (det == 0.0f)
+    {
+        return false;
+    }
+
+    if (((state.flags & RayFlag::CullBackFacingTriangles) && det < 0.0f)
+        || ((state.flags & RayFlag::CullFrontFacingTriangles) && det > 0.0f))
+    {
+        return false;
+    }
+
+    float const inv_det = 1.0f / det;
+    float3 const s = object_ray.origin - triangle.v0;
+    float const u = dot(s, p) * inv_det;
+    if (u < 0.0f || u > 1.0f)
+    {
+        return false;
+    }
+
+    float3 const q = cross(s, e1);
+    float const v = dot(object_ray.direction, q) * inv_det;
+    if (v < 0.0f || u + v > 1.0f)
+    {
+        return false;
+    }
+
+    float const t = dot(e2, q) * inv_det;
+    if (!is_in_range(t, state.t_min, state.t_current))
+    {
+        return false;
+    }
+
+    thit = t;
+    return true;
+}
+
+// Runs the intersection shader of an AABB geometry if the ray enters its bounds.
+bool Raytracer::intersect_aabb(Ray const& object_ray, Instance const& instance, HitGroupRecord const& record, u32 const geometry_index,
+                               RayState const& state, float& thit, ProceduralPrimitiveAttributes& attr,
+                               SphereTraceWarmStart* warm_start) const
+{
+    float3 const aabb[2] = {m_aabbs[geometry_index].min, m_aabbs[geometry_index].max};
+    float tmin, tmax;
+    if (!ray_aabb_intersection_test(object_ray, aabb, tmin, tmax, state))
+    {
+        return false;
+    }
+
+    // ReportHit() only accepts hits within <RayTMin(), RayTCurrent()>.
+    return run_intersection_shader(object_ray, instance, record, state, thit, attr, warm_start)
+        && is_in_range(thit, state.t_min, state.t_current);
+}
+
+bool Raytracer::run_intersection_shader(Ray const& object_ray, Instance const& instance, HitGroupRecord const& record,
+                                        RayState const& state, float& thit, ProceduralPrimitiveAttributes& attr,
+                                        SphereTraceWarmStart* warm_start) const
+{
+    AABBPrimitiveTransforms const& aabb_attribute = m_frame_constants.aabb_primitive_attributes[record.aabb_cb.instance_index];
+
+    // Get ray in AABB's local space.
+    Ray const local_ray = {mul_position(object_ray.origin, aabb_attribute.bottom_level_as_to_local_space),
+                           mul_direction(object_ray.direction, aabb_attribute.bottom_level_as_to_local_space)};
+
+    bool hit_found = false;
+    if (m_frame_constants.use_baked_mesh[record.aabb_cb.instance_index])
+    {
+        hit_found = m_baked_meshes[record.aabb_cb.instance_index].intersect(local_ray, thit, attr, state);
+    }
+    else
+    {
+        switch (record.intersection_shader_type)
+        {
+        case IntersectionShaderType::AnalyticPrimitive:
+            hit_found = ray_analytic_geometry_intersection_test(
+                local_ray, static_cast<AnalyticPrimitive::Enum>(record.aabb_cb.primitive_type), thit, attr, state);
+            break;
+        case IntersectionShaderType::VolumetricPrimitive:
+            if (record.aabb_cb.primitive_type == VolumetricPrimitive::Metaballs && !m_metaball_grid.is_empty())
+            {
+                hit_found = m_metaball_grid.intersect(local_ray, thit, attr, state);
+                break;
+            }
+
+            hit_found = ray_volumetric_geometry_intersection_test(local_ray, static_cast<VolumetricPrimitive::Enum>(record.aabb_cb.primitive_type),
+                                                                  thit, attr, m_frame_constants.elapsed_time, state);
+            break;
+        case IntersectionShaderType::SignedDistancePrimitive:
+        {
+            RayCone const cone = calculate_ray_cone(object_ray, local_ray, instance, state);
+            auto const sd_primitive = static_cast<SignedDistancePrimitive::Enum>(record.aabb_cb.primitive_type);
+            SparseDistanceField const* distance_field = get_distance_field(sd_primitive);
+
+            // Fractal detail follows the distance to the camera rather than along the ray, so shadow and reflection rays
+            // see the same fractal as the camera does.
+            FractalDetail fractal_detail = {};
+            fractal_detail.camera_position = mul_position(mul_position(m_frame_constants.camera_position, instance.world_to_object),
+                                                          aabb_attribute.bottom_level_as_to_local_space);
+            fractal_detail.pixel_spread_angle = m_frame_constants.pixel_spread_angle;
+
+            SignedDistanceProgramOctree const& programs = m_signed_distance_programs[sd_primitive];
+            if (!programs.is_empty() && m_signed_distance_pruning_enabled)
+            {
+                hit_found = ray_signed_distance_program_test(local_ray, programs, thit, attr, state, record.material_cb.step_scale,
+                                                             record.material_cb.over_relaxation, cone, distance_field, warm_start);
+            }
+            else if (!programs.is_empty())
+            {
+                hit_found = ray_signed_distance_program_test(local_ray, programs.get_program(), thit, attr, state,
+                                                             record.material_cb.step_scale, record.material_cb.over_relaxation, cone,
+                                                             distance_field, warm_start);
+            }
+            else
+            {
+                hit_found = ray_signed_distance_primitive_test(local_ray, sd_primitive, thit, attr, state, record.material_cb.step_scale,
+                                                               record.material_cb.over_relaxation, cone, distance_field, fractal_detail,
+                                                               warm_start);
+            }
+            break;
+        }
+        default:
+            break;
+        }
+    }
+
+    if (hit_found && !is_occlusion_ray(state))
+    {
+        transform_normal_to_world(aabb_attribute, instance, attr);
+    }
+
+    return hit_found;
+}
+
+// Signed distance primitives traced through their programs step a packet's rays together, each program instruction
+// decoded once for all of the lanes still stepping. Any other geometry tests the rays one by one.
+u32 Raytracer::intersect_aabb_geometry(Ray const (&object_rays)[PACKET_WIDTH], u32 const lane_mask, u32 const instance_index,
+                                       Instance const& instance, u32 const ray_contribution_to_hit_group_index,
+                                       u32 const multiplier_for_geometry_contribution_to_hit_group_index, u32 const geometry_index,
+                                       RayState (&states)[PACKET_WIDTH], Hit (&hits)[PACKET_WIDTH],
+                                       PixelWarmStart* const (&warm_starts)[PACKET_WIDTH]) const
+{
+    u32 const hit_group_index =
+        calculate_hit_group_index(instance.instance_contribution_to_hit_group_index, ray_contribution_to_hit_group_index,
+                                  multiplier_for_geometry_contribution_to_hit_group_index, geometry_index);
+    HitGroupRecord const& record = m_hit_group_shader_table[hit_group_index];
+    auto const sd_primitive = static_cast<SignedDistancePrimitive::Enum>(record.aabb_cb.primitive_type);
+    if (record.intersection_shader_type != IntersectionShaderType::SignedDistancePrimitive
+        || m_frame_constants.use_baked_mesh[record.aabb_cb.instance_index] || m_signed_distance_programs[sd_primitive].is_empty())
+    {
+        u32 hit_mask = 0;
+        for (u32 lane = 0; lane < PACKET_WIDTH; lane++)
+        {
+            if ((lane_mask & (1u << lane)) != 0
+                && intersect_aabb_geometry(object_rays[lane], instance_index, instance, ray_contribution_to_hit_group_index,
+                                           multiplier_for_geometry_contribution_to_hit_group_index, geometry_index, states[lane],
+                                           hits[lane], warm_starts[lane]))
+            {
+                hit_mask |= 1u << lane;
+            }
+        }
+        return hit_mask;
+    }
+
+    AABBPrimitiveTransforms const& aabb_attribute = m_frame_constants.aabb_primitive_attributes[record.aabb_cb.instance_index];
+    float3 const aabb[2] = {m_aabbs[geometry_index].min, m_aabbs[geometry_index].max};
+
+    // Same per ray setup as intersect_aabb_geometry() and run_intersection_shader().
+    Ray local_rays[PACKET_WIDTH] = {};
+    RayCone cones[PACKET_WIDTH] = {};
+    SphereTraceWarmStart trace_warm_starts[PACKET_WIDTH] = {};
+    SphereTraceWarmStart* trace_warm_start_pointers[PACKET_WIDTH] = {};
+    u32 trace_lane_mask = 0;
+    for (u32 lane = 0; lane < PACKET_WIDTH; lane++)
+    {
+        float tmin, tmax;
+        if ((lane_mask & (1u << lane)) == 0 || !ray_aabb_intersection_test(object_rays[lane], aabb, tmin, tmax, states[lane]))
+        {
+            continue;
+        }
+
+        local_rays[lane] = {mul_position(object_rays[lane].origin, aabb_attribute.bottom_level_as_to_local_space),
+                            mul_direction(object_rays[lane].direction, aabb_attribute.bottom_level_as_to_local_space)};
+        cones[lane] = calculate_ray_cone(object_rays[lane], local_rays[lane], instance, states[lane]);
+
+        PixelWarmStart const* warm_start = warm_starts[lane];
+        if (warm_start)
+        {
+            if (warm_start->instance_index == instance_index && warm_start->hit_group_index == hit_group_index)
+            {
+                trace_warm_starts[lane] = warm_start->trace;
+            }
+            trace_warm_start_pointers[lane] = &trace_warm_starts[lane];
+        }
+
+        trace_lane_mask |= 1u << lane;
+    }
+
+    if (trace_lane_mask == 0)
+    {
+        return 0;
+    }
+
+    float thits[PACKET_WIDTH] = {};
+    ProceduralPrimitiveAttributes attrs[PACKET_WIDTH] = {};
+    SignedDistanceProgramOctree const& programs = m_signed_distance_programs[sd_primitive];
+    SparseDistanceField const* distance_field = get_distance_field(sd_primitive);
+    float const step_scale = record.material_cb.step_scale;
+    float const over_relaxation = record.material_cb.over_relaxation;
+    u32 const trace_hit_mask =
+        m_signed_distance_pruning_enabled
+            ? ray_signed_distance_program_packet_test(local_rays, trace_lane_mask, programs, thits, attrs, states, step_scale,
+                                                      over_relaxation, cones, distance_field, trace_warm_start_pointers)
+            : ray_signed_distance_program_packet_test(local_rays, trace_lane_mask, programs.get_program(), thits, attrs, states, step_scale,
+                                                      over_relaxation, cones, distance_field, trace_warm_start_pointers);
+
+    u32 hit_mask = 0;
+    for (u32 lane = 0; lane < PACKET_WIDTH; lane++)
+    {
+        // ReportHit() only accepts hits within <RayTMin(), RayTCurrent()>.
+        if ((trace_hit_mask & (1u << lane)) == 0 || !is_in_range(thits[lane], states[lane].t_min, states[lane].t_current))
+        {
+            continue;
+        }
+
+        if (!is_occlusion_ray(states[lane]))
+        {
+            transform_normal_to_world(aabb_attribute, instance, attrs[lane]);
+        }
+
+        states[lane].t_current = thits[lane];
+        hits[lane] = {thits[lane], instance_index, hit_group_index, 0, attrs[lane], trace_warm_starts[lane]};
+        hit_mask |= 1u << lane;
+    }
+    return hit_mask;
+}
+
+RayCone Raytracer::calculate_ray_cone(Ray const& object_ray, Ray const& local_ray, Instance const& instance, RayState const& state) const
+{
+    RayCone cone = {};
+#if USE_CONE_TRACING
+    // Shadow rays start on a surface, where any cone would report a hit right away.
+    if (!is_occlusion_ray(state))
+    {
+        // Pixel cone in local space units, with a radius of half the pixel's footprint. A reflection ray starts
+        // at a previous hit, so the distance it has already travelled from the camera is at least the distance between the two.
+        float3 const world_origin = mul_position(object_ray.origin, instance.object_to_world);
+        cone.spread_angle = 0.5f * m_frame_constants.pixel_spread_angle * length(local_ray.direction);
+        cone.width = cone.spread_angle * length(world_origin - m_frame_constants.camera_position);
+    }
+#else
+    (void)object_ray;
+    (void)local_ray;
+    (void)instance;
+    (void)state;
+#endif
+    return cone;
+}
+
+SparseDistanceField const* Raytracer::get_distance_field(SignedDistancePrimitive::Enum const sd_primitive) const
+{
+    if (m_distance_field_cache_enabled && !m_distance_fields[sd_primitive].is_empty())
+    {
+        return &m_distance_fields[sd_primitive];
+    }
+    return nullptr;
+}
+
+void Raytracer::transform_normal_to_world(AABBPrimitiveTransforms const& aabb_attribute, Instance const& instance,
+                                          ProceduralPrimitiveAttributes& attr) const
+{
+    float3 normal = to_float3(attr.normal);
+    normal = mul_direction(normal, aabb_attribute.local_space_to_bottom_level_as);
+    normal = normalize(mul_direction(normal, instance.object_to_world));
+    attr.normal = {normal.x, normal.y, normal.z};
+}
+
+// Trace a radiance ray into the scene and returns a shaded color.
+float4 Raytracer::trace_radiance_ray(Ray const& ray, u32 const current_ray_recursion_depth, DispatchContext const& context) const
+{
+    if (current_ray_recursion_depth >= MAX_RAY_RECURSION_DEPTH)
+    {
+        return {0, 0, 0, 0};
+    }
+
+    // Set TMin to a zero value to avoid aliasing artifacts along contact areas.
+    // Note: make sure to enable face culling so as to avoid surface face fighting.
+    Hit hit = {};
+    if (!trace_ray(ray, RayFlag::CullBackFacingTriangles, TraceRayParameters::HitGroup::OFFSET[RayType::Radiance],
+                   TraceRayParameters::HitGroup::GEOMETRY_STRIDE, 0.0f, 10000.0f, hit,
+                   get_warm_start(context.index, context.dimensions, current_ray_recursion_depth)))
+    {
+        // Miss shader.
+        return to_float4(BACKGROUND_COLOR);
+    }
+
+    HitGroupRecord const& record = m_hit_group_shader_table[hit.hit_group_index];
+    if (!record.has_closest_hit_shader)
+    {
+        return {0, 0, 0, 0};
+    }
+
+    u32 const payload_recursion_depth = current_ray_recursion_depth + 1;
+    if (record.geometry_type == GeometryType::Triangle)
+    {
+        return closest_hit_shader_triangle(ray, hit, payload_recursion_depth, context);
+    }
+
+    return closest_hit_shader_aabb(ray, hit, payload_recursion_depth, context);
+}
+
+// Trace a shadow ray and return true if it hits any geometry.
+// Occlusion only: the first hit ends the search and no hit record or normal is ever made. The thread's last occluder
+// is tested before traversing the scene, since nearby shadow rays are likely to be blocked by the same primitive.
+bool Raytracer::trace_shadow_ray_and_report_if_hit(Ray const& ray, u32 const current_ray_recursion_depth, u32 const thread_index) const
+{
+    if (current_ray_recursion_depth >= MAX_RAY_RECURSION_DEPTH)
+    {
+        return false;
+    }
+
+    RayState const state = {0.0f, 10000.0f,
+                            RayFlag::CullBackFacingTriangles | RayFlag::AcceptFirstHitAndEndSearch | RayFlag::ForceOpaque
+                                | RayFlag::SkipClosestHitShader};
+
+    // A cached occluder that misses is skipped during traversal, so trying it first never tests anything twice.
+    Occluder& last_occluder = m_last_occluders[thread_index];
+    Occluder const missed_occluder = last_occluder;
+    if (last_occluder.instance_index != Occluder::NONE)
+    {
+        Instance const& instance = m_top_level_as.get_instance(last_occluder.instance_index);
+        if (instance.instance_mask & TraceRayParameters::INSTANCE_MASK)
+        {
+            Ray const object_ray = {mul_position(ray.origin, instance.world_to_object),
+                                    mul_direction(ray.direction, instance.world_to_object)};
+            if (intersect_occluder(object_ray, instance, last_occluder.primitive_index, state))
+            {
+                return true;
+            }
+        }
+    }
+
+    auto const intersect_instance = [&](u32 const instance_index, Instance const& instance, Ray const& object_ray, RayState& state) {
+        auto const intersect_primitive = [&](u32 const primitive_index, RayState& state) {
+            if ((instance_index == missed_occluder.instance_index && primitive_index == missed_occluder.primitive_index)
+                || !intersect_occluder(object_ray, instance, primitive_index, state))
+            {
+                return false;
+            }
+
+            last_occluder = {instance_index, primitive_index};
+            return true;
+        };
+
+        return intersect_bottom_level_as(instance.bottom_level_as_index, object_ray, state, intersect_primitive);
+    };
+
+    RayState traversal_state = state;
+    return m_top_level_as.intersect_any(ray, TraceRayParameters::INSTANCE_MASK, traversal_state, intersect_instance);
+}
+
+// Packet counterpart of trace_shadow_ray_and_report_if_hit(), returns the mask of the lanes whose rays hit any geometry.
+// The rays all try the thread's last occluder first, and only the ones it does not block get traced.
+u32 Raytracer::trace_shadow_ray_packet_and_report_hits(Ray const (&rays)[PACKET_WIDTH], u32 const lane_mask,
+                                                       u32 const current_ray_recursion_depth, u32 const thread_index) const
+{
+    if (current_ray_recursion_depth >= MAX_RAY_RECURSION_DEPTH)
+    {
+        return 0;
+    }
+
+    u32 constexpr ray_flags = RayFlag::CullBackFacingTriangles | RayFlag::AcceptFirstHitAndEndSearch | RayFlag::ForceOpaque
+                            | RayFlag::SkipClosestHitShader;
+    float constexpr t_min = 0.0f;
+    float constexpr t_max = 10000.0f;
+
+    Occluder& last_occluder = m_last_occluders[thread_index];
+    Occluder const missed_occluder = last_occluder;
+    u32 hit_mask = 0;
+    if (last_occluder.instance_index != Occluder::NONE)
+    {
+        Instance const& instance = m_top_level_as.get_instance(last_occluder.instance_index);
+        if (instance.instance_mask & TraceRayParameters::INSTANCE_MASK)
+        {
+            for (u32 lane = 0; lane < PACKET_WIDTH; lane++)
+            {
+                if ((lane_mask & (1u << lane)) == 0)
+                {
+                    continue;
+                }
+
+                Ray const object_ray = {mul_position(rays[lane].origin, instance.world_to_object),
+                                        mul_direction(rays[lane].direction, instance.world_to_object)};
+                if (intersect_occluder(object_ray, instance, last_occluder.primitive_index, {t_min, t_max, ray_flags}))
+                {
+                    hit_mask |= 1u << lane;
+                }
+            }
+        }
+    }
+
+    u32 const traced_lane_mask = lane_mask & ~hit_mask;
+    if (traced_lane_mask == 0)
+    {
+        return hit_mask;
+    }
+
+    RayPacket<PACKET_WIDTH> packet;
+    for (u32 lane = 0; lane < PACKET_WIDTH; lane++)
+    {
+        if ((traced_lane_mask & (1u << lane)) != 0)
+        {
+            packet.set_ray(lane, rays[lane], t_min, t_max);
+        }
+        else
+        {
+            packet.set_inactive(lane);
+        }
+    }
+
+    auto const intersect_instance = [&](u32 const instance_index, Instance const& instance, Ray const (&object_rays)[PACKET_WIDTH],
+                                        RayPacket<PACKET_WIDTH>& object_packet, u32 const instance_lane_mask) {
+        auto const intersect_primitive = [&](u32 const primitive_index, u32 const primitive_lane_mask, RayState (&states)[PACKET_WIDTH]) {
+            if (instance_index == missed_occluder.instance_index && primitive_index == missed_occluder.primitive_index)
+            {
+                return 0u;
+            }
+
+            u32 hit_mask = 0;
+            for (u32 lane = 0; lane < PACKET_WIDTH; lane++)
+            {
+                if ((primitive_lane_mask & (1u << lane)) != 0
+                    && intersect_occluder(object_rays[lane], instance, primitive_index, states[lane]))
+                {
+                    hit_mask |= 1u << lane;
+                }
+            }
+
+            if (hit_mask != 0)
+            {
+                last_occluder = {instance_index, primitive_index};
+            }
+            return hit_mask;
+        };
+
+        return intersect_bottom_level_as(instance.bottom_level_as_index, object_rays, object_packet, instance_lane_mask, ray_flags,
+                                         intersect_primitive);
+    };
+
+    return hit_mask | m_top_level_as.intersect_any(rays, packet, traced_lane_mask, TraceRayParameters::INSTANCE_MASK, intersect_instance);
+}
+
+// Any hit test of a single triangle or AABB geometry against a shadow ray.
+bool Raytracer::intersect_occluder(Ray const& object_ray, Instance const& instance, u32 const primitive_index, RayState const& state) const
+{
+    float thit = 0.0f;
+    if (instance.bottom_level_as_index == BottomLevelASType::Triangle)
+    {
+        return intersect_triangle(object_ray, primitive_index, state, thit);
+    }
+
+    // Each AABB is its own geometry.
+    u32 const hit_group_index =
+        calculate_hit_group_index(instance.instance_contribution_to_hit_group_index, TraceRayParameters::HitGroup::OFFSET[RayType::Shadow],
+                                  TraceRayParameters::HitGroup::GEOMETRY_STRIDE, primitive_index);
+    ProceduralPrimitiveAttributes attr = {};
+    return intersect_aabb(object_ray, instance, m_hit_group_shader_table[hit_group_index], primitive_index, state, thit, attr);
+}
+
+float4 Raytracer::raygen_shader(DispatchContext const& context) const
+{
+    // Generate a ray for a camera pixel corresponding to an index from the dispatched 2D grid.
+    Ray const ray =
+        generate_camera_ray(context.index, context.dimensions, m_frame_constants.camera_position, m_frame_constants.projection_to_world);
+
+    // Cast a ray into the scene and retrieve a shaded color.
+    u32 constexpr current_recursion_depth = 0;
+    return trace_radiance_ray(ray, current_recursion_depth, context);
+}
+
+// Wavefront counterpart of raygen_shader() for a whole tile. Every bounce traces all queued radiance rays, shades their hits,
+// which queues the shadow and reflection rays, and then traces all the shadow rays. Each loop runs a single kind of work
+// over many rays, which keeps its code and data hot, instead of switching between them for every ray.
+void Raytracer::render_tile_wavefront(TileScheduler::Tile const& tile, uint2 const dimensions, u32 const thread_index,
+                                      Wavefront& wavefront, RenderTarget& render_target) const
+{
+    wavefront.paths.clear();
+    wavefront.radiance_rays.clear();
+
+    for (u32 y = tile.origin.y; y < tile.origin.y + tile.size.y; y++)
+    {
+        for (u32 x = tile.origin.x; x < tile.origin.x + tile.size.x; x++)
+        {
+            Ray const ray = generate_camera_ray({x, y}, dimensions, m_frame_constants.camera_position, m_frame_constants.projection_to_world);
+            wavefront.radiance_rays.push(ray, static_cast<u32>(wavefront.paths.size()));
+            wavefront.paths.push_back({{x, y}, {0, 0, 0, 0}, {1, 1, 1, 1}});
+        }
+    }
+
+    // Rays past the recursion limit never get queued, so the loop ends within MAX_RAY_RECURSION_DEPTH bounces.
+    for (u32 current_recursion_depth = 0; !wavefront.radiance_rays.is_empty(); current_recursion_depth++)
+    {
+        trace_radiance_rays(wavefront, current_recursion_depth, dimensions);
+        shade_hits(wavefront, current_recursion_depth, dimensions);
+        trace_shadow_rays(wavefront, current_recursion_depth + 1, thread_index);
+        std::swap(wavefront.radiance_rays, wavefront.next_radiance_rays);
+    }
+
+    for (Path const& path : wavefront.paths)
+    {
+        render_target.set_pixel(path.pixel.x, path.pixel.y, path.radiance);
+    }
+}
+
+// Closest hit queries for the whole radiance queue, in packets of neighbouring rays. Misses are resolved right away,
+// the miss shader returns a constant.
+void Raytracer::trace_radiance_rays(Wavefront& wavefront, u32 const current_ray_recursion_depth, uint2 const dimensions) const
+{
+    wavefront.hit_ray_indices.clear();
+    wavefront.hits.clear();
+
+    for (u32 first_ray_index = 0; first_ray_index < wavefront.radiance_rays.size(); first_ray_index += PACKET_WIDTH)
+    {
+        u32 const ray_count = std::min(PACKET_WIDTH, wavefront.radiance_rays.size() - first_ray_index);
+        u32 const lane_mask = (1u << ray_count) - 1;
+
+        Ray rays[PACKET_WIDTH] = {};
+        PixelWarmStart* warm_starts[PACKET_WIDTH] = {};
+        for (u32 lane = 0; lane < ray_count; lane++)
+        {
+            Path const& path = wavefront.paths[wavefront.radiance_rays.get_path_index(first_ray_index + lane)];
+            rays[lane] = wavefront.radiance_rays.get_ray(first_ray_index + lane);
+            warm_starts[lane] = get_warm_start(path.pixel, dimensions, current_ray_recursion_depth);
+        }
+
+        Hit hits[PACKET_WIDTH] = {};
+        u32 const hit_mask = trace_ray_packet(rays, lane_mask, RayFlag::CullBackFacingTriangles,
+                                              TraceRayParameters::HitGroup::OFFSET[RayType::Radiance],
+                                              TraceRayParameters::HitGroup::GEOMETRY_STRIDE, 0.0f, 10000.0f, hits, warm_starts);
+
+        for (u32 lane = 0; lane < ray_count; lane++)
+        {
+            u32 const ray_index = first_ray_index + lane;
+            if ((hit_mask & (1u << lane)) != 0)
+            {
+                wavefront.hit_ray_indices.push_back(ray_index);
+                wavefront.hits.push_back(hits[lane]);
+                continue;
+            }
+
+            // Miss shader.
+            Path& path = wavefront.paths[wavefront.radiance_rays.get_path_index(ray_index)];
+            path.radiance += path.throughput * to_float4(BACKGROUND_COLOR);
+        }
+    }
+}
+
+// Closest hit shaders of the wavefront mode. The color they return is
+// lerp(checkers * (phong + reflectance * reflection_color), background, falloff), which is linear in the reflection's color,
+// so a hit adds everything but the reflection to its path right away, and scales the path's throughput for the reflection ray.
+// Phong lighting still waits for the shadow ray, which carries both of its possible results.
+void Raytracer::shade_hits(Wavefront& wavefront, u32 const current_ray_recursion_depth, uint2 const dimensions) const
+{
+    wavefront.next_radiance_rays.clear();
+    wavefront.shadow_rays.clear();
+    wavefront.shadow_unoccluded_radiance.clear();
+    wavefront.shadow_occluded_radiance.clear();
+
+    // Same limits as trace_shadow_ray_and_report_if_hit() and trace_radiance_ray() called with the payload's depth.
+    u32 const payload_recursion_depth = current_ray_recursion_depth + 1;
+    bool const can_trace_rays = payload_recursion_depth < MAX_RAY_RECURSION_DEPTH;
+
+    for (u32 i = 0; i < wavefront.hits.size(); i++)
+    {
+        Hit const& hit = wavefront.hits[i];
+        u32 const ray_index = wavefront.hit_ray_indices[i];
+        u32 const path_index = wavefront.radiance_rays.get_path_index(ray_index);
+        Ray const world_ray = wavefront.radiance_rays.get_ray(ray_index);
+        Path& path = wavefront.paths[path_index];
+
+        HitGroupRecord const& record = m_hit_group_shader_table[hit.hit_group_index];
+        if (!record.has_closest_hit_shader)
+        {
+            continue;
+        }
+
+        PrimitiveConstantBuffer const& material_cb = record.material_cb;
+        float4 const albedo = to_float4(material_cb.albedo);
+        float3 const hit_position = world_ray.origin + hit.t * world_ray.direction;
+
+        float3 normal = to_float3(hit.attributes.normal);
+        float checkers = 1.0f;
+        if (record.geometry_type == GeometryType::Triangle)
+        {
+            normal = m_triangles[hit.primitive_index].normal;
+            checkers = analytical_checkers_texture(hit_position, normal, m_frame_constants.camera_position,
+                                                   m_frame_constants.projection_to_world, path.pixel, dimensions);
+        }
+
+        // Visibility falloff.
+        float const t = hit.t;
+        float const falloff = 1.0f - std::exp(-0.000002f * t * t * t);
+        float4 const weight = (1.0f - falloff) * checkers * path.throughput;
+        path.radiance += falloff * path.throughput * to_float4(BACKGROUND_COLOR);
+
+        // Shadow component.
+        float4 const unoccluded_radiance =
+            weight
+            * calculate_phong_lighting(world_ray, hit_position, albedo, normal, false, material_cb.diffuse_coefficient,
+                                       material_cb.specular_coefficient, material_cb.specular_power);
+        if (can_trace_rays)
+        {
+            float4 const occluded_radiance =
+                weight
+                * calculate_phong_lighting(world_ray, hit_position, albedo, normal, true, material_cb.diffuse_coefficient,
+                                           material_cb.specular_coefficient, material_cb.specular_power);
+
+            wavefront.shadow_rays.push({hit_position, normalize(m_frame_constants.light_position - hit_position)}, path_index);
+            wavefront.shadow_unoccluded_radiance.push_back(unoccluded_radiance);
+            wavefront.shadow_occluded_radiance.push_back(occluded_radiance);
+        }
+        else
+        {
+            path.radiance += unoccluded_radiance;
+        }
+
+        // Reflected component.
+        if (can_trace_rays && material_cb.reflectance_coefficient > 0.001f)
+        {
+            float3 const fresnel_r = fresnel_reflectance_schlick(world_ray.direction, normal, albedo.xyz());
+            path.throughput = weight * material_cb.reflectance_coefficient * float4 {fresnel_r.x, fresnel_r.y, fresnel_r.z, 1};
+            wavefront.next_radiance_rays.push({hit_position, reflect(world_ray.direction, normal)}, path_index);
+        }
+    }
+}
+
+// Any hit queries for the whole shadow queue, in packets of neighbouring rays.
+void Raytracer::trace_shadow_rays(Wavefront& wavefront, u32 const current_ray_recursion_depth, u32 const thread_index) const
+{
+    for (u32 first_ray_index = 0; first_ray_index < wavefront.shadow_rays.size(); first_ray_index += PACKET_WIDTH)
+    {
+        u32 const ray_count = std::min(PACKET_WIDTH, wavefront.shadow_rays.size() - first_ray_index);
+
+        Ray rays[PACKET_WIDTH] = {};
+        for (u32 lane = 0; lane < ray_count; lane++)
+        {
+            rays[lane] = wavefront.shadow_rays.get_ray(first_ray_index + lane);
+        }
+
+        u32 const hit_mask =
+            trace_shadow_ray_packet_and_report_hits(rays, (1u << ray_count) - 1, current_ray_recursion_depth, thread_index);
+
+        for (u32 lane = 0; lane < ray_count; lane++)
+        {
+            u32 const ray_index = first_ray_index + lane;
+            Path& path = wavefront.paths[wavefront.shadow_rays.get_path_index(ray_index)];
+            path.radiance += (hit_mask & (1u << lane)) != 0 ? wavefront.shadow_occluded_radiance[ray_index]
+                                                            : wavefront.shadow_unoccluded_radiance[ray_index];
+        }
+    }
+}
+
+float4 Raytracer::closest_hit_shader_triangle(Ray const& world_ray, Hit const& hit, u32 const recursion_depth,
+                                              DispatchContext const& context) const
+{
+    PrimitiveConstantBuffer const& material_cb = m_hit_group_shader_table[hit.hit_group_index].material_cb;
+    float4 const albedo = to_float4(material_cb.albedo);
+
+    // Retrieve corresponding vertex normals for the triangle vertices.
+    float3 const triangle_normal = m_triangles[hit.primitive_index].normal;
+
+    // Shadow component.
+    // Trace a shadow ray.
+    float3 const hit_position = world_ray.origin + hit.t * world_ray.direction;
+    Ray const shadow_ray = {hit_position, normalize(m_frame_constants.light_position - hit_position)};
+    bool const shadow_ray_hit = trace_shadow_ray_and_report_if_hit(shadow_ray, recursion_depth, context.thread_index);
+
+    float const checkers = analytical_checkers_texture(hit_position, triangle_normal, m_frame_constants.camera_position,
+                                                       m_frame_constants.projection_to_world, context.index, context.dimensions);
+
+    // Reflected component.
+    float4 reflected_color = {0, 0, 0, 0};
+    if (material_cb.reflectance_coefficient > 0.001f)
+    {
+        // Trace a reflection ray.
+        Ray const reflection_ray = {hit_position, reflect(world_ray.direction, triangle_normal)};
+        float4 const reflection_color = trace_radiance_ray(reflection_ray, recursion_depth, context);
+
+        float3 const fresnel_r = fresnel_reflectance_schlick(world_ray.direction, triangle_normal, albedo.xyz());
+        reflected_color = material_cb.reflectance_coefficient * float4 {fresnel_r.x, fresnel_r.y, fresnel_r.z, 1} * reflection_color;
+    }
+
+    // Calculate final color.
+    float4 const phong_color = calculate_phong_lighting(world_ray, hit_position, albedo, triangle_normal, shadow_ray_hit,
+                                                        material_cb.diffuse_coefficient, material_cb.specular_coefficient,
+                                                        material_cb.specular_power);
+    float4 color = checkers * (phong_color + reflected_color);
+
+    // Apply visibility falloff.
+    float const t = hit.t;
+    color = lerp(color, to_float4(BACKGROUND_COLOR), 1.0f - std::exp(-0.000002f * t * t * t));
+
+    return color;
+}
+
+float4 Raytracer::closest_hit_shader_aabb(Ray const& world_ray, Hit const& hit, u32 const recursion_depth,
+                                          DispatchContext const& context) const
+{
+    PrimitiveConstantBuffer const& material_cb = m_hit_group_shader_table[hit.hit_group_index].material_cb;
+    float4 const albedo = to_float4(material_cb.albedo);
+    float3 const normal = to_float3(hit.attributes.normal);
+
+    // Shadow component.
+    // Trace a shadow ray.
+    float3 const hit_position = world_ray.origin + hit.t * world_ray.direction;
+    Ray const shadow_ray = {hit_position, normalize(m_frame_constants.light_position - hit_position)};
+    bool const shadow_ray_hit = trace_shadow_ray_and_report_if_hit(shadow_ray, recursion_depth, context.thread_index);
+
+    // Reflected component.
+    float4 reflected_color = {0, 0, 0, 0};
+    if (material_cb.reflectance_coefficient > 0.001f)
+    {
+        // Trace a reflection ray.
+        Ray const reflection_ray = {hit_position, reflect(world_ray.direction, normal)};
+        float4 const reflection_color = trace_radiance_ray(reflection_ray, recursion_depth, context);
+
+        float3 const fresnel_r = fresnel_reflectance_schlick(world_ray.direction, normal, albedo.xyz());
+        reflected_color = material_cb.reflectance_coefficient * float4 {fresnel_r.x, fresnel_r.y, fresnel_r.z, 1} * reflection_color;
+    }
+
+    // Calculate final color.
+    float4 const phong_color =
+        calculate_phong_lighting(world_ray, hit_position, albedo, normal, shadow_ray_hit, material_cb.diffuse_coefficient,
+                                 material_cb.specular_coefficient, material_cb.specular_power);
+    float4 color = phong_color + reflected_color;
+
+    // Apply visibility falloff.
+    float const t = hit.t;
+    color = lerp(color, to_float4(BACKGROUND_COLOR), 1.0f - std::exp(-0.000002f * t * t * t));
+
+    return color;
+}
+
+// Phong lighting model = ambient + diffuse + specular components.
+float4 Raytracer::calculate_phong_lighting(Ray const& world_ray, float3 const hit_position, float4 const albedo, float3 const normal,
+                                           bool const is_in_shadow, float const diffuse_coef, float const specular_coef,
+                                           float const specular_power) const
+{
+    float const shadow_factor = is_in_shadow ? IN_SHADOW_RADIANCE : 1.0f;
+    float3 const incident_light_ray = normalize(hit_position - m_frame_constants.light_position);
+
+    // Diffuse component.
+    float4 const light_diffuse_color = m_frame_constants.light_diffuse_color;
+    float const kd = saturate(dot(-incident_light_ray, normal));
+    float4 const diffuse_color = shadow_factor * diffuse_coef * kd * light_diffuse_color * albedo;
+
+    // Specular component.
+    float4 specular_color = {0, 0, 0, 0};
+    if (!is_in_shadow)
+    {
+        float4 constexpr light_specular_color = {1, 1, 1, 1};
+        float3 const reflected_light_ray = normalize(reflect(incident_light_ray, normal));
+        float const ks = std::pow(saturate(dot(reflected_light_ray, normalize(-world_ray.direction))), specular_power);
+        specular_color = specular_coef * ks * light_specular_color;
+    }
+
+    // Ambient component.
+    // Fake AO: Darken faces with normal facing downwards/away from the sky a little bit.
+    float4 const ambient_color_min = m_frame_constants.light_ambient_color - 0.1f;
+    float4 const ambient_color_max = m_frame_constants.light_ambient_color;
+    float const a = 1 - saturate(dot(normal, float3 {0, -1, 0}));
+    float4 const ambient_color = albedo * lerp(ambient_color_min, ambient_color_max, a);
+
+    return ambient_color + diffuse_color + specular_color;
+}
+
+}
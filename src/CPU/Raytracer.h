@@ -0,0 +1,342 @@
+#pragma once
+
+#include "AK/Types.h"
+#include "ConstantBuffers.h"
+#include "CPU/AABB.h"
+#include "CPU/BVH.h"
+#include "CPU/BVH8.h"
+#include "CPU/MetaballGrid.h"
+#include "CPU/ProceduralPrimitivesLibrary.h"
+#include "CPU/RayPacket.h"
+#include "CPU/RayQueue.h"
+#include "CPU/RaytracingShaderHelper.h"
+#include "CPU/RenderTarget.h"
+#include "CPU/SIMD.h"
+#include "CPU/ShaderMath.h"
+#include "CPU/SignedDistanceExpression.h"
+#include "CPU/SignedDistanceProgramOctree.h"
+#include "CPU/SparseDistanceField.h"
+#include "CPU/TileScheduler.h"
+#include "CPU/TopLevelAS.h"
+#include "CPU/TriangleMesh.h"
+#include "CPU/UniformGrid.h"
+#include "RaytracingScene.h"
+#include "RaytracingSceneDefines.h"
+
+#include <array>
+#include <span>
+#include <vector>
+
+namespace CPU
+{
+
+// Multi-threaded CPU implementation of the DXR pipeline from Raytracing.hlsl.
+// Runs the same ray generation, intersection, closest hit and miss shaders over a RaytracingScene
+// and writes into a RenderTarget, so its output can be compared against the GPU path.
+class Raytracer
+{
+public:
+    explicit Raytracer(RaytracingScene const& scene);
+
+    // Picks up static scene data: instances, geometry and the hit group shader table.
+    void build();
+
+    // Traces a ray for every pixel of the render target, using the scene's current per-frame state.
+    void dispatch_rays(RenderTarget& render_target);
+
+    void set_thread_count(u32 const thread_count);
+    [[nodiscard]] u32 get_thread_count() const;
+
+    void set_tile_size(u32 const tile_size);
+    [[nodiscard]] u32 get_tile_size() const;
+
+    // Wavefront mode traces a tile one bounce at a time, every ray type from its own queue, instead of following each pixel's
+    // rays recursively. Both modes run the same shading.
+    void set_wavefront_enabled(bool const enabled);
+    [[nodiscard]] bool is_wavefront_enabled() const;
+
+    // Sphere traces the signed distance primitives whose distance functions are the most expensive through a sparse
+    // distance field away from their surfaces. Fields get built the first time they are enabled.
+    void set_distance_field_cache_enabled(bool const enabled);
+    [[nodiscard]] bool is_distance_field_cache_enabled() const;
+
+    // Replaces the scene's animated metaballs with any number of metaballs in the Metaballs AABB's local space, e.g. from a
+    // fluid simulation. Call again whenever they move, and with none to go back to the animated ones.
+    void set_metaballs(std::span<Metaball const> const metaballs);
+
+    // Camera rays that hit a signed distance primitive remember the part of their path sphere tracing found empty, and
+    // next frame's ray through the same pixel skips it if the primitive has not moved too far. When the camera moves, they get
+    // reprojected to the pixels they now land in, except for the fractal's, whose detail changes with the camera.
+    void set_warm_start_enabled(bool const enabled);
+    [[nodiscard]] bool is_warm_start_enabled() const;
+
+    // Signed distance primitives and metaballs whose AABBs are farther than distance from the camera get traced through
+    // triangle meshes baked from them, trading detail finer than a mesh's cells for far cheaper intersections.
+    // Meshes get baked the first time a distance is set. Metaballs only get one once set_metaballs() set them, rebaked when
+    // they are replaced; the scene's animated ones move every frame and stay procedural. Distances are in world space.
+    // Infinity, the default, always traces the procedural geometry.
+    void set_baked_mesh_distance(float const distance);
+    [[nodiscard]] float get_baked_mesh_distance() const;
+
+    // Traces a signed distance primitive through an expression in place of its built-in distance function, so shapes can
+    // change without recompiling. The primitive's distance field and baked mesh no longer match it and get dropped.
+    // Returns false, keeping the primitive as it was, if the expression does not compile.
+    bool set_signed_distance_expression(SignedDistancePrimitive::Enum const sd_primitive, SignedDistanceExpression const& expression);
+
+    // Sphere traces expressions through programs pruned to the cells of an octree, leaving out whatever parts of them
+    // cannot decide the distance in a cell. Distances stay the same, only cheaper to evaluate.
+    void set_signed_distance_pruning_enabled(bool const enabled);
+    [[nodiscard]] bool is_signed_distance_pruning_enabled() const;
+
+    // Traces the procedural geometry's AABBs through a two-level uniform grid instead of a BVH, which suits scenes of
+    // many similarly sized AABBs in a regular layout. The grid gets rebuilt every frame, where the BVH gets refit.
+    void set_grid_enabled(bool const enabled);
+    [[nodiscard]] bool is_grid_enabled() const;
+
+    // Traces the bottom-level ASes through 8-wide BVHs collapsed from the binary ones, which test all children of a node
+    // at once and take half the memory traffic. The AABBs' one gets collapsed again every frame, after the binary one
+    // was refit. The grid takes precedence over it for the AABBs.
+    void set_wide_bvh_enabled(bool const enabled);
+    [[nodiscard]] bool is_wide_bvh_enabled() const;
+
+private:
+    // Rays the wavefront mode traces together, as many as fit a SIMD register.
+    static u32 constexpr PACKET_WIDTH = SIMD::has_float<8> ? 8 : 4;
+
+    // Shader record of the hit group shader table, mirroring Renderer::build_shader_tables().
+    struct HitGroupRecord
+    {
+        GeometryType::Enum geometry_type = GeometryType::Triangle;
+        IntersectionShaderType::Enum intersection_shader_type = IntersectionShaderType::AnalyticPrimitive;
+        bool has_closest_hit_shader = false;
+        PrimitiveConstantBuffer material_cb = {};
+        PrimitiveInstanceConstantBuffer aabb_cb = {};
+    };
+
+    // Bottom-level AS index of an instance is its BottomLevelASType, which is also the geometry type of the BLAS.
+    using Instance = TopLevelAS::Instance;
+
+    struct Triangle
+    {
+        float3 v0;
+        float3 v1;
+        float3 v2;
+        float3 normal; // Normal of the first vertex, which is what the closest hit shader reads.
+    };
+
+    struct AABBPrimitiveTransforms
+    {
+        float4x4 local_space_to_bottom_level_as = {};
+        float4x4 bottom_level_as_to_local_space = {};
+    };
+
+    // Per-frame state, the CPU side of SceneConstantBuffer and the AABB primitive attribute buffer.
+    struct FrameConstants
+    {
+        float4x4 projection_to_world = {};
+        float3 camera_position;
+        float3 light_position;
+        float4 light_ambient_color;
+        float4 light_diffuse_color;
+        float elapsed_time = 0.0f;
+        float pixel_spread_angle = 0.0f; // Derived from projection_to_world and the dispatch dimensions, as in the shaders.
+        std::array<AABBPrimitiveTransforms, IntersectionShaderType::TOTAL_PRIMITIVE_COUNT> aabb_primitive_attributes = {};
+        std::array<bool, IntersectionShaderType::TOTAL_PRIMITIVE_COUNT> use_baked_mesh = {}; // CPU only, see update_baked_meshes().
+    };
+
+    // Values the GPU exposes through DispatchRaysIndex() and DispatchRaysDimensions(),
+    // and the index of the CPU thread running the ray, which selects its per-thread state.
+    struct DispatchContext
+    {
+        uint2 index;
+        uint2 dimensions;
+        u32 thread_index = 0;
+    };
+
+    // Primitive that blocked a thread's last shadow ray.
+    struct Occluder
+    {
+        static u32 constexpr NONE = ~0u;
+
+        u32 instance_index = NONE;
+        u32 primitive_index = 0; // Triangle index, or geometry index of an AABB.
+    };
+
+    struct Hit
+    {
+        float t = 0.0f;
+        u32 instance_index = 0;
+        u32 hit_group_index = 0;
+        u32 primitive_index = 0;
+        ProceduralPrimitiveAttributes attributes = {};
+        SphereTraceWarmStart warm_start = {}; // Only set for hits of signed distance primitives.
+    };
+
+    // Where the sphere tracing of a pixel's camera ray can start from, for the AABB geometry it hit last frame.
+    struct PixelWarmStart
+    {
+        u32 instance_index = Occluder::NONE;
+        u32 hit_group_index = 0;
+        SphereTraceWarmStart trace = {};
+    };
+
+    // Chain of radiance rays started by a pixel: the color gathered so far and the weight of the next ray's color.
+    struct Path
+    {
+        uint2 pixel;
+        float4 radiance;
+        float4 throughput;
+    };
+
+    // Queues of the wavefront mode. Each thread has its own, and reuses their allocations from tile to tile.
+    struct Wavefront
+    {
+        std::vector<Path> paths = {};
+        RayQueue radiance_rays = {};
+        RayQueue next_radiance_rays = {};
+        RayQueue shadow_rays = {};
+
+        // Radiance rays that hit something, with their hits.
+        std::vector<u32> hit_ray_indices = {};
+        std::vector<Hit> hits = {};
+
+        // Radiance each shadow ray adds to its path when it does not hit anything and when it does.
+        std::vector<float4> shadow_unoccluded_radiance = {};
+        std::vector<float4> shadow_occluded_radiance = {};
+    };
+
+    void update_frame_constants(uint2 const dimensions);
+
+    // Refits the AABB bottom-level AS to this frame's primitive bounds, rebuilding it once refitting has degraded it,
+    // or rebuilds the grid in its place, and refits the top-level AS to the bottom-level ones. Needs this frame's constants.
+    void update_acceleration_structures();
+    void update_top_level_as();
+
+    // Picks the primitives that get traced through their baked meshes this frame, and rebakes the metaballs' mesh if
+    // set_metaballs() replaced them since. Needs this frame's AABBs and camera.
+    void update_baked_meshes();
+
+    // Moves every pixel's warm start to the pixel it projects to if the camera or the dimensions have changed since the last frame.
+    void update_warm_starts(uint2 const dimensions);
+    // Warm start of a pixel's camera ray, or null for any other ray.
+    PixelWarmStart* get_warm_start(uint2 const pixel, uint2 const dimensions, u32 const current_ray_recursion_depth) const;
+
+    // TraceRay() equivalent. Returns true and fills the hit if any geometry has been hit within <t_min, t_max>.
+    // A warm start, if given, gets used for the geometry it belongs to and replaced with the one of the hit.
+    bool trace_ray(Ray const& ray, u32 const ray_flags, u32 const ray_contribution_to_hit_group_index,
+                   u32 const multiplier_for_geometry_contribution_to_hit_group_index, float const t_min, float const t_max, Hit& hit,
+                   PixelWarmStart* warm_start = nullptr) const;
+    // Packet counterpart of trace_ray() for the rays in lane_mask. Returns the mask of the lanes that hit any geometry,
+    // and fills their hits.
+    u32 trace_ray_packet(Ray const (&rays)[PACKET_WIDTH], u32 const lane_mask, u32 const ray_flags,
+                         u32 const ray_contribution_to_hit_group_index, u32 const multiplier_for_geometry_contribution_to_hit_group_index, float const t_min, float const t_max,
+                         Hit (&hits)[PACKET_WIDTH], PixelWarmStart* const (&warm_starts)[PACKET_WIDTH]) const;
+    bool intersect_triangles(Ray const& object_ray, u32 const instance_index, Instance const& instance,
+                             u32 const ray_contribution_to_hit_group_index, RayState& state, Hit& hit) const;
+    bool intersect_aabbs(Ray const& object_ray, u32 const instance_index, Instance const& instance,
+                         u32 const ray_contribution_to_hit_group_index, u32 const multiplier_for_geometry_contribution_to_hit_group_index,
+                         RayState& state, Hit& hit, PixelWarmStart const* warm_start) const;
+    // Tests of a single triangle or AABB geometry, the intersect_primitive callbacks of the two above.
+    bool intersect_triangle_primitive(Ray const& object_ray, u32 const instance_index, u32 const hit_group_index, u32 const primitive_index,
+                                      RayState& state, Hit& hit) const;
+    bool intersect_aabb_geometry(Ray const& object_ray, u32 const instance_index, Instance const& instance,
+                                 u32 const ray_contribution_to_hit_group_index,
+                                 u32 const multiplier_for_geometry_contribution_to_hit_group_index, u32 const geometry_index,
+                                 RayState& state, Hit& hit, PixelWarmStart const* warm_start) const;
+    // Same for the rays of a packet in lane_mask, each with its state, hit and warm start. Returns the mask of the lanes that hit.
+    u32 intersect_aabb_geometry(Ray const (&object_rays)[PACKET_WIDTH], u32 const lane_mask, u32 const instance_index,
+                                Instance const& instance, u32 const ray_contribution_to_hit_group_index,
+                                u32 const multiplier_for_geometry_contribution_to_hit_group_index, u32 const geometry_index,
+                                RayState (&states)[PACKET_WIDTH], Hit (&hits)[PACKET_WIDTH],
+                                PixelWarmStart* const (&warm_starts)[PACKET_WIDTH]) const;
+    // Any hit query of a bottom-level AS if the ray accepts the first hit, closest hit query otherwise, same contract as the BVH's.
+    // Goes through the grid in place of the AABB bottom-level BVH, or the wide BVHs in place of the binary ones, when enabled.
+    template<typename IntersectPrimitive>
+    bool intersect_bottom_level_as(u32 const bottom_level_as_index, Ray const& object_ray, RayState& state,
+                                   IntersectPrimitive&& intersect_primitive) const;
+    // Same for the rays of a packet, following the BVH's packet contract, except that
+    // intersect_primitive(primitive_index, primitive_lane_mask, states) tests the rays in primitive_lane_mask together, each with
+    // its state like the callback above, and returns the mask of those that hit. Only the binary BVHs trace packets, the grid and
+    // the wide BVHs trace their rays one by one.
+    template<typename IntersectPrimitive>
+    u32 intersect_bottom_level_as(u32 const bottom_level_as_index, Ray const (&object_rays)[PACKET_WIDTH], RayPacket<PACKET_WIDTH>& packet,
+                                  u32 const lane_mask, u32 const ray_flags, IntersectPrimitive&& intersect_primitive) const;
+    bool intersect_triangle(Ray const& object_ray, u32 const primitive_index, RayState const& state, float& thit) const;
+    bool intersect_aabb(Ray const& object_ray, Instance const& instance, HitGroupRecord const& record, u32 const geometry_index,
+                        RayState const& state, float& thit, ProceduralPrimitiveAttributes& attr,
+                        SphereTraceWarmStart* warm_start = nullptr) const;
+    bool intersect_occluder(Ray const& object_ray, Instance const& instance, u32 const primitive_index, RayState const& state) const;
+    bool run_intersection_shader(Ray const& object_ray, Instance const& instance, HitGroupRecord const& record, RayState const& state,
+                                 float& thit, ProceduralPrimitiveAttributes& attr, SphereTraceWarmStart* warm_start) const;
+    // Pixel cone of a ray into a signed distance primitive, in the primitive's local space.
+    RayCone calculate_ray_cone(Ray const& object_ray, Ray const& local_ray, Instance const& instance, RayState const& state) const;
+    // Distance field of a signed distance primitive if the cache is enabled, null otherwise.
+    SparseDistanceField const* get_distance_field(SignedDistancePrimitive::Enum const sd_primitive) const;
+    // Hit normal from an AABB's local space to world space.
+    void transform_normal_to_world(AABBPrimitiveTransforms const& aabb_attribute, Instance const& instance,
+                                   ProceduralPrimitiveAttributes& attr) const;
+
+    float4 trace_radiance_ray(Ray const& ray, u32 const current_ray_recursion_depth, DispatchContext const& context) const;
+    bool trace_shadow_ray_and_report_if_hit(Ray const& ray, u32 const current_ray_recursion_depth, u32 const thread_index) const;
+    u32 trace_shadow_ray_packet_and_report_hits(Ray const (&rays)[PACKET_WIDTH], u32 const lane_mask, u32 const current_ray_recursion_depth,
+                                                u32 const thread_index) const;
+
+    float4 raygen_shader(DispatchContext const& context) const;
+
+    void render_tile_wavefront(TileScheduler::Tile const& tile, uint2 const dimensions, u32 const thread_index, Wavefront& wavefront,
+                               RenderTarget& render_target) const;
+    void trace_radiance_rays(Wavefront& wavefront, u32 const current_ray_recursion_depth, uint2 const dimensions) const;
+    void shade_hits(Wavefront& wavefront, u32 const current_ray_recursion_depth, uint2 const dimensions) const;
+    void trace_shadow_rays(Wavefront& wavefront, u32 const current_ray_recursion_depth, u32 const thread_index) const;
+
+    float4 closest_hit_shader_triangle(Ray const& world_ray, Hit const& hit, u32 const recursion_depth, DispatchContext const& context) const;
+    float4 closest_hit_shader_aabb(Ray const& world_ray, Hit const& hit, u32 const recursion_depth, DispatchContext const& context) const;
+
+    float4 calculate_phong_lighting(Ray const& world_ray, float3 const hit_position, float4 const albedo, float3 const normal,
+                                    bool const is_in_shadow, float const diffuse_coef = 1.0f, float const specular_coef = 1.0f,
+                                    float const specular_power = 50.0f) const;
+
+    RaytracingScene const& m_scene;
+
+    TileScheduler m_tile_scheduler = {};
+
+    bool m_wavefront_enabled = false;
+    std::vector<Wavefront> m_wavefronts = {};
+
+    bool m_distance_field_cache_enabled = false;
+    std::array<SparseDistanceField, SignedDistancePrimitive::Count> m_distance_fields = {}; // Empty for the uncached ones.
+
+    MetaballGrid m_metaball_grid = {};
+    std::vector<Metaball> m_metaballs = {}; // The ones of set_metaballs(), for baking.
+
+    float m_baked_mesh_distance = INFINITY_F;
+    std::array<TriangleMesh, IntersectionShaderType::TOTAL_PRIMITIVE_COUNT> m_baked_meshes = {}; // Empty for the unbaked ones.
+    std::vector<Metaball> m_baked_metaballs = {}; // Snapshot the metaballs' mesh was baked from.
+
+    std::array<SignedDistanceProgramOctree, SignedDistancePrimitive::Count> m_signed_distance_programs = {}; // Empty for the built-in ones.
+    bool m_signed_distance_pruning_enabled = false;
+
+    bool m_warm_start_enabled = false;
+    uint2 m_warm_start_dimensions;
+    float3 m_warm_start_camera_position;
+    float4x4 m_warm_start_projection_to_world = {};
+    // One per pixel, each only touched by the thread tracing its pixel.
+    mutable std::vector<PixelWarmStart> m_warm_starts = {};
+
+    // One per thread, each only touched by its own thread while tracing.
+    mutable std::vector<Occluder> m_last_occluders = {};
+
+    std::vector<Triangle> m_triangles = {};
+    std::vector<AABB> m_aabbs = {};
+    std::array<BVH, BottomLevelASType::Count> m_bottom_level_as = {};
+    bool m_grid_enabled = false;
+    UniformGrid m_aabb_grid = {}; // Empty unless enabled, then traced in place of the AABB bottom-level BVH.
+    bool m_wide_bvh_enabled = false;
+    std::array<BVH8, BottomLevelASType::Count> m_wide_bottom_level_as = {}; // Empty unless enabled.
+    TopLevelAS m_top_level_as = {};
+    std::vector<HitGroupRecord> m_hit_group_shader_table = {};
+
+    FrameConstants m_frame_constants = {};
+};
+
+}
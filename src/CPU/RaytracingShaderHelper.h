@@ -0,0 +1,215 @@
+#pragma once
+
+#include "CPU/ShaderMath.h"
+
+#include <limits>
+
+// CPU counterpart of RaytracingShaderHelper.hlsli.
+namespace CPU
+{
+
+float constexpr INFINITY_F = std::numeric_limits<float>::infinity();
+
+struct Ray
+{
+    float3 origin;
+    float3 direction;
+};
+
+// Subset of the DXR RAY_FLAG values the sample traces with.
+namespace RayFlag
+{
+
+enum Enum : u32
+{
+    None = 0x00,
+    ForceOpaque = 0x01,
+    AcceptFirstHitAndEndSearch = 0x04,
+    SkipClosestHitShader = 0x08,
+    CullBackFacingTriangles = 0x10,
+    CullFrontFacingTriangles = 0x20,
+};
+
+}
+
+// Ray values the shaders query through RayTMin(), RayTCurrent() and RayFlags() on the GPU.
+struct RayState
+{
+    float t_min = 0.0f;
+    float t_current = 0.0f;
+    u32 flags = RayFlag::None;
+};
+
+// Direction components closer to zero than this get clamped to it by safe_inverse(), keeping their sign.
+float constexpr MIN_SLAB_DIRECTION = 1e-20f;
+
+// Inverse ray direction for slab tests. Stays finite for rays parallel to a slab: a ray within the parallel slabs
+// gets entry and exit distances of about -1e20 and +1e20, and an origin lying exactly on such a slab gives
+// 0 * 1e20 = 0 instead of 0 * INF = NaN. The sign matches direction > 0, so zero maps to a negative inverse.
+inline float safe_inverse(float const direction)
+{
+    if (std::abs(direction) > MIN_SLAB_DIRECTION)
+    {
+        return 1.0f / direction;
+    }
+
+    return direction > 0.0f ? 1.0f / MIN_SLAB_DIRECTION : -1.0f / MIN_SLAB_DIRECTION;
+}
+
+inline float3 safe_inverse(float3 const direction)
+{
+    return {safe_inverse(direction.x), safe_inverse(direction.y), safe_inverse(direction.z)};
+}
+
+inline float length_to_pow2(float2 const p)
+{
+    return dot(p, p);
+}
+
+inline float length_to_pow2(float3 const p)
+{
+    return dot(p, p);
+}
+
+// Returns a cycling <0 -> 1 -> 0> animation interpolant
+inline float calculate_animation_interpolant(float const elapsed_time, float const cycle_duration)
+{
+    float cur_linear_cycle_time = std::fmod(elapsed_time, cycle_duration) / cycle_duration;
+    cur_linear_cycle_time = (cur_linear_cycle_time <= 0.5f) ? 2 * cur_linear_cycle_time : 1 - 2 * (cur_linear_cycle_time - 0.5f);
+    return smoothstep(0, 1, cur_linear_cycle_time);
+}
+
+inline bool is_in_range(float const val, float const min, float const max)
+{
+    return (val >= min && val <= max);
+}
+
+// Generate a ray in world space for a camera pixel corresponding to an index from the dispatched 2D grid.
+inline Ray generate_camera_ray(uint2 const index, uint2 const dimensions, float3 const camera_position, float4x4 const& projection_to_world)
+{
+    float2 const xy = {static_cast<float>(index.x) + 0.5f, static_cast<float>(index.y) + 0.5f}; // center in the middle of the pixel.
+    float2 screen_pos = xy / float2 {static_cast<float>(dimensions.x), static_cast<float>(dimensions.y)} * 2.0f - 1.0f;
+
+    // Invert Y for DirectX-style coordinates.
+    screen_pos.y = -screen_pos.y;
+
+    // Unproject the pixel coordinate into a world positon.
+    float4 world = mul(float4 {screen_pos.x, screen_pos.y, 0, 1}, projection_to_world);
+    float3 const world_position = world.xyz() / world.w;
+
+    Ray ray;
+    ray.origin = camera_position;
+    ray.direction = normalize(world_position - ray.origin);
+
+    return ray;
+}
+
+// Cone around a ray covering its pixel's footprint. Its radius at t is width + spread_angle * t.
+struct RayCone
+{
+    float width = 0.0f;
+    float spread_angle = 0.0f;
+};
+
+// Angle a pixel at the center of the screen subtends from the camera, by which a ray's pixel cone widens per unit of distance.
+// Ref: Akenine-Moller et al., "Texture Level of Detail Strategies for Real-Time Ray Tracing", Ray Tracing Gems 2019
+inline float calculate_pixel_spread_angle(uint2 const dimensions, float3 const camera_position, float4x4 const& projection_to_world)
+{
+    uint2 const center = {dimensions.x / 2, dimensions.y / 2};
+    Ray const ray = generate_camera_ray(center, dimensions, camera_position, projection_to_world);
+    Ray const neighbor = generate_camera_ray({center.x, center.y + 1}, dimensions, camera_position, projection_to_world);
+
+    // The chord between two close unit directions is their angle, to first order.
+    return length(neighbor.direction - ray.direction);
+}
+
+// Test if a hit is culled based on specified RayFlags, given anything with the sign of dot(ray direction, surface normal).
+inline bool is_culled(float const ray_direction_normal_dot, RayState const& state)
+{
+    bool const is_culled = ((state.flags & RayFlag::CullBackFacingTriangles) && (ray_direction_normal_dot > 0))
+                        || ((state.flags & RayFlag::CullFrontFacingTriangles) && (ray_direction_normal_dot < 0));
+
+    return is_culled;
+}
+
+// Test if a hit is culled based on specified RayFlags.
+inline bool is_culled(Ray const& ray, float3 const hit_surface_normal, RayState const& state)
+{
+    return is_culled(dot(ray.direction, hit_surface_normal), state);
+}
+
+// Occlusion rays skip the closest hit shader, so nothing reads the attributes of their hits. Intersection tests only need
+// to know which way the surface faces for the cull flags, and may skip calculating a normal.
+inline bool is_occlusion_ray(RayState const& state)
+{
+    return (state.flags & RayFlag::SkipClosestHitShader) != 0;
+}
+
+// Test if a hit is valid based on specified RayFlags and <RayTMin, RayTCurrent> range.
+inline bool is_a_valid_hit(Ray const& ray, float const thit, float3 const hit_surface_normal, RayState const& state)
+{
+    return is_in_range(thit, state.t_min, state.t_current) && !is_culled(ray, hit_surface_normal, state);
+}
+
+// Texture coordinates on a horizontal plane.
+inline float2 tex_coords(float3 const position)
+{
+    return position.xz();
+}
+
+// Calculate ray differentials.
+inline void calculate_ray_differentials(float2& ddx_uv, float2& ddy_uv, float2 const uv, float3 const hit_position, float3 const surface_normal,
+                                        float3 const camera_position, float4x4 const& projection_to_world, uint2 const dispatch_index,
+                                        uint2 const dispatch_dimensions)
+{
+    // Compute ray differentials by intersecting the tangent plane to the  surface.
+    Ray const ddx = generate_camera_ray({dispatch_index.x + 1, dispatch_index.y}, dispatch_dimensions, camera_position, projection_to_world);
+    Ray const ddy = generate_camera_ray({dispatch_index.x, dispatch_index.y + 1}, dispatch_dimensions, camera_position, projection_to_world);
+
+    // Compute ray differentials.
+    float3 const ddx_pos =
+        ddx.origin - ddx.direction * dot(ddx.origin - hit_position, surface_normal) / dot(ddx.direction, surface_normal);
+    float3 const ddy_pos =
+        ddy.origin - ddy.direction * dot(ddy.origin - hit_position, surface_normal) / dot(ddy.direction, surface_normal);
+
+    // Calculate texture sampling footprint.
+    ddx_uv = tex_coords(ddx_pos) - uv;
+    ddy_uv = tex_coords(ddy_pos) - uv;
+}
+
+// Analytically integrated checkerboard grid (box filter).
+// Ref: http://iquilezles.org/www/articles/filterableprocedurals/filterableprocedurals.htm
+// ratio - Center fill to border ratio.
+inline float checkers_texture_box_filter(float2 const uv, float2 const dpdx, float2 const dpdy, u32 const ratio)
+{
+    float const r = static_cast<float>(ratio);
+    float2 const w = max(abs(dpdx), abs(dpdy)); // Filter kernel
+    float2 const a = uv + 0.5f * w;
+    float2 const b = uv - 0.5f * w;
+
+    // Analytical integral (box filter).
+    float2 const i = (floor(a) + min(frac(a) * r, 1.0f) - floor(b) - min(frac(b) * r, 1.0f)) / (r * w);
+    return (1.0f - i.x) * (1.0f - i.y);
+}
+
+// Return analytically integrated checkerboard texture (box filter).
+inline float analytical_checkers_texture(float3 const hit_position, float3 const surface_normal, float3 const camera_position,
+                                         float4x4 const& projection_to_world, uint2 const dispatch_index, uint2 const dispatch_dimensions)
+{
+    float2 ddx_uv;
+    float2 ddy_uv;
+    float2 const uv = tex_coords(hit_position);
+
+    calculate_ray_differentials(ddx_uv, ddy_uv, uv, hit_position, surface_normal, camera_position, projection_to_world, dispatch_index,
+                                dispatch_dimensions);
+    return checkers_texture_box_filter(uv, ddx_uv, ddy_uv, 50);
+}
+
+// Fresnel reflectance - schlick approximation.
+inline float3 fresnel_reflectance_schlick(float3 const i, float3 const n, float3 const f0)
+{
+    float const cosi = saturate(dot(-i, n));
+    return f0 + (1.0f - f0) * std::pow(1.0f - cosi, 5.0f);
+}
+
+}
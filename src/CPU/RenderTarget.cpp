@@ -0,0 +1,85 @@
+#include "CPU/RenderTarget.h"
+
+#include <cmath>
+#include <fstream>
+
+namespace CPU
+{
+
+namespace
+{
+
+u8 float_to_unorm8(float const value)
+{
+    // NaN converts to 0, as it does on the GPU.
+    if (!(value > 0.0f))
+    {
+        return 0;
+    }
+
+    return static_cast<u8>(std::lround(saturate(value) * 255.0f));
+}
+
+}
+
+RenderTarget::RenderTarget(u32 const width, u32 const height)
+{
+    resize(width, height);
+}
+
+void RenderTarget::resize(u32 const width, u32 const height)
+{
+    m_width = width;
+    m_height = height;
+    m_data.assign(static_cast<size_t>(width) * height * bytes_per_pixel, 0);
+}
+
+void RenderTarget::set_pixel(u32 const x, u32 const y, float4 const& color)
+{
+    size_t const offset = (static_cast<size_t>(y) * m_width + x) * bytes_per_pixel;
+    m_data[offset + 0] = float_to_unorm8(color.x);
+    m_data[offset + 1] = float_to_unorm8(color.y);
+    m_data[offset + 2] = float_to_unorm8(color.z);
+    m_data[offset + 3] = float_to_unorm8(color.w);
+}
+
+u32 RenderTarget::get_width() const
+{
+    return m_width;
+}
+
+u32 RenderTarget::get_height() const
+{
+    return m_height;
+}
+
+u32 RenderTarget::get_row_pitch() const
+{
+    return m_width * bytes_per_pixel;
+}
+
+std::vector<u8> const& RenderTarget::get_data() const
+{
+    return m_data;
+}
+
+bool RenderTarget::write_ppm(std::string const& path) const
+{
+    std::ofstream file(path, std::ios::binary);
+
+    if (!file)
+    {
+        return false;
+    }
+
+    file << "P6\n" << m_width << " " << m_height << "\n255\n";
+
+    for (size_t offset = 0; offset < m_data.size(); offset += bytes_per_pixel)
+    {
+        file.write(reinterpret_cast<char const*>(&m_data[offset]), 3);
+    }
+
+    return static_cast<bool>(file);
+}
+
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "AK/Types.h"
+#include "CPU/ShaderMath.h"
+
+#include <string>
+#include <vector>
+
+namespace CPU
+{
+
+// In-memory counterpart of the raytracing output UAV. Pixels are stored as R8G8B8A8_UNORM,
+// which is the format of the DXR output texture and of the swap chain it gets copied to.
+class RenderTarget
+{
+public:
+    RenderTarget() = default;
+    RenderTarget(u32 const width, u32 const height);
+
+    void resize(u32 const width, u32 const height);
+
+    // Converts the color the same way a float4 store to a UNORM texture does.
+    void set_pixel(u32 const x, u32 const y, float4 const& color);
+
+    [[nodiscard]] u32 get_width() const;
+    [[nodiscard]] u32 get_height() const;
+    [[nodiscard]] u32 get_row_pitch() const;
+    [[nodiscard]] std::vector<u8> const& get_data() const;
+
+    // Writes the color channels as a binary PPM (P6) image. Returns false if the file could not be written.
+    [[nodiscard]] bool write_ppm(std::string const& path) const;
+
+    static u32 constexpr bytes_per_pixel = 4;
+
+private:
+    u32 m_width = 0;
+    u32 m_height = 0;
+    std::vector<u8> m_data = {};
+};
+
+}
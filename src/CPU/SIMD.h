@@ -0,0 +1,296 @@
+#pragma once
+
+#include "AK/Types.h"
+
+// Instruction sets the CPU kernels can use, picked from the compiler target (-mavx2, -mavx512f, /arch:AVX2, /arch:AVX512).
+// SSE2 is part of every x64 target. Wider kernels fall back to the scalar code when their instruction set is not enabled.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CPU_SIMD_SSE 1
+#include <cstring>
+#include <immintrin.h>
+#else
+#define CPU_SIMD_SSE 0
+#endif
+
+#if CPU_SIMD_SSE && defined(__AVX2__)
+#define CPU_SIMD_AVX2 1
+#else
+#define CPU_SIMD_AVX2 0
+#endif
+
+#if CPU_SIMD_SSE && defined(__AVX512F__)
+#define CPU_SIMD_AVX512 1
+#else
+#define CPU_SIMD_AVX512 0
+#endif
+
+namespace CPU::SIMD
+{
+
+// Thin wrappers over N-wide float registers, so a kernel can be written once and instantiated per width.
+// Only the operations the kernels need are exposed. min() and max() follow the SSE rule of returning
+// the second operand when either one is NaN, which kernels rely on to keep NaNs out of accumulators.
+template<u32 N>
+struct Float;
+
+template<u32 N>
+inline constexpr bool has_float = false;
+
+#if CPU_SIMD_SSE
+
+template<>
+struct Float<4>
+{
+    using Type = __m128;
+
+    static Type load(float const* p)
+    {
+        return _mm_load_ps(p);
+    }
+
+    static void store(float* p, Type const v)
+    {
+        _mm_storeu_ps(p, v);
+    }
+
+    // N unsigned bytes converted to floats.
+    static Type load_u8(u8 const* p)
+    {
+        // Four bytes zero extended to 32-bit integers, SSE2 has no single instruction for it.
+        i32 bytes;
+        std::memcpy(&bytes, p, sizeof(bytes));
+        __m128i const zero = _mm_setzero_si128();
+        __m128i const words = _mm_unpacklo_epi8(_mm_cvtsi32_si128(bytes), zero);
+        return _mm_cvtepi32_ps(_mm_unpacklo_epi16(words, zero));
+    }
+
+    static Type set1(float const v)
+    {
+        return _mm_set1_ps(v);
+    }
+
+    static Type add(Type const a, Type const b)
+    {
+        return _mm_add_ps(a, b);
+    }
+
+    static Type sub(Type const a, Type const b)
+    {
+        return _mm_sub_ps(a, b);
+    }
+
+    static Type mul(Type const a, Type const b)
+    {
+        return _mm_mul_ps(a, b);
+    }
+
+    static Type div(Type const a, Type const b)
+    {
+        return _mm_div_ps(a, b);
+    }
+
+    static Type sqrt(Type const a)
+    {
+        return _mm_sqrt_ps(a);
+    }
+
+    static Type abs(Type const a)
+    {
+        return _mm_andnot_ps(_mm_set1_ps(-0.0f), a);
+    }
+
+    // Rounds towards zero. Only for |a| < 2^31, SSE2 has no rounding instruction and goes through 32-bit integers.
+    static Type trunc(Type const a)
+    {
+        return _mm_cvtepi32_ps(_mm_cvttps_epi32(a));
+    }
+
+    static Type min(Type const a, Type const b)
+    {
+        return _mm_min_ps(a, b);
+    }
+
+    static Type max(Type const a, Type const b)
+    {
+        return _mm_max_ps(a, b);
+    }
+
+    // Bit i is set if a[i] <= b[i].
+    static u32 less_equal_mask(Type const a, Type const b)
+    {
+        return static_cast<u32>(_mm_movemask_ps(_mm_cmple_ps(a, b)));
+    }
+};
+
+template<>
+inline constexpr bool has_float<4> = true;
+
+#endif
+
+#if CPU_SIMD_AVX2
+
+template<>
+struct Float<8>
+{
+    using Type = __m256;
+
+    static Type load(float const* p)
+    {
+        return _mm256_load_ps(p);
+    }
+
+    static void store(float* p, Type const v)
+    {
+        _mm256_storeu_ps(p, v);
+    }
+
+    static Type load_u8(u8 const* p)
+    {
+        return _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<__m128i const*>(p))));
+    }
+
+    static Type set1(float const v)
+    {
+        return _mm256_set1_ps(v);
+    }
+
+    static Type add(Type const a, Type const b)
+    {
+        return _mm256_add_ps(a, b);
+    }
+
+    static Type sub(Type const a, Type const b)
+    {
+        return _mm256_sub_ps(a, b);
+    }
+
+    static Type mul(Type const a, Type const b)
+    {
+        return _mm256_mul_ps(a, b);
+    }
+
+    static Type div(Type const a, Type const b)
+    {
+        return _mm256_div_ps(a, b);
+    }
+
+    static Type sqrt(Type const a)
+    {
+        return _mm256_sqrt_ps(a);
+    }
+
+    static Type abs(Type const a)
+    {
+        return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a);
+    }
+
+    static Type trunc(Type const a)
+    {
+        return _mm256_round_ps(a, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+    }
+
+    static Type min(Type const a, Type const b)
+    {
+        return _mm256_min_ps(a, b);
+    }
+
+    static Type max(Type const a, Type const b)
+    {
+        return _mm256_max_ps(a, b);
+    }
+
+    static u32 less_equal_mask(Type const a, Type const b)
+    {
+        return static_cast<u32>(_mm256_movemask_ps(_mm256_cmp_ps(a, b, _CMP_LE_OQ)));
+    }
+};
+
+template<>
+inline constexpr bool has_float<8> = true;
+
+#endif
+
+#if CPU_SIMD_AVX512
+
+template<>
+struct Float<16>
+{
+    using Type = __m512;
+
+    static Type load(float const* p)
+    {
+        return _mm512_load_ps(p);
+    }
+
+    static void store(float* p, Type const v)
+    {
+        _mm512_storeu_ps(p, v);
+    }
+
+    static Type load_u8(u8 const* p)
+    {
+        return _mm512_cvtepi32_ps(_mm512_cvtepu8_epi32(_mm_loadu_si128(reinterpret_cast<__m128i const*>(p))));
+    }
+
+    static Type set1(float const v)
+    {
+        return _mm512_set1_ps(v);
+    }
+
+    static Type add(Type const a, Type const b)
+    {
+        return _mm512_add_ps(a, b);
+    }
+
+    static Type sub(Type const a, Type const b)
+    {
+        return _mm512_sub_ps(a, b);
+    }
+
+    static Type mul(Type const a, Type const b)
+    {
+        return _mm512_mul_ps(a, b);
+    }
+
+    static Type div(Type const a, Type const b)
+    {
+        return _mm512_div_ps(a, b);
+    }
+
+    static Type sqrt(Type const a)
+    {
+        return _mm512_sqrt_ps(a);
+    }
+
+    static Type abs(Type const a)
+    {
+        return _mm512_abs_ps(a);
+    }
+
+    static Type trunc(Type const a)
+    {
+        return _mm512_roundscale_ps(a, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+    }
+
+    static Type min(Type const a, Type const b)
+    {
+        return _mm512_min_ps(a, b);
+    }
+
+    static Type max(Type const a, Type const b)
+    {
+        return _mm512_max_ps(a, b);
+    }
+
+    static u32 less_equal_mask(Type const a, Type const b)
+    {
+        return static_cast<u32>(_mm512_cmp_ps_mask(a, b, _CMP_LE_OQ));
+    }
+};
+
+template<>
+inline constexpr bool has_float<16> = true;
+
+#endif
+
+}
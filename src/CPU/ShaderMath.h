@@ -0,0 +1,405 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+
+#include "AK/Types.h"
+
+// Minimal HLSL-like vector library. It lets the CPU port of the shaders read line by line like the .hlsli originals.
+namespace CPU
+{
+
+struct float2
+{
+    float x = 0.0f;
+    float y = 0.0f;
+};
+
+struct float3
+{
+    float x = 0.0f;
+    float y = 0.0f;
+    float z = 0.0f;
+
+    [[nodiscard]] float operator[](u32 const i) const
+    {
+        return (&x)[i];
+    }
+
+    float& operator[](u32 const i)
+    {
+        return (&x)[i];
+    }
+
+    [[nodiscard]] float2 xz() const
+    {
+        return {x, z};
+    }
+
+    [[nodiscard]] float2 xy() const
+    {
+        return {x, y};
+    }
+};
+
+struct float4
+{
+    float x = 0.0f;
+    float y = 0.0f;
+    float z = 0.0f;
+    float w = 0.0f;
+
+    [[nodiscard]] float3 xyz() const
+    {
+        return {x, y, z};
+    }
+};
+
+struct uint2
+{
+    u32 x = 0;
+    u32 y = 0;
+};
+
+// Row-major matrix, used with row vectors the same way DirectXMath matrices are used by mul() in the shaders.
+struct float4x4
+{
+    float m[4][4] = {};
+};
+
+// float2
+inline float2 operator+(float2 const a, float2 const b)
+{
+    return {a.x + b.x, a.y + b.y};
+}
+
+inline float2 operator-(float2 const a, float2 const b)
+{
+    return {a.x - b.x, a.y - b.y};
+}
+
+inline float2 operator*(float2 const a, float2 const b)
+{
+    return {a.x * b.x, a.y * b.y};
+}
+
+inline float2 operator/(float2 const a, float2 const b)
+{
+    return {a.x / b.x, a.y / b.y};
+}
+
+inline float2 operator+(float2 const a, float const b)
+{
+    return {a.x + b, a.y + b};
+}
+
+inline float2 operator-(float2 const a, float const b)
+{
+    return {a.x - b, a.y - b};
+}
+
+inline float2 operator*(float2 const a, float const b)
+{
+    return {a.x * b, a.y * b};
+}
+
+inline float2 operator*(float const a, float2 const b)
+{
+    return {a * b.x, a * b.y};
+}
+
+inline float2 operator/(float2 const a, float const b)
+{
+    return {a.x / b, a.y / b};
+}
+
+inline float2 operator-(float2 const a)
+{
+    return {-a.x, -a.y};
+}
+
+// float3
+inline float3 operator+(float3 const a, float3 const b)
+{
+    return {a.x + b.x, a.y + b.y, a.z + b.z};
+}
+
+inline float3 operator-(float3 const a, float3 const b)
+{
+    return {a.x - b.x, a.y - b.y, a.z - b.z};
+}
+
+inline float3 operator*(float3 const a, float3 const b)
+{
+    return {a.x * b.x, a.y * b.y, a.z * b.z};
+}
+
+inline float3 operator/(float3 const a, float3 const b)
+{
+    return {a.x / b.x, a.y / b.y, a.z / b.z};
+}
+
+inline float3 operator+(float3 const a, float const b)
+{
+    return {a.x + b, a.y + b, a.z + b};
+}
+
+inline float3 operator-(float3 const a, float const b)
+{
+    return {a.x - b, a.y - b, a.z - b};
+}
+
+inline float3 operator*(float3 const a, float const b)
+{
+    return {a.x * b, a.y * b, a.z * b};
+}
+
+inline float3 operator*(float const a, float3 const b)
+{
+    return {a * b.x, a * b.y, a * b.z};
+}
+
+inline float3 operator/(float3 const a, float const b)
+{
+    return {a.x / b, a.y / b, a.z / b};
+}
+
+inline float3 operator-(float const a, float3 const b)
+{
+    return {a - b.x, a - b.y, a - b.z};
+}
+
+inline float3 operator/(float const a, float3 const b)
+{
+    return {a / b.x, a / b.y, a / b.z};
+}
+
+inline float3 operator-(float3 const a)
+{
+    return {-a.x, -a.y, -a.z};
+}
+
+inline float3& operator+=(float3& a, float3 const b)
+{
+    a = a + b;
+    return a;
+}
+
+inline float3& operator-=(float3& a, float3 const b)
+{
+    a = a - b;
+    return a;
+}
+
+inline float3& operator*=(float3& a, float const b)
+{
+    a = a * b;
+    return a;
+}
+
+// float4
+inline float4 operator+(float4 const a, float4 const b)
+{
+    return {a.x + b.x, a.y + b.y, a.z + b.z, a.w + b.w};
+}
+
+inline float4 operator-(float4 const a, float4 const b)
+{
+    return {a.x - b.x, a.y - b.y, a.z - b.z, a.w - b.w};
+}
+
+inline float4 operator*(float4 const a, float4 const b)
+{
+    return {a.x * b.x, a.y * b.y, a.z * b.z, a.w * b.w};
+}
+
+inline float4 operator-(float4 const a, float const b)
+{
+    return {a.x - b, a.y - b, a.z - b, a.w - b};
+}
+
+inline float4 operator*(float4 const a, float const b)
+{
+    return {a.x * b, a.y * b, a.z * b, a.w * b};
+}
+
+inline float4 operator*(float const a, float4 const b)
+{
+    return {a * b.x, a * b.y, a * b.z, a * b.w};
+}
+
+inline float4& operator+=(float4& a, float4 const b)
+{
+    a = a + b;
+    return a;
+}
+
+// Intrinsics
+inline float saturate(float const x)
+{
+    return std::clamp(x, 0.0f, 1.0f);
+}
+
+inline float lerp(float const a, float const b, float const s)
+{
+    return a + s * (b - a);
+}
+
+inline float3 lerp(float3 const a, float3 const b, float const s)
+{
+    return a + s * (b - a);
+}
+
+inline float4 lerp(float4 const a, float4 const b, float const s)
+{
+    return a + s * (b - a);
+}
+
+inline float4 lerp(float4 const a, float4 const b, float4 const s)
+{
+    return a + s * (b - a);
+}
+
+inline float smoothstep(float const min, float const max, float const x)
+{
+    float const t = saturate((x - min) / (max - min));
+    return t * t * (3.0f - 2.0f * t);
+}
+
+inline float frac(float const x)
+{
+    return x - std::floor(x);
+}
+
+inline float sign(float const x)
+{
+    return static_cast<float>((x > 0.0f) - (x < 0.0f));
+}
+
+inline float dot(float2 const a, float2 const b)
+{
+    return a.x * b.x + a.y * b.y;
+}
+
+inline float dot(float3 const a, float3 const b)
+{
+    return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+inline float length(float2 const a)
+{
+    return std::sqrt(dot(a, a));
+}
+
+inline float length(float3 const a)
+{
+    return std::sqrt(dot(a, a));
+}
+
+inline float3 normalize(float3 const a)
+{
+    return a / length(a);
+}
+
+inline float3 cross(float3 const a, float3 const b)
+{
+    return {a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x};
+}
+
+inline float3 reflect(float3 const i, float3 const n)
+{
+    return i - 2.0f * dot(n, i) * n;
+}
+
+inline float2 abs(float2 const a)
+{
+    return {std::abs(a.x), std::abs(a.y)};
+}
+
+inline float3 abs(float3 const a)
+{
+    return {std::abs(a.x), std::abs(a.y), std::abs(a.z)};
+}
+
+inline float2 max(float2 const a, float const b)
+{
+    return {std::max(a.x, b), std::max(a.y, b)};
+}
+
+inline float2 max(float2 const a, float2 const b)
+{
+    return {std::max(a.x, b.x), std::max(a.y, b.y)};
+}
+
+inline float3 max(float3 const a, float const b)
+{
+    return {std::max(a.x, b), std::max(a.y, b), std::max(a.z, b)};
+}
+
+inline float3 max(float3 const a, float3 const b)
+{
+    return {std::max(a.x, b.x), std::max(a.y, b.y), std::max(a.z, b.z)};
+}
+
+inline float3 min(float3 const a, float3 const b)
+{
+    return {std::min(a.x, b.x), std::min(a.y, b.y), std::min(a.z, b.z)};
+}
+
+inline float2 min(float2 const a, float const b)
+{
+    return {std::min(a.x, b), std::min(a.y, b)};
+}
+
+inline float2 floor(float2 const a)
+{
+    return {std::floor(a.x), std::floor(a.y)};
+}
+
+inline float2 frac(float2 const a)
+{
+    return {frac(a.x), frac(a.y)};
+}
+
+inline float3 fmod(float3 const a, float3 const b)
+{
+    return {std::fmod(a.x, b.x), std::fmod(a.y, b.y), std::fmod(a.z, b.z)};
+}
+
+inline float3 pow(float3 const a, float const b)
+{
+    return {std::pow(a.x, b), std::pow(a.y, b), std::pow(a.z, b)};
+}
+
+// mul(float4(v, 1), m)
+inline float3 mul_position(float3 const v, float4x4 const& m)
+{
+    return {
+        v.x * m.m[0][0] + v.y * m.m[1][0] + v.z * m.m[2][0] + m.m[3][0],
+        v.x * m.m[0][1] + v.y * m.m[1][1] + v.z * m.m[2][1] + m.m[3][1],
+        v.x * m.m[0][2] + v.y * m.m[1][2] + v.z * m.m[2][2] + m.m[3][2],
+    };
+}
+
+// mul(v, (float3x3) m)
+inline float3 mul_direction(float3 const v, float4x4 const& m)
+{
+    return {
+        v.x * m.m[0][0] + v.y * m.m[1][0] + v.z * m.m[2][0],
+        v.x * m.m[0][1] + v.y * m.m[1][1] + v.z * m.m[2][1],
+        v.x * m.m[0][2] + v.y * m.m[1][2] + v.z * m.m[2][2],
+    };
+}
+
+// mul(v, m)
+inline float4 mul(float4 const v, float4x4 const& m)
+{
+    float4 result = {};
+    result.x = v.x * m.m[0][0] + v.y * m.m[1][0] + v.z * m.m[2][0] + v.w * m.m[3][0];
+    result.y = v.x * m.m[0][1] + v.y * m.m[1][1] + v.z * m.m[2][1] + v.w * m.m[3][1];
+    result.z = v.x * m.m[0][2] + v.y * m.m[1][2] + v.z * m.m[2][2] + v.w * m.m[3][2];
+    result.w = v.x * m.m[0][3] + v.y * m.m[1][3] + v.z * m.m[2][3] + v.w * m.m[3][3];
+    return result;
+}
+
+}
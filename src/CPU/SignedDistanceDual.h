@@ -0,0 +1,151 @@
+#pragma once
+
+#include "ConstantBuffers.h"
+#include "CPU/DualNumbers.h"
+#include "CPU/SignedDistancePrimitives.h"
+
+// Overloads of the signed distance functions over dual numbers, returning a distance along with its gradient.
+// They mirror the float versions in SignedDistancePrimitives.h and SignedDistanceFractals.h line by line,
+// for the functions the signed distance primitives use, and have to be kept in sync with them.
+namespace CPU
+{
+
+inline dual op_s(dual const d1, dual const d2)
+{
+    return max(d1, -d2);
+}
+
+inline dual op_i(dual const d1, dual const d2)
+{
+    return max(d1, d2);
+}
+
+inline dual3 op_rep(dual3 const p, float3 const c)
+{
+    return fmod(p, c) - 0.5f * c;
+}
+
+inline dual3 op_twist(dual3 const p)
+{
+    dual const c = cos(3.0f * p.y);
+    dual const s = sin(3.0f * p.y);
+    return {c * p.x - s * p.z, s * p.x + c * p.z, p.y};
+}
+
+inline dual sd_sphere(dual3 const p, float const s)
+{
+    return length(p) - s;
+}
+
+inline dual sd_box(dual3 const p, float3 const b)
+{
+    dual3 const d = abs(p) - b;
+    return min(max(d.x, max(d.y, d.z)), 0.0f) + length(max(d, 0.0f));
+}
+
+inline dual ud_round_box(dual3 const p, float3 const b, float const r)
+{
+    return length(max(abs(p) - b, 0.0f)) - r;
+}
+
+inline dual sd_torus(dual3 const p, float2 const t)
+{
+    dual2 const q = {length(p.xz()) - t.x, p.y};
+    return length(q) - t.y;
+}
+
+inline dual sd_cylinder(dual3 const p, float2 const h)
+{
+    dual2 const d = abs(dual2 {length(p.xz()), p.y}) - h;
+    return min(max(d.x, d.y), 0.0f) + length(max(d, 0.0f));
+}
+
+inline dual sd_octahedron(dual3 const p, float3 const h)
+{
+    dual const d = dot(dual2 {max(abs(p.x), abs(p.z)), abs(p.y)}, float2 {h.x, h.y});
+    return d - h.y * h.z;
+}
+
+inline dual sd_pyramid(dual3 const p, float3 const h)
+{
+    dual const octa = sd_octahedron(p, h);
+    return op_s(octa, p.y);
+}
+
+inline dual length_to_pow_negative8(dual2 p)
+{
+    p = p * p;
+    p = p * p;
+    p = p * p;
+    return pow(p.x + p.y, 1.0f / 8.0f);
+}
+
+inline dual sd_torus82(dual3 const p, float2 const t)
+{
+    dual2 const q = {length(p.xz()) - t.x, p.y};
+    return length_to_pow_negative8(q) - t.y;
+}
+
+// Every fold scales the position by scale and the distance by 1 / scale, so the gradient comes out of the folds
+// unscaled, as the gradient of the pyramid at the folded position.
+// The iteration count is constant to the gradient: the blend is taken between the gradients of both counts.
+inline dual sd_fractal_pyramid(dual3 position, float3 const h, float const scale = 2.0f,
+                               float const iterations = FRACTAL_ITERATIONS_COUNT)
+{
+    float const a = h.z * h.y / h.x;
+    float3 const v1 = {0, h.z, 0};
+    float3 const v2 = {-a, 0, a};
+    float3 const v3 = {a, 0, -a};
+    float3 const v4 = {a, 0, a};
+    float3 const v5 = {-a, 0, -a};
+
+    i32 const fold_count = static_cast<i32>(std::ceil(iterations));
+    float const blend = iterations - static_cast<float>(fold_count - 1);
+    dual coarse_distance = {};
+
+    i32 n = 0;
+    for (n = 0; n < fold_count; n++)
+    {
+        if (n == fold_count - 1 && blend < 1.0f)
+        {
+            coarse_distance = sd_pyramid(position, h) * std::pow(scale, static_cast<float>(-n));
+        }
+
+        // The closest vertex only depends on the values.
+        float3 const p = {position.x.value, position.y.value, position.z.value};
+        float3 v = v1;
+        float dist = length_to_pow2(p - v1);
+        float d = length_to_pow2(p - v2);
+        if (d < dist)
+        {
+            v = v2;
+            dist = d;
+        }
+        d = length_to_pow2(p - v3);
+        if (d < dist)
+        {
+            v = v3;
+            dist = d;
+        }
+        d = length_to_pow2(p - v4);
+        if (d < dist)
+        {
+            v = v4;
+            dist = d;
+        }
+        d = length_to_pow2(p - v5);
+        if (d < dist)
+        {
+            v = v5;
+            dist = d;
+        }
+
+        position = scale * position - v * (scale - 1.0f);
+    }
+    dual const distance = sd_pyramid(position, h);
+
+    dual const fine_distance = distance * std::pow(scale, static_cast<float>(-n));
+    return blend < 1.0f ? (1.0f - blend) * coarse_distance + blend * fine_distance : fine_distance;
+}
+
+}
@@ -0,0 +1,982 @@
+#include "CPU/SignedDistanceExpression.h"
+
+#include <bit>
+#include <cassert>
+#include <cctype>
+#include <charconv>
+#include <utility>
+
+namespace CPU
+{
+
+namespace
+{
+
+u32 constexpr NONE = ~0u;
+
+// Node indices have to fit next to an opcode in a lookup key.
+u32 constexpr MAX_NODE_COUNT = 1u << 28;
+
+interval apply_signed_distance_opcode(SignedDistanceOpcode::Enum const opcode, interval const a, interval const b)
+{
+    using namespace SignedDistanceOpcode;
+    switch (opcode)
+    {
+    case Neg:
+        return -a;
+    case Abs:
+        return abs(a);
+    case Sqrt:
+        return sqrt(a);
+    case Cos:
+        return cos(a);
+    case Sin:
+        return sin(a);
+    case Add:
+        return a + b;
+    case Sub:
+        return a - b;
+    case Mul:
+        return a * b;
+    case Div:
+        return a / b;
+    case Min:
+        return min(a, b);
+    case Max:
+        return max(a, b);
+    case Mod:
+        return fmod(a, b);
+    case Atan2:
+        return atan2(a, b);
+    default:
+        return {-INFINITY, INFINITY};
+    }
+}
+
+}
+
+SignedDistanceExpression::SignedDistanceExpression()
+{
+    add_node({SignedDistanceOpcode::X});
+    add_node({SignedDistanceOpcode::Y});
+    add_node({SignedDistanceOpcode::Z});
+}
+
+SignedDistanceExpression::Vector SignedDistanceExpression::get_position() const
+{
+    return {0, 1, 2};
+}
+
+SignedDistanceExpression::Node SignedDistanceExpression::constant(float const value)
+{
+    return add_node({SignedDistanceOpcode::Constant, 0, 0, value});
+}
+
+SignedDistanceExpression::Node SignedDistanceExpression::operation(SignedDistanceOpcode::Enum const opcode, Node a, Node b)
+{
+    using namespace SignedDistanceOpcode;
+    assert(!is_leaf(opcode));
+
+    if (!is_binary(opcode))
+    {
+        b = 0;
+    }
+
+    NodeData const node_a = m_nodes[a];
+    NodeData const node_b = m_nodes[b];
+    if (node_a.opcode == Constant && (!is_binary(opcode) || node_b.opcode == Constant))
+    {
+        return constant(apply_signed_distance_opcode(opcode, node_a.value, node_b.value));
+    }
+
+    auto const is_constant = [&](NodeData const& node, float const value) {
+        return node.opcode == Constant && node.value == value;
+    };
+
+    switch (opcode)
+    {
+    case Neg:
+        if (node_a.opcode == Neg)
+        {
+            return node_a.a;
+        }
+        break;
+    case Abs:
+        if (node_a.opcode == Abs)
+        {
+            return a;
+        }
+        if (node_a.opcode == Neg)
+        {
+            return operation(Abs, node_a.a);
+        }
+        break;
+    case Add:
+        if (is_constant(node_b, 0.0f))
+        {
+            return a;
+        }
+        if (is_constant(node_a, 0.0f))
+        {
+            return b;
+        }
+        break;
+    case Sub:
+        if (is_constant(node_b, 0.0f))
+        {
+            return a;
+        }
+        if (is_constant(node_a, 0.0f))
+        {
+            return operation(Neg, b);
+        }
+        break;
+    case Mul:
+        if (is_constant(node_b, 1.0f))
+        {
+            return a;
+        }
+        if (is_constant(node_a, 1.0f))
+        {
+            return b;
+        }
+        break;
+    case Div:
+        if (is_constant(node_b, 1.0f))
+        {
+            return a;
+        }
+        break;
+    case Min:
+    case Max:
+        if (a == b)
+        {
+            return a;
+        }
+        break;
+    default:
+        break;
+    }
+
+    // Commutative operations take their operands in a fixed order, so a + b and b + a share a node.
+    if ((opcode == Add || opcode == Mul || opcode == Min || opcode == Max) && a > b)
+    {
+        std::swap(a, b);
+    }
+
+    return add_node({opcode, a, b});
+}
+
+SignedDistanceExpression::Node SignedDistanceExpression::neg(Node const a)
+{
+    return operation(SignedDistanceOpcode::Neg, a);
+}
+
+SignedDistanceExpression::Node SignedDistanceExpression::abs(Node const a)
+{
+    return operation(SignedDistanceOpcode::Abs, a);
+}
+
+SignedDistanceExpression::Node SignedDistanceExpression::sqrt(Node const a)
+{
+    return operation(SignedDistanceOpcode::Sqrt, a);
+}
+
+SignedDistanceExpression::Node SignedDistanceExpression::cos(Node const a)
+{
+    return operation(SignedDistanceOpcode::Cos, a);
+}
+
+SignedDistanceExpression::Node SignedDistanceExpression::sin(Node const a)
+{
+    return operation(SignedDistanceOpcode::Sin, a);
+}
+
+SignedDistanceExpression::Node SignedDistanceExpression::add(Node const a, Node const b)
+{
+    return operation(SignedDistanceOpcode::Add, a, b);
+}
+
+SignedDistanceExpression::Node SignedDistanceExpression::sub(Node const a, Node const b)
+{
+    return operation(SignedDistanceOpcode::Sub, a, b);
+}
+
+SignedDistanceExpression::Node SignedDistanceExpression::mul(Node const a, Node const b)
+{
+    return operation(SignedDistanceOpcode::Mul, a, b);
+}
+
+SignedDistanceExpression::Node SignedDistanceExpression::div(Node const a, Node const b)
+{
+    return operation(SignedDistanceOpcode::Div, a, b);
+}
+
+SignedDistanceExpression::Node SignedDistanceExpression::min(Node const a, Node const b)
+{
+    return operation(SignedDistanceOpcode::Min, a, b);
+}
+
+SignedDistanceExpression::Node SignedDistanceExpression::max(Node const a, Node const b)
+{
+    return operation(SignedDistanceOpcode::Max, a, b);
+}
+
+SignedDistanceExpression::Node SignedDistanceExpression::mod(Node const a, Node const b)
+{
+    return operation(SignedDistanceOpcode::Mod, a, b);
+}
+
+SignedDistanceExpression::Node SignedDistanceExpression::atan2(Node const y, Node const x)
+{
+    return operation(SignedDistanceOpcode::Atan2, y, x);
+}
+
+SignedDistanceExpression::Vector SignedDistanceExpression::add(Vector const a, float3 const b)
+{
+    return {add(a.x, constant(b.x)), add(a.y, constant(b.y)), add(a.z, constant(b.z))};
+}
+
+SignedDistanceExpression::Node SignedDistanceExpression::length(Node const x, Node const y)
+{
+    return sqrt(add(mul(x, x), mul(y, y)));
+}
+
+SignedDistanceExpression::Node SignedDistanceExpression::length(Vector const v)
+{
+    return sqrt(add(add(mul(v.x, v.x), mul(v.y, v.y)), mul(v.z, v.z)));
+}
+
+SignedDistanceExpression::Node SignedDistanceExpression::op_s(Node const d1, Node const d2)
+{
+    return max(d1, neg(d2));
+}
+
+SignedDistanceExpression::Node SignedDistanceExpression::op_u(Node const d1, Node const d2)
+{
+    return min(d1, d2);
+}
+
+SignedDistanceExpression::Node SignedDistanceExpression::op_i(Node const d1, Node const d2)
+{
+    return max(d1, d2);
+}
+
+// smin(d1, d2, 0.1)
+SignedDistanceExpression::Node SignedDistanceExpression::op_blend_u(Node const d1, Node const d2)
+{
+    Node const k = constant(0.1f);
+    Node const h = min(max(add(constant(0.5f), div(mul(constant(0.5f), sub(d2, d1)), k)), constant(0.0f)), constant(1.0f));
+    return sub(add(d2, mul(h, sub(d1, d2))), mul(mul(k, h), sub(constant(1.0f), h)));
+}
+
+// smax(d1, d2, 0.1)
+SignedDistanceExpression::Node SignedDistanceExpression::op_blend_i(Node const d1, Node const d2)
+{
+    Node const k = constant(0.1f);
+    Node const h = min(max(add(constant(0.5f), div(mul(constant(0.5f), sub(d2, d1)), k)), constant(0.0f)), constant(1.0f));
+    return add(add(d1, mul(h, sub(d2, d1))), mul(mul(k, h), sub(constant(1.0f), h)));
+}
+
+SignedDistanceExpression::Vector SignedDistanceExpression::op_rep(Vector const p, float3 const c)
+{
+    return {sub(mod(p.x, constant(c.x)), constant(0.5f * c.x)), sub(mod(p.y, constant(c.y)), constant(0.5f * c.y)),
+            sub(mod(p.z, constant(c.z)), constant(0.5f * c.z))};
+}
+
+SignedDistanceExpression::Vector SignedDistanceExpression::op_twist(Vector const p)
+{
+    Node const angle = mul(constant(3.0f), p.y);
+    Node const c = cos(angle);
+    Node const s = sin(angle);
+    return {sub(mul(c, p.x), mul(s, p.z)), add(mul(s, p.x), mul(c, p.z)), p.y};
+}
+
+SignedDistanceExpression::Node SignedDistanceExpression::sd_sphere(Vector const p, float const s)
+{
+    return sub(length(p), constant(s));
+}
+
+SignedDistanceExpression::Node SignedDistanceExpression::sd_box(Vector const p, float3 const b)
+{
+    Node const zero = constant(0.0f);
+    Vector const d = {sub(abs(p.x), constant(b.x)), sub(abs(p.y), constant(b.y)), sub(abs(p.z), constant(b.z))};
+    return add(min(max(d.x, max(d.y, d.z)), zero), length({max(d.x, zero), max(d.y, zero), max(d.z, zero)}));
+}
+
+SignedDistanceExpression::Node SignedDistanceExpression::ud_round_box(Vector const p, float3 const b, float const r)
+{
+    Node const zero = constant(0.0f);
+    Vector const d = {max(sub(abs(p.x), constant(b.x)), zero), max(sub(abs(p.y), constant(b.y)), zero),
+                      max(sub(abs(p.z), constant(b.z)), zero)};
+    return sub(length(d), constant(r));
+}
+
+SignedDistanceExpression::Node SignedDistanceExpression::sd_torus(Vector const p, float2 const t)
+{
+    return sub(length(sub(length(p.x, p.z), constant(t.x)), p.y), constant(t.y));
+}
+
+// length_to_pow_negative8(q) - t.y, with the 8th root taken as three square roots.
+SignedDistanceExpression::Node SignedDistanceExpression::sd_torus82(Vector const p, float2 const t)
+{
+    Node qx = sub(length(p.x, p.z), constant(t.x));
+    Node qy = p.y;
+    for (u32 i = 0; i < 3; i++)
+    {
+        qx = mul(qx, qx);
+        qy = mul(qy, qy);
+    }
+    return sub(sqrt(sqrt(sqrt(add(qx, qy)))), constant(t.y));
+}
+
+SignedDistanceExpression::Node SignedDistanceExpression::sd_cylinder(Vector const p, float2 const h)
+{
+    Node const zero = constant(0.0f);
+    Node const dx = sub(abs(length(p.x, p.z)), constant(h.x));
+    Node const dy = sub(abs(p.y), constant(h.y));
+    return add(min(max(dx, dy), zero), length(max(dx, zero), max(dy, zero)));
+}
+
+void SignedDistanceExpression::set_root(Node const root)
+{
+    m_root = root;
+}
+
+SignedDistanceExpression::Node SignedDistanceExpression::get_root() const
+{
+    return m_root;
+}
+
+std::vector<SignedDistanceExpression::NodeData> const& SignedDistanceExpression::get_nodes() const
+{
+    return m_nodes;
+}
+
+SignedDistanceProgram SignedDistanceExpression::compile() const
+{
+    std::vector<Node> sources(m_root + 1);
+    for (Node i = 0; i <= m_root; i++)
+    {
+        sources[i] = i;
+    }
+    return compile(sources);
+}
+
+SignedDistanceProgram SignedDistanceExpression::compile(float3 const lower, float3 const upper, interval& distance) const
+{
+    using namespace SignedDistanceOpcode;
+
+    // Intervals are of the nodes' values, which pruning leaves as they are. Where the interval of one operand of a min() or
+    // max() lies entirely on the winning side of the other's, the node takes its value from that operand's source instead.
+    std::vector<interval> intervals(m_root + 1);
+    std::vector<Node> sources(m_root + 1);
+    for (Node i = 0; i <= m_root; i++)
+    {
+        NodeData const& node = m_nodes[i];
+        sources[i] = i;
+        switch (node.opcode)
+        {
+        case X:
+            intervals[i] = {lower.x, upper.x};
+            break;
+        case Y:
+            intervals[i] = {lower.y, upper.y};
+            break;
+        case Z:
+            intervals[i] = {lower.z, upper.z};
+            break;
+        case Constant:
+            intervals[i] = {node.value, node.value};
+            break;
+        default:
+        {
+            interval const a = intervals[node.a];
+            interval const b = intervals[node.b];
+            intervals[i] = apply_signed_distance_opcode(node.opcode, a, b);
+            if ((node.opcode == Min && a.upper <= b.lower) || (node.opcode == Max && a.lower >= b.upper))
+            {
+                sources[i] = sources[node.a];
+            }
+            else if ((node.opcode == Min && b.upper <= a.lower) || (node.opcode == Max && b.lower >= a.upper))
+            {
+                sources[i] = sources[node.b];
+            }
+            break;
+        }
+        }
+    }
+
+    distance = intervals[m_root];
+    return compile(sources);
+}
+
+SignedDistanceProgram SignedDistanceExpression::compile(std::vector<Node> const& sources) const
+{
+    using namespace SignedDistanceOpcode;
+    using Instruction = SignedDistanceProgram::Instruction;
+
+    // Nodes the root depends on, and the last node that reads each of them. Nodes past the root cannot be among them.
+    // Operands get read from their sources.
+    Node const root = sources[m_root];
+    u32 const node_count = root + 1;
+    std::vector<bool> is_used(node_count, false);
+    std::vector<u32> last_use(node_count, NONE);
+    is_used[root] = true;
+    for (u32 i = node_count; i-- > 0;)
+    {
+        NodeData const& node = m_nodes[i];
+        if (!is_used[i] || is_leaf(node.opcode))
+        {
+            continue;
+        }
+
+        Node const a = sources[node.a];
+        is_used[a] = true;
+        last_use[a] = std::max(last_use[a] == NONE ? 0 : last_use[a], i);
+        if (is_binary(node.opcode))
+        {
+            Node const b = sources[node.b];
+            is_used[b] = true;
+            last_use[b] = std::max(last_use[b] == NONE ? 0 : last_use[b], i);
+        }
+    }
+
+    // Leaves get their registers up front, and keep them.
+    std::vector<u32> registers(node_count, NONE);
+    std::vector<float> constants = {};
+    for (u32 i = 0; i < node_count; i++)
+    {
+        NodeData const& node = m_nodes[i];
+        if (!is_used[i] || !is_leaf(node.opcode))
+        {
+            continue;
+        }
+
+        if (node.opcode == Constant)
+        {
+            registers[i] = SignedDistanceProgram::FIRST_CONSTANT_REGISTER + static_cast<u32>(constants.size());
+            constants.push_back(node.value);
+        }
+        else
+        {
+            registers[i] = node.opcode - X;
+        }
+    }
+
+    // Operations take the lowest free register. Operands read for the last time free theirs first,
+    // so a result can go right into the register of one of its operands.
+    u32 register_count = SignedDistanceProgram::FIRST_CONSTANT_REGISTER + static_cast<u32>(constants.size());
+    std::vector<u32> free_registers = {};
+    std::vector<Instruction> instructions = {};
+    auto const release = [&](Node const operand, u32 const i) {
+        if (last_use[operand] == i && !is_leaf(m_nodes[operand].opcode))
+        {
+            free_registers.insert(std::lower_bound(free_registers.begin(), free_registers.end(), registers[operand], std::greater<u32>()),
+                                  registers[operand]);
+        }
+    };
+
+    for (u32 i = 0; i < node_count; i++)
+    {
+        NodeData const& node = m_nodes[i];
+        if (!is_used[i] || is_leaf(node.opcode))
+        {
+            continue;
+        }
+
+        Node const a = sources[node.a];
+        Node const b = is_binary(node.opcode) ? sources[node.b] : a;
+        release(a, i);
+        if (b != a)
+        {
+            release(b, i);
+        }
+
+        if (free_registers.empty())
+        {
+            free_registers.push_back(register_count++);
+        }
+        registers[i] = free_registers.back();
+        free_registers.pop_back();
+
+        if (register_count > SignedDistanceProgram::MAX_REGISTER_COUNT)
+        {
+            return {};
+        }
+
+        Instruction instruction = {};
+        instruction.opcode = node.opcode;
+        instruction.result = static_cast<u8>(registers[i]);
+        instruction.a = static_cast<u8>(registers[a]);
+        instruction.b = static_cast<u8>(is_binary(node.opcode) ? registers[b] : 0);
+        instructions.push_back(instruction);
+    }
+
+    if (register_count > SignedDistanceProgram::MAX_REGISTER_COUNT)
+    {
+        return {};
+    }
+
+    return SignedDistanceProgram(std::move(constants), std::move(instructions), register_count, static_cast<u8>(registers[root]));
+}
+
+SignedDistanceExpression::Node SignedDistanceExpression::add_node(NodeData const& node)
+{
+    u64 const key = node.opcode == SignedDistanceOpcode::Constant
+                      ? (static_cast<u64>(node.opcode) << 56) | std::bit_cast<u32>(node.value)
+                      : (static_cast<u64>(node.opcode) << 56) | (static_cast<u64>(node.a) << 28) | node.b;
+
+    auto const [it, is_new] = m_node_lookup.try_emplace(key, static_cast<Node>(m_nodes.size()));
+    if (is_new)
+    {
+        assert(m_nodes.size() < MAX_NODE_COUNT);
+        m_nodes.push_back(node);
+    }
+    return it->second;
+}
+
+bool build_signed_distance_primitive_expression(SignedDistancePrimitive::Enum const sd_primitive, SignedDistanceExpression& expression)
+{
+    using Node = SignedDistanceExpression::Node;
+    SignedDistanceExpression::Vector const position = expression.get_position();
+
+    Node root = 0;
+    switch (sd_primitive)
+    {
+    case SignedDistancePrimitive::MiniSpheres:
+        root = expression.op_i(expression.sd_sphere(expression.op_rep(expression.add(position, {1, 1, 1}), {0.5f, 0.5f, 0.5f}), 0.65f / 4),
+                               expression.sd_box(position, {1, 1, 1}));
+        break;
+    case SignedDistancePrimitive::IntersectedRoundCube:
+        root = expression.op_s(expression.op_s(expression.ud_round_box(position, {0.75f, 0.75f, 0.75f}, 0.2f),
+                                                expression.sd_sphere(position, 1.20f)),
+                               expression.neg(expression.sd_sphere(position, 1.32f)));
+        break;
+    case SignedDistancePrimitive::SquareTorus:
+        root = expression.sd_torus82(position, {0.75f, 0.15f});
+        break;
+    case SignedDistancePrimitive::TwistedTorus:
+        root = expression.sd_torus(expression.op_twist(position), {0.6f, 0.2f});
+        break;
+    case SignedDistancePrimitive::Cog:
+    {
+        SignedDistanceExpression::Vector const warped = {
+            expression.div(expression.atan2(position.z, position.x), expression.constant(6.2831f)),
+            expression.constant(1.0f),
+            expression.add(expression.constant(0.015f), expression.mul(expression.constant(0.25f), expression.length(position))),
+        };
+        SignedDistanceExpression::Vector const repeated = expression.op_rep(expression.add(warped, {1, 1, 1}), {0.05f, 1, 0.075f});
+        root = expression.op_s(expression.sd_torus82(position, {0.60f, 0.3f}), expression.sd_cylinder(repeated, {0.02f, 0.8f}));
+        break;
+    }
+    case SignedDistancePrimitive::Cylinder:
+        root = expression.op_i(expression.sd_cylinder(expression.op_rep(expression.add(position, {1, 1, 1}), {1, 2, 1}), {0.3f, 2}),
+                               expression.sd_box(expression.add(position, {1, 1, 1}), {2, 2, 2}));
+        break;
+    default:
+        return false;
+    }
+
+    expression.set_root(root);
+    return true;
+}
+
+namespace
+{
+
+// Recursive descent over the S-expressions. Values are numbers or vectors, and arithmetic on a mix of both
+// applies the number to every component.
+class ExpressionParser
+{
+public:
+    ExpressionParser(std::string_view const text, SignedDistanceExpression& expression, std::string& error)
+        : m_text(text), m_expression(expression), m_error(error)
+    {
+    }
+
+    bool parse()
+    {
+        skip_whitespace();
+        u32 const begin = m_offset;
+        Value value = {};
+        if (!parse_value(value))
+        {
+            return false;
+        }
+
+        skip_whitespace();
+        if (m_offset != m_text.size())
+        {
+            return fail("expected the end of the expression");
+        }
+        if (value.is_vector)
+        {
+            m_offset = begin;
+            return fail("the expression has to be a distance, not a vector");
+        }
+
+        m_expression.set_root(value.x);
+        return true;
+    }
+
+private:
+    using Node = SignedDistanceExpression::Node;
+    using Vector = SignedDistanceExpression::Vector;
+
+    struct Value
+    {
+        bool is_vector = false;
+        Node x = 0; // The number, if not a vector.
+        Node y = 0;
+        Node z = 0;
+
+        [[nodiscard]] Vector vector() const
+        {
+            return {x, y, z};
+        }
+    };
+
+    bool fail(std::string_view const message)
+    {
+        m_error = "offset " + std::to_string(m_offset) + ": " + std::string(message);
+        return false;
+    }
+
+    // Whitespace and comments, which run from ; to the end of the line.
+    void skip_whitespace()
+    {
+        while (m_offset < m_text.size())
+        {
+            if (m_text[m_offset] == ';')
+            {
+                while (m_offset < m_text.size() && m_text[m_offset] != '\n')
+                {
+                    m_offset++;
+                }
+            }
+            else if (std::isspace(static_cast<unsigned char>(m_text[m_offset])))
+            {
+                m_offset++;
+            }
+            else
+            {
+                break;
+            }
+        }
+    }
+
+    std::string_view read_atom()
+    {
+        u32 const begin = m_offset;
+        while (m_offset < m_text.size() && m_text[m_offset] != '(' && m_text[m_offset] != ')' && m_text[m_offset] != ';'
+               && !std::isspace(static_cast<unsigned char>(m_text[m_offset])))
+        {
+            m_offset++;
+        }
+        return m_text.substr(begin, m_offset - begin);
+    }
+
+    bool parse_value(Value& value)
+    {
+        skip_whitespace();
+        if (m_offset >= m_text.size())
+        {
+            return fail("unexpected end of the expression");
+        }
+
+        if (m_text[m_offset] == '(')
+        {
+            m_offset++;
+            skip_whitespace();
+            u32 const name_offset = m_offset;
+            std::string_view const name = read_atom();
+
+            std::vector<Value> arguments = {};
+            std::vector<u32> argument_offsets = {};
+            for (skip_whitespace(); m_offset < m_text.size() && m_text[m_offset] != ')'; skip_whitespace())
+            {
+                argument_offsets.push_back(m_offset);
+                Value argument = {};
+                if (!parse_value(argument))
+                {
+                    return false;
+                }
+                arguments.push_back(argument);
+            }
+
+            if (m_offset >= m_text.size())
+            {
+                return fail("missing )");
+            }
+            m_offset++;
+
+            // Errors in the function's own arguments point at the function, or at the argument.
+            u32 const end_offset = m_offset;
+            m_offset = name_offset;
+            m_argument_offsets = std::move(argument_offsets);
+            if (!apply_function(name, arguments, value))
+            {
+                return false;
+            }
+            m_offset = end_offset;
+            return true;
+        }
+
+        u32 const atom_offset = m_offset;
+        std::string_view const atom = read_atom();
+        Vector const position = m_expression.get_position();
+        if (atom == "x" || atom == "y" || atom == "z")
+        {
+            value = {false, atom == "x" ? position.x : (atom == "y" ? position.y : position.z)};
+            return true;
+        }
+        if (atom == "p")
+        {
+            value = {true, position.x, position.y, position.z};
+            return true;
+        }
+
+        float number = 0.0f;
+        auto const [end, ec] = std::from_chars(atom.data(), atom.data() + atom.size(), number);
+        if (atom.empty() || ec != std::errc() || end != atom.data() + atom.size())
+        {
+            m_offset = atom_offset;
+            return fail(atom.empty() ? "expected a value" : "unknown name " + std::string(atom));
+        }
+
+        value = {false, m_expression.constant(number)};
+        return true;
+    }
+
+    // Applies an operation component-wise, turning numbers into vectors where the other operand is one. Unary operations ignore b.
+    Value apply(SignedDistanceOpcode::Enum const opcode, Value const& a, Value const& b)
+    {
+        if (!a.is_vector && !b.is_vector)
+        {
+            return {false, m_expression.operation(opcode, a.x, b.x)};
+        }
+
+        auto const component = [](Value const& v, u32 const i) {
+            return v.is_vector ? (i == 0 ? v.x : (i == 1 ? v.y : v.z)) : v.x;
+        };
+        return {true, m_expression.operation(opcode, component(a, 0), component(b, 0)),
+                m_expression.operation(opcode, component(a, 1), component(b, 1)),
+                m_expression.operation(opcode, component(a, 2), component(b, 2))};
+    }
+
+    bool get_number(Value const& value, float& number)
+    {
+        SignedDistanceExpression::NodeData const& node = m_expression.get_nodes()[value.x];
+        if (value.is_vector || node.opcode != SignedDistanceOpcode::Constant)
+        {
+            return fail("expected a constant number");
+        }
+
+        number = node.value;
+        return true;
+    }
+
+    // Checks the arguments against a signature of 'v' for vectors, 's' for distances and other numbers,
+    // and 'c' for constant numbers, which get written into numbers in order.
+    bool check_arguments(std::string_view const name, std::vector<Value> const& arguments, std::string_view const signature, float* numbers)
+    {
+        if (arguments.size() != signature.size())
+        {
+            return fail(std::string(name) + " takes " + std::to_string(signature.size()) + " arguments");
+        }
+
+        for (u32 i = 0; i < signature.size(); i++)
+        {
+            m_offset = m_argument_offsets[i];
+            if (signature[i] == 'v' && !arguments[i].is_vector)
+            {
+                return fail(std::string(name) + " takes a vector as argument " + std::to_string(i + 1));
+            }
+            if (signature[i] != 'v' && arguments[i].is_vector)
+            {
+                return fail(std::string(name) + " takes a number as argument " + std::to_string(i + 1));
+            }
+            if (signature[i] == 'c' && !get_number(arguments[i], *numbers++))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool apply_function(std::string_view const name, std::vector<Value> const& arguments, Value& value)
+    {
+        using namespace SignedDistanceOpcode;
+        float n[5] = {};
+
+        struct Arithmetic
+        {
+            std::string_view name;
+            Enum opcode;
+        };
+
+        Arithmetic constexpr binary_functions[] = {
+            {"+", Add}, {"-", Sub}, {"*", Mul}, {"/", Div}, {"min", Min}, {"max", Max}, {"mod", Mod}, {"atan2", Atan2},
+        };
+        Arithmetic constexpr unary_functions[] = {
+            {"-", Neg}, {"abs", Abs}, {"sqrt", Sqrt}, {"cos", Cos}, {"sin", Sin},
+        };
+
+        for (Arithmetic const& function : unary_functions)
+        {
+            if (name == function.name && arguments.size() == 1)
+            {
+                value = apply(function.opcode, arguments[0], arguments[0]);
+                return true;
+            }
+        }
+
+        for (Arithmetic const& function : binary_functions)
+        {
+            if (name == function.name)
+            {
+                if (arguments.size() != 2)
+                {
+                    return fail(std::string(name) + " takes 2 arguments");
+                }
+                value = apply(function.opcode, arguments[0], arguments[1]);
+                return true;
+            }
+        }
+
+        if (name == "vec")
+        {
+            if (!check_arguments(name, arguments, "sss", n))
+            {
+                return false;
+            }
+            value = {true, arguments[0].x, arguments[1].x, arguments[2].x};
+            return true;
+        }
+
+        if (name == "x" || name == "y" || name == "z")
+        {
+            if (!check_arguments(name, arguments, "v", n))
+            {
+                return false;
+            }
+            value = {false, name == "x" ? arguments[0].x : (name == "y" ? arguments[0].y : arguments[0].z)};
+            return true;
+        }
+
+        if (name == "length")
+        {
+            if (arguments.size() == 1 && !arguments[0].is_vector)
+            {
+                value = apply(Abs, arguments[0], arguments[0]);
+                return true;
+            }
+            if (!check_arguments(name, arguments, "v", n))
+            {
+                return false;
+            }
+            value = {false, m_expression.length(arguments[0].vector())};
+            return true;
+        }
+
+        if (name == "union" || name == "subtract" || name == "intersect" || name == "blend-union" || name == "blend-intersect")
+        {
+            if (!check_arguments(name, arguments, "ss", n))
+            {
+                return false;
+            }
+
+            Node const a = arguments[0].x;
+            Node const b = arguments[1].x;
+            Node const result = name == "union"          ? m_expression.op_u(a, b)
+                              : name == "subtract"       ? m_expression.op_s(a, b)
+                              : name == "intersect"      ? m_expression.op_i(a, b)
+                              : name == "blend-union"    ? m_expression.op_blend_u(a, b)
+                                                         : m_expression.op_blend_i(a, b);
+            value = {false, result};
+            return true;
+        }
+
+        if (name == "repeat")
+        {
+            if (!check_arguments(name, arguments, "vccc", n))
+            {
+                return false;
+            }
+            Vector const p = m_expression.op_rep(arguments[0].vector(), {n[0], n[1], n[2]});
+            value = {true, p.x, p.y, p.z};
+            return true;
+        }
+
+        if (name == "twist")
+        {
+            if (!check_arguments(name, arguments, "v", n))
+            {
+                return false;
+            }
+            Vector const p = m_expression.op_twist(arguments[0].vector());
+            value = {true, p.x, p.y, p.z};
+            return true;
+        }
+
+        Node distance = 0;
+        if (name == "sphere")
+        {
+            if (!check_arguments(name, arguments, "vc", n))
+            {
+                return false;
+            }
+            distance = m_expression.sd_sphere(arguments[0].vector(), n[0]);
+        }
+        else if (name == "box")
+        {
+            if (!check_arguments(name, arguments, "vccc", n))
+            {
+                return false;
+            }
+            distance = m_expression.sd_box(arguments[0].vector(), {n[0], n[1], n[2]});
+        }
+        else if (name == "round-box")
+        {
+            if (!check_arguments(name, arguments, "vcccc", n))
+            {
+                return false;
+            }
+            distance = m_expression.ud_round_box(arguments[0].vector(), {n[0], n[1], n[2]}, n[3]);
+        }
+        else if (name == "torus" || name == "torus82" || name == "cylinder")
+        {
+            if (!check_arguments(name, arguments, "vcc", n))
+            {
+                return false;
+            }
+            Vector const p = arguments[0].vector();
+            distance = name == "torus"     ? m_expression.sd_torus(p, {n[0], n[1]})
+                     : name == "torus82"   ? m_expression.sd_torus82(p, {n[0], n[1]})
+                                           : m_expression.sd_cylinder(p, {n[0], n[1]});
+        }
+        else
+        {
+            return fail("unknown function " + std::string(name));
+        }
+
+        value = {false, distance};
+        return true;
+    }
+
+    std::string_view m_text;
+    SignedDistanceExpression& m_expression;
+    std::string& m_error;
+    u32 m_offset = 0;
+    std::vector<u32> m_argument_offsets = {};
+};
+
+}
+
+bool parse_signed_distance_expression(std::string_view const text, SignedDistanceExpression& expression, std::string& error)
+{
+    return ExpressionParser(text, expression, error).parse();
+}
+
+}
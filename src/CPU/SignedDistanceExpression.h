@@ -0,0 +1,123 @@
+#pragma once
+
+#include "AK/Types.h"
+#include "CPU/IntervalArithmetic.h"
+#include "CPU/ShaderMath.h"
+#include "CPU/SignedDistanceProgram.h"
+#include "RaytracingSceneDefines.h"
+
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace CPU
+{
+
+// Distance function built at runtime, as a graph of scalar operations on the position, so new shapes need no recompiling.
+// The shapes and operations of SignedDistancePrimitives.h are there under the same names, and expand into the scalar
+// operations they are made of. Operations on constants get folded into constants, identities like x + 0 drop out,
+// and an operation on the same operands as an earlier one reuses its node, so the graph never computes a value twice.
+// Nodes only ever refer to earlier nodes, which makes their order a topological order.
+class SignedDistanceExpression
+{
+public:
+    using Node = u32; // Index of a node.
+
+    struct Vector
+    {
+        Node x = 0;
+        Node y = 0;
+        Node z = 0;
+    };
+
+    struct NodeData
+    {
+        SignedDistanceOpcode::Enum opcode = SignedDistanceOpcode::Constant;
+        Node a = 0;
+        Node b = 0;
+        float value = 0.0f; // Constants only.
+    };
+
+    // Starts out with the position's nodes, and the distance being the position's x.
+    SignedDistanceExpression();
+
+    [[nodiscard]] Vector get_position() const;
+
+    Node constant(float const value);
+    Node operation(SignedDistanceOpcode::Enum const opcode, Node const a, Node const b = 0);
+
+    Node neg(Node const a);
+    Node abs(Node const a);
+    Node sqrt(Node const a);
+    Node cos(Node const a);
+    Node sin(Node const a);
+    Node add(Node const a, Node const b);
+    Node sub(Node const a, Node const b);
+    Node mul(Node const a, Node const b);
+    Node div(Node const a, Node const b);
+    Node min(Node const a, Node const b);
+    Node max(Node const a, Node const b);
+    Node mod(Node const a, Node const b);
+    Node atan2(Node const y, Node const x);
+
+    Vector add(Vector const a, float3 const b);
+    Node length(Node const x, Node const y);
+    Node length(Vector const v);
+
+    // Counterparts of SignedDistancePrimitives.h.
+    Node op_s(Node const d1, Node const d2);
+    Node op_u(Node const d1, Node const d2);
+    Node op_i(Node const d1, Node const d2);
+    Node op_blend_u(Node const d1, Node const d2);
+    Node op_blend_i(Node const d1, Node const d2);
+    Vector op_rep(Vector const p, float3 const c);
+    Vector op_twist(Vector const p);
+    Node sd_sphere(Vector const p, float const s);
+    Node sd_box(Vector const p, float3 const b);
+    Node ud_round_box(Vector const p, float3 const b, float const r);
+    Node sd_torus(Vector const p, float2 const t);
+    Node sd_torus82(Vector const p, float2 const t);
+    Node sd_cylinder(Vector const p, float2 const h);
+
+    // Node whose value is the distance.
+    void set_root(Node const root);
+    [[nodiscard]] Node get_root() const;
+
+    [[nodiscard]] std::vector<NodeData> const& get_nodes() const;
+
+    // Flattens the nodes the root depends on into a program. Empty if they need more than
+    // SignedDistanceProgram::MAX_REGISTER_COUNT registers.
+    [[nodiscard]] SignedDistanceProgram compile() const;
+
+    // Flattens just the nodes that decide the distance within a box. Where interval arithmetic shows one operand of a min()
+    // or max() to win over the other everywhere in the box, the other drops out, along with all the nodes only it reads.
+    // Inside the box, the program's distances are those of compile()'s, and distance bounds them.
+    // Ref: Duff, "Interval Arithmetic and Recursive Subdivision for Implicit Functions and Constructive Solid Geometry", SIGGRAPH 1992
+    // Ref: Keeter, "Massively Parallel Rendering of Complex Closed-Form Implicit Surfaces", SIGGRAPH 2020
+    [[nodiscard]] SignedDistanceProgram compile(float3 const lower, float3 const upper, interval& distance) const;
+
+private:
+    Node add_node(NodeData const& node);
+
+    // Compiles with every node's value read from its source, an earlier node with the same value, or itself.
+    [[nodiscard]] SignedDistanceProgram compile(std::vector<Node> const& sources) const;
+
+    std::vector<NodeData> m_nodes = {};
+    std::unordered_map<u64, Node> m_node_lookup = {};
+    Node m_root = 0;
+};
+
+// Expression of a built-in signed distance primitive, the same distance function get_distance_from_signed_distance_primitive()
+// hard-codes. Returns false for the FractalPyramid, whose folds depend on the position, which expressions have no branches for.
+bool build_signed_distance_primitive_expression(SignedDistancePrimitive::Enum const sd_primitive, SignedDistanceExpression& expression);
+
+// Parses an expression from text, with every operation written as (name arguments...). x, y and z are the position's
+// coordinates and p the position itself, and +, -, *, /, min, max, mod, abs, sqrt, cos, sin, atan2 and length work on
+// numbers and, component-wise, on vectors made with (vec x y z). Shapes and operations take the names of SignedDistancePrimitives.h
+// without their prefixes, with numbers for their parameters, e.g. the IntersectedRoundCube is
+//   (subtract (subtract (round-box p 0.75 0.75 0.75 0.2) (sphere p 1.2)) (- (sphere p 1.32)))
+// Returns false, and describes the first error in error, if the text is not a valid expression.
+bool parse_signed_distance_expression(std::string_view const text, SignedDistanceExpression& expression, std::string& error);
+
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include "ConstantBuffers.h"
+#include "CPU/RaytracingShaderHelper.h"
+#include "CPU/SignedDistancePrimitives.h"
+
+// CPU counterpart of SignedDistanceFractals.hlsli.
+// Set of signed distance fractal tests.
+namespace CPU
+{
+
+// What decides how many iterations a fractal gets at a position: the camera in the primitive's local space,
+// and the angle a pixel spans from it. Without a pixel spread angle, every position gets the fixed iteration count.
+struct FractalDetail
+{
+    float3 camera_position;
+    float pixel_spread_angle = 0.0f;
+    float iterations = FRACTAL_ITERATIONS_COUNT;
+};
+
+// Iterations of a fractal whose copies shrink by scale every iteration, for its smallest copies,
+// of size base_size * scale^-iterations, to span FRACTAL_DETAIL_SIZE_IN_PIXELS pixels at position. A camera right at the position
+// gets the most iterations.
+inline float calculate_fractal_iterations(float3 const position, FractalDetail const& detail, float const base_size, float const scale)
+{
+    if (detail.pixel_spread_angle <= 0.0f)
+    {
+        return detail.iterations;
+    }
+
+    float const footprint = FRACTAL_DETAIL_SIZE_IN_PIXELS * detail.pixel_spread_angle * length(position - detail.camera_position);
+    float const iterations = std::log(base_size / footprint) / std::log(scale);
+    return std::clamp(iterations, static_cast<float>(FRACTAL_MIN_ITERATIONS_COUNT), static_cast<float>(FRACTAL_MAX_ITERATIONS_COUNT));
+}
+
+// Returns a signed distance to a recursive pyramid fractal.
+// h = { sin a, cos a, height of a pyramid}.
+// a = pyramid's inner angle between its side plane and a ground plane.
+// Pyramid position - sitting on a ground plane.
+// Pyramid span: {<-a,0,-a>, <a,h.z,a>}, where a = width of base = h.z * h.y / h.x.
+// More info here http://blog.hvidtfeldts.net/index.php/2011/08/distance-estimated-3d-fractals-iii-folding-space/
+// A fractional iteration count folds ceil(iterations) times and blends into the pyramid one fold short by the fraction.
+inline float sd_fractal_pyramid(float3 position, float3 const h, float const scale = 2.0f,
+                                float const iterations = FRACTAL_ITERATIONS_COUNT)
+{
+    // Set pyramid vertices to AABB's extremities.
+    float const a = h.z * h.y / h.x;
+    float3 const v1 = {0, h.z, 0};
+    float3 const v2 = {-a, 0, a};
+    float3 const v3 = {a, 0, -a};
+    float3 const v4 = {a, 0, a};
+    float3 const v5 = {-a, 0, -a};
+
+    i32 const fold_count = static_cast<i32>(std::ceil(iterations));
+    float const blend = iterations - static_cast<float>(fold_count - 1);
+    float coarse_distance = 0.0f;
+
+    i32 n = 0;
+    for (n = 0; n < fold_count; n++)
+    {
+        if (n == fold_count - 1 && blend < 1.0f)
+        {
+            coarse_distance = sd_pyramid(position, h) * std::pow(scale, static_cast<float>(-n));
+        }
+
+        // Find the closest vertex.
+        float3 v = v1;
+        float dist = length_to_pow2(position - v1);
+        float d = length_to_pow2(position - v2);
+        if (d < dist)
+        {
+            v = v2;
+            dist = d;
+        }
+        d = length_to_pow2(position - v3);
+        if (d < dist)
+        {
+            v = v3;
+            dist = d;
+        }
+        d = length_to_pow2(position - v4);
+        if (d < dist)
+        {
+            v = v4;
+            dist = d;
+        }
+        d = length_to_pow2(position - v5);
+        if (d < dist)
+        {
+            v = v5;
+            dist = d;
+        }
+
+        // Update to a relative position in the current fractal iteration.
+        position = scale * position - v * (scale - 1.0f);
+    }
+    float const distance = sd_pyramid(position, h);
+
+    // Convert the distance from within a fractal iteration to the object space.
+    float const fine_distance = distance * std::pow(scale, static_cast<float>(-n));
+    return blend < 1.0f ? lerp(coarse_distance, fine_distance, blend) : fine_distance;
+}
+
+}
@@ -0,0 +1,224 @@
+#pragma once
+
+#include "CPU/RaytracingShaderHelper.h"
+
+// CPU counterpart of SignedDistancePrimitives.hlsli.
+// A list of useful distance function to simple primitives, and an example on how to
+// do some interesting boolean operations, repetition and displacement.
+// More info here: http://www.iquilezles.org/www/articles/distfunctions/distfunctions.htm
+// Copyright(c) 2013 Inigo Quilez, MIT License.
+namespace CPU
+{
+
+// Subtract: Obj1 - Obj2
+inline float op_s(float const d1, float const d2)
+{
+    return std::max(d1, -d2);
+}
+
+// Union: Obj1 + Obj2
+inline float op_u(float const d1, float const d2)
+{
+    return std::min(d1, d2);
+}
+
+// Intersection: Obj1 & Obj2
+inline float op_i(float const d1, float const d2)
+{
+    return std::max(d1, d2);
+}
+
+// Repetitions
+inline float3 op_rep(float3 const p, float3 const c)
+{
+    return fmod(p, c) - 0.5f * c;
+}
+
+// Polynomial smooth min/union (k = 0.1)
+// Ref: http://www.iquilezles.org/www/articles/smin/smin.htm
+inline float smin(float const a, float const b, float const k)
+{
+    float const h = std::clamp(0.5f + 0.5f * (b - a) / k, 0.0f, 1.0f);
+    return lerp(b, a, h) - k * h * (1.0f - h);
+}
+
+// Polynomial smooth min/union (k = 0.1)
+inline float smax(float const a, float const b, float const k)
+{
+    float const h = std::clamp(0.5f + 0.5f * (b - a) / k, 0.0f, 1.0f);
+    return lerp(a, b, h) + k * h * (1.0f - h);
+}
+
+// Smooth blend as union
+inline float op_blend_u(float const d1, float const d2)
+{
+    return smin(d1, d2, 0.1f);
+}
+
+// Smooth blend as intersect
+inline float op_blend_i(float const d1, float const d2)
+{
+    return smax(d1, d2, 0.1f);
+}
+
+// Twist
+inline float3 op_twist(float3 const p)
+{
+    float const c = std::cos(3.0f * p.y);
+    float const s = std::sin(3.0f * p.y);
+
+    // mul(float2x2(c, -s, s, c), p.xz)
+    return {c * p.x - s * p.z, s * p.x + c * p.z, p.y};
+}
+
+inline float sd_plane(float3 const p)
+{
+    return p.y;
+}
+
+inline float sd_sphere(float3 const p, float const s)
+{
+    return length(p) - s;
+}
+
+// Box extents: <-b,b>
+inline float sd_box(float3 const p, float3 const b)
+{
+    float3 const d = abs(p) - b;
+    return std::min(std::max(d.x, std::max(d.y, d.z)), 0.0f) + length(max(d, 0.0f));
+}
+
+inline float sd_ellipsoid(float3 const p, float3 const r)
+{
+    return (length(p / r) - 1.0f) * std::min(std::min(r.x, r.y), r.z);
+}
+
+inline float ud_round_box(float3 const p, float3 const b, float const r)
+{
+    return length(max(abs(p) - b, 0.0f)) - r;
+}
+
+// t: {radius, tube radius}
+inline float sd_torus(float3 const p, float2 const t)
+{
+    float2 const q = {length(p.xz()) - t.x, p.y};
+    return length(q) - t.y;
+}
+
+inline float sd_hex_prism(float3 const p, float2 const h)
+{
+    float3 const q = abs(p);
+    float const d1 = q.z - h.y;
+    float const d2 = std::max((q.x * 0.866025f + q.y * 0.5f), q.y) - h.x;
+    return length(max(float2 {d1, d2}, 0.0f)) + std::min(std::max(d1, d2), 0.0f);
+}
+
+inline float sd_capsule(float3 const p, float3 const a, float3 const b, float const r)
+{
+    float3 const pa = p - a;
+    float3 const ba = b - a;
+    float const h = std::clamp(dot(pa, ba) / dot(ba, ba), 0.0f, 1.0f);
+    return length(pa - ba * h) - r;
+}
+
+inline float sd_equilateral_triangle(float2 p)
+{
+    float constexpr k = 1.73205f; // sqrt(3.0)
+    p.x = std::abs(p.x) - 1.0f;
+    p.y = p.y + 1.0f / k;
+    if (p.x + k * p.y > 0.0f)
+        p = float2 {p.x - k * p.y, -k * p.x - p.y} / 2.0f;
+    p.x += 2.0f - 2.0f * std::clamp((p.x + 2.0f) / 2.0f, 0.0f, 1.0f);
+    return -length(p) * sign(p.y);
+}
+
+inline float sd_tri_prism(float3 const p, float2 const h)
+{
+    float3 const q = abs(p);
+    float const d1 = q.z - h.y;
+
+    // distance bound
+    float const d2 = std::max(q.x * 0.866025f + p.y * 0.5f, -p.y) - h.x * 0.5f;
+    return length(max(float2 {d1, d2}, 0.0f)) + std::min(std::max(d1, d2), 0.0f);
+}
+
+inline float sd_cylinder(float3 const p, float2 const h)
+{
+    float2 const d = abs(float2 {length(p.xz()), p.y}) - h;
+    return std::min(std::max(d.x, d.y), 0.0f) + length(max(d, 0.0f));
+}
+
+inline float sd_cone(float3 const p, float3 const c)
+{
+    float2 const q = {length(p.xz()), p.y};
+    float const d1 = -q.y - c.z;
+    float const d2 = std::max(dot(q, c.xy()), q.y);
+    return length(max(float2 {d1, d2}, 0.0f)) + std::min(std::max(d1, d2), 0.0f);
+}
+
+inline float sd_cone_section(float3 const p, float const h, float const r1, float const r2)
+{
+    float const d1 = -p.y - h;
+    float const q = p.y - h;
+    float const si = 0.5f * (r1 - r2) / h;
+    float const d2 = std::max(std::sqrt(dot(p.xz(), p.xz()) * (1.0f - si * si)) + q * si - r2, q);
+    return length(max(float2 {d1, d2}, 0.0f)) + std::min(std::max(d1, d2), 0.0f);
+}
+
+// h = { sin a, cos a, height of a pyramid }
+// a = pyramid's inner angle between its side plane and a ground plane.
+// Octahedron position - ground plane intersecting in the middle.
+inline float sd_octahedron(float3 const p, float3 const h)
+{
+    // Get distance against pyramid's sides going through origin.
+    // Test: d = p.x * sin a + p.y * cos a
+    float const d = dot(float2 {std::max(std::abs(p.x), std::abs(p.z)), std::abs(p.y)}, float2 {h.x, h.y});
+
+    // Subtract distance to a side when at height h.z from the origin.
+    return d - h.y * h.z;
+}
+
+// h = { sin a, cos a, height of a pyramid}
+// a = pyramid's inner angle between its side plane and a ground plane.
+// Pyramid position - sitting on a ground plane.
+inline float sd_pyramid(float3 const p, float3 const h)
+{
+    float const octa = sd_octahedron(p, h);
+
+    // Subtract bottom half
+    return op_s(octa, p.y);
+}
+
+inline float length_to_pow_negative6(float2 p)
+{
+    p = p * p * p;
+    p = p * p;
+    return std::pow(p.x + p.y, 1.0f / 6.0f);
+}
+
+inline float length_to_pow_negative8(float2 p)
+{
+    p = p * p;
+    p = p * p;
+    p = p * p;
+    return std::pow(p.x + p.y, 1.0f / 8.0f);
+}
+
+inline float sd_torus82(float3 const p, float2 const t)
+{
+    float2 const q = {length(p.xz()) - t.x, p.y};
+    return length_to_pow_negative8(q) - t.y;
+}
+
+inline float sd_torus88(float3 const p, float2 const t)
+{
+    float2 const q = {length_to_pow_negative8(p.xz()) - t.x, p.y};
+    return length_to_pow_negative8(q) - t.y;
+}
+
+inline float sd_cylinder6(float3 const p, float2 const h)
+{
+    return std::max(length_to_pow_negative6(p.xz()) - h.x, std::abs(p.y) - h.y);
+}
+
+}
@@ -0,0 +1,227 @@
+#include "CPU/SignedDistanceProgram.h"
+
+#include <type_traits>
+#include <utility>
+
+namespace CPU
+{
+
+namespace
+{
+
+// Single lane counterpart of SIMD::Float<N>, for evaluating one position at a time.
+struct Scalar
+{
+    using Type = float;
+
+    static Type load(float const* p)
+    {
+        return *p;
+    }
+
+    static void store(float* p, Type const v)
+    {
+        *p = v;
+    }
+
+    static Type set1(float const v)
+    {
+        return v;
+    }
+};
+
+template<u32 N>
+using Lanes = std::conditional_t<N == 1, Scalar, SIMD::Float<N>>;
+
+// Operations without an instruction of their own go through the scalar ones, lane by lane.
+template<u32 N, typename Function>
+typename Lanes<N>::Type apply_per_lane(typename Lanes<N>::Type const a, typename Lanes<N>::Type const b, Function&& function)
+{
+    using F = Lanes<N>;
+    alignas(64) float lanes_a[N];
+    alignas(64) float lanes_b[N];
+    F::store(lanes_a, a);
+    F::store(lanes_b, b);
+    for (u32 i = 0; i < N; i++)
+    {
+        lanes_a[i] = function(lanes_a[i], lanes_b[i]);
+    }
+    return F::load(lanes_a);
+}
+
+template<u32 N>
+void run(std::span<SignedDistanceProgram::Instruction const> const instructions, typename Lanes<N>::Type* registers)
+{
+    using namespace SignedDistanceOpcode;
+    using F = Lanes<N>;
+    using Type = typename F::Type;
+
+    for (SignedDistanceProgram::Instruction const& instruction : instructions)
+    {
+        // Both operands are read before the result is written, so the result can take over either one's register.
+        Type const a = registers[instruction.a];
+        Type const b = registers[instruction.b];
+
+        if constexpr (N == 1)
+        {
+            registers[instruction.result] = apply_signed_distance_opcode(instruction.opcode, a, b);
+        }
+        else
+        {
+            Type result;
+            switch (instruction.opcode)
+            {
+            case Neg:
+                result = F::sub(F::set1(0.0f), a);
+                break;
+            case Abs:
+                result = F::abs(a);
+                break;
+            case Sqrt:
+                result = F::sqrt(a);
+                break;
+            case Add:
+                result = F::add(a, b);
+                break;
+            case Sub:
+                result = F::sub(a, b);
+                break;
+            case Mul:
+                result = F::mul(a, b);
+                break;
+            case Div:
+                result = F::div(a, b);
+                break;
+            case Min:
+                result = F::min(a, b);
+                break;
+            case Max:
+                result = F::max(a, b);
+                break;
+            case Mod:
+                // a - b * trunc(a / b) rounds twice where fmod() is exact, which is well within what sphere tracing resolves.
+                result = F::sub(a, F::mul(b, F::trunc(F::div(a, b))));
+                break;
+            default:
+                result = apply_per_lane<N>(a, b, [opcode = instruction.opcode](float const x, float const y) {
+                    return apply_signed_distance_opcode(opcode, x, y);
+                });
+                break;
+            }
+            registers[instruction.result] = result;
+        }
+    }
+}
+
+}
+
+SignedDistanceProgram::SignedDistanceProgram(std::vector<float> constants, std::vector<Instruction> instructions, u32 const register_count,
+                                             u8 const result)
+    : m_constants(std::move(constants)), m_instructions(std::move(instructions)), m_register_count(register_count), m_result(result)
+{
+}
+
+float SignedDistanceProgram::get_distance(float3 const position) const
+{
+    float registers[MAX_REGISTER_COUNT];
+    registers[0] = position.x;
+    registers[1] = position.y;
+    registers[2] = position.z;
+    std::copy(m_constants.begin(), m_constants.end(), registers + FIRST_CONSTANT_REGISTER);
+
+    run<1>(m_instructions, registers);
+    return registers[m_result];
+}
+
+void SignedDistanceProgram::evaluate(std::span<float3 const> const positions, std::span<float> const distances) const
+{
+    if constexpr (WIDTH == 1)
+    {
+        for (u32 i = 0; i < positions.size(); i++)
+        {
+            distances[i] = get_distance(positions[i]);
+        }
+    }
+    else
+    {
+        using F = Lanes<WIDTH>;
+        typename F::Type registers[MAX_REGISTER_COUNT];
+
+        // Constants stay in their registers from batch to batch.
+        for (u32 i = 0; i < m_constants.size(); i++)
+        {
+            registers[FIRST_CONSTANT_REGISTER + i] = F::set1(m_constants[i]);
+        }
+
+        for (u32 first = 0; first < positions.size(); first += WIDTH)
+        {
+            // A partial batch repeats its last position in the lanes past the end.
+            u32 const count = std::min(WIDTH, static_cast<u32>(positions.size()) - first);
+            alignas(64) float x[WIDTH];
+            alignas(64) float y[WIDTH];
+            alignas(64) float z[WIDTH];
+            for (u32 i = 0; i < WIDTH; i++)
+            {
+                float3 const& position = positions[first + std::min(i, count - 1)];
+                x[i] = position.x;
+                y[i] = position.y;
+                z[i] = position.z;
+            }
+
+            registers[0] = F::load(x);
+            registers[1] = F::load(y);
+            registers[2] = F::load(z);
+            run<WIDTH>(m_instructions, registers);
+
+            alignas(64) float result[WIDTH];
+            F::store(result, registers[m_result]);
+            std::copy(result, result + count, distances.begin() + first);
+        }
+    }
+}
+
+float3 SignedDistanceProgram::calculate_gradient(float3 const position) const
+{
+    float constexpr e = 0.0001f;
+    float3 const positions[6] = {
+        position + float3 {e, 0.0f, 0.0f}, position - float3 {e, 0.0f, 0.0f}, position + float3 {0.0f, e, 0.0f},
+        position - float3 {0.0f, e, 0.0f}, position + float3 {0.0f, 0.0f, e}, position - float3 {0.0f, 0.0f, e},
+    };
+
+    float distances[6];
+    evaluate(positions, distances);
+    return float3 {distances[0] - distances[1], distances[2] - distances[3], distances[4] - distances[5]} / (2.0f * e);
+}
+
+float SignedDistanceProgram::calculate_directional_derivative(float3 const position, float3 const direction) const
+{
+    float constexpr e = 0.0001f;
+    float3 const offset = e * normalize(direction);
+    float3 const positions[2] = {position + offset, position - offset};
+
+    float distances[2];
+    evaluate(positions, distances);
+    return distances[0] - distances[1];
+}
+
+bool SignedDistanceProgram::is_empty() const
+{
+    return m_register_count == 0;
+}
+
+std::span<SignedDistanceProgram::Instruction const> SignedDistanceProgram::get_instructions() const
+{
+    return m_instructions;
+}
+
+u32 SignedDistanceProgram::get_instruction_count() const
+{
+    return static_cast<u32>(m_instructions.size());
+}
+
+u32 SignedDistanceProgram::get_register_count() const
+{
+    return m_register_count;
+}
+
+}
@@ -0,0 +1,148 @@
+#pragma once
+
+#include "AK/Types.h"
+#include "CPU/SIMD.h"
+#include "CPU/ShaderMath.h"
+
+#include <algorithm>
+#include <cmath>
+#include <span>
+#include <vector>
+
+namespace CPU
+{
+
+namespace SignedDistanceOpcode
+{
+
+enum Enum : u8
+{
+    // Leaves of an expression. Programs hold them in registers from the start, so no instruction computes them.
+    X,
+    Y,
+    Z,
+    Constant,
+
+    // Unary operations on a.
+    Neg,
+    Abs,
+    Sqrt,
+    Cos,
+    Sin,
+
+    // Binary operations on a and b.
+    Add,
+    Sub,
+    Mul,
+    Div,
+    Min,
+    Max,
+    Mod,
+    Atan2,
+
+    Count
+};
+
+inline bool is_leaf(Enum const opcode)
+{
+    return opcode <= Constant;
+}
+
+inline bool is_binary(Enum const opcode)
+{
+    return opcode >= Add;
+}
+
+}
+
+// Value of an operation on scalars. Constant folding goes through it as well, so a folded constant is exactly what
+// evaluating the operation would have given. Mod is HLSL's fmod(), with the sign of a.
+inline float apply_signed_distance_opcode(SignedDistanceOpcode::Enum const opcode, float const a, float const b)
+{
+    using namespace SignedDistanceOpcode;
+    switch (opcode)
+    {
+    case Neg:
+        return -a;
+    case Abs:
+        return std::abs(a);
+    case Sqrt:
+        return std::sqrt(a);
+    case Cos:
+        return std::cos(a);
+    case Sin:
+        return std::sin(a);
+    case Add:
+        return a + b;
+    case Sub:
+        return a - b;
+    case Mul:
+        return a * b;
+    case Div:
+        return a / b;
+    case Min:
+        return std::min(a, b);
+    case Max:
+        return std::max(a, b);
+    case Mod:
+        return std::fmod(a, b);
+    case Atan2:
+        return std::atan2(a, b);
+    default:
+        return 0.0f;
+    }
+}
+
+// Signed distance expression flattened into register-based bytecode by SignedDistanceExpression::compile().
+// Registers 0, 1 and 2 hold the position's x, y and z, and the constants follow them. No instruction overwrites those,
+// so the rest of the registers get reused as soon as the values in them are dead, and a program only needs as many registers
+// as its expression has values live at once. The interpreter runs every instruction over WIDTH positions at once,
+// which spreads the cost of decoding it over all of them.
+class SignedDistanceProgram
+{
+public:
+    static u32 constexpr MAX_REGISTER_COUNT = 256;
+    static u32 constexpr FIRST_CONSTANT_REGISTER = 3;
+
+    // Positions evaluated at once: 8 with AVX2, 4 with SSE2, and 1 without either.
+    static u32 constexpr WIDTH = SIMD::has_float<8> ? 8 : (SIMD::has_float<4> ? 4 : 1);
+
+    struct Instruction
+    {
+        SignedDistanceOpcode::Enum opcode = SignedDistanceOpcode::Neg;
+        u8 result = 0;
+        u8 a = 0;
+        u8 b = 0; // Unused by unary operations.
+    };
+
+    static_assert(sizeof(Instruction) == 4, "Instructions should stay packed into 32 bits.");
+
+    SignedDistanceProgram() = default;
+    SignedDistanceProgram(std::vector<float> constants, std::vector<Instruction> instructions, u32 const register_count, u8 const result);
+
+    // Distance at a single position, with every instruction decoded for just it. What sphere tracing steps use.
+    [[nodiscard]] float get_distance(float3 const position) const;
+
+    // Distances at any number of positions, WIDTH at a time.
+    void evaluate(std::span<float3 const> const positions, std::span<float> const distances) const;
+
+    // Central differences, with all six positions evaluated as a single batch.
+    [[nodiscard]] float3 calculate_gradient(float3 const position) const;
+
+    // Central difference along a direction, with the sign of dot(direction, gradient), from a single batch as well.
+    [[nodiscard]] float calculate_directional_derivative(float3 const position, float3 const direction) const;
+
+    // Default constructed programs have no registers, and are not valid to evaluate.
+    [[nodiscard]] bool is_empty() const;
+    [[nodiscard]] std::span<Instruction const> get_instructions() const;
+    [[nodiscard]] u32 get_instruction_count() const;
+    [[nodiscard]] u32 get_register_count() const;
+
+private:
+    std::vector<float> m_constants = {};
+    std::vector<Instruction> m_instructions = {};
+    u32 m_register_count = 0;
+    u8 m_result = 0;
+};
+
+}
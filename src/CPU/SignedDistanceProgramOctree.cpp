@@ -0,0 +1,177 @@
+#include "CPU/SignedDistanceProgramOctree.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <utility>
+
+namespace CPU
+{
+
+bool SignedDistanceProgramOctree::build(SignedDistanceExpression const& expression)
+{
+    m_cells.clear();
+    m_programs.clear();
+    m_grid.clear();
+
+    SignedDistanceProgram program = expression.compile();
+    if (program.is_empty())
+    {
+        return false;
+    }
+
+    m_programs.push_back(std::move(program));
+    m_cells.push_back({});
+    build_cell(expression, 0, float3 {-1.0f, -1.0f, -1.0f}, float3 {1.0f, 1.0f, 1.0f}, 0);
+
+    // Every grid cell lies within a single leaf, which its center finds.
+    m_grid.resize(GRID_SIZE * GRID_SIZE * GRID_SIZE);
+    for (u32 z = 0; z < GRID_SIZE; z++)
+    {
+        for (u32 y = 0; y < GRID_SIZE; y++)
+        {
+            for (u32 x = 0; x < GRID_SIZE; x++)
+            {
+                float3 const cell = {static_cast<float>(x), static_cast<float>(y), static_cast<float>(z)};
+                float3 const center = (cell + 0.5f) * (2.0f / GRID_SIZE) - 1.0f;
+                m_grid[(z * GRID_SIZE + y) * GRID_SIZE + x] = find_leaf(center).program_index;
+            }
+        }
+    }
+    return true;
+}
+
+// The cell starts out with its parent's program.
+void SignedDistanceProgramOctree::build_cell(SignedDistanceExpression const& expression, u32 const cell_index, float3 const lower,
+                                             float3 const upper, u32 const depth)
+{
+    interval distance = {};
+    SignedDistanceProgram program = expression.compile(lower, upper, distance);
+    u32 program_index = m_cells[cell_index].program_index;
+    if (!program.is_empty() && program.get_instruction_count() < m_programs[program_index].get_instruction_count())
+    {
+        program_index = static_cast<u32>(m_programs.size());
+        m_cells[cell_index].program_index = program_index;
+        m_programs.push_back(std::move(program));
+    }
+
+    // Programs without min() or max() have nothing left to prune in smaller cells.
+    std::span<SignedDistanceProgram::Instruction const> const instructions = m_programs[program_index].get_instructions();
+    bool const can_prune = std::any_of(instructions.begin(), instructions.end(), [](SignedDistanceProgram::Instruction const& instruction) {
+        return instruction.opcode == SignedDistanceOpcode::Min || instruction.opcode == SignedDistanceOpcode::Max;
+    });
+    if (depth == MAX_DEPTH || !can_prune)
+    {
+        return;
+    }
+
+    u32 const first_child = static_cast<u32>(m_cells.size());
+    m_cells[cell_index].first_child = first_child;
+    m_cells.resize(first_child + 8, {NO_CHILDREN, program_index});
+
+    float3 const center = 0.5f * (lower + upper);
+    for (u32 i = 0; i < 8; i++)
+    {
+        float3 const child_lower = {(i & 1) ? center.x : lower.x, (i & 2) ? center.y : lower.y, (i & 4) ? center.z : lower.z};
+        float3 const child_upper = {(i & 1) ? upper.x : center.x, (i & 2) ? upper.y : center.y, (i & 4) ? upper.z : center.z};
+        build_cell(expression, first_child + i, child_lower, child_upper, depth + 1);
+    }
+}
+
+SignedDistanceProgramOctree::Cell const& SignedDistanceProgramOctree::find_leaf(float3 const position) const
+{
+    float3 lower = {-1.0f, -1.0f, -1.0f};
+    float3 upper = {1.0f, 1.0f, 1.0f};
+    Cell const* cell = &m_cells[0];
+    while (cell->first_child != NO_CHILDREN)
+    {
+        float3 const center = 0.5f * (lower + upper);
+        u32 child = 0;
+        for (u32 axis = 0; axis < 3; axis++)
+        {
+            if (position[axis] >= center[axis])
+            {
+                child |= 1u << axis;
+                lower[axis] = center[axis];
+            }
+            else
+            {
+                upper[axis] = center[axis];
+            }
+        }
+        cell = &m_cells[cell->first_child + child];
+    }
+    return *cell;
+}
+
+SignedDistanceProgram const& SignedDistanceProgramOctree::get_program() const
+{
+    return m_programs[0];
+}
+
+void SignedDistanceProgramOctree::evaluate(std::span<float3 const> const positions, std::span<float> const distances) const
+{
+    u32 constexpr width = SignedDistanceProgram::WIDTH;
+    for (u32 first = 0; first < positions.size(); first += width)
+    {
+        u32 const count = std::min(width, static_cast<u32>(positions.size()) - first);
+        SignedDistanceProgram const* programs[width];
+        for (u32 i = 0; i < count; i++)
+        {
+            programs[i] = &get_program(positions[first + i]);
+        }
+
+        // Every program evaluates the positions in its cells as a batch, which is a single one for positions close together.
+        u32 remaining_mask = (1u << count) - 1;
+        while (remaining_mask != 0)
+        {
+            SignedDistanceProgram const* program = programs[std::countr_zero(remaining_mask)];
+            float3 batch_positions[width];
+            u32 batch_indices[width];
+            u32 batch_count = 0;
+            for (u32 i = 0; i < count; i++)
+            {
+                if ((remaining_mask & (1u << i)) != 0 && programs[i] == program)
+                {
+                    batch_positions[batch_count] = positions[first + i];
+                    batch_indices[batch_count++] = first + i;
+                    remaining_mask &= ~(1u << i);
+                }
+            }
+
+            float batch_distances[width];
+            program->evaluate(std::span<float3 const>(batch_positions, batch_count), std::span<float>(batch_distances, batch_count));
+            for (u32 i = 0; i < batch_count; i++)
+            {
+                distances[batch_indices[i]] = batch_distances[i];
+            }
+        }
+    }
+}
+
+float3 SignedDistanceProgramOctree::calculate_gradient(float3 const position) const
+{
+    return m_programs[0].calculate_gradient(position);
+}
+
+float SignedDistanceProgramOctree::calculate_directional_derivative(float3 const position, float3 const direction) const
+{
+    return m_programs[0].calculate_directional_derivative(position, direction);
+}
+
+bool SignedDistanceProgramOctree::is_empty() const
+{
+    return m_programs.empty();
+}
+
+u32 SignedDistanceProgramOctree::get_cell_count() const
+{
+    return static_cast<u32>(m_cells.size());
+}
+
+u32 SignedDistanceProgramOctree::get_program_count() const
+{
+    return static_cast<u32>(m_programs.size());
+}
+
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "AK/Types.h"
+#include "CPU/ShaderMath.h"
+#include "CPU/SignedDistanceExpression.h"
+#include "CPU/SignedDistanceProgram.h"
+
+#include <algorithm>
+#include <cmath>
+#include <span>
+#include <vector>
+
+namespace CPU
+{
+
+// Programs of a signed distance expression pruned to the cells of an octree over its AABB, <-1,1> in local space.
+// Most of a CSG tree's min() and max() have one side that always wins away from where the shapes meet, so a cell's program
+// only evaluates the shapes that are close, and sphere tracing steps through a cell at the cost of its shorter program.
+// Cells keep getting split until no min() or max() is left in their program, or MAX_DEPTH. Children whose program
+// is no shorter than their parent's share it. Lookups go through a grid of the cells at MAX_DEPTH instead of down the octree,
+// as sphere tracing looks up a program at every step.
+// Works as a distance function for sphere_trace(). Distances come from the program of the cell they are in, and gradients
+// from the whole expression's, as the central differences straddle cells.
+class SignedDistanceProgramOctree
+{
+public:
+    static u32 constexpr MAX_DEPTH = 4;
+    static u32 constexpr GRID_SIZE = 1u << MAX_DEPTH; // Cells of the lookup grid per axis.
+
+    // Returns false, leaving the octree empty, if the expression does not compile.
+    bool build(SignedDistanceExpression const& expression);
+
+    // Program that decides the distance at a local space position. The whole expression's outside of the AABB.
+    // Positions within rounding of a boundary between cells can end up in either cell, whose programs differ from each other
+    // by about as little there.
+    [[nodiscard]] SignedDistanceProgram const& get_program(float3 const position) const
+    {
+        if (m_programs.size() == 1 || !(std::abs(position.x) <= 1.0f && std::abs(position.y) <= 1.0f && std::abs(position.z) <= 1.0f))
+        {
+            return m_programs[0];
+        }
+
+        float constexpr scale = 0.5f * GRID_SIZE;
+        u32 const x = std::min(static_cast<u32>((position.x + 1.0f) * scale), GRID_SIZE - 1);
+        u32 const y = std::min(static_cast<u32>((position.y + 1.0f) * scale), GRID_SIZE - 1);
+        u32 const z = std::min(static_cast<u32>((position.z + 1.0f) * scale), GRID_SIZE - 1);
+        return m_programs[m_grid[(z * GRID_SIZE + y) * GRID_SIZE + x]];
+    }
+
+    // Program of the whole expression, unpruned.
+    [[nodiscard]] SignedDistanceProgram const& get_program() const;
+
+    [[nodiscard]] float get_distance(float3 const position) const
+    {
+        return get_program(position).get_distance(position);
+    }
+
+    // Distances at any number of positions, each from the program of its cell, batched by program.
+    void evaluate(std::span<float3 const> const positions, std::span<float> const distances) const;
+
+    [[nodiscard]] float3 calculate_gradient(float3 const position) const;
+    [[nodiscard]] float calculate_directional_derivative(float3 const position, float3 const direction) const;
+
+    [[nodiscard]] bool is_empty() const;
+    [[nodiscard]] u32 get_cell_count() const;
+    [[nodiscard]] u32 get_program_count() const;
+
+private:
+    static u32 constexpr NO_CHILDREN = 0; // The root is nobody's child.
+
+    struct Cell
+    {
+        u32 first_child = NO_CHILDREN; // Of eight consecutive ones, in x, y, z bit order.
+        u32 program_index = 0;
+    };
+
+    void build_cell(SignedDistanceExpression const& expression, u32 const cell_index, float3 const lower, float3 const upper,
+                    u32 const depth);
+    [[nodiscard]] Cell const& find_leaf(float3 const position) const;
+
+    std::vector<Cell> m_cells = {};
+    std::vector<SignedDistanceProgram> m_programs = {}; // The first is the whole expression's.
+    std::vector<u32> m_grid = {}; // Program of every cell, GRID_SIZE^3, x-major.
+};
+
+}
@@ -0,0 +1,202 @@
+#include "CPU/SparseDistanceField.h"
+
+#include "CPU/LipschitzBound.h"
+#include "CPU/ProceduralPrimitivesLibrary.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace CPU
+{
+
+namespace
+{
+
+u32 constexpr SAMPLE_COUNT = SparseDistanceField::CELL_COUNT + 1; // Cell corners per axis.
+
+u32 sample_index(u32 const x, u32 const y, u32 const z, u32 const count)
+{
+    return (z * count + y) * count + x;
+}
+
+// The field of a fractal bounds it at its fewest iterations. Every iteration only removes parts of the fractal,
+// so that field never overestimates the distance at whatever iterations the fractal gets traced with.
+template<SignedDistancePrimitive::Enum sd_primitive>
+float get_cached_distance(float3 const position)
+{
+    FractalDetail fractal_detail = {};
+    fractal_detail.iterations = FRACTAL_MIN_ITERATIONS_COUNT;
+    return get_distance_from_signed_distance_primitive<sd_primitive>(position, fractal_detail);
+}
+
+}
+
+void SparseDistanceField::build(SignedDistancePrimitive::Enum const sd_primitive)
+{
+    float const lipschitz_bound = estimate_lipschitz_bound(sd_primitive);
+
+    using namespace SignedDistancePrimitive;
+    switch (sd_primitive)
+    {
+    case MiniSpheres:
+        return build(&get_cached_distance<MiniSpheres>, lipschitz_bound);
+    case IntersectedRoundCube:
+        return build(&get_cached_distance<IntersectedRoundCube>, lipschitz_bound);
+    case SquareTorus:
+        return build(&get_cached_distance<SquareTorus>, lipschitz_bound);
+    case TwistedTorus:
+        return build(&get_cached_distance<TwistedTorus>, lipschitz_bound);
+    case Cog:
+        return build(&get_cached_distance<Cog>, lipschitz_bound);
+    case Cylinder:
+        return build(&get_cached_distance<Cylinder>, lipschitz_bound);
+    case FractalPyramid:
+        return build(&get_cached_distance<FractalPyramid>, lipschitz_bound);
+    default:
+        break;
+    }
+}
+
+void SparseDistanceField::build(float (*distance_function)(float3 const), float const lipschitz_bound)
+{
+    m_cells.assign(BRICK_COUNT * BRICK_COUNT * BRICK_COUNT, {});
+    m_bricks.clear();
+    m_samples.clear();
+
+    // Neighbouring bricks share their boundary samples, so sample every cell corner once.
+    std::vector<float> distances(SAMPLE_COUNT * SAMPLE_COUNT * SAMPLE_COUNT);
+    for (u32 z = 0; z < SAMPLE_COUNT; z++)
+    {
+        for (u32 y = 0; y < SAMPLE_COUNT; y++)
+        {
+            for (u32 x = 0; x < SAMPLE_COUNT; x++)
+            {
+                float3 const position = float3 {static_cast<float>(x), static_cast<float>(y), static_cast<float>(z)} * CELL_SIZE - 1.0f;
+                distances[sample_index(x, y, z, SAMPLE_COUNT)] = distance_function(position);
+            }
+        }
+    }
+
+    // Anywhere in a cell, the distance is within this of the trilinear interpolation of its corners.
+    float const interpolation_error = lipschitz_bound * 0.5f * std::sqrt(3.0f) * CELL_SIZE;
+    m_error_bound = interpolation_error;
+    // Neighbouring samples further apart than the bound allows straddle a jump, like the fractal's at its folds.
+    float const max_sample_difference = 1.01f * lipschitz_bound * CELL_SIZE;
+
+    for (u32 bz = 0; bz < BRICK_COUNT; bz++)
+    {
+        for (u32 by = 0; by < BRICK_COUNT; by++)
+        {
+            for (u32 bx = 0; bx < BRICK_COUNT; bx++)
+            {
+                auto const brick_sample = [&](u32 const x, u32 const y, u32 const z) {
+                    return distances[sample_index(bx * BRICK_SIZE + x, by * BRICK_SIZE + y, bz * BRICK_SIZE + z, SAMPLE_COUNT)];
+                };
+
+                float min_distance = brick_sample(0, 0, 0);
+                float max_distance = min_distance;
+                bool has_jump = false;
+                for (u32 z = 0; z <= BRICK_SIZE; z++)
+                {
+                    for (u32 y = 0; y <= BRICK_SIZE; y++)
+                    {
+                        for (u32 x = 0; x <= BRICK_SIZE; x++)
+                        {
+                            float const distance = brick_sample(x, y, z);
+                            min_distance = std::min(min_distance, distance);
+                            max_distance = std::max(max_distance, distance);
+                            has_jump |= x < BRICK_SIZE && std::abs(brick_sample(x + 1, y, z) - distance) > max_sample_difference;
+                            has_jump |= y < BRICK_SIZE && std::abs(brick_sample(x, y + 1, z) - distance) > max_sample_difference;
+                            has_jump |= z < BRICK_SIZE && std::abs(brick_sample(x, y, z + 1) - distance) > max_sample_difference;
+                        }
+                    }
+                }
+
+                Cell& cell = m_cells[sample_index(bx, by, bz, BRICK_COUNT)];
+
+                // Across a jump, neither the samples nor the interpolation error bound anything. Leave the exact distance function to it.
+                if (has_jump)
+                {
+                    continue;
+                }
+
+                // Clear of the surface, whether outside or inside of it. Inside, there is no bound to step by.
+                if (min_distance - interpolation_error > 0.0f || max_distance + interpolation_error < 0.0f)
+                {
+                    cell.lower_bound = std::max(0.0f, min_distance - interpolation_error);
+                    continue;
+                }
+
+                Brick brick = {};
+                brick.scale = std::max(max_distance - min_distance, 1e-6f) / 255.0f;
+                brick.offset = min_distance - 0.5f * brick.scale;
+
+                cell.brick_index = static_cast<u32>(m_bricks.size());
+                m_bricks.push_back(brick);
+
+                for (u32 z = 0; z <= BRICK_SIZE; z++)
+                {
+                    for (u32 y = 0; y <= BRICK_SIZE; y++)
+                    {
+                        for (u32 x = 0; x <= BRICK_SIZE; x++)
+                        {
+                            float const q = std::round((brick_sample(x, y, z) - min_distance) / brick.scale);
+                            m_samples.push_back(static_cast<u8>(std::clamp(q, 0.0f, 255.0f)));
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+float SparseDistanceField::get_distance(float3 const position) const
+{
+    float3 const p = (position + 1.0f) * (CELL_COUNT / 2.0f);
+
+    // Written so a NaN position fails too.
+    float constexpr max_coordinate = static_cast<float>(CELL_COUNT);
+    if (!(p.x >= 0.0f && p.x < max_coordinate && p.y >= 0.0f && p.y < max_coordinate && p.z >= 0.0f && p.z < max_coordinate)
+        || m_cells.empty())
+    {
+        return 0.0f;
+    }
+
+    u32 const x = static_cast<u32>(p.x);
+    u32 const y = static_cast<u32>(p.y);
+    u32 const z = static_cast<u32>(p.z);
+    Cell const& cell = m_cells[sample_index(x / BRICK_SIZE, y / BRICK_SIZE, z / BRICK_SIZE, BRICK_COUNT)];
+    if (cell.brick_index == NO_BRICK)
+    {
+        return cell.lower_bound;
+    }
+
+    u32 constexpr row = BRICK_SIZE + 1;
+    u32 constexpr slice = row * row;
+    u8 const* samples = &m_samples[cell.brick_index * BRICK_SAMPLE_COUNT
+                                   + sample_index(x % BRICK_SIZE, y % BRICK_SIZE, z % BRICK_SIZE, row)];
+
+    float const fx = p.x - static_cast<float>(x);
+    float const fy = p.y - static_cast<float>(y);
+    float const fz = p.z - static_cast<float>(z);
+    auto const lerp_x = [&](u32 const offset) {
+        return lerp(static_cast<float>(samples[offset]), static_cast<float>(samples[offset + 1]), fx);
+    };
+    float const q = lerp(lerp(lerp_x(0), lerp_x(row), fy), lerp(lerp_x(slice), lerp_x(slice + row), fy), fz);
+
+    // Closer to the surface than the error bound, 0 hands over to the exact distance function.
+    Brick const& brick = m_bricks[cell.brick_index];
+    return std::max(0.0f, brick.offset + q * brick.scale - m_error_bound);
+}
+
+bool SparseDistanceField::is_empty() const
+{
+    return m_cells.empty();
+}
+
+u32 SparseDistanceField::get_brick_count() const
+{
+    return static_cast<u32>(m_bricks.size());
+}
+
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "AK/Types.h"
+#include "CPU/ShaderMath.h"
+#include "RaytracingSceneDefines.h"
+
+#include <vector>
+
+namespace CPU
+{
+
+// Distance function of a signed distance primitive sampled over its AABB, <-1,1> in local space, so sphere tracing
+// can skip most evaluations of expensive ones, like the fractal's folds or the Cog's atan2() and repetition.
+// The AABB is split into bricks of BRICK_SIZE^3 cells. Only bricks the surface passes through keep their samples,
+// quantized to 8 bits relative to the brick's range, and every other brick keeps a single lower bound for all of its points.
+// The trilinear filtered samples overestimate the distance by up to an error bound, which lookups subtract. Below it,
+// within a few cells of the surface, and in bricks the distance function jumps in, the exact distance function has to take over.
+class SparseDistanceField
+{
+public:
+    static u32 constexpr BRICK_SIZE = 8; // Cells per brick along an axis.
+    static u32 constexpr BRICK_COUNT = 16; // Bricks per axis.
+    static u32 constexpr CELL_COUNT = BRICK_SIZE * BRICK_COUNT; // Cells per axis.
+    static float constexpr CELL_SIZE = 2.0f / CELL_COUNT;
+
+    // Closer to the surface than this, the exact distance function has to take over from lookups.
+    static float constexpr REFINE_DISTANCE = CELL_SIZE;
+
+    // Samples the primitive's distance function. Only depends on the primitive, so a field can be built once and reused.
+    void build(SignedDistancePrimitive::Enum const sd_primitive);
+
+    // Lower bound of the distance to the surface from a local space position, never negative. Zero when nothing is known:
+    // outside the AABB, inside the primitive, closer to the surface than the error bound, and in bricks with jumps.
+    [[nodiscard]] float get_distance(float3 const position) const;
+
+    [[nodiscard]] bool is_empty() const;
+    [[nodiscard]] u32 get_brick_count() const;
+
+private:
+    static u32 constexpr NO_BRICK = ~0u;
+    static u32 constexpr BRICK_SAMPLE_COUNT = (BRICK_SIZE + 1) * (BRICK_SIZE + 1) * (BRICK_SIZE + 1); // Cell corners.
+
+    struct Cell
+    {
+        u32 brick_index = NO_BRICK;
+        float lower_bound = 0.0f; // Of every point in the brick, without one.
+    };
+
+    // A sample's distance is offset + quantized value * scale. The offset takes out the quantization error,
+    // so rounding never moves a sample further from the surface.
+    struct Brick
+    {
+        float offset = 0.0f;
+        float scale = 0.0f;
+    };
+
+    void build(float (*distance_function)(float3 const), float const lipschitz_bound);
+
+    std::vector<Cell> m_cells = {}; // BRICK_COUNT^3, x-major.
+    std::vector<Brick> m_bricks = {};
+    std::vector<u8> m_samples = {}; // BRICK_SAMPLE_COUNT per brick, x-major.
+    float m_error_bound = 0.0f; // Of the filtered samples over the distance anywhere in a brick.
+};
+
+}
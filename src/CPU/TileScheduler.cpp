@@ -0,0 +1,231 @@
+#include "CPU/TileScheduler.h"
+
+#include <algorithm>
+#include <thread>
+
+namespace CPU
+{
+
+namespace
+{
+
+// Spreads the lower 16 bits of v out to the even bits.
+u32 part_1_by_1(u32 v)
+{
+    v &= 0x0000ffff;
+    v = (v | (v << 8)) & 0x00ff00ff;
+    v = (v | (v << 4)) & 0x0f0f0f0f;
+    v = (v | (v << 2)) & 0x33333333;
+    v = (v | (v << 1)) & 0x55555555;
+    return v;
+}
+
+u32 morton_code(u32 const x, u32 const y)
+{
+    return part_1_by_1(x) | (part_1_by_1(y) << 1);
+}
+
+}
+
+TileScheduler::TileScheduler()
+{
+    m_thread_count = std::max(1u, std::thread::hardware_concurrency());
+}
+
+TileScheduler::~TileScheduler()
+{
+    stop_workers();
+}
+
+void TileScheduler::dispatch(uint2 const dimensions, RenderTile const& render_tile)
+{
+    if (dimensions.x == 0 || dimensions.y == 0)
+    {
+        return;
+    }
+
+    // Tiles in Morton order.
+    uint2 const tile_count = {(dimensions.x + m_tile_size - 1) / m_tile_size, (dimensions.y + m_tile_size - 1) / m_tile_size};
+    m_tiles.clear();
+    for (u32 y = 0; y < tile_count.y; y++)
+    {
+        for (u32 x = 0; x < tile_count.x; x++)
+        {
+            uint2 const origin = {x * m_tile_size, y * m_tile_size};
+            uint2 const size = {std::min(m_tile_size, dimensions.x - origin.x), std::min(m_tile_size, dimensions.y - origin.y)};
+            m_tiles.push_back({origin, size});
+        }
+    }
+
+    std::ranges::sort(m_tiles, {}, [&](Tile const& tile) {
+        return morton_code(tile.origin.x / m_tile_size, tile.origin.y / m_tile_size);
+    });
+
+    // Every thread starts with an equal, contiguous run of tiles.
+    u32 const thread_count = std::min(m_thread_count, static_cast<u32>(m_tiles.size()));
+    m_queues = std::vector<TileQueue>(thread_count);
+    for (u32 i = 0; i < thread_count; i++)
+    {
+        u32 const begin = static_cast<u32>(static_cast<u64>(m_tiles.size()) * i / thread_count);
+        u32 const end = static_cast<u32>(static_cast<u64>(m_tiles.size()) * (i + 1) / thread_count);
+        for (u32 tile_index = begin; tile_index < end; tile_index++)
+        {
+            m_queues[i].tiles.push_back(tile_index);
+        }
+    }
+
+    if (m_workers.size() + 1 != m_thread_count)
+    {
+        stop_workers();
+        start_workers();
+    }
+
+    {
+        std::scoped_lock const lock(m_pool_mutex);
+        m_render_tile = &render_tile;
+        m_dispatch_thread_count = thread_count;
+        m_busy_worker_count = thread_count - 1;
+        m_dispatch_index++;
+    }
+    m_dispatch_started.notify_all();
+
+    render_tiles(0);
+
+    std::unique_lock lock(m_pool_mutex);
+    m_dispatch_finished.wait(lock, [&] {
+        return m_busy_worker_count == 0;
+    });
+    m_render_tile = nullptr;
+}
+
+void TileScheduler::set_thread_count(u32 const thread_count)
+{
+    m_thread_count = std::max(1u, thread_count);
+}
+
+u32 TileScheduler::get_thread_count() const
+{
+    return m_thread_count;
+}
+
+void TileScheduler::set_tile_size(u32 const tile_size)
+{
+    m_tile_size = std::max(1u, tile_size);
+}
+
+u32 TileScheduler::get_tile_size() const
+{
+    return m_tile_size;
+}
+
+void TileScheduler::render_tiles(u32 const thread_index)
+{
+    u32 tile_index = 0;
+    while (pop_tile(thread_index, tile_index) || steal_tile(thread_index, tile_index))
+    {
+        (*m_render_tile)(m_tiles[tile_index], thread_index);
+    }
+}
+
+void TileScheduler::start_workers()
+{
+    m_stopping = false;
+    for (u32 i = 1; i < m_thread_count; i++)
+    {
+        m_workers.emplace_back(&TileScheduler::run_worker, this, i, m_dispatch_index);
+    }
+}
+
+void TileScheduler::stop_workers()
+{
+    {
+        std::scoped_lock const lock(m_pool_mutex);
+        m_stopping = true;
+    }
+    m_dispatch_started.notify_all();
+
+    for (std::thread& worker : m_workers)
+    {
+        worker.join();
+    }
+    m_workers.clear();
+}
+
+// dispatch_index is the last dispatch before the worker got started, which it waits for the next one after.
+void TileScheduler::run_worker(u32 const thread_index, u64 dispatch_index)
+{
+    while (true)
+    {
+        {
+            std::unique_lock lock(m_pool_mutex);
+            m_dispatch_started.wait(lock, [&] {
+                return m_stopping || m_dispatch_index != dispatch_index;
+            });
+
+            if (m_stopping)
+            {
+                return;
+            }
+
+            dispatch_index = m_dispatch_index;
+            if (thread_index >= m_dispatch_thread_count)
+            {
+                continue;
+            }
+        }
+
+        render_tiles(thread_index);
+
+        bool is_last = false;
+        {
+            std::scoped_lock const lock(m_pool_mutex);
+            is_last = --m_busy_worker_count == 0;
+        }
+
+        if (is_last)
+        {
+            m_dispatch_finished.notify_one();
+        }
+    }
+}
+
+bool TileScheduler::pop_tile(u32 const thread_index, u32& tile_index)
+{
+    TileQueue& queue = m_queues[thread_index];
+    std::scoped_lock const lock(queue.mutex);
+
+    if (queue.tiles.empty())
+    {
+        return false;
+    }
+
+    tile_index = queue.tiles.front();
+    queue.tiles.pop_front();
+    return true;
+}
+
+bool TileScheduler::steal_tile(u32 const thread_index, u32& tile_index)
+{
+    u32 const queue_count = static_cast<u32>(m_queues.size());
+
+    // Victims are tried starting with the next thread, so thieves spread out instead of all hitting the same queue.
+    for (u32 i = 1; i < queue_count; i++)
+    {
+        TileQueue& victim = m_queues[(thread_index + i) % queue_count];
+        std::scoped_lock const lock(victim.mutex);
+
+        if (victim.tiles.empty())
+        {
+            continue;
+        }
+
+        // The back is the farthest from where the victim is working, in both time and screen space.
+        tile_index = victim.tiles.back();
+        victim.tiles.pop_back();
+        return true;
+    }
+
+    return false;
+}
+
+}
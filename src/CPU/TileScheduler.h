@@ -0,0 +1,88 @@
+#pragma once
+
+#include "AK/Types.h"
+#include "CPU/ShaderMath.h"
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace CPU
+{
+
+// Splits a dispatch grid into tiles and renders them on a set of threads with work stealing.
+// Tiles are issued in Morton order and every thread starts with its own contiguous, so spatially compact, run of them.
+// Threads take tiles from the front of their own queue, and once it runs dry steal from the back of the others.
+// This keeps cores busy when some tiles are far more expensive than others, e.g. the ones covering the SDF primitives.
+// The dispatching thread renders tiles as thread 0, next to a pool of workers that persists from dispatch to dispatch,
+// so frames do not pay for starting and joining threads.
+class TileScheduler
+{
+public:
+    struct Tile
+    {
+        uint2 origin;
+        uint2 size;
+    };
+
+    using RenderTile = std::function<void(Tile const& tile, u32 const thread_index)>;
+
+    TileScheduler();
+    ~TileScheduler();
+
+    TileScheduler(TileScheduler const&) = delete;
+    TileScheduler& operator=(TileScheduler const&) = delete;
+
+    // Runs render_tile() once for every tile covering the <0, dimensions) grid, and returns when all of them are done.
+    // thread_index is below get_thread_count() and unique among the threads running at the same time.
+    void dispatch(uint2 const dimensions, RenderTile const& render_tile);
+
+    // Workers get started or stopped on the next dispatch.
+    void set_thread_count(u32 const thread_count);
+    [[nodiscard]] u32 get_thread_count() const;
+
+    // Width and height of a tile in pixels.
+    void set_tile_size(u32 const tile_size);
+    [[nodiscard]] u32 get_tile_size() const;
+
+private:
+    struct alignas(64) TileQueue
+    {
+        std::mutex mutex = {};
+        std::deque<u32> tiles = {};
+    };
+
+    bool pop_tile(u32 const thread_index, u32& tile_index);
+    bool steal_tile(u32 const thread_index, u32& tile_index);
+
+    // No tiles get added during a dispatch, so a thread that finds every queue empty is done.
+    void render_tiles(u32 const thread_index);
+
+    void start_workers();
+    void stop_workers();
+    void run_worker(u32 const thread_index, u64 dispatch_index);
+
+    u32 m_thread_count = 0;
+    u32 m_tile_size = 16;
+
+    std::vector<Tile> m_tiles = {};
+    std::vector<TileQueue> m_queues = {};
+
+    // Everything below is guarded by m_pool_mutex. Workers wait for m_dispatch_index to change, take part in the dispatch if
+    // their thread index is below m_dispatch_thread_count, and the last of those to finish wakes up the dispatching thread.
+    std::mutex m_pool_mutex = {};
+    std::condition_variable m_dispatch_started = {};
+    std::condition_variable m_dispatch_finished = {};
+    u64 m_dispatch_index = 0;
+    u32 m_dispatch_thread_count = 0;
+    u32 m_busy_worker_count = 0;
+    RenderTile const* m_render_tile = nullptr;
+    bool m_stopping = false;
+
+    std::vector<std::thread> m_workers = {}; // Threads 1 to m_thread_count - 1.
+};
+
+}
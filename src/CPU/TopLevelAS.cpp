@@ -0,0 +1,80 @@
+#include "CPU/TopLevelAS.h"
+
+namespace CPU
+{
+
+void TopLevelAS::build(std::vector<Instance> instances, std::span<BVH const> const bottom_level_as, BVHBuildSettings const& settings)
+{
+    m_instances = std::move(instances);
+    m_settings = settings;
+
+    std::vector<AABB> instance_bounds = {};
+    calculate_instance_bounds(get_bottom_level_as_bounds(bottom_level_as), instance_bounds, m_bvh_instance_indices);
+    m_bvh.build(instance_bounds, m_settings);
+}
+
+bool TopLevelAS::update(std::span<BVH const> const bottom_level_as, float const max_sah_cost_growth)
+{
+    return update(get_bottom_level_as_bounds(bottom_level_as), max_sah_cost_growth);
+}
+
+bool TopLevelAS::update(std::span<AABB const> const bottom_level_as_bounds, float const max_sah_cost_growth)
+{
+    std::vector<AABB> instance_bounds = {};
+    std::vector<u32> bvh_instance_indices = {};
+    calculate_instance_bounds(bottom_level_as_bounds, instance_bounds, bvh_instance_indices);
+
+    // Refitting keeps the BVH's primitives, which are the instances that were not empty last time.
+    if (bvh_instance_indices == m_bvh_instance_indices)
+    {
+        return m_bvh.update(instance_bounds, max_sah_cost_growth);
+    }
+
+    m_bvh_instance_indices = std::move(bvh_instance_indices);
+    m_bvh.build(instance_bounds, m_settings);
+    return true;
+}
+
+std::vector<TopLevelAS::Instance> const& TopLevelAS::get_instances() const
+{
+    return m_instances;
+}
+
+TopLevelAS::Instance const& TopLevelAS::get_instance(u32 const instance_index) const
+{
+    return m_instances[instance_index];
+}
+
+std::vector<AABB> TopLevelAS::get_bottom_level_as_bounds(std::span<BVH const> const bottom_level_as)
+{
+    std::vector<AABB> bottom_level_as_bounds = {};
+    bottom_level_as_bounds.reserve(bottom_level_as.size());
+
+    for (BVH const& bvh : bottom_level_as)
+    {
+        bottom_level_as_bounds.push_back(bvh.get_bounds());
+    }
+
+    return bottom_level_as_bounds;
+}
+
+// Instances with an empty bottom-level AS can never be hit and are left out.
+void TopLevelAS::calculate_instance_bounds(std::span<AABB const> const bottom_level_as_bounds, std::vector<AABB>& instance_bounds,
+                                           std::vector<u32>& bvh_instance_indices) const
+{
+    instance_bounds.clear();
+    bvh_instance_indices.clear();
+
+    for (u32 instance_index = 0; instance_index < m_instances.size(); instance_index++)
+    {
+        Instance const& instance = m_instances[instance_index];
+        AABB const world_bounds = transform_aabb(bottom_level_as_bounds[instance.bottom_level_as_index], instance.object_to_world);
+        if (!world_bounds.is_empty())
+        {
+            instance_bounds.push_back(world_bounds);
+            bvh_instance_indices.push_back(instance_index);
+        }
+    }
+}
+
+}
@@ -0,0 +1,188 @@
+#pragma once
+
+#include "AK/Types.h"
+#include "CPU/AABB.h"
+#include "CPU/BVH.h"
+#include "CPU/RayPacket.h"
+#include "CPU/RaytracingShaderHelper.h"
+#include "CPU/ShaderMath.h"
+
+#include <span>
+#include <vector>
+
+namespace CPU
+{
+
+// Hit group shader record index of a hit, addressed the same way DXR does:
+// RayContributionToHitGroupIndex + MultiplierForGeometryContributionToHitGroupIndex * GeometryIndex
+// + InstanceContributionToHitGroupIndex. TraceRayParameters::HitGroup holds the ray contributions and the multiplier.
+inline u32 calculate_hit_group_index(u32 const instance_contribution_to_hit_group_index, u32 const ray_contribution_to_hit_group_index,
+                                     u32 const multiplier_for_geometry_contribution_to_hit_group_index, u32 const geometry_index)
+{
+    return ray_contribution_to_hit_group_index + multiplier_for_geometry_contribution_to_hit_group_index * geometry_index
+         + instance_contribution_to_hit_group_index;
+}
+
+// CPU counterpart of a top-level acceleration structure: a BVH over instances, each placing a shared bottom-level BVH
+// in the world with its own transform. Instances only hold their transforms and indices, never a copy of the geometry,
+// so a single bottom-level BVH can be instanced any number of times.
+class TopLevelAS
+{
+public:
+    // Counterpart of D3D12_RAYTRACING_INSTANCE_DESC, with the inverse transform precomputed.
+    struct Instance
+    {
+        float4x4 object_to_world = {};
+        float4x4 world_to_object = {};
+        u32 instance_mask = 0;
+        u32 instance_contribution_to_hit_group_index = 0;
+        u32 bottom_level_as_index = 0; // Index into the bottom-level BVHs the top-level AS was built with.
+    };
+
+    // Bottom-level BVHs have to be built already. They are only read here, to bound the instances.
+    void build(std::vector<Instance> instances, std::span<BVH const> const bottom_level_as, BVHBuildSettings const& settings = {});
+
+    // Rebounds the instances after their bottom-level BVHs were refit or rebuilt, keeping the instances of the last build().
+    // Rebuilds instead once a bottom-level AS has become empty, or stopped being empty, which takes instances out of the BVH
+    // or puts them back in, and once refitting has grown the SAH cost by more than max_sah_cost_growth, as BVH::update() does,
+    // so instances drifting apart do not degrade it without limit. Returns true if it rebuilt.
+    bool update(std::span<BVH const> const bottom_level_as, float const max_sah_cost_growth);
+
+    // Same, from the bounds of every bottom-level AS, for ones that are not BVHs, like a UniformGrid.
+    bool update(std::span<AABB const> const bottom_level_as_bounds, float const max_sah_cost_growth);
+
+    // Closest hit query over every instance whose mask shares a bit with instance_inclusion_mask and whose world bounds
+    // the ray overlaps. intersect_instance(instance_index, instance, object_ray, state) traces the instance's bottom-level AS
+    // with the ray in its object space, and follows the BVH::intersect_closest() callback contract.
+    // The object space direction is not renormalized, so t values are the same in both spaces.
+    template<typename IntersectInstance>
+    bool intersect_closest(Ray const& ray, u32 const instance_inclusion_mask, RayState& state,
+                           IntersectInstance&& intersect_instance) const;
+
+    // Any hit query, returns as soon as an instance reports a hit.
+    template<typename IntersectInstance>
+    bool intersect_any(Ray const& ray, u32 const instance_inclusion_mask, RayState& state, IntersectInstance&& intersect_instance) const;
+
+    // Closest hit query for the rays in lane_mask, with rays[lane] described by the packet's lane, which holds their ranges.
+    // intersect_instance(instance_index, instance, object_rays, object_packet, lane_mask) traces the instance's bottom-level AS
+    // with the rays that overlap it in its object space, and follows the BVH packet callback contract on object_packet.
+    // Lanes outside of lane_mask are inactive in object_packet, and their object_rays are left unset.
+    template<u32 N, typename IntersectInstance>
+    u32 intersect_closest(Ray const (&rays)[N], RayPacket<N>& packet, u32 const lane_mask, u32 const instance_inclusion_mask,
+                          IntersectInstance&& intersect_instance) const;
+
+    // Any hit query for a packet, rays stop being traced once an instance reports a hit for them.
+    template<u32 N, typename IntersectInstance>
+    u32 intersect_any(Ray const (&rays)[N], RayPacket<N>& packet, u32 const lane_mask, u32 const instance_inclusion_mask,
+                      IntersectInstance&& intersect_instance) const;
+
+    [[nodiscard]] std::vector<Instance> const& get_instances() const;
+    [[nodiscard]] Instance const& get_instance(u32 const instance_index) const;
+
+private:
+    template<typename IntersectInstance>
+    auto make_instance_test(Ray const& ray, u32 const instance_inclusion_mask, IntersectInstance& intersect_instance) const;
+
+    template<u32 N, typename IntersectInstance>
+    auto make_instance_test(Ray const (&rays)[N], RayPacket<N>& packet, u32 const instance_inclusion_mask,
+                            IntersectInstance& intersect_instance) const;
+
+    [[nodiscard]] static std::vector<AABB> get_bottom_level_as_bounds(std::span<BVH const> const bottom_level_as);
+    void calculate_instance_bounds(std::span<AABB const> const bottom_level_as_bounds, std::vector<AABB>& instance_bounds,
+                                   std::vector<u32>& bvh_instance_indices) const;
+
+    std::vector<Instance> m_instances = {};
+    BVHBuildSettings m_settings = {};
+
+    // Instances with an empty bottom-level AS can never be hit and are left out of the BVH,
+    // so its primitive indices map through this array to instance indices.
+    std::vector<u32> m_bvh_instance_indices = {};
+    BVH m_bvh = {};
+};
+
+template<typename IntersectInstance>
+auto TopLevelAS::make_instance_test(Ray const& ray, u32 const instance_inclusion_mask, IntersectInstance& intersect_instance) const
+{
+    return [&, instance_inclusion_mask](u32 const bvh_primitive_index, RayState& state) {
+        u32 const instance_index = m_bvh_instance_indices[bvh_primitive_index];
+        Instance const& instance = m_instances[instance_index];
+        if ((instance.instance_mask & instance_inclusion_mask) == 0)
+        {
+            return false;
+        }
+
+        Ray const object_ray = {mul_position(ray.origin, instance.world_to_object), mul_direction(ray.direction, instance.world_to_object)};
+        return static_cast<bool>(intersect_instance(instance_index, instance, object_ray, state));
+    };
+}
+
+template<u32 N, typename IntersectInstance>
+auto TopLevelAS::make_instance_test(Ray const (&rays)[N], RayPacket<N>& packet, u32 const instance_inclusion_mask,
+                                    IntersectInstance& intersect_instance) const
+{
+    return [&, instance_inclusion_mask](u32 const bvh_primitive_index, u32 const lane_mask) {
+        u32 const instance_index = m_bvh_instance_indices[bvh_primitive_index];
+        Instance const& instance = m_instances[instance_index];
+        if ((instance.instance_mask & instance_inclusion_mask) == 0)
+        {
+            return 0u;
+        }
+
+        Ray object_rays[N];
+        RayPacket<N> object_packet;
+        for (u32 lane = 0; lane < N; lane++)
+        {
+            if ((lane_mask & (1u << lane)) == 0)
+            {
+                object_packet.set_inactive(lane);
+                continue;
+            }
+
+            object_rays[lane] = {mul_position(rays[lane].origin, instance.world_to_object),
+                                 mul_direction(rays[lane].direction, instance.world_to_object)};
+            object_packet.set_ray(lane, object_rays[lane], packet.t_min[lane], packet.t_max[lane]);
+        }
+
+        u32 const hits = static_cast<u32>(intersect_instance(instance_index, instance, object_rays, object_packet, lane_mask)) & lane_mask;
+
+        // t values are the same in both spaces.
+        for (u32 lane = 0; lane < N; lane++)
+        {
+            if ((hits & (1u << lane)) != 0)
+            {
+                packet.t_max[lane] = object_packet.t_max[lane];
+            }
+        }
+        return hits;
+    };
+}
+
+template<typename IntersectInstance>
+bool TopLevelAS::intersect_closest(Ray const& ray, u32 const instance_inclusion_mask, RayState& state,
+                                   IntersectInstance&& intersect_instance) const
+{
+    return m_bvh.intersect_closest(ray, state, make_instance_test(ray, instance_inclusion_mask, intersect_instance));
+}
+
+template<typename IntersectInstance>
+bool TopLevelAS::intersect_any(Ray const& ray, u32 const instance_inclusion_mask, RayState& state,
+                               IntersectInstance&& intersect_instance) const
+{
+    return m_bvh.intersect_any(ray, state, make_instance_test(ray, instance_inclusion_mask, intersect_instance));
+}
+
+template<u32 N, typename IntersectInstance>
+u32 TopLevelAS::intersect_closest(Ray const (&rays)[N], RayPacket<N>& packet, u32 const lane_mask,
+                                  u32 const instance_inclusion_mask, IntersectInstance&& intersect_instance) const
+{
+    return m_bvh.intersect_closest(packet, lane_mask, make_instance_test(rays, packet, instance_inclusion_mask, intersect_instance));
+}
+
+template<u32 N, typename IntersectInstance>
+u32 TopLevelAS::intersect_any(Ray const (&rays)[N], RayPacket<N>& packet, u32 const lane_mask,
+                              u32 const instance_inclusion_mask, IntersectInstance&& intersect_instance) const
+{
+    return m_bvh.intersect_any(packet, lane_mask, make_instance_test(rays, packet, instance_inclusion_mask, intersect_instance));
+}
+
+}
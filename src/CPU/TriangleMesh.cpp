@@ -0,0 +1,112 @@
+#include "CPU/TriangleMesh.h"
+
+namespace CPU
+{
+
+namespace
+{
+
+float3 to_float3(XMFLOAT3 const& v)
+{
+    return {v.x, v.y, v.z};
+}
+
+}
+
+void TriangleMesh::build(BakedMesh const& mesh)
+{
+    m_triangles.resize(mesh.indices.size() / 3);
+    for (u32 i = 0; i < m_triangles.size(); i++)
+    {
+        Vertex const& v0 = mesh.vertices[mesh.indices[3 * i]];
+        Vertex const& v1 = mesh.vertices[mesh.indices[3 * i + 1]];
+        Vertex const& v2 = mesh.vertices[mesh.indices[3 * i + 2]];
+
+        Triangle& triangle = m_triangles[i];
+        triangle.v0 = to_float3(v0.position);
+        triangle.e1 = to_float3(v1.position) - triangle.v0;
+        triangle.e2 = to_float3(v2.position) - triangle.v0;
+        triangle.normals[0] = to_float3(v0.normal);
+        triangle.normals[1] = to_float3(v1.normal);
+        triangle.normals[2] = to_float3(v2.normal);
+    }
+
+    m_bvh.build(calculate_primitive_bounds<u32>(mesh.vertices, mesh.indices));
+}
+
+// Moller-Trumbore ray/triangle test, see Raytracer::intersect_triangle().
+bool TriangleMesh::intersect(Ray const& ray, float& thit, ProceduralPrimitiveAttributes& attr, RayState const& state) const
+{
+    u32 hit_triangle_index = 0;
+    float2 hit_barycentrics = {};
+
+    auto const intersect_triangle = [&](u32 const triangle_index, RayState& state) {
+        Triangle const& triangle = m_triangles[triangle_index];
+        float3 const p = cross(ray.direction, triangle.e2);
+
+        // det = -dot(ray direction, geometric normal), positive for front facing (clockwise) triangles.
+        float const det = dot(triangle.e1, p);
+        if (det == 0.0f || is_culled(-det, state))
+        {
+            return false;
+        }
+
+        float const inv_det = 1.0f / det;
+        float3 const s = ray.origin - triangle.v0;
+        float const u = dot(s, p) * inv_det;
+        if (u < 0.0f || u > 1.0f)
+        {
+            return false;
+        }
+
+        float3 const q = cross(s, triangle.e1);
+        float const v = dot(ray.direction, q) * inv_det;
+        if (v < 0.0f || u + v > 1.0f)
+        {
+            return false;
+        }
+
+        float const t = dot(triangle.e2, q) * inv_det;
+        if (!is_in_range(t, state.t_min, state.t_current))
+        {
+            return false;
+        }
+
+        state.t_current = t;
+        hit_triangle_index = triangle_index;
+        hit_barycentrics = {u, v};
+        return true;
+    };
+
+    RayState trace_state = state;
+    bool const is_hit = (state.flags & RayFlag::AcceptFirstHitAndEndSearch)
+                          ? m_bvh.intersect_any(ray, trace_state, intersect_triangle)
+                          : m_bvh.intersect_closest(ray, trace_state, intersect_triangle);
+    if (!is_hit)
+    {
+        return false;
+    }
+
+    thit = trace_state.t_current;
+    if (!is_occlusion_ray(state))
+    {
+        Triangle const& triangle = m_triangles[hit_triangle_index];
+        float const u = hit_barycentrics.x;
+        float const v = hit_barycentrics.y;
+        float3 const normal = normalize((1.0f - u - v) * triangle.normals[0] + u * triangle.normals[1] + v * triangle.normals[2]);
+        attr.normal = {normal.x, normal.y, normal.z};
+    }
+    return true;
+}
+
+bool TriangleMesh::is_empty() const
+{
+    return m_triangles.empty();
+}
+
+u32 TriangleMesh::get_triangle_count() const
+{
+    return static_cast<u32>(m_triangles.size());
+}
+
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "AK/Types.h"
+#include "CPU/BVH.h"
+#include "CPU/MeshBaker.h"
+#include "CPU/RaytracingShaderHelper.h"
+#include "CPU/ShaderMath.h"
+
+#include <vector>
+
+namespace CPU
+{
+
+// Baked mesh with a BVH of its own, traced in place of the procedural primitive it was baked from. Hits report
+// the interpolated vertex normal as the primitive's intersection shader reports its normal, so they go through
+// the primitive's closest hit shader as they are.
+class TriangleMesh
+{
+public:
+    void build(BakedMesh const& mesh);
+
+    // Same contract as the intersection tests of procedural primitives, in the space the mesh was baked in.
+    // Triangles are culled by their winding, as the primitive is by its normal.
+    bool intersect(Ray const& ray, float& thit, ProceduralPrimitiveAttributes& attr, RayState const& state) const;
+
+    [[nodiscard]] bool is_empty() const;
+    [[nodiscard]] u32 get_triangle_count() const;
+
+private:
+    struct Triangle
+    {
+        float3 v0;
+        float3 e1; // v1 - v0
+        float3 e2; // v2 - v0
+        float3 normals[3];
+    };
+
+    std::vector<Triangle> m_triangles = {};
+    BVH m_bvh = {};
+};
+
+}
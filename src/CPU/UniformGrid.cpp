@@ -0,0 +1,173 @@
+#include "CPU/UniformGrid.h"
+
+namespace CPU
+{
+
+void UniformGrid::build(std::span<AABB const> const primitive_bounds, UniformGridBuildSettings const& settings)
+{
+    m_bounds = {};
+    m_primitive_count = 0;
+    m_levels.clear();
+    m_cells.clear();
+    m_primitive_indices.clear();
+
+    for (AABB const& bounds : primitive_bounds)
+    {
+        if (!bounds.is_empty())
+        {
+            m_bounds.grow(bounds);
+            m_primitive_count++;
+        }
+    }
+
+    if (m_primitive_count == 0)
+    {
+        return;
+    }
+
+    // Cells need a size along every axis, also those all primitives are flat in, like triangles of a floor.
+    float3 const extent = m_bounds.extent();
+    float const max_extent = std::max(std::max(extent.x, extent.y), extent.z);
+    float const min_extent = max_extent > 0.0f ? 1e-3f * max_extent : 1.0f;
+    for (u32 axis = 0; axis < 3; axis++)
+    {
+        float const growth = 0.5f * std::max(min_extent - extent[axis], 0.0f);
+        m_bounds.min[axis] -= growth;
+        m_bounds.max[axis] += growth;
+    }
+
+    float const cell_count = std::min(settings.density * static_cast<float>(m_primitive_count), static_cast<float>(MAX_CELL_COUNT));
+    Level const top_level = make_level(m_bounds, cell_count, MAX_RESOLUTION, 0);
+    u32 const top_cell_count = top_level.resolution[0] * top_level.resolution[1] * top_level.resolution[2];
+    m_levels.push_back(top_level);
+
+    // Count the primitives of every top level cell, turn the counts into offsets, then fill the cells in.
+    std::vector<u32> cell_offsets(top_cell_count + 1, 0);
+    for (AABB const& bounds : primitive_bounds)
+    {
+        if (!bounds.is_empty())
+        {
+            for_each_overlapped_cell(top_level, bounds, [&](u32 const cell_index) {
+                cell_offsets[cell_index + 1]++;
+            });
+        }
+    }
+
+    for (u32 i = 1; i < cell_offsets.size(); i++)
+    {
+        cell_offsets[i] += cell_offsets[i - 1];
+    }
+
+    std::vector<u32> cell_ends(cell_offsets.begin(), cell_offsets.end() - 1);
+    std::vector<u32> cell_primitives(cell_offsets.back());
+    for (u32 primitive_index = 0; primitive_index < primitive_bounds.size(); primitive_index++)
+    {
+        if (!primitive_bounds[primitive_index].is_empty())
+        {
+            for_each_overlapped_cell(top_level, primitive_bounds[primitive_index], [&](u32 const cell_index) {
+                cell_primitives[cell_ends[cell_index]++] = primitive_index;
+            });
+        }
+    }
+
+    // Crowded cells hand their primitives on to a sub-grid, whose cells go after all of the top level's.
+    m_cells.resize(top_cell_count);
+    m_primitive_indices.reserve(cell_primitives.size());
+    std::vector<u32> sub_cell_offsets = {};
+    for (u32 cell_index = 0; cell_index < top_cell_count; cell_index++)
+    {
+        std::span<u32 const> const primitives =
+            std::span(cell_primitives).subspan(cell_offsets[cell_index], cell_offsets[cell_index + 1] - cell_offsets[cell_index]);
+        if (primitives.size() <= settings.max_cell_primitive_count)
+        {
+            m_cells[cell_index] = {static_cast<u32>(m_primitive_indices.size()), static_cast<u32>(primitives.size())};
+            m_primitive_indices.insert(m_primitive_indices.end(), primitives.begin(), primitives.end());
+            continue;
+        }
+
+        u32 const x = cell_index % top_level.resolution[0];
+        u32 const y = cell_index / top_level.resolution[0] % top_level.resolution[1];
+        u32 const z = cell_index / (top_level.resolution[0] * top_level.resolution[1]);
+        float3 const cell = {static_cast<float>(x), static_cast<float>(y), static_cast<float>(z)};
+        AABB cell_bounds = {};
+        cell_bounds.min = top_level.origin + cell * top_level.cell_size;
+        cell_bounds.max = cell_bounds.min + top_level.cell_size;
+
+        u32 const first_sub_cell = static_cast<u32>(m_cells.size());
+        Level const sub_grid = make_level(cell_bounds, settings.sub_grid_density * static_cast<float>(primitives.size()),
+                                          MAX_SUB_GRID_RESOLUTION, first_sub_cell);
+        u32 const sub_cell_count = sub_grid.resolution[0] * sub_grid.resolution[1] * sub_grid.resolution[2];
+        m_cells[cell_index].sub_grid = static_cast<u32>(m_levels.size());
+        m_levels.push_back(sub_grid);
+        m_cells.resize(first_sub_cell + sub_cell_count);
+
+        sub_cell_offsets.assign(sub_cell_count + 1, 0);
+        for (u32 const primitive_index : primitives)
+        {
+            for_each_overlapped_cell(sub_grid, primitive_bounds[primitive_index], [&](u32 const sub_cell_index) {
+                sub_cell_offsets[sub_cell_index + 1]++;
+            });
+        }
+
+        u32 const first_primitive = static_cast<u32>(m_primitive_indices.size());
+        for (u32 i = 0; i < sub_cell_count; i++)
+        {
+            m_cells[first_sub_cell + i] = {first_primitive + sub_cell_offsets[i], 0};
+            sub_cell_offsets[i + 1] += sub_cell_offsets[i];
+        }
+
+        m_primitive_indices.resize(first_primitive + sub_cell_offsets.back());
+        for (u32 const primitive_index : primitives)
+        {
+            for_each_overlapped_cell(sub_grid, primitive_bounds[primitive_index], [&](u32 const sub_cell_index) {
+                Cell& sub_cell = m_cells[first_sub_cell + sub_cell_index];
+                m_primitive_indices[sub_cell.first_primitive + sub_cell.primitive_count++] = primitive_index;
+            });
+        }
+    }
+}
+
+bool UniformGrid::is_empty() const
+{
+    return m_primitive_count == 0;
+}
+
+AABB UniformGrid::get_bounds() const
+{
+    return m_bounds;
+}
+
+u32 UniformGrid::get_primitive_count() const
+{
+    return m_primitive_count;
+}
+
+u32 UniformGrid::get_cell_count() const
+{
+    return static_cast<u32>(m_cells.size());
+}
+
+u32 UniformGrid::get_sub_grid_count() const
+{
+    return m_levels.empty() ? 0 : static_cast<u32>(m_levels.size()) - 1;
+}
+
+// Cells as close to cubes as the resolution allows, about cell_count of them.
+UniformGrid::Level UniformGrid::make_level(AABB const& bounds, float const cell_count, u32 const max_resolution, u32 const first_cell)
+{
+    float3 const extent = bounds.extent();
+    float const cells_per_length = std::cbrt(cell_count / (extent.x * extent.y * extent.z));
+
+    Level level = {};
+    level.origin = bounds.min;
+    level.first_cell = first_cell;
+    for (u32 axis = 0; axis < 3; axis++)
+    {
+        float const resolution = std::round(extent[axis] * cells_per_length);
+        level.resolution[axis] = static_cast<u32>(std::clamp(resolution, 1.0f, static_cast<float>(max_resolution)));
+        level.cell_size[axis] = extent[axis] / static_cast<float>(level.resolution[axis]);
+    }
+    return level;
+}
+
+}
@@ -0,0 +1,257 @@
+#pragma once
+
+#include "AK/Types.h"
+#include "CPU/AABB.h"
+#include "CPU/RayPacket.h"
+#include "CPU/RaytracingShaderHelper.h"
+#include "CPU/ShaderMath.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <span>
+#include <vector>
+
+namespace CPU
+{
+
+struct UniformGridBuildSettings
+{
+    // Top level cells per primitive.
+    float density = 1.0f;
+
+    // Top level cells overlapped by more primitives than this get a grid of their own, with sub_grid_density cells
+    // per primitive in it, so a cluster in an otherwise sparse scene does not end up in a few crowded cells.
+    u32 max_cell_primitive_count = 8;
+    float sub_grid_density = 2.0f;
+};
+
+// Two-level uniform grid over primitive bounds, an alternative to the BVH for many similarly sized primitives laid out
+// in a regular pattern, like fields of procedural geometry. Building takes time linear in the primitives and the cells
+// they overlap, with no sorting or partitioning, so it is cheap enough to redo every frame instead of refitting.
+// Rays walk the top level cells front to back with a 3D-DDA, and the cells of a sub-grid with another one, so they only
+// visit cells along their way instead of descending a tree from the root. Primitives are referenced by every cell they
+// overlap, and the last few a ray tested are remembered so it rarely tests one twice.
+// Ref: Amanatides and Woo, "A Fast Voxel Traversal Algorithm for Ray Tracing", Eurographics 1987
+// Ref: Kalojanov et al., "Two-Level Grids for Ray Tracing on GPUs", Eurographics 2011
+class UniformGrid
+{
+public:
+    static u32 constexpr MAX_RESOLUTION = 4096; // Top level cells per axis.
+    static u32 constexpr MAX_CELL_COUNT = 1u << 24; // Top level cells in total.
+    static u32 constexpr MAX_SUB_GRID_RESOLUTION = 16; // Sub-grid cells per axis.
+
+    // Primitives are identified by their index in primitive_bounds, the same as for BVH::build(). Empty bounds are left out.
+    void build(std::span<AABB const> const primitive_bounds, UniformGridBuildSettings const& settings = {});
+
+    // Same queries and callback contract as BVH::intersect_closest() and BVH::intersect_any().
+    template<typename IntersectPrimitive>
+    bool intersect_closest(Ray const& ray, RayState& state, IntersectPrimitive&& intersect_primitive) const;
+
+    template<typename IntersectPrimitive>
+    bool intersect_any(Ray const& ray, RayState& state, IntersectPrimitive&& intersect_primitive) const;
+
+    [[nodiscard]] bool is_empty() const;
+
+    // Bounds of all primitives, grown along axes they are flat in, empty if there are none.
+    [[nodiscard]] AABB get_bounds() const;
+    [[nodiscard]] u32 get_primitive_count() const;
+    [[nodiscard]] u32 get_cell_count() const;
+    [[nodiscard]] u32 get_sub_grid_count() const;
+
+private:
+    static u32 constexpr NO_SUB_GRID = ~0u;
+    static u32 constexpr MAILBOX_SIZE = 8;
+
+    // Placement of a grid's cells, the top level's or a sub-grid's.
+    struct Level
+    {
+        float3 origin;
+        float3 cell_size;
+        std::array<u32, 3> resolution = {};
+        u32 first_cell = 0; // Of the level's cells in m_cells, x-major.
+    };
+
+    struct Cell
+    {
+        u32 first_primitive = 0; // Into m_primitive_indices.
+        u32 primitive_count = 0;
+        u32 sub_grid = NO_SUB_GRID; // Level of the cell's sub-grid, which then holds its primitives.
+    };
+
+    [[nodiscard]] static Level make_level(AABB const& bounds, float const cell_count, u32 const max_resolution, u32 const first_cell);
+
+    // Calls visit(cell_index) for every cell of the level the bounds overlap.
+    template<typename VisitCell>
+    static void for_each_overlapped_cell(Level const& level, AABB const& bounds, VisitCell&& visit);
+
+    template<bool any_hit, typename IntersectPrimitive>
+    bool traverse(Ray const& ray, RayState& state, IntersectPrimitive& intersect_primitive) const;
+
+    // Walks the cells of the level the ray passes through from t_begin on, front to back, calling visit(cell_index, t_enter, t_exit)
+    // for each until it returns true, which walk() then does too. Stops at t_end, or state.t_current if that comes first.
+    template<typename VisitCell>
+    static bool walk(Level const& level, Ray const& ray, SlabRay const& slab_ray, float const t_begin, float const t_end,
+                     RayState const& state, VisitCell&& visit);
+
+    AABB m_bounds = {};
+    u32 m_primitive_count = 0;
+
+    std::vector<Level> m_levels = {}; // The top level, then the sub-grids.
+    std::vector<Cell> m_cells = {}; // The top level's cells, then those of the sub-grids.
+    std::vector<u32> m_primitive_indices = {};
+};
+
+template<typename IntersectPrimitive>
+bool UniformGrid::intersect_closest(Ray const& ray, RayState& state, IntersectPrimitive&& intersect_primitive) const
+{
+    return traverse<false>(ray, state, intersect_primitive);
+}
+
+template<typename IntersectPrimitive>
+bool UniformGrid::intersect_any(Ray const& ray, RayState& state, IntersectPrimitive&& intersect_primitive) const
+{
+    return traverse<true>(ray, state, intersect_primitive);
+}
+
+template<typename VisitCell>
+void UniformGrid::for_each_overlapped_cell(Level const& level, AABB const& bounds, VisitCell&& visit)
+{
+    // Widened by a sliver of a cell, so bounds that end on a cell boundary are in the cells on both sides of it
+    // however the division rounds, as rays along the boundary can end up walking either.
+    float constexpr margin = 1e-4f;
+    u32 first[3];
+    u32 last[3];
+    for (u32 axis = 0; axis < 3; axis++)
+    {
+        float const max_cell = static_cast<float>(level.resolution[axis] - 1);
+        float const lower = (bounds.min[axis] - level.origin[axis]) / level.cell_size[axis] - margin;
+        float const upper = (bounds.max[axis] - level.origin[axis]) / level.cell_size[axis] + margin;
+        first[axis] = static_cast<u32>(std::clamp(std::floor(lower), 0.0f, max_cell));
+        last[axis] = static_cast<u32>(std::clamp(std::floor(upper), 0.0f, max_cell));
+    }
+
+    for (u32 z = first[2]; z <= last[2]; z++)
+    {
+        for (u32 y = first[1]; y <= last[1]; y++)
+        {
+            for (u32 x = first[0]; x <= last[0]; x++)
+            {
+                visit((z * level.resolution[1] + y) * level.resolution[0] + x);
+            }
+        }
+    }
+}
+
+template<typename VisitCell>
+bool UniformGrid::walk(Level const& level, Ray const& ray, SlabRay const& slab_ray, float const t_begin, float const t_end,
+                       RayState const& state, VisitCell&& visit)
+{
+    // Cell the ray starts in, clamped in case the starting point rounds to just outside of the level.
+    float3 const start = ray.origin + t_begin * ray.direction;
+    i32 cell[3];
+    i32 step[3];
+    float t_next[3]; // Distance to the next cell boundary along each axis.
+    float t_delta[3]; // Distance between cell boundaries along each axis.
+    for (u32 axis = 0; axis < 3; axis++)
+    {
+        float const position = (start[axis] - level.origin[axis]) / level.cell_size[axis];
+        cell[axis] = std::clamp(static_cast<i32>(std::floor(position)), 0, static_cast<i32>(level.resolution[axis]) - 1);
+        step[axis] = ray.direction[axis] > 0.0f ? 1 : -1;
+
+        float const boundary = level.origin[axis] + static_cast<float>(cell[axis] + (step[axis] > 0 ? 1 : 0)) * level.cell_size[axis];
+        t_next[axis] = (boundary - ray.origin[axis]) * slab_ray.inv_direction[axis];
+        t_delta[axis] = level.cell_size[axis] * std::abs(slab_ray.inv_direction[axis]);
+    }
+
+    float t0 = t_begin;
+    for (;;)
+    {
+        u32 const axis = t_next[0] < t_next[1] ? (t_next[0] < t_next[2] ? 0 : 2) : (t_next[1] < t_next[2] ? 1 : 2);
+        float const t1 = std::min(t_next[axis], t_end);
+
+        u32 const cell_index = (static_cast<u32>(cell[2]) * level.resolution[1] + static_cast<u32>(cell[1])) * level.resolution[0]
+                             + static_cast<u32>(cell[0]);
+        if (visit(level.first_cell + cell_index, t0, t1))
+        {
+            return true;
+        }
+
+        if (t_next[axis] >= std::min(t_end, state.t_current))
+        {
+            return false;
+        }
+
+        cell[axis] += step[axis];
+        if (cell[axis] < 0 || cell[axis] >= static_cast<i32>(level.resolution[axis]))
+        {
+            return false;
+        }
+
+        t0 = t_next[axis];
+        t_next[axis] += t_delta[axis];
+    }
+}
+
+template<bool any_hit, typename IntersectPrimitive>
+bool UniformGrid::traverse(Ray const& ray, RayState& state, IntersectPrimitive& intersect_primitive) const
+{
+    if (is_empty())
+    {
+        return false;
+    }
+
+    SlabRay const slab_ray = make_slab_ray(ray, state.t_min, state.t_current);
+    float t_entry = 0.0f;
+    if (!ray_aabb_intersection_test(slab_ray, m_bounds.min, m_bounds.max, t_entry))
+    {
+        return false;
+    }
+
+    u32 mailbox[MAILBOX_SIZE];
+    std::fill(mailbox, mailbox + MAILBOX_SIZE, ~0u);
+    u32 mailbox_next = 0;
+    bool hit_found = false;
+
+    // A hit in a cell can lie beyond it, in a primitive sticking out of it, where a nearer one from a later cell can still
+    // beat it. The walk keeps going until the cells start beyond state.t_current.
+    auto const visit_leaf = [&](u32 const cell_index, float, float) {
+        Cell const& cell = m_cells[cell_index];
+        for (u32 i = cell.first_primitive; i < cell.first_primitive + cell.primitive_count; i++)
+        {
+            u32 const primitive_index = m_primitive_indices[i];
+            if (std::find(mailbox, mailbox + MAILBOX_SIZE, primitive_index) != mailbox + MAILBOX_SIZE)
+            {
+                continue;
+            }
+            mailbox[mailbox_next] = primitive_index;
+            mailbox_next = (mailbox_next + 1) % MAILBOX_SIZE;
+
+            if (intersect_primitive(primitive_index, state))
+            {
+                hit_found = true;
+                if constexpr (any_hit)
+                {
+                    return true;
+                }
+            }
+        }
+        return false;
+    };
+
+    auto const visit = [&](u32 const cell_index, float const t_enter, float const t_exit) {
+        u32 const sub_grid = m_cells[cell_index].sub_grid;
+        if (sub_grid == NO_SUB_GRID)
+        {
+            return visit_leaf(cell_index, t_enter, t_exit);
+        }
+
+        // The sub-grid covers just its cell, so the ray's part in the cell is its part in the sub-grid.
+        return walk(m_levels[sub_grid], ray, slab_ray, t_enter, t_exit, state, visit_leaf);
+    };
+
+    walk(m_levels[0], ray, slab_ray, t_entry, INFINITY_F, state, visit);
+    return hit_found;
+}
+
+}
@@ -0,0 +1,316 @@
+#pragma once
+
+#include "ConstantBuffers.h"
+#include "CPU/AnalyticPrimitives.h"
+#include "CPU/RaytracingShaderHelper.h"
+
+#include <span>
+
+// CPU counterpart of VolumetricPrimitives.hlsli.
+// Ray marching of Metaballs (aka "Blobs").
+// More info here: https://www.scratchapixel.com/lessons/advanced-rendering/rendering-distance-fields/blobbies
+namespace CPU
+{
+
+struct Metaball
+{
+    float3 center;
+    float radius = 0.0f;
+};
+
+// Calculate a magnitude of an influence from a Metaball charge at a distance from its center.
+// Return metaball potential range: <0,1>
+// radius - largest possible area of metaball contribution - AKA its bounding sphere.
+inline float calculate_metaball_potential(float const distance, float const radius)
+{
+    if (distance <= radius)
+    {
+        // Quintic polynomial field function.
+        // The advantage of this polynomial is having smooth second derivative. Not having a smooth
+        // second derivative may result in a sharp and visually unpleasant normal vector jump.
+        // The field function should return 1 at distance 0 from a center, and 1 at radius distance,
+        // but this one gives f(0) = 0, f(radius) = 1, so we use the distance to radius instead.
+        float const d = radius - distance;
+
+        float const r = radius;
+        return 6 * (d * d * d * d * d) / (r * r * r * r * r) - 15 * (d * d * d * d) / (r * r * r * r) + 10 * (d * d * d) / (r * r * r);
+    }
+    return 0;
+}
+
+inline float calculate_metaball_potential(float3 const position, Metaball const& blob, float& distance)
+{
+    distance = length(position - blob.center);
+    return calculate_metaball_potential(distance, blob.radius);
+}
+
+// Calculate field potential from all active metaballs.
+inline float calculate_metaballs_potential(float3 const position, std::span<Metaball const> const blobs)
+{
+    float sum_field_potential = 0;
+    for (Metaball const& blob : blobs)
+    {
+        float dummy;
+        sum_field_potential += calculate_metaball_potential(position, blob, dummy);
+    }
+    return sum_field_potential;
+}
+
+// Gradient of a metaball's potential. With u = (radius - distance) / radius, the quintic falls off at 30 * u^2 * (1 - u)^2 / radius
+// per unit of distance from the center.
+inline float3 calculate_metaball_potential_gradient(float3 const position, Metaball const& blob)
+{
+    float3 const offset = position - blob.center;
+    float const distance = length(offset);
+
+    if (distance <= blob.radius && distance > 0)
+    {
+        float const u = (blob.radius - distance) / blob.radius;
+        float const w = u * (1 - u);
+        return offset * (-30 * w * w / (blob.radius * distance));
+    }
+    return {};
+}
+
+// Calculate field potential gradient from all active metaballs.
+inline float3 calculate_metaballs_gradient(float3 const position, std::span<Metaball const> const blobs)
+{
+    float3 gradient = {};
+    for (Metaball const& blob : blobs)
+    {
+        gradient += calculate_metaball_potential_gradient(position, blob);
+    }
+    return gradient;
+}
+
+// Calculate a normal from the analytic gradient. The potential grows inwards, so the normal points down the gradient.
+inline float3 calculate_metaballs_normal(float3 const position, std::span<Metaball const> const blobs)
+{
+    return normalize(-calculate_metaballs_gradient(position, blobs));
+}
+
+// Derivative of the potential along a direction. The normal points down the potential, so this has the sign
+// of -dot(direction, normal), without normalizing the gradient.
+inline float calculate_metaballs_directional_derivative(float3 const position, float3 const direction, std::span<Metaball const> const blobs)
+{
+    return dot(calculate_metaballs_gradient(position, blobs), direction);
+}
+
+// Field potential threshold defining the isosurface.
+// Threshold - valid range is (0, 1>, the larger the threshold the smaller the blob.
+float constexpr METABALLS_THRESHOLD = 0.25f;
+
+// Seconds the animated metaballs take to move from one key frame to the other and back.
+float constexpr METABALLS_CYCLE_DURATION = 12.0f;
+
+inline void initialize_animated_metaballs(Metaball (&blobs)[METABALLS_COUNT], float const elapsed_time, float const cycle_duration)
+{
+    // Metaball centers at t0 and t1 key frames.
+#if METABALLS_COUNT == 5
+    float3 constexpr key_frame_centers[METABALLS_COUNT][2] = {
+        {{-0.7f, 0, 0}, {0.7f, 0, 0}},
+        {{0.7f, 0, 0}, {-0.7f, 0, 0}},
+        {{0, -0.7f, 0}, {0, 0.7f, 0}},
+        {{0, 0.7f, 0}, {0, -0.7f, 0}},
+        {{0, 0, 0}, {0, 0, 0}},
+    };
+    // Metaball field radii of max influence
+    float constexpr radii[METABALLS_COUNT] = {0.35f, 0.35f, 0.35f, 0.35f, 0.25f};
+#else
+    float3 constexpr key_frame_centers[METABALLS_COUNT][2] = {
+        {{-0.3f, -0.3f, -0.4f}, {0.3f, -0.3f, -0.0f}},
+        {{0.0f, -0.2f, 0.5f}, {0.0f, 0.4f, 0.5f}},
+        {{0.4f, 0.4f, 0.4f}, {-0.4f, 0.2f, -0.4f}},
+    };
+    // Metaball field radii of max influence
+    float constexpr radii[METABALLS_COUNT] = {0.45f, 0.55f, 0.45f};
+#endif
+
+    // Calculate animated metaball center positions.
+    float const t_animate = calculate_animation_interpolant(elapsed_time, cycle_duration);
+    for (u32 j = 0; j < METABALLS_COUNT; j++)
+    {
+        blobs[j].center = lerp(key_frame_centers[j][0], key_frame_centers[j][1], t_animate);
+        blobs[j].radius = radii[j];
+    }
+}
+
+// Find all metaballs that ray intersects.
+// The passed in array is sorted to the first active_metaballs_count.
+inline void find_intersecting_metaballs(Ray const& ray, float& tmin, float& tmax, Metaball (&blobs)[METABALLS_COUNT],
+                                        u32& active_metaballs_count, RayState const& state)
+{
+    // Find the entry and exit points for all metaball bounding spheres combined.
+    tmin = INFINITY_F;
+    tmax = -INFINITY_F;
+
+    active_metaballs_count = 0;
+    for (u32 i = 0; i < METABALLS_COUNT; i++)
+    {
+        float _thit, _tmax;
+        if (ray_solid_sphere_intersection_test(ray, _thit, _tmax, state, blobs[i].center, blobs[i].radius))
+        {
+            tmin = std::min(_thit, tmin);
+            tmax = std::max(_tmax, tmax);
+#if LIMIT_TO_ACTIVE_METABALLS
+            blobs[active_metaballs_count++] = blobs[i];
+#else
+            active_metaballs_count = METABALLS_COUNT;
+#endif
+        }
+    }
+    tmin = std::max(tmin, state.t_min);
+    tmax = std::min(tmax, state.t_current);
+}
+
+// Bounds of the field potential over the ray segment <t0, t1>. A metaball's potential only falls off with the distance
+// from its center, so over the segment it peaks at the point closest to the center, and bottoms out at one of the ends.
+inline void calculate_metaballs_potential_bounds(Ray const& ray, float const t0, float const t1, std::span<Metaball const> const blobs,
+                                                 float& min_potential, float& max_potential)
+{
+    min_potential = 0;
+    max_potential = 0;
+    float const direction_length_squared = dot(ray.direction, ray.direction);
+    for (Metaball const& blob : blobs)
+    {
+        float const t_closest = std::clamp(dot(blob.center - ray.origin, ray.direction) / direction_length_squared, t0, t1);
+        float const min_distance = length(ray.origin + t_closest * ray.direction - blob.center);
+        float const max_distance = std::max(length(ray.origin + t0 * ray.direction - blob.center),
+                                            length(ray.origin + t1 * ray.direction - blob.center));
+        min_potential += calculate_metaball_potential(max_distance, blob.radius);
+        max_potential += calculate_metaball_potential(min_distance, blob.radius);
+    }
+}
+
+// Find where the ray crosses the isosurface within <t0, t1>, given the crossing is there, with Newton's method.
+// Steps that would leave the segment known to hold the crossing bisect it instead.
+inline float find_metaballs_isosurface_crossing(Ray const& ray, float t0, float t1, bool const is_inside_at_t0, float const threshold,
+                                                std::span<Metaball const> const blobs)
+{
+    u32 constexpr max_steps = 8;
+    float t = 0.5f * (t0 + t1);
+    for (u32 step = 0; step < max_steps; step++)
+    {
+        float3 const position = ray.origin + t * ray.direction;
+        float const potential = calculate_metaballs_potential(position, blobs) - threshold;
+        if ((potential >= 0) == is_inside_at_t0)
+        {
+            t0 = t;
+        }
+        else
+        {
+            t1 = t;
+        }
+
+        float const derivative = dot(calculate_metaballs_gradient(position, blobs), ray.direction);
+        float const t_newton = t - potential / derivative;
+        t = (t_newton > t0 && t_newton < t1) ? t_newton : 0.5f * (t0 + t1);
+    }
+    return t;
+}
+
+// Test if a ray segment <tmin, tmax> within <RayTMin(), RayTCurrent()> intersects the field of the metaballs, given RayFlags.
+// The test searches the segment for crossings of a threshold isosurface, front to back.
+// Segments where bounds of the potential rule out a crossing are skipped whole, the rest are halved down to max_depth,
+// and a segment whose ends lie on different sides of the isosurface has its crossing refined.
+// Ref: Mitchell, "Robust Ray Intersection with Interval Arithmetic", Graphics Interface 1990
+inline bool ray_metaballs_segment_intersection_test(Ray const& ray, float const tmin, float const tmax, std::span<Metaball const> const blobs,
+                                                    float& thit, ProceduralPrimitiveAttributes& attr, RayState const& state)
+{
+    if (tmin > tmax)
+    {
+        return false;
+    }
+
+    float constexpr threshold = METABALLS_THRESHOLD;
+
+    bool is_inside = calculate_metaballs_potential(ray.origin + tmin * ray.direction, blobs) >= threshold;
+
+    // Segments are visited in order as the nodes of a binary tree over <tmin, tmax>, without a stack:
+    // the index-th of the 2^depth equal segments at a depth.
+    u32 constexpr max_depth = 8;
+    u32 depth = 0;
+    u32 index = 0;
+    for (;;)
+    {
+        float const segment_length = (tmax - tmin) / static_cast<float>(1u << depth);
+        float const t0 = tmin + static_cast<float>(index) * segment_length;
+        float const t1 = t0 + segment_length;
+
+        float min_potential, max_potential;
+        calculate_metaballs_potential_bounds(ray, t0, t1, blobs, min_potential, max_potential);
+        bool const may_cross = is_inside ? min_potential < threshold : max_potential >= threshold;
+        if (may_cross && depth < max_depth)
+        {
+            depth++;
+            index *= 2;
+            continue;
+        }
+
+        if (may_cross)
+        {
+            float const potential_at_t1 = calculate_metaballs_potential(ray.origin + t1 * ray.direction, blobs);
+            bool const is_inside_at_t1 = potential_at_t1 >= threshold;
+            if (is_inside_at_t1 != is_inside)
+            {
+                float const t = find_metaballs_isosurface_crossing(ray, t0, t1, is_inside, threshold, blobs);
+                float3 const position = ray.origin + t * ray.direction;
+                if (is_occlusion_ray(state))
+                {
+                    if (is_in_range(t, state.t_min, state.t_current)
+                        && !is_culled(-calculate_metaballs_directional_derivative(position, ray.direction, blobs), state))
+                    {
+                        thit = t;
+                        return true;
+                    }
+                }
+                else
+                {
+                    float3 const normal = calculate_metaballs_normal(position, blobs);
+                    if (is_a_valid_hit(ray, t, normal, state))
+                    {
+                        thit = t;
+                        attr.normal = {normal.x, normal.y, normal.z};
+                        return true;
+                    }
+                }
+                is_inside = is_inside_at_t1;
+            }
+        }
+
+        // Move on to the next segment, up the tree past the last segments of their parents.
+        index++;
+        while ((index & 1) == 0 && depth > 0)
+        {
+            index >>= 1;
+            depth--;
+        }
+        if (depth == 0)
+        {
+            break;
+        }
+    }
+
+    return false;
+}
+
+// Test if a ray with RayFlags and segment <RayTMin(), RayTCurrent()> intersects metaball field.
+inline bool ray_metaballs_intersection_test(Ray const& ray, float& thit, ProceduralPrimitiveAttributes& attr, float const elapsed_time,
+                                            RayState const& state)
+{
+    Metaball blobs[METABALLS_COUNT];
+    initialize_animated_metaballs(blobs, elapsed_time, METABALLS_CYCLE_DURATION);
+
+    float tmin, tmax; // Ray extents to first and last metaball intersections.
+    u32 active_metaballs_count = 0; // Number of metaballs's that the ray intersects.
+    find_intersecting_metaballs(ray, tmin, tmax, blobs, active_metaballs_count, state);
+
+#if USE_DYNAMIC_LOOPS
+    std::span<Metaball const> const active_blobs(blobs, active_metaballs_count);
+#else
+    std::span<Metaball const> const active_blobs(blobs);
+#endif
+    return ray_metaballs_segment_intersection_test(ray, tmin, tmax, active_blobs, thit, attr, state);
+}
+
+}
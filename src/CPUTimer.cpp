@@ -0,0 +1,99 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "CPUTimer.h"
+
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+using namespace DX;
+
+namespace
+{
+inline float lerp(float a, float b, float f)
+{
+    return (1.f - f) * a + f * b;
+}
+
+inline float UpdateRunningAverage(float avg, float value)
+{
+    return lerp(value, avg, 0.95f);
+}
+
+template<typename TimePoint>
+inline void DebugWarnings(uint32_t timerid, TimePoint start, TimePoint end)
+{
+#if defined(_DEBUG)
+    TimePoint const unset = {};
+    if (start == unset && end != unset)
+    {
+        std::fprintf(stderr, "ERROR: Timer %u stopped but not started\n", timerid);
+    }
+    else if (start != unset && end == unset)
+    {
+        std::fprintf(stderr, "ERROR: Timer %u started but not stopped\n", timerid);
+    }
+#else
+    (void)timerid;
+    (void)start;
+    (void)end;
+#endif
+}
+};
+
+//======================================================================================
+// CPUTimer
+//======================================================================================
+
+CPUTimer::CPUTimer() : m_start {}, m_end {}, m_avg {}
+{
+}
+
+void CPUTimer::Start(uint32_t timerid)
+{
+    if (timerid >= c_maxTimers)
+        throw std::out_of_range("Timer ID out of range");
+
+    m_start[timerid] = clock::now();
+}
+
+void CPUTimer::Stop(uint32_t timerid)
+{
+    if (timerid >= c_maxTimers)
+        throw std::out_of_range("Timer ID out of range");
+
+    m_end[timerid] = clock::now();
+}
+
+void CPUTimer::Update()
+{
+    for (uint32_t j = 0; j < c_maxTimers; ++j)
+    {
+        DebugWarnings(j, m_start[j], m_end[j]);
+
+        float value = float(std::chrono::duration<double, std::milli>(m_end[j] - m_start[j]).count());
+        m_avg[j] = UpdateRunningAverage(m_avg[j], value);
+    }
+}
+
+void CPUTimer::Reset()
+{
+    memset(m_avg, 0, sizeof(m_avg));
+}
+
+double CPUTimer::GetElapsedMS(uint32_t timerid) const
+{
+    if (timerid >= c_maxTimers)
+        return 0.0;
+
+    return std::chrono::duration<double, std::milli>(m_end[timerid] - m_start[timerid]).count();
+}
@@ -0,0 +1,65 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+//
+// Helpers for doing CPU performance timing and statitics
+//
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace DX
+{
+    //----------------------------------------------------------------------------------
+    // CPU performance timer, portable counterpart of the QPC based one
+    class CPUTimer
+    {
+    public:
+        static const size_t c_maxTimers = 8;
+
+        CPUTimer();
+
+        CPUTimer(const CPUTimer&) = delete;
+        CPUTimer& operator=(const CPUTimer&) = delete;
+
+        CPUTimer(CPUTimer&&) = default;
+        CPUTimer& operator=(CPUTimer&&) = default;
+
+        // Start/stop a particular performance timer (don't start same index more than once in a single frame)
+        void Start(uint32_t timerid = 0);
+        void Stop(uint32_t timerid = 0);
+
+        // Should Update once per frame to compute timer results
+        void Update();
+
+        // Reset running average
+        void Reset();
+
+        // Returns delta time in milliseconds
+        double GetElapsedMS(uint32_t timerid = 0) const;
+
+        // Returns running average in milliseconds
+        float GetAverageMS(uint32_t timerid = 0) const
+        {
+            return (timerid < c_maxTimers) ? m_avg[timerid] : 0.f;
+        }
+
+    private:
+        using clock = std::chrono::steady_clock;
+
+        clock::time_point   m_start[c_maxTimers];
+        clock::time_point   m_end[c_maxTimers];
+        float               m_avg[c_maxTimers];
+    };
+}
@@ -6,6 +6,9 @@
 #else
 #include <DirectXMath.h>
 using namespace DirectX;
+
+// Matches the windows.h typedef, so the layouts below compile without any Windows headers.
+typedef unsigned int UINT;
 #endif
 
 // Number of metaballs to use within an AABB.
@@ -24,7 +27,20 @@ using namespace DirectX;
 #define LIMIT_TO_ACTIVE_METABALLS 0
 #endif
 
+// Fractal level of detail: the fractal pyramid folds its space just often enough for its smallest copies to stay
+// FRACTAL_DETAIL_SIZE_IN_PIXELS pixels wide where the camera sees them,
+// within <FRACTAL_MIN_ITERATIONS_COUNT, FRACTAL_MAX_ITERATIONS_COUNT>.
+// Fractional counts blend between the distances of whole ones, so detail fades in and out instead of popping.
+// FRACTAL_ITERATIONS_COUNT is the count wherever no camera is given.
 #define FRACTAL_ITERATIONS_COUNT 4
+#define FRACTAL_MIN_ITERATIONS_COUNT 2
+#define FRACTAL_MAX_ITERATIONS_COUNT 8
+#define FRACTAL_DETAIL_SIZE_IN_PIXELS 12
+
+// Cone tracing of signed distance primitives: sphere tracing stops once the distance drops below the radius
+// of the ray's pixel cone, instead of a fixed fraction of t. Detail smaller than a pixel is never marched into,
+// which saves most of the steps spent on distant primitives.
+#define USE_CONE_TRACING 1
 
 // NOTE: Set max recursion depth as low as needed
 // as drivers may apply optimization strategies for low recursion depths.
@@ -55,6 +71,7 @@ struct SceneConstantBuffer
     XMVECTOR light_diffuse_color;
     float reflectance;
     float elapsed_time;
+    float pixel_spread_angle; // Of the pixel at the output's center, set by the renderer once per frame for its output size.
 };
 
 // Attributes per primitive type.
@@ -67,7 +84,10 @@ struct PrimitiveConstantBuffer
     float specular_power;
     float step_scale; // Step scale for ray marching of signed distance primitives.
         // - Some object transformations don't preserve the distances and thus require shorter steps.
-    XMFLOAT3 padding;
+        // - Estimated at startup by RaytracingScene::estimate_step_scales().
+    float over_relaxation; // Over-relaxation factor of the ray marching steps, 1 for plain sphere tracing.
+        // - Smooth distance fields can take steps past the unbounding sphere, see RaySignedDistancePrimitiveTest().
+    XMFLOAT2 padding;
 };
 
 // Attributes per primitive instance.
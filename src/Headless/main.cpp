@@ -0,0 +1,283 @@
+#include "AK/Types.h"
+#include "CPU/Raytracer.h"
+#include "CPU/RenderTarget.h"
+#include "CPUTimer.h"
+#include "RaytracingScene.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Renders the sample scene with the CPU raytracer, without a window or a GPU, and writes the last frame to a PPM file.
+// Usage: EngineHeadless [--width 1280] [--height 720] [--frames 1] [--threads 0] [--tile-size 16] [--wavefront 0]
+//                       [--sdf-cache 0] [--warm-start 0] [--metaballs 0] [--baked-mesh-distance inf] [--sdf-expressions 0]
+//                       [--sdf-expression primitive file] [--sdf-pruning 0] [--grid 0] [--wide-bvh 0] [--output output.ppm]
+
+namespace
+{
+
+// Signed distance primitive to trace through the expression in a file, see CPU::parse_signed_distance_expression().
+struct ExpressionFile
+{
+    u32 sd_primitive = 0; // Index in SignedDistancePrimitive::Enum.
+    std::string path = {};
+};
+
+struct Options
+{
+    u32 width = 1280;
+    u32 height = 720;
+    u32 frames = 1;
+    u32 threads = 0; // 0 uses every hardware thread.
+    u32 tile_size = 16;
+    bool wavefront = false;
+    bool sdf_cache = false;
+    bool warm_start = false;
+    u32 metaballs = 0; // 0 keeps the scene's animated metaballs.
+    float baked_mesh_distance = INFINITY; // Infinity never swaps in baked meshes.
+    bool sdf_expressions = false; // Traces the signed distance primitives through expressions of their distance functions.
+    std::vector<ExpressionFile> sdf_expression_files = {}; // Applied after sdf_expressions, so they replace its expressions.
+    bool sdf_pruning = false;
+    bool grid = false; // Traces the procedural geometry's AABBs through a uniform grid instead of a BVH.
+    bool wide_bvh = false; // Traces the bottom-level ASes through 8-wide BVHs.
+    std::string output = "output.ppm";
+};
+
+bool parse_options(int const argc, char** argv, Options& options)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        if (i + 1 >= argc)
+        {
+            return false;
+        }
+
+        char const* name = argv[i];
+        char const* value = argv[++i];
+
+        if (std::strcmp(name, "--width") == 0)
+        {
+            options.width = static_cast<u32>(std::strtoul(value, nullptr, 10));
+        }
+        else if (std::strcmp(name, "--height") == 0)
+        {
+            options.height = static_cast<u32>(std::strtoul(value, nullptr, 10));
+        }
+        else if (std::strcmp(name, "--frames") == 0)
+        {
+            options.frames = static_cast<u32>(std::strtoul(value, nullptr, 10));
+        }
+        else if (std::strcmp(name, "--threads") == 0)
+        {
+            options.threads = static_cast<u32>(std::strtoul(value, nullptr, 10));
+        }
+        else if (std::strcmp(name, "--tile-size") == 0)
+        {
+            options.tile_size = static_cast<u32>(std::strtoul(value, nullptr, 10));
+        }
+        else if (std::strcmp(name, "--wavefront") == 0)
+        {
+            options.wavefront = std::strtoul(value, nullptr, 10) != 0;
+        }
+        else if (std::strcmp(name, "--sdf-cache") == 0)
+        {
+            options.sdf_cache = std::strtoul(value, nullptr, 10) != 0;
+        }
+        else if (std::strcmp(name, "--warm-start") == 0)
+        {
+            options.warm_start = std::strtoul(value, nullptr, 10) != 0;
+        }
+        else if (std::strcmp(name, "--metaballs") == 0)
+        {
+            options.metaballs = static_cast<u32>(std::strtoul(value, nullptr, 10));
+        }
+        else if (std::strcmp(name, "--baked-mesh-distance") == 0)
+        {
+            options.baked_mesh_distance = std::strtof(value, nullptr);
+        }
+        else if (std::strcmp(name, "--sdf-expressions") == 0)
+        {
+            options.sdf_expressions = std::strtoul(value, nullptr, 10) != 0;
+        }
+        else if (std::strcmp(name, "--sdf-expression") == 0)
+        {
+            if (i + 1 >= argc)
+            {
+                return false;
+            }
+
+            u32 const sd_primitive = static_cast<u32>(std::strtoul(value, nullptr, 10));
+            if (sd_primitive >= SignedDistancePrimitive::Count)
+            {
+                return false;
+            }
+
+            options.sdf_expression_files.push_back({sd_primitive, argv[++i]});
+        }
+        else if (std::strcmp(name, "--sdf-pruning") == 0)
+        {
+            options.sdf_pruning = std::strtoul(value, nullptr, 10) != 0;
+        }
+        else if (std::strcmp(name, "--grid") == 0)
+        {
+            options.grid = std::strtoul(value, nullptr, 10) != 0;
+        }
+        else if (std::strcmp(name, "--wide-bvh") == 0)
+        {
+            options.wide_bvh = std::strtoul(value, nullptr, 10) != 0;
+        }
+        else if (std::strcmp(name, "--output") == 0)
+        {
+            options.output = value;
+        }
+        else
+        {
+            return false;
+        }
+    }
+
+    return options.width > 0 && options.height > 0 && options.frames > 0 && options.tile_size > 0;
+}
+
+// Scatters count metaballs over the Metaballs AABB, from a fixed seed so renders are comparable between runs.
+// Radii shrink with the cube root of the count, so the field keeps about the same density of surface.
+std::vector<CPU::Metaball> generate_metaballs(u32 const count)
+{
+    std::mt19937 generator(1);
+    std::uniform_real_distribution<float> distribution(0.0f, 1.0f);
+
+    float const base_radius = 0.45f * std::cbrt(3.0f / static_cast<float>(count));
+    std::vector<CPU::Metaball> metaballs(count);
+    for (CPU::Metaball& metaball : metaballs)
+    {
+        metaball.radius = base_radius * (0.75f + 0.5f * distribution(generator));
+
+        // Keep the influence spheres inside of the AABB, which spans [-1, 1] on every axis.
+        float const range = 1.0f - metaball.radius;
+        for (u32 axis = 0; axis < 3; axis++)
+        {
+            metaball.center[axis] = range * (2.0f * distribution(generator) - 1.0f);
+        }
+    }
+
+    return metaballs;
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    Options options = {};
+
+    if (!parse_options(argc, argv, options))
+    {
+        std::fprintf(stderr,
+                     "Usage: %s [--width N] [--height N] [--frames N] [--threads N] [--tile-size N] [--wavefront 0|1]"
+                     " [--sdf-cache 0|1] [--warm-start 0|1] [--metaballs N] [--baked-mesh-distance D] [--sdf-expressions 0|1]"
+                     " [--sdf-expression primitive file] [--sdf-pruning 0|1] [--grid 0|1] [--wide-bvh 0|1] [--output path.ppm]\n",
+                     argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    RaytracingScene scene = {};
+    scene.initialize(static_cast<float>(options.width) / static_cast<float>(options.height));
+
+    CPU::Raytracer raytracer(scene);
+    raytracer.build();
+
+    if (options.threads > 0)
+    {
+        raytracer.set_thread_count(options.threads);
+    }
+
+    raytracer.set_tile_size(options.tile_size);
+    raytracer.set_wavefront_enabled(options.wavefront);
+    raytracer.set_grid_enabled(options.grid);
+    raytracer.set_wide_bvh_enabled(options.wide_bvh);
+
+    if (options.sdf_expressions)
+    {
+        for (u32 i = 0; i < SignedDistancePrimitive::Count; i++)
+        {
+            auto const sd_primitive = static_cast<SignedDistancePrimitive::Enum>(i);
+            CPU::SignedDistanceExpression expression = {};
+            if (CPU::build_signed_distance_primitive_expression(sd_primitive, expression))
+            {
+                raytracer.set_signed_distance_expression(sd_primitive, expression);
+            }
+        }
+    }
+
+    for (ExpressionFile const& file : options.sdf_expression_files)
+    {
+        std::ifstream stream(file.path);
+        if (!stream)
+        {
+            std::fprintf(stderr, "Failed to read %s\n", file.path.c_str());
+            return EXIT_FAILURE;
+        }
+
+        std::stringstream text;
+        text << stream.rdbuf();
+
+        CPU::SignedDistanceExpression expression = {};
+        std::string error = {};
+        if (!CPU::parse_signed_distance_expression(text.str(), expression, error))
+        {
+            std::fprintf(stderr, "%s: %s\n", file.path.c_str(), error.c_str());
+            return EXIT_FAILURE;
+        }
+
+        if (!raytracer.set_signed_distance_expression(static_cast<SignedDistancePrimitive::Enum>(file.sd_primitive), expression))
+        {
+            std::fprintf(stderr, "%s: Expression does not compile\n", file.path.c_str());
+            return EXIT_FAILURE;
+        }
+    }
+    raytracer.set_signed_distance_pruning_enabled(options.sdf_pruning);
+
+    raytracer.set_distance_field_cache_enabled(options.sdf_cache);
+    raytracer.set_warm_start_enabled(options.warm_start);
+    raytracer.set_baked_mesh_distance(options.baked_mesh_distance);
+
+    if (options.metaballs > 0)
+    {
+        std::vector<CPU::Metaball> const metaballs = generate_metaballs(options.metaballs);
+        raytracer.set_metaballs(metaballs);
+    }
+
+    CPU::RenderTarget render_target(options.width, options.height);
+    DX::CPUTimer timer = {};
+
+    // Frames advance at a fixed 60 Hz, so the output does not depend on how long rendering takes.
+    float constexpr frame_time = 1.0f / 60.0f;
+    double total_ms = 0.0;
+
+    for (u32 frame = 0; frame < options.frames; ++frame)
+    {
+        scene.update(frame_time);
+
+        timer.Start();
+        raytracer.dispatch_rays(render_target);
+        timer.Stop();
+
+        total_ms += timer.GetElapsedMS();
+    }
+
+    std::printf("%ux%u, %u frame(s) on %u thread(s): %.2f ms/frame\n", options.width, options.height, options.frames,
+                raytracer.get_thread_count(), total_ms / options.frames);
+
+    if (!render_target.write_ppm(options.output))
+    {
+        std::fprintf(stderr, "Failed to write %s\n", options.output.c_str());
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -59,73 +59,6 @@ inline void DebugWarnings(uint32_t timerid, uint64_t start, uint64_t end)
 }
 };
 
-//======================================================================================
-// CPUTimer
-//======================================================================================
-
-CPUTimer::CPUTimer() : m_cpuFreqInv(1.f), m_start {}, m_end {}, m_avg {}
-{
-    LARGE_INTEGER cpuFreq;
-    if (!QueryPerformanceFrequency(&cpuFreq))
-    {
-        throw std::exception("QueryPerformanceFrequency");
-    }
-
-    m_cpuFreqInv = 1000.0 / double(cpuFreq.QuadPart);
-}
-
-void CPUTimer::Start(uint32_t timerid)
-{
-    if (timerid >= c_maxTimers)
-        throw std::out_of_range("Timer ID out of range");
-
-    if (!QueryPerformanceCounter(&m_start[timerid]))
-    {
-        throw std::exception("QueryPerformanceCounter");
-    }
-}
-
-void CPUTimer::Stop(uint32_t timerid)
-{
-    if (timerid >= c_maxTimers)
-        throw std::out_of_range("Timer ID out of range");
-
-    if (!QueryPerformanceCounter(&m_end[timerid]))
-    {
-        throw std::exception("QueryPerformanceCounter");
-    }
-}
-
-void CPUTimer::Update()
-{
-    for (uint32_t j = 0; j < c_maxTimers; ++j)
-    {
-        uint64_t start = m_start[j].QuadPart;
-        uint64_t end = m_end[j].QuadPart;
-
-        DebugWarnings(j, start, end);
-
-        float value = float(double(end - start) * m_cpuFreqInv);
-        m_avg[j] = UpdateRunningAverage(m_avg[j], value);
-    }
-}
-
-void CPUTimer::Reset()
-{
-    memset(m_avg, 0, sizeof(m_avg));
-}
-
-double CPUTimer::GetElapsedMS(uint32_t timerid) const
-{
-    if (timerid >= c_maxTimers)
-        return 0.0;
-
-    uint64_t start = m_start[timerid].QuadPart;
-    uint64_t end = m_end[timerid].QuadPart;
-
-    return double(end - start) * m_cpuFreqInv;
-}
-
 //======================================================================================
 // GPUTimer (DirectX 12)
 //======================================================================================
@@ -15,51 +15,11 @@
 
 #pragma once
 
+#include "CPUTimer.h"
+
 
 namespace DX
 {
-    //----------------------------------------------------------------------------------
-    // CPU performance timer
-    class CPUTimer
-    {
-    public:
-        static const size_t c_maxTimers = 8;
-
-        CPUTimer();
-
-        CPUTimer(const CPUTimer&) = delete;
-        CPUTimer& operator=(const CPUTimer&) = delete;
-
-        CPUTimer(CPUTimer&&) = default;
-        CPUTimer& operator=(CPUTimer&&) = default;
-
-        // Start/stop a particular performance timer (don't start same index more than once in a single frame)
-        void Start(uint32_t timerid = 0);
-        void Stop(uint32_t timerid = 0);
-
-        // Should Update once per frame to compute timer results
-        void Update();
-
-        // Reset running average
-        void Reset();
-
-        // Returns delta time in milliseconds
-        double GetElapsedMS(uint32_t timerid = 0) const;
-
-        // Returns running average in milliseconds
-        float GetAverageMS(uint32_t timerid = 0) const
-        {
-            return (timerid < c_maxTimers) ? m_avg[timerid] : 0.f;
-        }
-
-    private:
-        double          m_cpuFreqInv;
-        LARGE_INTEGER   m_start[c_maxTimers];
-        LARGE_INTEGER   m_end[c_maxTimers];
-        float           m_avg[c_maxTimers];
-    };
-
-
     //----------------------------------------------------------------------------------
     // DirectX 12 implementation of GPU timer
     class GPUTimer
@@ -58,9 +58,11 @@ bool RayVolumetricGeometryIntersectionTest(in Ray ray, in VolumetricPrimitive::E
 
 // Signed distance functions use a shared ray signed distance test.
 // The test, instead, calls into this function to retrieve a distance for a primitive.
+// Fractals pick their iterations from the camera's distance in the same local space, see CalculateFractalIterations().
 // AABB local space dimensions: <-1,1>.
 // Ref: http://www.iquilezles.org/www/articles/distfunctions/distfunctions.htm
-float GetDistanceFromSignedDistancePrimitive(in float3 position, in SignedDistancePrimitive::Enum signedDistancePrimitive)
+float GetDistanceFromSignedDistancePrimitive(in float3 position, in SignedDistancePrimitive::Enum signedDistancePrimitive,
+                                             in float3 cameraPosition, in float pixelSpreadAngle)
 {
     switch (signedDistancePrimitive)
     {
@@ -91,7 +93,8 @@ float GetDistanceFromSignedDistancePrimitive(in float3 position, in SignedDistan
     case SignedDistancePrimitive::FractalPyramid: 
          // Let pyramid have a base at y == -1 of AABB => position + float3(0,1,0) 
          // Pyramid: 63.435 degrees at base, height 2
-         return sdFractalPyramid(position + float3(0, 1, 0), float3(0.894, 0.447, 2.0), 2.0f);
+         return sdFractalPyramid(position + float3(0, 1, 0), float3(0.894, 0.447, 2.0), 2.0f,
+                                 CalculateFractalIterations(position, cameraPosition, pixelSpreadAngle, 2.0f, 2.0f));
     
     default: return 0;
     }
@@ -328,11 +328,32 @@ void MyIntersectionShader_SignedDistancePrimitive()
     Ray localRay = GetRayInAABBPrimitiveLocalSpace();
     SignedDistancePrimitive::Enum primitiveType = (SignedDistancePrimitive::Enum) l_aabbCB.primitive_type;
 
+    float pixelSpreadAngle = g_sceneCB.pixel_spread_angle;
+
+    // Fractal detail follows the distance to the camera rather than along the ray, so shadow and reflection rays
+    // see the same fractal as the camera does.
+    PrimitiveInstancePerFrameBuffer aabbAttribute = g_AABBPrimitiveAttributes[l_aabbCB.instance_index];
+    float3 localCameraPosition = mul(float4(mul(WorldToObject3x4(), float4(g_sceneCB.camera_position.xyz, 1)), 1),
+                                     aabbAttribute.bottom_level_as_to_local_space).xyz;
+
+    float coneWidth = 0;
+    float coneSpreadAngle = 0;
+#if USE_CONE_TRACING
+    // Shadow rays start on a surface, where any cone would report a hit right away.
+    if (!(RayFlags() & RAY_FLAG_SKIP_CLOSEST_HIT_SHADER))
+    {
+        // Pixel cone in local space units, with a radius of half the pixel's footprint. A reflection ray starts
+        // at a previous hit, so the distance it has already travelled from the camera is at least the distance between the two.
+        coneSpreadAngle = 0.5 * pixelSpreadAngle * length(localRay.direction);
+        coneWidth = coneSpreadAngle * length(WorldRayOrigin() - g_sceneCB.camera_position.xyz);
+    }
+#endif
+
     float thit;
     ProceduralPrimitiveAttributes attr = (ProceduralPrimitiveAttributes)0;
-    if (RaySignedDistancePrimitiveTest(localRay, primitiveType, thit, attr, l_materialCB.step_scale))
+    if (RaySignedDistancePrimitiveTest(localRay, primitiveType, thit, attr, l_materialCB.step_scale, l_materialCB.over_relaxation,
+                                       coneWidth, coneSpreadAngle, localCameraPosition, pixelSpreadAngle))
     {
-        PrimitiveInstancePerFrameBuffer aabbAttribute = g_AABBPrimitiveAttributes[l_aabbCB.instance_index];
         attr.normal = mul(attr.normal, (float3x3) aabbAttribute.local_space_to_bottom_level_as);
         attr.normal = normalize(mul((float3x3) ObjectToWorld3x4(), attr.normal));
 
@@ -0,0 +1,497 @@
+#include "RaytracingScene.h"
+
+#include "CPU/LipschitzBound.h"
+#include "CPU/VolumetricPrimitives.h"
+
+#include <DirectXMath.h>
+
+using namespace DirectX;
+
+void RaytracingScene::initialize(float const aspect_ratio)
+{
+    m_aspect_ratio = aspect_ratio;
+
+    initialize_materials();
+    initialize_camera();
+    initialize_lights();
+
+    build_procedural_geometry_aabbs();
+    build_plane_geometry();
+    build_instance_descs();
+
+    update_aabb_primitive_attributes(m_animate_geometry_time);
+    update_aabbs(m_animate_geometry_time);
+    estimate_step_scales();
+    m_scene_cb.elapsed_time = m_animate_geometry_time;
+}
+
+void RaytracingScene::update(float const elapsed_time)
+{
+    // Rotate the camera around Y axis.
+    if (m_animate_camera)
+    {
+        float constexpr seconds_to_rotate_around = 48.0f;
+        float const angle_to_rotate_by = 360.0f * (elapsed_time / seconds_to_rotate_around);
+        XMMATRIX const rotate = XMMatrixRotationY(XMConvertToRadians(angle_to_rotate_by));
+        m_eye = XMVector3Transform(m_eye, rotate);
+        m_up = XMVector3Transform(m_up, rotate);
+        m_at = XMVector3Transform(m_at, rotate);
+        update_camera_matrices();
+    }
+
+    // Rotate the second light around Y axis.
+    if (m_animate_light)
+    {
+        float constexpr seconds_to_rotate_around = 8.0f;
+        float const angle_to_rotate_by = -360.0f * (elapsed_time / seconds_to_rotate_around);
+        XMMATRIX const rotate = XMMatrixRotationY(XMConvertToRadians(angle_to_rotate_by));
+        m_scene_cb.light_position = XMVector3Transform(m_scene_cb.light_position, rotate);
+    }
+
+    // Transform the procedular geometry.
+    if (m_animate_geometry)
+    {
+        m_animate_geometry_time += elapsed_time;
+    }
+
+    update_aabb_primitive_attributes(m_animate_geometry_time);
+    update_aabbs(m_animate_geometry_time);
+    m_scene_cb.elapsed_time = m_animate_geometry_time;
+}
+
+void RaytracingScene::update_camera_matrices()
+{
+    m_scene_cb.camera_position = m_eye;
+    float constexpr fov_angle_y = 45.0f;
+    XMMATRIX const view = XMMatrixLookAtLH(m_eye, m_at, m_up);
+    XMMATRIX const proj = XMMatrixPerspectiveFovLH(XMConvertToRadians(fov_angle_y), m_aspect_ratio, 0.01f, 125.0f);
+    XMMATRIX const view_proj = view * proj;
+
+    m_scene_cb.projection_to_world = XMMatrixInverse(nullptr, view_proj);
+}
+
+void RaytracingScene::set_aspect_ratio(float const aspect_ratio)
+{
+    m_aspect_ratio = aspect_ratio;
+    update_camera_matrices();
+}
+
+SceneConstantBuffer const& RaytracingScene::get_scene_cb() const
+{
+    return m_scene_cb;
+}
+
+float RaytracingScene::calculate_pixel_spread_angle(u32 const width, u32 const height) const
+{
+    // Directions of the camera rays through the center pixel and the one below it, as GenerateCameraRay() makes them.
+    auto const get_camera_ray_direction = [&](u32 const x, u32 const y) {
+        float const screen_x = (static_cast<float>(x) + 0.5f) / static_cast<float>(width) * 2.0f - 1.0f;
+        float const screen_y = -((static_cast<float>(y) + 0.5f) / static_cast<float>(height) * 2.0f - 1.0f);
+        XMVECTOR const world = XMVector3TransformCoord(XMVectorSet(screen_x, screen_y, 0.0f, 1.0f), m_scene_cb.projection_to_world);
+        return XMVector3Normalize(world - m_scene_cb.camera_position);
+    };
+
+    XMVECTOR const ray_direction = get_camera_ray_direction(width / 2, height / 2);
+    XMVECTOR const neighbor_direction = get_camera_ray_direction(width / 2, height / 2 + 1);
+
+    // The chord between two close unit directions is their angle, to first order.
+    return XMVectorGetX(XMVector3Length(neighbor_direction - ray_direction));
+}
+
+PrimitiveConstantBuffer const& RaytracingScene::get_plane_material_cb() const
+{
+    return m_plane_material_cb;
+}
+
+PrimitiveConstantBuffer const& RaytracingScene::get_aabb_material_cb(u32 const primitive_index) const
+{
+    return m_aabb_material_cb[primitive_index];
+}
+
+PrimitiveInstancePerFrameBuffer const& RaytracingScene::get_aabb_primitive_attributes(u32 const primitive_index) const
+{
+    return m_aabb_primitive_attributes[primitive_index];
+}
+
+std::vector<RaytracingAABB> const& RaytracingScene::get_aabbs() const
+{
+    return m_aabbs;
+}
+
+std::vector<RaytracingScene::Index> const& RaytracingScene::get_plane_indices() const
+{
+    return m_plane_indices;
+}
+
+std::vector<Vertex> const& RaytracingScene::get_plane_vertices() const
+{
+    return m_plane_vertices;
+}
+
+std::array<RaytracingInstanceDesc, RaytracingScene::num_blas> const& RaytracingScene::get_instance_descs() const
+{
+    return m_instance_descs;
+}
+
+void RaytracingScene::initialize_materials()
+{
+    auto set_attributes = [&](u32 primitive_index, XMFLOAT4 const& albedo, float reflectance_coefficient = 0.0f,
+                              float diffuse_coefficient = 0.9f, float specular_coefficient = 0.7f, float specular_power = 50.0f,
+                              float over_relaxation = 1.0f) {
+        auto& attributes = m_aabb_material_cb[primitive_index];
+        attributes.albedo = albedo;
+        attributes.reflectance_coefficient = reflectance_coefficient;
+        attributes.diffuse_coefficient = diffuse_coefficient;
+        attributes.specular_coefficient = specular_coefficient;
+        attributes.specular_power = specular_power;
+        attributes.step_scale = 1.0f; // See estimate_step_scales().
+        attributes.over_relaxation = over_relaxation;
+    };
+
+    m_plane_material_cb = {};
+    m_plane_material_cb.albedo = XMFLOAT4(0.9f, 0.9f, 0.9f, 1.0f);
+    m_plane_material_cb.reflectance_coefficient = 0.25f;
+    m_plane_material_cb.diffuse_coefficient = 1.0f;
+    m_plane_material_cb.specular_coefficient = 0.4f;
+    m_plane_material_cb.specular_power = 50.0f;
+    m_plane_material_cb.step_scale = 1.0f;
+    m_plane_material_cb.over_relaxation = 1.0f;
+
+    // Albedos
+    auto constexpr green = XMFLOAT4(0.1f, 1.0f, 0.5f, 1.0f);
+    auto constexpr red = XMFLOAT4(1.0f, 0.5f, 0.5f, 1.0f);
+    auto constexpr yellow = XMFLOAT4(1.0f, 1.0f, 0.5f, 1.0f);
+
+    u32 offset = 0;
+
+    // Analytic primitives.
+    {
+        using namespace AnalyticPrimitive;
+        set_attributes(offset + AABB, red);
+        set_attributes(offset + Spheres, CHROMIUM_REFLECTANCE, 1);
+        offset += AnalyticPrimitive::Count;
+    }
+
+    // Volumetric primitives.
+    {
+        using namespace VolumetricPrimitive;
+        set_attributes(offset + Metaballs, CHROMIUM_REFLECTANCE, 1);
+        offset += VolumetricPrimitive::Count;
+    }
+
+    // Signed distance primitives.
+    {
+        using namespace SignedDistancePrimitive;
+        // Over-relaxation pays off for the smooth fields. MiniSpheres' and Cylinder's are cheap enough that the extra
+        // bookkeeping per step costs as much as the steps it saves, and the Cog's and FractalPyramid's are folded and warped,
+        // which trips the overlap test along their edges.
+        set_attributes(offset + MiniSpheres, green);
+        set_attributes(offset + IntersectedRoundCube, green, 0, 0.9f, 0.7f, 50, 1.6f);
+        set_attributes(offset + SquareTorus, CHROMIUM_REFLECTANCE, 1, 0.9f, 0.7f, 50, 2.0f);
+        set_attributes(offset + TwistedTorus, yellow, 0, 1.0f, 0.7f, 50, 2.0f);
+        set_attributes(offset + Cog, yellow, 0, 1.0f, 0.1f, 2);
+        set_attributes(offset + Cylinder, red);
+        set_attributes(offset + FractalPyramid, green, 0, 1, 0.1f, 4);
+    }
+}
+
+void RaytracingScene::initialize_camera()
+{
+    // Initialize the view and projection inverse matrices.
+    m_eye = XMVectorSet(0.0f, 5.3f, -17.0f, 1.0f);
+    m_at = XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f);
+    XMVECTOR const right = XMVectorSet(1.0f, 0.0f, 0.0f, 0.0f);
+
+    XMVECTOR const direction = XMVector4Normalize(m_at - m_eye);
+    m_up = XMVector3Normalize(XMVector3Cross(direction, right));
+
+    // Rotate camera around Y axis.
+    XMMATRIX const rotate = XMMatrixRotationY(XMConvertToRadians(45.0f));
+    m_eye = XMVector3Transform(m_eye, rotate);
+    m_up = XMVector3Transform(m_up, rotate);
+
+    update_camera_matrices();
+}
+
+void RaytracingScene::initialize_lights()
+{
+    // Initialize the lighting parameters.
+    XMFLOAT4 light_position;
+    XMFLOAT4 light_ambient_color;
+    XMFLOAT4 light_diffuse_color;
+
+    light_position = {0.0f, 18.0f, -20.0f, 0.0f};
+    m_scene_cb.light_position = XMLoadFloat4(&light_position);
+
+    light_ambient_color = {0.25f, 0.25f, 0.25f, 1.0f};
+    m_scene_cb.light_ambient_color = XMLoadFloat4(&light_ambient_color);
+
+    float constexpr d = 0.6f;
+    light_diffuse_color = {d, d, d, 1.0f};
+    m_scene_cb.light_diffuse_color = XMLoadFloat4(&light_diffuse_color);
+}
+
+void RaytracingScene::build_procedural_geometry_aabbs()
+{
+    // Set up AABBs on a grid.
+    auto constexpr aabb_grid = XMINT3(4, 1, 4);
+    XMFLOAT3 constexpr base_position = {
+        -(aabb_grid.x * aabb_width + (aabb_grid.x - 1) * aabb_distance) / 2.0f,
+        -(aabb_grid.y * aabb_width + (aabb_grid.y - 1) * aabb_distance) / 2.0f,
+        -(aabb_grid.z * aabb_width + (aabb_grid.z - 1) * aabb_distance) / 2.0f,
+    };
+
+    auto stride = XMFLOAT3(aabb_width + aabb_distance, aabb_width + aabb_distance, aabb_width + aabb_distance);
+    auto initialize_aabb = [&](auto const& offset_index, auto const& size) {
+        return RaytracingAABB {
+            XMFLOAT3(base_position.x + offset_index.x * stride.x, base_position.y + offset_index.y * stride.y,
+                     base_position.z + offset_index.z * stride.z),
+            XMFLOAT3(base_position.x + offset_index.x * stride.x + size.x, base_position.y + offset_index.y * stride.y + size.y,
+                     base_position.z + offset_index.z * stride.z + size.z),
+        };
+    };
+    m_aabb_slots.resize(IntersectionShaderType::TOTAL_PRIMITIVE_COUNT);
+    u32 offset = 0;
+
+    // Analytic primitives.
+    {
+        using namespace AnalyticPrimitive;
+        m_aabb_slots[offset + AABB] = initialize_aabb(XMINT3(3, 0, 0), XMFLOAT3(2, 3, 2));
+        m_aabb_slots[offset + Spheres] = initialize_aabb(XMFLOAT3(2.25f, 0, 0.75f), XMFLOAT3(3, 3, 3));
+        offset += AnalyticPrimitive::Count;
+    }
+
+    // Volumetric primitives.
+    {
+        using namespace VolumetricPrimitive;
+        m_aabb_slots[offset + Metaballs] = initialize_aabb(XMINT3(0, 0, 0), XMFLOAT3(3, 3, 3));
+        offset += VolumetricPrimitive::Count;
+    }
+
+    // Signed distance primitives.
+    {
+        using namespace SignedDistancePrimitive;
+        m_aabb_slots[offset + MiniSpheres] = initialize_aabb(XMINT3(2, 0, 0), XMFLOAT3(2, 2, 2));
+        m_aabb_slots[offset + TwistedTorus] = initialize_aabb(XMINT3(0, 0, 1), XMFLOAT3(2, 2, 2));
+        m_aabb_slots[offset + IntersectedRoundCube] = initialize_aabb(XMINT3(0, 0, 2), XMFLOAT3(2, 2, 2));
+        m_aabb_slots[offset + SquareTorus] = initialize_aabb(XMFLOAT3(0.75f, -0.1f, 2.25f), XMFLOAT3(3, 3, 3));
+        m_aabb_slots[offset + Cog] = initialize_aabb(XMINT3(1, 0, 0), XMFLOAT3(2, 2, 2));
+        m_aabb_slots[offset + Cylinder] = initialize_aabb(XMINT3(0, 0, 3), XMFLOAT3(2, 3, 2));
+        m_aabb_slots[offset + FractalPyramid] = initialize_aabb(XMINT3(2, 0, 2), XMFLOAT3(6, 6, 6));
+    }
+
+    m_aabbs = m_aabb_slots;
+}
+
+void RaytracingScene::build_plane_geometry()
+{
+    // Plane indices.
+    m_plane_indices = {
+        3, 1, 0, 2, 1, 3,
+    };
+
+    // Cube vertices positions and corresponding triangle normals.
+    m_plane_vertices = {
+        Vertex {XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(0.0f, 1.0f, 0.0f)},
+        {XMFLOAT3(1.0f, 0.0f, 0.0f), XMFLOAT3(0.0f, 1.0f, 0.0f)},
+        {XMFLOAT3(1.0f, 0.0f, 1.0f), XMFLOAT3(0.0f, 1.0f, 0.0f)},
+        {XMFLOAT3(0.0f, 0.0f, 1.0f), XMFLOAT3(0.0f, 1.0f, 0.0f)},
+    };
+}
+
+void RaytracingScene::build_instance_descs()
+{
+    // Width of a bottom-level AS geometry.
+    // Make the plane a little larger than the actual number of primitives in each dimension.
+    auto constexpr num_aabb = XMUINT3(700, 1, 700);
+    auto constexpr f_width =
+        XMFLOAT3(num_aabb.x * aabb_width + (num_aabb.x - 1) * aabb_distance, num_aabb.y * aabb_width + (num_aabb.y - 1) * aabb_distance,
+                 num_aabb.z * aabb_width + (num_aabb.z - 1) * aabb_distance);
+    const XMVECTOR v_width = XMLoadFloat3(&f_width);
+
+    // Bottom-level AS with a single plane.
+    {
+        auto& instance_desc = m_instance_descs[BottomLevelASType::Triangle];
+        instance_desc = {};
+        instance_desc.instance_mask = 1;
+        instance_desc.instance_contribution_to_hit_group_index = 0;
+        instance_desc.bottom_level_as_type = BottomLevelASType::Triangle;
+
+        // Calculate transformation matrix.
+        auto constexpr base_position = XMFLOAT3(-0.35f, 0.0f, -0.35f);
+        XMVECTOR const v_base_position = v_width * XMLoadFloat3(&base_position);
+
+        // Scale in XZ dimensions.
+        XMMATRIX const m_scale = XMMatrixScaling(f_width.x, f_width.y, f_width.z);
+        XMMATRIX const m_translation = XMMatrixTranslationFromVector(v_base_position);
+        XMMATRIX const m_transform = m_scale * m_translation;
+        XMStoreFloat3x4(&instance_desc.transform, m_transform);
+    }
+
+    // Create instanced bottom-level AS with procedural geometry AABBs.
+    // Instances share all the data, except for a transform.
+    {
+        auto& instance_desc = m_instance_descs[BottomLevelASType::AABB];
+        instance_desc = {};
+        instance_desc.instance_mask = 1;
+
+        // Set hit group offset to beyond the shader records for the triangle AABB.
+        instance_desc.instance_contribution_to_hit_group_index =
+            static_cast<u32>(BottomLevelASType::AABB) * static_cast<u32>(RayType::Count);
+        instance_desc.bottom_level_as_type = BottomLevelASType::AABB;
+
+        // Move all AABBS above the ground plane.
+        auto constexpr y_translate = XMFLOAT3(0.0f, aabb_width / 2.0f, 0.0f);
+        XMMATRIX const m_translation = XMMatrixTranslationFromVector(XMLoadFloat3(&y_translate));
+        XMStoreFloat3x4(&instance_desc.transform, m_translation);
+    }
+}
+
+void RaytracingScene::update_aabb_primitive_attributes(float const animation_time)
+{
+    XMMATRIX const m_identity = XMMatrixIdentity();
+
+    XMMATRIX const m_scale_15_y = XMMatrixScaling(1.0f, 1.5f, 1.0f);
+    XMMATRIX const m_scale_15 = XMMatrixScaling(1.5f, 1.5f, 1.5f);
+
+    XMMATRIX const m_scale_3 = XMMatrixScaling(3.0f, 3.0f, 3.0f);
+
+    XMMATRIX const m_rotation = XMMatrixRotationY(-2.0f * animation_time);
+
+    // Apply scale, rotation and translation transforms.
+    // The intersection shader tests in this sample work with local space, so here
+    // we apply the BLAS object space translation that was passed to geometry descs.
+    auto set_transform_for_aabb = [&](u32 const primitive_index, XMMATRIX const& m_scale, XMMATRIX const& m_rotation) {
+        XMVECTOR const v_translation =
+            0.5f * (XMLoadFloat3(&m_aabb_slots[primitive_index].min) + XMLoadFloat3(&m_aabb_slots[primitive_index].max));
+        XMMATRIX const m_translation = XMMatrixTranslationFromVector(v_translation);
+
+        XMMATRIX const m_transform = m_scale * m_rotation * m_translation;
+        m_aabb_primitive_attributes[primitive_index].local_space_to_bottom_level_as = m_transform;
+        m_aabb_primitive_attributes[primitive_index].bottom_level_as_to_local_space = XMMatrixInverse(nullptr, m_transform);
+    };
+
+    u32 offset = 0;
+
+    // Analytic primitives.
+    {
+        using namespace AnalyticPrimitive;
+        set_transform_for_aabb(offset + AABB, m_scale_15_y, m_identity);
+        set_transform_for_aabb(offset + Spheres, m_scale_15, m_rotation);
+        offset += AnalyticPrimitive::Count;
+    }
+
+    // Volumetric primitives.
+    {
+        using namespace VolumetricPrimitive;
+        set_transform_for_aabb(offset + Metaballs, m_scale_15, m_rotation);
+        offset += VolumetricPrimitive::Count;
+    }
+
+    // Signed distance primitives.
+    {
+        using namespace SignedDistancePrimitive;
+
+        set_transform_for_aabb(offset + MiniSpheres, m_identity, m_identity);
+        set_transform_for_aabb(offset + IntersectedRoundCube, m_identity, m_identity);
+        set_transform_for_aabb(offset + SquareTorus, m_scale_15, m_identity);
+        set_transform_for_aabb(offset + TwistedTorus, m_identity, m_rotation);
+        set_transform_for_aabb(offset + Cog, m_identity, m_rotation);
+        set_transform_for_aabb(offset + Cylinder, m_scale_15_y, m_identity);
+        set_transform_for_aabb(offset + FractalPyramid, m_scale_3, m_identity);
+    }
+}
+
+void RaytracingScene::update_aabbs(float const animation_time)
+{
+    // Bounds of every primitive's geometry in its local space, within the <-1, 1> cube the intersection shaders test.
+    std::array<RaytracingAABB, IntersectionShaderType::TOTAL_PRIMITIVE_COUNT> local_bounds = {};
+    local_bounds.fill({XMFLOAT3(-1, -1, -1), XMFLOAT3(1, 1, 1)});
+
+    // Sphere tracing reports hits up to a pixel cone's radius away from the surface.
+    float constexpr margin = 0.05f;
+    auto const symmetric_bounds = [&](float const radius_xz, float const half_height) {
+        return RaytracingAABB {XMFLOAT3(-radius_xz - margin, -half_height - margin, -radius_xz - margin),
+                               XMFLOAT3(radius_xz + margin, half_height + margin, radius_xz + margin)};
+    };
+
+    u32 offset = 0;
+
+    // Analytic primitives.
+    {
+        using namespace AnalyticPrimitive;
+        local_bounds[offset + Spheres] = {XMFLOAT3(-0.9f, -0.9f, -0.9f), XMFLOAT3(0.5f, 0.5f, 0.7f)};
+        offset += AnalyticPrimitive::Count;
+    }
+
+    // Volumetric primitives.
+    {
+        using namespace VolumetricPrimitive;
+
+        // The isosurface lies within the metaballs' radii of influence.
+        CPU::Metaball blobs[METABALLS_COUNT];
+        CPU::initialize_animated_metaballs(blobs, animation_time, CPU::METABALLS_CYCLE_DURATION);
+        XMVECTOR blobs_min = XMVectorReplicate(CPU::INFINITY_F);
+        XMVECTOR blobs_max = XMVectorReplicate(-CPU::INFINITY_F);
+        for (CPU::Metaball const& blob : blobs)
+        {
+            XMVECTOR const center = XMVectorSet(blob.center.x, blob.center.y, blob.center.z, 0.0f);
+            blobs_min = XMVectorMin(blobs_min, center - XMVectorReplicate(blob.radius));
+            blobs_max = XMVectorMax(blobs_max, center + XMVectorReplicate(blob.radius));
+        }
+        XMStoreFloat3(&local_bounds[offset + Metaballs].min, blobs_min);
+        XMStoreFloat3(&local_bounds[offset + Metaballs].max, blobs_max);
+        offset += VolumetricPrimitive::Count;
+    }
+
+    // Signed distance primitives. The rotated ones are round around Y, so their bounds hold at any angle.
+    {
+        using namespace SignedDistancePrimitive;
+        local_bounds[offset + IntersectedRoundCube] = symmetric_bounds(0.95f, 0.95f);
+        local_bounds[offset + SquareTorus] = symmetric_bounds(0.9f, 0.15f);
+        local_bounds[offset + TwistedTorus] = symmetric_bounds(0.8f, 0.8f);
+        local_bounds[offset + Cog] = symmetric_bounds(0.9f, 0.3f);
+    }
+
+    // Transform the local bounds with this frame's animation, clipped to the slots the geometry used to be bounded by.
+    for (u32 i = 0; i < IntersectionShaderType::TOTAL_PRIMITIVE_COUNT; i++)
+    {
+        XMMATRIX const& transform = m_aabb_primitive_attributes[i].local_space_to_bottom_level_as;
+        XMVECTOR const local_min = XMLoadFloat3(&local_bounds[i].min);
+        XMVECTOR const local_max = XMLoadFloat3(&local_bounds[i].max);
+
+        XMVECTOR bounds_min = XMVectorReplicate(CPU::INFINITY_F);
+        XMVECTOR bounds_max = XMVectorReplicate(-CPU::INFINITY_F);
+        for (u32 corner = 0; corner < 8; corner++)
+        {
+            XMVECTOR const select = XMVectorSelectControl(corner & 1, (corner >> 1) & 1, (corner >> 2) & 1, 0);
+            XMVECTOR const position = XMVector3Transform(XMVectorSelect(local_min, local_max, select), transform);
+            bounds_min = XMVectorMin(bounds_min, position);
+            bounds_max = XMVectorMax(bounds_max, position);
+        }
+
+        XMStoreFloat3(&m_aabbs[i].min, XMVectorMax(bounds_min, XMLoadFloat3(&m_aabb_slots[i].min)));
+        XMStoreFloat3(&m_aabbs[i].max, XMVectorMin(bounds_max, XMLoadFloat3(&m_aabb_slots[i].max)));
+    }
+}
+
+void RaytracingScene::estimate_step_scales()
+{
+    // Sampling may miss the narrowest peaks of a distance function's gradient.
+    float constexpr safety_factor = 0.95f;
+
+    u32 const offset = IntersectionShaderType::TOTAL_PRIMITIVE_COUNT - SignedDistancePrimitive::Count;
+    for (u32 i = 0; i < SignedDistancePrimitive::Count; i++)
+    {
+        float const lipschitz_bound = CPU::estimate_lipschitz_bound(static_cast<SignedDistancePrimitive::Enum>(i));
+
+        // Rays are marched in local space with their direction left unnormalized, so a step of t moves t * |direction|,
+        // and |direction| is at most 1 / the transform's smallest scale. Transforms are scale * rotation * translation,
+        // so their rows are as long as the scales. Only the rotation is animated, so the scales hold for every frame.
+        XMMATRIX const& transform = m_aabb_primitive_attributes[offset + i].local_space_to_bottom_level_as;
+        float const min_scale = XMVectorGetX(
+            XMVectorMin(XMVector3Length(transform.r[0]), XMVectorMin(XMVector3Length(transform.r[1]), XMVector3Length(transform.r[2]))));
+
+        m_aabb_material_cb[offset + i].step_scale = safety_factor * min_scale / lipschitz_bound;
+    }
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include "AK/Types.h"
+#include "ConstantBuffers.h"
+#include "RaytracingSceneDefines.h"
+
+#include <array>
+#include <vector>
+
+// Same memory layout as D3D12_RAYTRACING_AABB.
+struct RaytracingAABB
+{
+    XMFLOAT3 min;
+    XMFLOAT3 max;
+};
+
+// API agnostic counterpart of D3D12_RAYTRACING_INSTANCE_DESC.
+struct RaytracingInstanceDesc
+{
+    XMFLOAT3X4 transform;
+    u32 instance_mask = 1;
+    u32 instance_contribution_to_hit_group_index = 0;
+    BottomLevelASType::Enum bottom_level_as_type = BottomLevelASType::Triangle;
+};
+
+// Scene description shared by the DXR renderer and the CPU raytracer.
+// Holds geometry, materials, instances and per-frame constants, without touching any graphics API.
+class RaytracingScene
+{
+public:
+    static u32 constexpr num_blas = 2; // Triangle + AABB bottom-level AS.
+    static float constexpr aabb_width = 2.0f;
+    static float constexpr aabb_distance = 2.0f; // Distance between AABBs.
+
+    // FIXME: Isn't u16 pretty low for an index?
+    typedef u16 Index;
+
+    void initialize(float const aspect_ratio);
+    void update(float const elapsed_time);
+    void update_camera_matrices();
+
+    void set_aspect_ratio(float const aspect_ratio);
+
+    [[nodiscard]] SceneConstantBuffer const& get_scene_cb() const;
+
+    // Angle a pixel at the center of a width x height output subtends from the camera, by which a ray's pixel cone widens
+    // per unit of distance, for SceneConstantBuffer::pixel_spread_angle. Measured like CPU::calculate_pixel_spread_angle().
+    // Ref: Akenine-Moller et al., "Texture Level of Detail Strategies for Real-Time Ray Tracing", Ray Tracing Gems 2019
+    [[nodiscard]] float calculate_pixel_spread_angle(u32 const width, u32 const height) const;
+    [[nodiscard]] PrimitiveConstantBuffer const& get_plane_material_cb() const;
+    [[nodiscard]] PrimitiveConstantBuffer const& get_aabb_material_cb(u32 const primitive_index) const;
+    [[nodiscard]] PrimitiveInstancePerFrameBuffer const& get_aabb_primitive_attributes(u32 const primitive_index) const;
+    // Bounds of every procedural primitive for the current frame, as tight as its animation allows.
+    // Acceleration structures built over them have to be refit after every update().
+    [[nodiscard]] std::vector<RaytracingAABB> const& get_aabbs() const;
+    [[nodiscard]] std::vector<Index> const& get_plane_indices() const;
+    [[nodiscard]] std::vector<Vertex> const& get_plane_vertices() const;
+    [[nodiscard]] std::array<RaytracingInstanceDesc, num_blas> const& get_instance_descs() const;
+
+private:
+    void initialize_materials();
+    void initialize_camera();
+    void initialize_lights();
+    void build_procedural_geometry_aabbs();
+    void build_plane_geometry();
+    void build_instance_descs();
+    void update_aabb_primitive_attributes(float const animation_time);
+    void update_aabbs(float const animation_time);
+
+    // Largest safe sphere tracing step scale of every signed distance primitive, from its distance function's
+    // Lipschitz bound and its transform's scale.
+    void estimate_step_scales();
+
+    float m_aspect_ratio = 1.0f;
+
+    // Application state
+    float m_animate_geometry_time = 0.0f;
+    bool m_animate_geometry = true;
+    bool m_animate_camera = false;
+    bool m_animate_light = false;
+    XMVECTOR m_eye = {};
+    XMVECTOR m_at = {};
+    XMVECTOR m_up = {};
+
+    SceneConstantBuffer m_scene_cb = {};
+    std::array<PrimitiveInstancePerFrameBuffer, IntersectionShaderType::TOTAL_PRIMITIVE_COUNT> m_aabb_primitive_attributes = {};
+
+    // Root constants
+    PrimitiveConstantBuffer m_plane_material_cb = {};
+    std::array<PrimitiveConstantBuffer, IntersectionShaderType::TOTAL_PRIMITIVE_COUNT> m_aabb_material_cb = {};
+
+    // Geometry
+    // Every primitive is laid out in a fixed slot, which its local <-1, 1> cube is centered on.
+    // Its AABB is the part of the slot its geometry can reach in the current frame.
+    std::vector<RaytracingAABB> m_aabb_slots = {};
+    std::vector<RaytracingAABB> m_aabbs = {};
+    std::vector<Index> m_plane_indices = {};
+    std::vector<Vertex> m_plane_vertices = {};
+
+    std::array<RaytracingInstanceDesc, num_blas> m_instance_descs = {};
+};
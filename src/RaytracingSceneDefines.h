@@ -2,6 +2,8 @@
 
 #include "ConstantBuffers.h"
 
+#include <algorithm>
+
 namespace GlobalRootSignature::Slot
 {
 
@@ -139,5 +141,6 @@ inline UINT per_primitive_type_count(Enum const type)
 
 //static const UINT MAX_PER_PRIMITIVE_TYPE_COUNT =
 //    std::max(AnalyticPrimitive::Count, std::max(VolumetricPrimitive::Count, SignedDistancePrimitive::Count));
-static constexpr UINT TOTAL_PRIMITIVE_COUNT = AnalyticPrimitive::Count + VolumetricPrimitive::Count + SignedDistancePrimitive::Count;
+static constexpr UINT TOTAL_PRIMITIVE_COUNT = static_cast<UINT>(AnalyticPrimitive::Count) + static_cast<UINT>(VolumetricPrimitive::Count)
+                                            + static_cast<UINT>(SignedDistancePrimitive::Count);
 }
@@ -33,6 +33,10 @@ wchar_t const* Renderer::closest_hit_shader_names[] = {
 };
 wchar_t const* Renderer::miss_shader_names[] = {L"MyMissShader", L"MyMissShader_ShadowRay"};
 
+// Procedural primitives move every frame, so the acceleration structures over them are refit in place rather than rebuilt.
+static D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAGS constexpr updatable_as_build_flags =
+    D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_PREFER_FAST_TRACE | D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_ALLOW_UPDATE;
+
 // Hit groups.
 wchar_t const* Renderer::hit_group_names_triangle_geometry[] = {L"MyHitGroup_Triangle", L"MyHitGroup_Triangle_ShadowRay"};
 wchar_t const* Renderer::hit_group_names_aabb_geometry[][RayType::Count] = {
@@ -43,7 +47,6 @@ wchar_t const* Renderer::hit_group_names_aabb_geometry[][RayType::Count] = {
 
 Renderer::Renderer(u32 const width, u32 const height, std::wstring const& name)
 {
-    m_animate_geometry = true;
     m_window = std::make_unique<Window>(this, width, height, name);
     Window::set_instance(m_window.get());
 }
@@ -88,35 +91,15 @@ void Renderer::on_update()
     u32 const frame_index = m_device_resources->get_current_frame_index();
     u32 const previous_frame_index = m_device_resources->get_previous_frame_index();
 
-    // Rotate the camera around Y axis.
-    if (m_animate_camera)
-    {
-        float constexpr seconds_to_rotate_around = 48.0f;
-        float const angle_to_rotate_by = 360.0f * (elapsed_time / seconds_to_rotate_around);
-        XMMATRIX const rotate = XMMatrixRotationY(XMConvertToRadians(angle_to_rotate_by));
-        m_eye = XMVector3Transform(m_eye, rotate);
-        m_up = XMVector3Transform(m_up, rotate);
-        m_at = XMVector3Transform(m_at, rotate);
-        update_camera_matrices();
-    }
+    m_scene.update(elapsed_time);
 
-    // Rotate the second light around Y axis.
-    if (m_animate_light)
+    m_scene_cb.staging = m_scene.get_scene_cb();
+    m_scene_cb.staging.pixel_spread_angle = m_scene.calculate_pixel_spread_angle(m_window->get_width(), m_window->get_height());
+    for (u32 i = 0; i < IntersectionShaderType::TOTAL_PRIMITIVE_COUNT; i++)
     {
-        float constexpr seconds_to_rotate_around = 8.0f;
-        float const angle_to_rotate_by = -360.0f * (elapsed_time / seconds_to_rotate_around);
-        XMMATRIX const rotate = XMMatrixRotationY(XMConvertToRadians(angle_to_rotate_by));
-        m_scene_cb->light_position = XMVector3Transform(m_scene_cb->light_position, rotate);
+        m_aabb_primitive_attribute_buffer[i] = m_scene.get_aabb_primitive_attributes(i);
+        m_aabb_buffer[i].aabb = m_scene.get_aabbs()[i];
     }
-
-    // Transform the procedular geometry.
-    if (m_animate_geometry)
-    {
-        m_animate_geometry_time += elapsed_time;
-    }
-
-    update_aabb_primitive_attributes(m_animate_geometry_time);
-    m_scene_cb->elapsed_time = m_animate_geometry_time;
 }
 
 void Renderer::on_render()
@@ -196,163 +179,9 @@ void Renderer::on_device_restored()
 
 void Renderer::initialize_scene()
 {
-    u32 const frame_index = m_device_resources->get_current_frame_index();
-
-    // Setup materials.
-    {
-        auto set_attributes = [&](u32 primitive_index, XMFLOAT4 const& albedo, float reflectance_coefficient = 0.0f,
-                                  float diffuse_coefficient = 0.9f, float specular_coefficient = 0.7f, float specular_power = 50.0f,
-                                  float step_scale = 1.0f) {
-            auto& attributes = m_aabb_material_cb[primitive_index];
-            attributes.albedo = albedo;
-            attributes.reflectance_coefficient = reflectance_coefficient;
-            attributes.diffuse_coefficient = diffuse_coefficient;
-            attributes.specular_coefficient = specular_coefficient;
-            attributes.specular_power = specular_power;
-            attributes.step_scale = step_scale;
-        };
-
-        m_plane_material_cb = {XMFLOAT4(0.9f, 0.9f, 0.9f, 1.0f), 0.25f, 1, 0.4f, 50, 1};
-
-        // Albedos
-        auto constexpr green = XMFLOAT4(0.1f, 1.0f, 0.5f, 1.0f);
-        auto constexpr red = XMFLOAT4(1.0f, 0.5f, 0.5f, 1.0f);
-        auto constexpr yellow = XMFLOAT4(1.0f, 1.0f, 0.5f, 1.0f);
-
-        u32 offset = 0;
-
-        // Analytic primitives.
-        {
-            using namespace AnalyticPrimitive;
-            set_attributes(offset + AABB, red);
-            set_attributes(offset + Spheres, CHROMIUM_REFLECTANCE, 1);
-            offset += AnalyticPrimitive::Count;
-        }
-
-        // Volumetric primitives.
-        {
-            using namespace VolumetricPrimitive;
-            set_attributes(offset + Metaballs, CHROMIUM_REFLECTANCE, 1);
-            offset += VolumetricPrimitive::Count;
-        }
-
-        // Signed distance primitives.
-        {
-            using namespace SignedDistancePrimitive;
-            set_attributes(offset + MiniSpheres, green);
-            set_attributes(offset + IntersectedRoundCube, green);
-            set_attributes(offset + SquareTorus, CHROMIUM_REFLECTANCE, 1);
-            set_attributes(offset + TwistedTorus, yellow, 0, 1.0f, 0.7f, 50, 0.5f);
-            set_attributes(offset + Cog, yellow, 0, 1.0f, 0.1f, 2);
-            set_attributes(offset + Cylinder, red);
-            set_attributes(offset + FractalPyramid, green, 0, 1, 0.1f, 4, 0.8f);
-        }
-    }
-
-    // Setup camera.
-    {
-        // Initialize the view and projection inverse matrices.
-        m_eye = {0.0f, 5.3f, -17.0f, 1.0f};
-        m_at = {0.0f, 0.0f, 0.0f, 1.0f};
-        XMVECTOR constexpr right = {1.0f, 0.0f, 0.0f, 0.0f};
-
-        XMVECTOR const direction = XMVector4Normalize(m_at - m_eye);
-        m_up = XMVector3Normalize(XMVector3Cross(direction, right));
-
-        // Rotate camera around Y axis.
-        XMMATRIX const rotate = XMMatrixRotationY(XMConvertToRadians(45.0f));
-        m_eye = XMVector3Transform(m_eye, rotate);
-        m_up = XMVector3Transform(m_up, rotate);
-
-        update_camera_matrices();
-    }
-
-    // Setup lights.
-    {
-        // Initialize the lighting parameters.
-        XMFLOAT4 light_position;
-        XMFLOAT4 light_ambient_color;
-        XMFLOAT4 light_diffuse_color;
-
-        light_position = {0.0f, 18.0f, -20.0f, 0.0f};
-        m_scene_cb->light_position = XMLoadFloat4(&light_position);
-
-        light_ambient_color = {0.25f, 0.25f, 0.25f, 1.0f};
-        m_scene_cb->light_ambient_color = XMLoadFloat4(&light_ambient_color);
-
-        float constexpr d = 0.6f;
-        light_diffuse_color = {d, d, d, 1.0f};
-        m_scene_cb->light_diffuse_color = XMLoadFloat4(&light_diffuse_color);
-    }
-}
-
-void Renderer::update_camera_matrices()
-{
-    auto const frame_index = m_device_resources->get_current_frame_index();
-
-    m_scene_cb->camera_position = m_eye;
-    float constexpr fov_angle_y = 45.0f;
-    XMMATRIX const view = XMMatrixLookAtLH(m_eye, m_at, m_up);
-    XMMATRIX const proj = XMMatrixPerspectiveFovLH(XMConvertToRadians(fov_angle_y), m_window->get_aspect_ratio(), 0.01f, 125.0f);
-    XMMATRIX const view_proj = view * proj;
-
-    m_scene_cb->projection_to_world = XMMatrixInverse(nullptr, view_proj);
-}
-
-void Renderer::update_aabb_primitive_attributes(float const animation_time)
-{
-    XMMATRIX const m_identity = XMMatrixIdentity();
-
-    XMMATRIX const m_scale_15_y = XMMatrixScaling(1.0f, 1.5f, 1.0f);
-    XMMATRIX const m_scale_15 = XMMatrixScaling(1.5f, 1.5f, 1.5f);
-
-    XMMATRIX const m_scale_3 = XMMatrixScaling(3.0f, 3.0f, 3.0f);
-
-    XMMATRIX const m_rotation = XMMatrixRotationY(-2.0f * animation_time);
-
-    // Apply scale, rotation and translation transforms.
-    // The intersection shader tests in this sample work with local space, so here
-    // we apply the BLAS object space translation that was passed to geometry descs.
-    auto set_transform_for_aabb = [&](u32 const primitive_index, XMMATRIX const& m_scale, XMMATRIX const& m_rotation) {
-        XMVECTOR const v_translation = 0.5f
-                                     * (XMLoadFloat3(reinterpret_cast<XMFLOAT3*>(&m_aabbs[primitive_index].MinX))
-                                        + XMLoadFloat3(reinterpret_cast<XMFLOAT3*>(&m_aabbs[primitive_index].MaxX)));
-        XMMATRIX const m_translation = XMMatrixTranslationFromVector(v_translation);
-
-        XMMATRIX const m_transform = m_scale * m_rotation * m_translation;
-        m_aabb_primitive_attribute_buffer[primitive_index].local_space_to_bottom_level_as = m_transform;
-        m_aabb_primitive_attribute_buffer[primitive_index].bottom_level_as_to_local_space = XMMatrixInverse(nullptr, m_transform);
-    };
-
-    u32 offset = 0;
-
-    // Analytic primitives.
-    {
-        using namespace AnalyticPrimitive;
-        set_transform_for_aabb(offset + AABB, m_scale_15_y, m_identity);
-        set_transform_for_aabb(offset + Spheres, m_scale_15, m_rotation);
-        offset += AnalyticPrimitive::Count;
-    }
-
-    // Volumetric primitives.
-    {
-        using namespace VolumetricPrimitive;
-        set_transform_for_aabb(offset + Metaballs, m_scale_15, m_rotation);
-        offset += VolumetricPrimitive::Count;
-    }
+    m_scene.initialize(m_window->get_aspect_ratio());
 
-    // Signed distance primitives.
-    {
-        using namespace SignedDistancePrimitive;
-
-        set_transform_for_aabb(offset + MiniSpheres, m_identity, m_identity);
-        set_transform_for_aabb(offset + IntersectedRoundCube, m_identity, m_identity);
-        set_transform_for_aabb(offset + SquareTorus, m_scale_15, m_identity);
-        set_transform_for_aabb(offset + TwistedTorus, m_identity, m_rotation);
-        set_transform_for_aabb(offset + Cog, m_identity, m_rotation);
-        set_transform_for_aabb(offset + Cylinder, m_scale_15_y, m_identity);
-        set_transform_for_aabb(offset + FractalPyramid, m_scale_3, m_identity);
-    }
+    m_scene_cb.staging = m_scene.get_scene_cb();
 }
 
 void Renderer::create_constant_buffers()
@@ -443,6 +272,8 @@ void Renderer::do_raytracing()
                                                        m_aabb_primitive_attribute_buffer.GpuVirtualAddress(frame_index));
     }
 
+    update_acceleration_structures();
+
     // Bind the heaps, acceleration structure and dispatch rays.
     D3D12_DISPATCH_RAYS_DESC dispatch_desc = {};
     set_common_pipeline_state(command_list);
@@ -485,54 +316,20 @@ void Renderer::build_procedural_geometry_aabbs()
 {
     auto const device = m_device_resources->get_d3d_device();
 
-    // Set up AABBs on a grid.
-    {
-        auto constexpr aabb_grid = XMINT3(4, 1, 4);
-        XMFLOAT3 constexpr base_position = {
-            -(aabb_grid.x * aabb_width + (aabb_grid.x - 1) * aabb_distance) / 2.0f,
-            -(aabb_grid.y * aabb_width + (aabb_grid.y - 1) * aabb_distance) / 2.0f,
-            -(aabb_grid.z * aabb_width + (aabb_grid.z - 1) * aabb_distance) / 2.0f,
-        };
-
-        auto stride = XMFLOAT3(aabb_width + aabb_distance, aabb_width + aabb_distance, aabb_width + aabb_distance);
-        auto initialize_aabb = [&](auto const& offset_index, auto const& size) {
-            return D3D12_RAYTRACING_AABB {
-                base_position.x + offset_index.x * stride.x,          base_position.y + offset_index.y * stride.y,
-                base_position.z + offset_index.z * stride.z,          base_position.x + offset_index.x * stride.x + size.x,
-                base_position.y + offset_index.y * stride.y + size.y, base_position.z + offset_index.z * stride.z + size.z,
-            };
-        };
-        m_aabbs.resize(IntersectionShaderType::TOTAL_PRIMITIVE_COUNT);
-        u32 offset = 0;
-
-        // Analytic primitives.
-        {
-            using namespace AnalyticPrimitive;
-            m_aabbs[offset + AABB] = initialize_aabb(XMINT3(3, 0, 0), XMFLOAT3(2, 3, 2));
-            m_aabbs[offset + Spheres] = initialize_aabb(XMFLOAT3(2.25f, 0, 0.75f), XMFLOAT3(3, 3, 3));
-            offset += AnalyticPrimitive::Count;
-        }
+    u32 const frame_count = m_device_resources->get_back_buffer_count();
 
-        // Volumetric primitives.
-        {
-            using namespace VolumetricPrimitive;
-            m_aabbs[offset + Metaballs] = initialize_aabb(XMINT3(0, 0, 0), XMFLOAT3(3, 3, 3));
-            offset += VolumetricPrimitive::Count;
-        }
+    static_assert(sizeof(RaytracingAABB) == sizeof(D3D12_RAYTRACING_AABB));
+    static_assert(sizeof(PaddedRaytracingAABB) % D3D12_RAYTRACING_AABB_BYTE_ALIGNMENT == 0);
 
-        // Signed distance primitives.
-        {
-            using namespace SignedDistancePrimitive;
-            m_aabbs[offset + MiniSpheres] = initialize_aabb(XMINT3(2, 0, 0), XMFLOAT3(2, 2, 2));
-            m_aabbs[offset + TwistedTorus] = initialize_aabb(XMINT3(0, 0, 1), XMFLOAT3(2, 2, 2));
-            m_aabbs[offset + IntersectedRoundCube] = initialize_aabb(XMINT3(0, 0, 2), XMFLOAT3(2, 2, 2));
-            m_aabbs[offset + SquareTorus] = initialize_aabb(XMFLOAT3(0.75f, -0.1f, 2.25f), XMFLOAT3(3, 3, 3));
-            m_aabbs[offset + Cog] = initialize_aabb(XMINT3(1, 0, 0), XMFLOAT3(2, 2, 2));
-            m_aabbs[offset + Cylinder] = initialize_aabb(XMINT3(0, 0, 3), XMFLOAT3(2, 3, 2));
-            m_aabbs[offset + FractalPyramid] = initialize_aabb(XMINT3(2, 0, 2), XMFLOAT3(6, 6, 6));
-        }
+    m_aabb_buffer.Create(device, IntersectionShaderType::TOTAL_PRIMITIVE_COUNT, frame_count, L"AABBs");
+    for (u32 i = 0; i < IntersectionShaderType::TOTAL_PRIMITIVE_COUNT; i++)
+    {
+        m_aabb_buffer[i].aabb = m_scene.get_aabbs()[i];
+    }
 
-        AllocateUploadBuffer(device, m_aabbs.data(), m_aabbs.size() * sizeof(m_aabbs[0]), &m_aabb_buffer.resource);
+    for (u32 frame_index = 0; frame_index < frame_count; frame_index++)
+    {
+        m_aabb_buffer.CopyStagingToGpu(frame_index);
     }
 }
 
@@ -540,24 +337,16 @@ void Renderer::build_plane_geometry()
 {
     auto const device = m_device_resources->get_d3d_device();
 
-    // Plane indices.
-    Index indices[] = {
-        3, 1, 0, 2, 1, 3,
-    };
-
-    // Cube vertices positions and corresponding triangle normals.
-    std::array<Vertex, 4> vertices = {
-        Vertex {XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(0.0f, 1.0f, 0.0f)},
-        {XMFLOAT3(1.0f, 0.0f, 0.0f), XMFLOAT3(0.0f, 1.0f, 0.0f)},
-        {XMFLOAT3(1.0f, 0.0f, 1.0f), XMFLOAT3(0.0f, 1.0f, 0.0f)},
-        {XMFLOAT3(0.0f, 0.0f, 1.0f), XMFLOAT3(0.0f, 1.0f, 0.0f)},
-    };
+    // Plane indices and vertices.
+    std::vector<RaytracingScene::Index> indices = m_scene.get_plane_indices();
+    std::vector<Vertex> vertices = m_scene.get_plane_vertices();
+    u32 const indices_size = static_cast<u32>(indices.size() * sizeof(indices[0]));
 
-    AllocateUploadBuffer(device, indices, sizeof(indices), &m_index_buffer.resource);
-    AllocateUploadBuffer(device, vertices.data(), sizeof(vertices), &m_vertex_buffer.resource);
+    AllocateUploadBuffer(device, indices.data(), indices_size, &m_index_buffer.resource);
+    AllocateUploadBuffer(device, vertices.data(), vertices.size() * sizeof(vertices[0]), &m_vertex_buffer.resource);
 
     // Vertex buffer is passed to the shader along with index buffer as a descriptor range.
-    u32 const descriptor_index_ib = create_buffer_srv(&m_index_buffer, sizeof(indices) / 4, 0);
+    u32 const descriptor_index_ib = create_buffer_srv(&m_index_buffer, indices_size / 4, 0);
     u32 const descriptor_index_vb = create_buffer_srv(&m_vertex_buffer, vertices.size(), sizeof(vertices[0]));
 
     // Vertex Buffer descriptor index must follow that of Index Buffer descriptor index.
@@ -565,7 +354,7 @@ void Renderer::build_plane_geometry()
 }
 
 void Renderer::build_geometry_descs_for_bottom_level_as(
-    std::array<std::vector<D3D12_RAYTRACING_GEOMETRY_DESC>, BottomLevelASType::Count>& geometry_descs)
+    std::array<std::vector<D3D12_RAYTRACING_GEOMETRY_DESC>, BottomLevelASType::Count>& geometry_descs, u32 const frame_index)
 {
     // Mark the geometry as opaque.
     // PERFORMANCE TIP: Mark geometry as opaque whenever applicable as it can enable important ray processing optimizations.
@@ -582,7 +371,7 @@ void Renderer::build_geometry_descs_for_bottom_level_as(
         geometry_desc = {};
         geometry_desc.Type = D3D12_RAYTRACING_GEOMETRY_TYPE_TRIANGLES;
         geometry_desc.Triangles.IndexBuffer = m_index_buffer.resource->GetGPUVirtualAddress();
-        geometry_desc.Triangles.IndexCount = static_cast<UINT>(m_index_buffer.resource->GetDesc().Width) / sizeof(Index);
+        geometry_desc.Triangles.IndexCount = static_cast<UINT>(m_index_buffer.resource->GetDesc().Width) / sizeof(RaytracingScene::Index);
         geometry_desc.Triangles.IndexFormat = DXGI_FORMAT_R16_UINT;
         geometry_desc.Triangles.VertexFormat = DXGI_FORMAT_R32G32B32_FLOAT;
         geometry_desc.Triangles.VertexCount = static_cast<UINT>(m_vertex_buffer.resource->GetDesc().Width) / sizeof(Vertex);
@@ -608,7 +397,7 @@ void Renderer::build_geometry_descs_for_bottom_level_as(
         for (u32 i = 0; i < IntersectionShaderType::TOTAL_PRIMITIVE_COUNT; i++)
         {
             auto& geometry_desc = geometry_descs[BottomLevelASType::AABB][i];
-            geometry_desc.AABBs.AABBs.StartAddress = m_aabb_buffer.resource->GetGPUVirtualAddress() + i * sizeof(D3D12_RAYTRACING_AABB);
+            geometry_desc.AABBs.AABBs.StartAddress = m_aabb_buffer.GpuVirtualAddress(frame_index) + i * sizeof(PaddedRaytracingAABB);
         }
     }
 }
@@ -633,8 +422,10 @@ AccelerationStructureBuffers Renderer::build_bottom_level_as(std::vector<D3D12_R
     m_dxr_device->GetRaytracingAccelerationStructurePrebuildInfo(&bottom_level_inputs, &bottom_level_prebuild_info);
     assert(bottom_level_prebuild_info.ResultDataMaxSizeInBytes > 0);
 
-    // Create a scratch buffer.
-    AllocateUAVBuffer(device, bottom_level_prebuild_info.ScratchDataSizeInBytes, &scratch, D3D12_RESOURCE_STATE_UNORDERED_ACCESS,
+    // Create a scratch buffer, large enough for updates too when the AS allows them.
+    u64 const bottom_level_scratch_size =
+        std::max(bottom_level_prebuild_info.ScratchDataSizeInBytes, bottom_level_prebuild_info.UpdateScratchDataSizeInBytes);
+    AllocateUAVBuffer(device, bottom_level_scratch_size, &scratch, D3D12_RESOURCE_STATE_UNORDERED_ACCESS,
                       L"ScratchResource");
 
     // Allocate resources for acceleration structures.
@@ -679,13 +470,15 @@ AccelerationStructureBuffers Renderer::build_top_level_as(AccelerationStructureB
     top_level_inputs.Type = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL;
     top_level_inputs.DescsLayout = D3D12_ELEMENTS_LAYOUT_ARRAY;
     top_level_inputs.Flags = build_flags;
-    top_level_inputs.NumDescs = num_blas;
+    top_level_inputs.NumDescs = RaytracingScene::num_blas;
 
     D3D12_RAYTRACING_ACCELERATION_STRUCTURE_PREBUILD_INFO top_level_prebuild_info = {};
     m_dxr_device->GetRaytracingAccelerationStructurePrebuildInfo(&top_level_inputs, &top_level_prebuild_info);
     ThrowIfFalse(top_level_prebuild_info.ResultDataMaxSizeInBytes > 0);
 
-    AllocateUAVBuffer(device, top_level_prebuild_info.ScratchDataSizeInBytes, &scratch, D3D12_RESOURCE_STATE_UNORDERED_ACCESS,
+    u64 const top_level_scratch_size =
+        std::max(top_level_prebuild_info.ScratchDataSizeInBytes, top_level_prebuild_info.UpdateScratchDataSizeInBytes);
+    AllocateUAVBuffer(device, top_level_scratch_size, &scratch, D3D12_RESOURCE_STATE_UNORDERED_ACCESS,
                       L"ScratchResource");
 
     // Allocate resources for acceleration structures.
@@ -734,51 +527,20 @@ void Renderer::build_bottom_level_as_instance_descs(BLASPtrType* bottom_level_as
 {
     auto const device = m_device_resources->get_d3d_device();
 
-    std::vector<InstanceDescType> instance_descs = {};
-    instance_descs.resize(num_blas);
-
-    // Width of a bottom-level AS geometry.
-    // Make the plane a little larger than the actual number of primitives in each dimension.
-    auto constexpr num_aabb = XMUINT3(700, 1, 700);
-    auto constexpr f_width =
-        XMFLOAT3(num_aabb.x * aabb_width + (num_aabb.x - 1) * aabb_distance, num_aabb.y * aabb_width + (num_aabb.y - 1) * aabb_distance,
-                 num_aabb.z * aabb_width + (num_aabb.z - 1) * aabb_distance);
-    const XMVECTOR v_width = XMLoadFloat3(&f_width);
+    auto const& scene_instance_descs = m_scene.get_instance_descs();
 
-    // Bottom-level AS with a single plane.
-    {
-        auto& instance_desc = instance_descs[BottomLevelASType::Triangle];
-        instance_desc = {};
-        instance_desc.InstanceMask = 1;
-        instance_desc.InstanceContributionToHitGroupIndex = 0;
-        instance_desc.AccelerationStructure = bottom_level_as_addresses[BottomLevelASType::Triangle];
-
-        // Calculate transformation matrix.
-        auto constexpr base_position = XMFLOAT3(-0.35f, 0.0f, -0.35f);
-        XMVECTOR const v_base_position = v_width * XMLoadFloat3(&base_position);
-
-        // Scale in XZ dimensions.
-        XMMATRIX const m_scale = XMMatrixScaling(f_width.x, f_width.y, f_width.z);
-        XMMATRIX const m_translation = XMMatrixTranslationFromVector(v_base_position);
-        XMMATRIX const m_transform = m_scale * m_translation;
-        XMStoreFloat3x4(reinterpret_cast<XMFLOAT3X4*>(instance_desc.Transform), m_transform);
-    }
+    std::vector<InstanceDescType> instance_descs = {};
+    instance_descs.resize(scene_instance_descs.size());
 
-    // Create instanced bottom-level AS with procedural geometry AABBs.
-    // Instances share all the data, except for a transform.
+    for (u32 i = 0; i < scene_instance_descs.size(); i++)
     {
-        auto& instance_desc = instance_descs[BottomLevelASType::AABB];
+        auto& instance_desc = instance_descs[i];
+        auto const& scene_instance_desc = scene_instance_descs[i];
         instance_desc = {};
-        instance_desc.InstanceMask = 1;
-
-        // Set hit group offset to beyond the shader records for the triangle AABB.
-        instance_desc.InstanceContributionToHitGroupIndex = BottomLevelASType::AABB * RayType::Count;
-        instance_desc.AccelerationStructure = bottom_level_as_addresses[BottomLevelASType::AABB];
-
-        // Move all AABBS above the ground plane.
-        auto constexpr y_translate = XMFLOAT3(0.0f, aabb_width / 2.0f, 0.0f);
-        XMMATRIX const m_translation = XMMatrixTranslationFromVector(XMLoadFloat3(&y_translate));
-        XMStoreFloat3x4(reinterpret_cast<XMFLOAT3X4*>(instance_desc.Transform), m_translation);
+        instance_desc.InstanceMask = scene_instance_desc.instance_mask;
+        instance_desc.InstanceContributionToHitGroupIndex = scene_instance_desc.instance_contribution_to_hit_group_index;
+        instance_desc.AccelerationStructure = bottom_level_as_addresses[scene_instance_desc.bottom_level_as_type];
+        memcpy(instance_desc.Transform, &scene_instance_desc.transform, sizeof(instance_desc.Transform));
     }
 
     u64 const buffer_size = static_cast<u64>(instance_descs.size() * sizeof(instance_descs[0]));
@@ -799,13 +561,11 @@ void Renderer::build_acceleration_structures()
     std::array<AccelerationStructureBuffers, BottomLevelASType::Count> bottom_level_as = {};
     std::array<std::vector<D3D12_RAYTRACING_GEOMETRY_DESC>, BottomLevelASType::Count> geometry_descs = {};
     {
-        build_geometry_descs_for_bottom_level_as(geometry_descs);
+        build_geometry_descs_for_bottom_level_as(geometry_descs, m_device_resources->get_current_frame_index());
 
         // Build all bottom-level AS.
-        for (u32 i = 0; i < BottomLevelASType::Count; i++)
-        {
-            bottom_level_as[i] = build_bottom_level_as(geometry_descs[i]);
-        }
+        bottom_level_as[BottomLevelASType::Triangle] = build_bottom_level_as(geometry_descs[BottomLevelASType::Triangle]);
+        bottom_level_as[BottomLevelASType::AABB] = build_bottom_level_as(geometry_descs[BottomLevelASType::AABB], updatable_as_build_flags);
     }
 
     // Batch all resource barriers for bottom-level AS builds.
@@ -818,7 +578,7 @@ void Renderer::build_acceleration_structures()
     command_list->ResourceBarrier(BottomLevelASType::Count, resource_barriers.data());
 
     // Build top-level AS.
-    AccelerationStructureBuffers const top_level_as = build_top_level_as(bottom_level_as.data());
+    AccelerationStructureBuffers const top_level_as = build_top_level_as(bottom_level_as.data(), updatable_as_build_flags);
 
     // Kick off acceleration structure construction.
     m_device_resources->execute_command_list();
@@ -832,6 +592,63 @@ void Renderer::build_acceleration_structures()
         m_bottom_level_as[i] = bottom_level_as[i].accelerationStructure;
     }
     m_top_level_as = top_level_as.accelerationStructure;
+
+    m_aabb_bottom_level_as_scratch = bottom_level_as[BottomLevelASType::AABB].scratch;
+    m_top_level_as_scratch = top_level_as.scratch;
+    m_top_level_as_instance_descs = top_level_as.instanceDesc;
+}
+
+// Refit the AABB bottom-level AS to this frame's AABBs, then the top-level AS to it.
+// Updates keep the tree topology, which only degrades slowly as the few animated primitives only move within their slots.
+void Renderer::update_acceleration_structures()
+{
+    u32 const frame_index = m_device_resources->get_current_frame_index();
+    auto const command_list = m_device_resources->get_command_list();
+
+    m_aabb_buffer.CopyStagingToGpu(frame_index);
+
+    std::array<std::vector<D3D12_RAYTRACING_GEOMETRY_DESC>, BottomLevelASType::Count> geometry_descs = {};
+    build_geometry_descs_for_bottom_level_as(geometry_descs, frame_index);
+
+    // Bottom-level AS update.
+    {
+        ID3D12Resource* const bottom_level_as = m_bottom_level_as[BottomLevelASType::AABB].Get();
+
+        D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC bottom_level_build_desc = {};
+        D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_INPUTS& bottom_level_inputs = bottom_level_build_desc.Inputs;
+        bottom_level_inputs.Type = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL;
+        bottom_level_inputs.DescsLayout = D3D12_ELEMENTS_LAYOUT_ARRAY;
+        bottom_level_inputs.Flags = updatable_as_build_flags | D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_PERFORM_UPDATE;
+        bottom_level_inputs.NumDescs = static_cast<u32>(geometry_descs[BottomLevelASType::AABB].size());
+        bottom_level_inputs.pGeometryDescs = geometry_descs[BottomLevelASType::AABB].data();
+        bottom_level_build_desc.SourceAccelerationStructureData = bottom_level_as->GetGPUVirtualAddress();
+        bottom_level_build_desc.DestAccelerationStructureData = bottom_level_as->GetGPUVirtualAddress();
+        bottom_level_build_desc.ScratchAccelerationStructureData = m_aabb_bottom_level_as_scratch->GetGPUVirtualAddress();
+
+        m_dxr_command_list->BuildRaytracingAccelerationStructure(&bottom_level_build_desc, 0, nullptr);
+
+        CD3DX12_RESOURCE_BARRIER const barrier = CD3DX12_RESOURCE_BARRIER::UAV(bottom_level_as);
+        command_list->ResourceBarrier(1, &barrier);
+    }
+
+    // Top-level AS update. Instances do not move, only the bounds of the bottom-level AS they reference.
+    {
+        D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC top_level_build_desc = {};
+        D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_INPUTS& top_level_inputs = top_level_build_desc.Inputs;
+        top_level_inputs.Type = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL;
+        top_level_inputs.DescsLayout = D3D12_ELEMENTS_LAYOUT_ARRAY;
+        top_level_inputs.Flags = updatable_as_build_flags | D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_PERFORM_UPDATE;
+        top_level_inputs.NumDescs = RaytracingScene::num_blas;
+        top_level_inputs.InstanceDescs = m_top_level_as_instance_descs->GetGPUVirtualAddress();
+        top_level_build_desc.SourceAccelerationStructureData = m_top_level_as->GetGPUVirtualAddress();
+        top_level_build_desc.DestAccelerationStructureData = m_top_level_as->GetGPUVirtualAddress();
+        top_level_build_desc.ScratchAccelerationStructureData = m_top_level_as_scratch->GetGPUVirtualAddress();
+
+        m_dxr_command_list->BuildRaytracingAccelerationStructure(&top_level_build_desc, 0, nullptr);
+
+        CD3DX12_RESOURCE_BARRIER const barrier = CD3DX12_RESOURCE_BARRIER::UAV(m_top_level_as.Get());
+        command_list->ResourceBarrier(1, &barrier);
+    }
 }
 
 // Build shader tables.
@@ -942,7 +759,7 @@ void Renderer::build_shader_tables()
         // Triangle geometry hit groups.
         {
             LocalRootSignature::Triangle::RootArguments root_args = {};
-            root_args.material_cb = m_plane_material_cb;
+            root_args.material_cb = m_scene.get_plane_material_cb();
 
             for (auto& hit_group_shader_id : hit_group_shader_identifiers_triangle_geometry)
             {
@@ -963,7 +780,7 @@ void Renderer::build_shader_tables()
                 // Primitives for each intersection shader.
                 for (u32 primitive_index = 0; primitive_index < num_primitive_types; primitive_index++, instance_index++)
                 {
-                    root_args.material_cb = m_aabb_material_cb[instance_index];
+                    root_args.material_cb = m_scene.get_aabb_material_cb(instance_index);
                     root_args.aabb_cb.instance_index = instance_index;
                     root_args.aabb_cb.primitive_type = primitive_index;
 
@@ -1300,7 +1117,8 @@ void Renderer::create_window_size_dependent_resources()
 {
     create_raytracing_output_resource();
 
-    update_camera_matrices();
+    m_scene.set_aspect_ratio(m_window->get_aspect_ratio());
+    m_scene_cb.staging = m_scene.get_scene_cb();
 }
 
 void Renderer::serialize_and_create_raytracing_root_signature(D3D12_ROOT_SIGNATURE_DESC const& desc,
@@ -1389,10 +1207,13 @@ void Renderer::release_device_dependent_resources()
     m_aabb_primitive_attribute_buffer.Release();
     m_index_buffer.resource.Reset();
     m_vertex_buffer.resource.Reset();
-    m_aabb_buffer.resource.Reset();
+    m_aabb_buffer.Release();
 
     ResetComPtrArray(&m_bottom_level_as);
     m_top_level_as.Reset();
+    m_aabb_bottom_level_as_scratch.Reset();
+    m_top_level_as_scratch.Reset();
+    m_top_level_as_instance_descs.Reset();
 
     m_raytracing_output.Reset();
     m_raytracing_output_resource_uav_descriptor_heap_index = UINT_MAX;
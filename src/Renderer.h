@@ -4,6 +4,7 @@
 #include "ConstantBuffers.h"
 #include "DeviceResources.h"
 #include "PerformanceTimers.h"
+#include "RaytracingScene.h"
 #include "RaytracingSceneDefines.h"
 #include "StepTimer.h"
 
@@ -42,9 +43,13 @@ private:
         D3D12_GPU_DESCRIPTOR_HANDLE gpu_descriptor_handle;
     };
 
+    // D3D12_RAYTRACING_AABB padded to the 16 byte aligned elements of a structured buffer.
+    struct alignas(16) PaddedRaytracingAABB
+    {
+        RaytracingAABB aabb;
+    };
+
     void initialize_scene();
-    void update_camera_matrices();
-    void update_aabb_primitive_attributes(float const animation_time);
     void create_constant_buffers();
     void create_aabb_primitive_attributes_buffers();
 
@@ -56,7 +61,7 @@ private:
     void build_procedural_geometry_aabbs();
     void build_plane_geometry();
     void build_geometry_descs_for_bottom_level_as(
-        std::array<std::vector<D3D12_RAYTRACING_GEOMETRY_DESC>, BottomLevelASType::Count>& geometry_descs);
+        std::array<std::vector<D3D12_RAYTRACING_GEOMETRY_DESC>, BottomLevelASType::Count>& geometry_descs, u32 const frame_index);
     template<class InstanceDescType, class BLASPtrType>
     void build_bottom_level_as_instance_descs(BLASPtrType* bottom_level_as_addresses, ComPtr<ID3D12Resource>* instance_descs_resource);
     [[nodiscard]] AccelerationStructureBuffers build_bottom_level_as(
@@ -67,6 +72,7 @@ private:
                                                                   D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAGS build_flags =
                                                                       D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_PREFER_FAST_TRACE);
     void build_acceleration_structures();
+    void update_acceleration_structures();
     void build_shader_tables();
 
     void create_device_dependent_resources();
@@ -91,42 +97,29 @@ private:
 
     static u32 constexpr frame_count = 3;
 
-    static u32 constexpr num_blas = 2; // Triangle + AABB bottom-level AS.
-    static float constexpr aabb_width = 2.0f;
-    static float constexpr aabb_distance = 2.0f; // Distance between AABBs.
-
-    // FIXME: Isn't u16 pretty low for an index?
-    typedef u16 Index;
-
     // Application state
     std::array<DX::GPUTimer, GpuTimers::Count> m_gpu_timers = {};
     StepTimer m_timer;
-    float m_animate_geometry_time = 0.0f;
-    bool m_animate_geometry = false;
-    bool m_animate_camera = false;
-    bool m_animate_light = false;
-    XMVECTOR m_eye = {};
-    XMVECTOR m_at = {};
-    XMVECTOR m_up = {};
 
     // TODO: Sample specific
+    RaytracingScene m_scene = {};
     ConstantBuffer<SceneConstantBuffer> m_scene_cb;
     StructuredBuffer<PrimitiveInstancePerFrameBuffer> m_aabb_primitive_attribute_buffer = {};
-    std::vector<D3D12_RAYTRACING_AABB> m_aabbs = {};
-
-    // Root constants
-    PrimitiveConstantBuffer m_plane_material_cb = {};
-    PrimitiveConstantBuffer m_aabb_material_cb[IntersectionShaderType::TOTAL_PRIMITIVE_COUNT];
 
     // Geometry
     D3DBuffer m_index_buffer = {};
     D3DBuffer m_vertex_buffer = {};
-    D3DBuffer m_aabb_buffer = {};
+    StructuredBuffer<PaddedRaytracingAABB> m_aabb_buffer = {}; // Rewritten every frame, one copy per frame in flight.
 
     // Acceleration structure
     std::array<Microsoft::WRL::ComPtr<ID3D12Resource>, BottomLevelASType::Count> m_bottom_level_as = {};
     Microsoft::WRL::ComPtr<ID3D12Resource> m_top_level_as = {};
 
+    // Kept from the build for updating the AABB bottom-level AS and the top-level AS in place every frame.
+    Microsoft::WRL::ComPtr<ID3D12Resource> m_aabb_bottom_level_as_scratch = {};
+    Microsoft::WRL::ComPtr<ID3D12Resource> m_top_level_as_scratch = {};
+    Microsoft::WRL::ComPtr<ID3D12Resource> m_top_level_as_instance_descs = {};
+
     // Raytracing output
     Microsoft::WRL::ComPtr<ID3D12Resource> m_raytracing_output = {};
     D3D12_GPU_DESCRIPTOR_HANDLE m_raytracing_output_resource_uav_gpu_descriptor = {};
@@ -25,13 +25,28 @@
 
 //------------------------------------------------------------------
 
+// Iterations of a fractal whose copies shrink by Scale every iteration, for its smallest copies,
+// of size baseSize * Scale^-iterations, to span FRACTAL_DETAIL_SIZE_IN_PIXELS pixels at position.
+// cameraPosition is in the same space as position. Without a pixel spread angle, the fixed iteration count is used.
+float CalculateFractalIterations(in float3 position, in float3 cameraPosition, in float pixelSpreadAngle, in float baseSize, in float Scale)
+{
+    if (pixelSpreadAngle <= 0)
+    {
+        return FRACTAL_ITERATIONS_COUNT;
+    }
+
+    float footprint = FRACTAL_DETAIL_SIZE_IN_PIXELS * pixelSpreadAngle * length(position - cameraPosition);
+    return clamp(log2(baseSize / footprint) / log2(Scale), FRACTAL_MIN_ITERATIONS_COUNT, FRACTAL_MAX_ITERATIONS_COUNT);
+}
+
 // Returns a signed distance to a recursive pyramid fractal.
 // h = { sin a, cos a, height of a pyramid}.
 // a = pyramid's inner angle between its side plane and a ground plane.
 // Pyramid position - sitting on a ground plane.
 // Pyramid span: {<-a,0,-a>, <a,h.z,a>}, where a = width of base = h.z * h.y / h.x.
 // More info here http://blog.hvidtfeldts.net/index.php/2011/08/distance-estimated-3d-fractals-iii-folding-space/
-float sdFractalPyramid(in float3 position, float3 h, in float Scale = 2.0f)
+// A fractional iteration count folds ceil(iterations) times and blends into the pyramid one fold short by the fraction.
+float sdFractalPyramid(in float3 position, float3 h, in float Scale = 2.0f, in float iterations = FRACTAL_ITERATIONS_COUNT)
 {
     // Set pyramid vertices to AABB's extremities.
     float a = h.z * h.y / h.x;
@@ -41,9 +56,18 @@ float sdFractalPyramid(in float3 position, float3 h, in float Scale = 2.0f)
     float3 v4 = float3(a, 0, a);
     float3 v5 = float3(-a, 0, -a);
 
+    int foldCount = (int) ceil(iterations);
+    float blend = iterations - (foldCount - 1);
+    float coarseDistance = 0;
+
     int n = 0;
-    for (n = 0; n < FRACTAL_ITERATIONS_COUNT; n++)
+    for (n = 0; n < foldCount; n++)
     {
+        if (n == foldCount - 1 && blend < 1)
+        {
+            coarseDistance = sdPyramid(position, h) * pow(Scale, float(-n));
+        }
+
         // Find the closest vertex.
         float dist, d;
         float3 v;
@@ -59,6 +83,7 @@ float sdFractalPyramid(in float3 position, float3 h, in float Scale = 2.0f)
     float distance = sdPyramid(position, h);
 
     // Convert the distance from within a fractal iteration to the object space.
-    return distance * pow(Scale, float(-n));
+    float fineDistance = distance * pow(Scale, float(-n));
+    return blend < 1 ? lerp(coarseDistance, fineDistance, blend) : fineDistance;
 }
 #endif // SIGNEDDISTANCEFRACTALS_H
\ No newline at end of file
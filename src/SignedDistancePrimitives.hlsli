@@ -47,7 +47,8 @@
 #include "RaytracingShaderHelper.hlsli"
 
 //------------------------------------------------------------------
-float GetDistanceFromSignedDistancePrimitive(in float3 position, in SignedDistancePrimitive::Enum sdPrimitive);
+float GetDistanceFromSignedDistancePrimitive(in float3 position, in SignedDistancePrimitive::Enum sdPrimitive,
+                                             in float3 cameraPosition, in float pixelSpreadAngle);
 
 //------------------------------------------------------------------
 
@@ -272,40 +273,78 @@ float sdCylinder6(float3 p, float2 h)
     return max(length_toPowNegative6(p.xz) - h.x, abs(p.y) - h.y);
 }
 
-float3 sdCalculateNormal(in float3 pos, in SignedDistancePrimitive::Enum sdPrimitive)
+// Gradient of the distance, from the four samples of the tetrahedron technique, which sum up to 4 * e^2 * gradient.
+float3 sdCalculateGradient(in float3 pos, in SignedDistancePrimitive::Enum sdPrimitive, in float3 cameraPosition = (float3)0,
+                           in float pixelSpreadAngle = 0)
 {
     float2 e = float2(1.0, -1.0) * 0.5773 * 0.0001;
-    return normalize(
-        e.xyy * GetDistanceFromSignedDistancePrimitive(pos + e.xyy, sdPrimitive) +
-        e.yyx * GetDistanceFromSignedDistancePrimitive(pos + e.yyx, sdPrimitive) +
-        e.yxy * GetDistanceFromSignedDistancePrimitive(pos + e.yxy, sdPrimitive) +
-        e.xxx * GetDistanceFromSignedDistancePrimitive(pos + e.xxx, sdPrimitive));
+    return (
+        e.xyy * GetDistanceFromSignedDistancePrimitive(pos + e.xyy, sdPrimitive, cameraPosition, pixelSpreadAngle) +
+        e.yyx * GetDistanceFromSignedDistancePrimitive(pos + e.yyx, sdPrimitive, cameraPosition, pixelSpreadAngle) +
+        e.yxy * GetDistanceFromSignedDistancePrimitive(pos + e.yxy, sdPrimitive, cameraPosition, pixelSpreadAngle) +
+        e.xxx * GetDistanceFromSignedDistancePrimitive(pos + e.xxx, sdPrimitive, cameraPosition, pixelSpreadAngle)) / (4 * e.x * e.x);
+}
+
+float3 sdCalculateNormal(in float3 pos, in SignedDistancePrimitive::Enum sdPrimitive, in float3 cameraPosition = (float3)0,
+                         in float pixelSpreadAngle = 0)
+{
+    return normalize(sdCalculateGradient(pos, sdPrimitive, cameraPosition, pixelSpreadAngle));
 }
 
 // Test ray against a signed distance primitive.
+// The ray's pixel cone has a radius of coneWidth + coneSpreadAngle * t, in the primitive's local space.
+// Fractals resolve detail down to the footprint of a pixel spanning pixelSpreadAngle from cameraPosition, in the same space.
 // Ref: https://www.scratchapixel.com/lessons/advanced-rendering/rendering-distance-fields/basic-sphere-tracer
-bool RaySignedDistancePrimitiveTest(in Ray ray, in SignedDistancePrimitive::Enum sdPrimitive, inout float thit, inout ProceduralPrimitiveAttributes attr, in float stepScale = 1.0f)
+// Ref: Amanatides, "Ray Tracing with Cones", SIGGRAPH 1984
+// Ref: Keinert et al., "Enhanced Sphere Tracing", STAG 2014
+// Ref: Balint and Valasek, "Accelerating Sphere Tracing", Eurographics 2018 Short Papers
+bool RaySignedDistancePrimitiveTest(in Ray ray, in SignedDistancePrimitive::Enum sdPrimitive, inout float thit, inout ProceduralPrimitiveAttributes attr, in float stepScale = 1.0f,
+    in float overRelaxation = 1.0f, in float coneWidth = 0, in float coneSpreadAngle = 0, in float3 cameraPosition = (float3)0,
+    in float pixelSpreadAngle = 0)
 {
     const float threshold = 0.0001;
     float t = RayTMin();
     const UINT MaxSteps = 512;
 
+    float previousRadius = 0;
+    float stepLength = 0;
+    float slope = -1; // Running estimate of the rate the distance changes at along the ray.
+
     // Do sphere tracing through the AABB.
     UINT i = 0;
     while (i++ < MaxSteps && t <= RayTCurrent())
     {
         float3 position = ray.origin + t * ray.direction;
-        float distance = GetDistanceFromSignedDistancePrimitive(position, sdPrimitive);
+        float distance = GetDistanceFromSignedDistancePrimitive(position, sdPrimitive, cameraPosition, pixelSpreadAngle);
+        float radius = stepScale * distance;
+
+        // A step past the previous unbounding sphere is safe only if the spheres at both of its ends overlap,
+        // leaving no gap along the ray for the surface to hide in. Otherwise, go back and take the plain step instead.
+        if (stepLength > previousRadius && (radius < 0 || previousRadius + radius < stepLength))
+        {
+            t += previousRadius - stepLength;
+            stepLength = previousRadius;
+            slope = -1;
+            continue;
+        }
 
         // Has the ray intersected the primitive? 
-        if (distance <= threshold * t)
+        // Anything closer than the pixel cone's radius is below the pixel's footprint and counts as a hit.
+        float coneRadius = coneWidth + coneSpreadAngle * t;
+        if (distance <= max(threshold * t, coneRadius))
         {
-            float3 hitSurfaceNormal = sdCalculateNormal(position, sdPrimitive);
-            if (IsAValidHit(ray, t, hitSurfaceNormal))
+            // Distance functions built on domain warps, like the Cog's, underestimate the distance to the surface.
+            // Near the surface, distance / |gradient| is close to the true distance, so the cone is tested against that.
+            float3 gradient = sdCalculateGradient(position, sdPrimitive, cameraPosition, pixelSpreadAngle);
+            if (distance <= max(threshold * t, coneRadius * length(gradient)))
             {
-                thit = t;
-                attr.normal = hitSurfaceNormal;
-                return true;
+                float3 hitSurfaceNormal = normalize(gradient);
+                if (IsAValidHit(ray, t, hitSurfaceNormal))
+                {
+                    thit = t;
+                    attr.normal = hitSurfaceNormal;
+                    return true;
+                }
             }
         }
 
@@ -313,7 +352,21 @@ bool RaySignedDistancePrimitiveTest(in Ray ray, in SignedDistancePrimitive::Enum
         // we can safely jump by that amount without intersecting the primitive.
         // We allow for scaling of steps per primitive type due to any pre-applied 
         // transformations that don't preserve true distances.
-        t += stepScale * distance;
+        // Steps get over-relaxed by up to overRelaxation, depending on the slope: a ray heading straight at the surface
+        // takes plain steps, one running along it steps further. Relaxed steps stop at RayTCurrent(), not to miss a hit just before it.
+        // The slope lags a step behind, so its divisions overlap with the next distance evaluation instead of delaying it.
+        float relaxation = 1;
+        if (overRelaxation > 1)
+        {
+            relaxation = clamp(2 / (1 - slope), 1, overRelaxation);
+            if (stepLength > 0)
+            {
+                slope = 0.5 * (slope + clamp((radius - previousRadius) / stepLength, -1, 1));
+            }
+        }
+        previousRadius = radius;
+        stepLength = max(radius, min(relaxation * radius, RayTCurrent() - t));
+        t += stepLength;
     }
     return false;
 }
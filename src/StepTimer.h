@@ -1,6 +1,9 @@
 #pragma once
 
-#include "DeviceResources.h"
+#include "AK/Types.h"
+
+#include <chrono>
+#include <cstdlib>
 
 // Helper class for animation and simulation timing.
 class StepTimer
@@ -8,11 +11,10 @@ class StepTimer
 public:
     StepTimer() : m_target_elapsed_ticks(ticks_per_second / 60)
     {
-        QueryPerformanceFrequency(&m_qpc_qpc_frequency);
-        QueryPerformanceCounter(&m_qpc_last_time);
+        m_last_time = clock::now();
 
         // Initialize max delta to 1/10 of a second.
-        m_qpc_max_delta = m_qpc_qpc_frequency.QuadPart / 10;
+        m_max_delta = clock_frequency / 10;
     }
 
     // Get elapsed time since the previous Update call.
@@ -85,12 +87,12 @@ public:
 
     void reset_elapsed_time()
     {
-        QueryPerformanceCounter(&m_qpc_last_time);
+        m_last_time = clock::now();
 
         m_left_over_ticks = 0;
         m_frames_per_second = 0;
         m_frames_this_second = 0;
-        m_qpc_second_counter = 0;
+        m_second_counter = 0;
     }
 
     typedef void (*LPUPDATEFUNC)(void);
@@ -99,24 +101,22 @@ public:
     void tick(LPUPDATEFUNC const update = nullptr)
     {
         // Query the current time.
-        LARGE_INTEGER current_time;
-
-        QueryPerformanceCounter(&current_time);
+        clock::time_point const current_time = clock::now();
 
-        u64 time_delta = current_time.QuadPart - m_qpc_last_time.QuadPart;
+        u64 time_delta = static_cast<u64>((current_time - m_last_time).count());
 
-        m_qpc_last_time = current_time;
-        m_qpc_second_counter += time_delta;
+        m_last_time = current_time;
+        m_second_counter += time_delta;
 
         // Clamp excessively large time deltas (e.g. after paused in the debugger).
-        if (time_delta > m_qpc_max_delta)
+        if (time_delta > m_max_delta)
         {
-            time_delta = m_qpc_max_delta;
+            time_delta = m_max_delta;
         }
 
-        // Convert QPC units into a canonical tick format. This cannot overflow due to the previous clamp.
+        // Convert clock units into a canonical tick format. This cannot overflow due to the previous clamp.
         time_delta *= ticks_per_second;
-        time_delta /= m_qpc_qpc_frequency.QuadPart;
+        time_delta /= clock_frequency;
 
         u32 const last_frame_count = m_frame_count;
 
@@ -131,7 +131,7 @@ public:
             // accumulate enough tiny errors that it would drop a frame. It is better to just round
             // small deviations down to zero to leave things running smoothly.
 
-            if (abs(static_cast<int>(time_delta - m_target_elapsed_ticks)) < ticks_per_second / 4000)
+            if (std::abs(static_cast<int>(time_delta - m_target_elapsed_ticks)) < ticks_per_second / 4000)
             {
                 time_delta = m_target_elapsed_ticks;
             }
@@ -171,19 +171,21 @@ public:
             m_frames_this_second++;
         }
 
-        if (m_qpc_second_counter >= static_cast<u64>(m_qpc_qpc_frequency.QuadPart))
+        if (m_second_counter >= clock_frequency)
         {
             m_frames_per_second = m_frames_this_second;
             m_frames_this_second = 0;
-            m_qpc_second_counter %= m_qpc_qpc_frequency.QuadPart;
+            m_second_counter %= clock_frequency;
         }
     }
 
 private:
-    // Source timing data uses QPC units.
-    LARGE_INTEGER m_qpc_qpc_frequency = {};
-    LARGE_INTEGER m_qpc_last_time = {};
-    u64 m_qpc_max_delta = 0;
+    // Source timing data uses steady_clock units. On Windows steady_clock is backed by QPC.
+    using clock = std::chrono::steady_clock;
+    static constexpr u64 clock_frequency = clock::period::den / clock::period::num;
+
+    clock::time_point m_last_time = {};
+    u64 m_max_delta = 0;
 
     // Derived timing data uses a canonical tick format.
     u64 m_elapsed_ticks = 0;
@@ -194,7 +196,7 @@ private:
     u32 m_frame_count = 0;
     u32 m_frames_per_second = 0;
     u32 m_frames_this_second = 0;
-    u64 m_qpc_second_counter = 0;
+    u64 m_second_counter = 0;
 
     // Members for configuring fixed timestep mode.
     bool m_is_fixed_time_step = false;
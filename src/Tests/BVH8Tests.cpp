@@ -0,0 +1,69 @@
+#include "AK/Types.h"
+#include "CPU/AABB.h"
+#include "CPU/BVH.h"
+#include "CPU/BVH8.h"
+#include "CPU/RaytracingShaderHelper.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+// Checks that collapsing binary BVHs into BVH8s keeps every primitive reachable.
+// Usage: BVH8Tests, exits with a failure if any check fails.
+
+namespace
+{
+
+using namespace CPU;
+
+// A binary BVH leaf with more primitives than a BVH8 leaf child holds, here all of them, since their centroids coincide.
+// A ray through them has to reach every one exactly once.
+bool check_oversized_leaf(u32 const primitive_count)
+{
+    std::vector<AABB> const bounds(primitive_count, AABB {{-1.0f, -1.0f, -1.0f}, {1.0f, 1.0f, 1.0f}});
+
+    BVHBuildSettings settings = {};
+    settings.max_leaf_size = primitive_count;
+    BVH bvh = {};
+    bvh.build(bounds, settings);
+
+    BVH8 bvh8 = {};
+    bvh8.build(bvh);
+
+    std::vector<u32> visit_counts(primitive_count, 0);
+    Ray const ray = {{0.0f, 0.0f, -5.0f}, {0.0f, 0.0f, 1.0f}};
+    RayState state = {};
+    state.t_current = 100.0f;
+    bvh8.intersect_closest(ray, state, [&](u32 const primitive_index, RayState&) {
+        visit_counts[primitive_index]++;
+        return false;
+    });
+
+    u32 missed_count = 0;
+    u32 repeated_count = 0;
+    for (u32 const visit_count : visit_counts)
+    {
+        missed_count += visit_count == 0;
+        repeated_count += visit_count > 1;
+    }
+
+    bool const passed = bvh.get_nodes().size() == 1 && missed_count == 0 && repeated_count == 0;
+    std::printf("%s leaf of %u primitives: %u BVH8 nodes, %u missed, %u visited more than once\n", passed ? "ok  " : "FAIL",
+                primitive_count, static_cast<u32>(bvh8.get_nodes().size()), missed_count, repeated_count);
+    return passed;
+}
+
+}
+
+int main()
+{
+    bool passed = true;
+    passed &= check_oversized_leaf(BVH8::MAX_LEAF_SIZE);
+    passed &= check_oversized_leaf(BVH8::MAX_LEAF_SIZE + 1);
+    passed &= check_oversized_leaf(1000);
+
+    // More than a single node of leaf children holds.
+    passed &= check_oversized_leaf(BVH8::WIDTH * BVH8::MAX_LEAF_SIZE + 1);
+
+    return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,258 @@
+#include "AK/Types.h"
+#include "CPU/ProceduralPrimitivesLibrary.h"
+#include "CPU/SignedDistanceExpression.h"
+#include "CPU/SignedDistanceProgram.h"
+#include "CPU/SignedDistanceProgramOctree.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+// Checks the signed distance expressions against the distance functions they stand in for, their pruned programs
+// against the whole ones, and packets of rays traced through them against single rays.
+// Usage: SignedDistanceExpressionTests, exits with a failure if any check fails.
+
+namespace
+{
+
+using namespace CPU;
+
+// Points scattered over the AABB and a bit beyond it, from a fixed seed so failures reproduce.
+std::vector<float3> generate_points(u32 const count, float const extent)
+{
+    std::mt19937 generator(1);
+    std::uniform_real_distribution<float> distribution(-extent, extent);
+
+    std::vector<float3> points(count);
+    for (float3& point : points)
+    {
+        point = {distribution(generator), distribution(generator), distribution(generator)};
+    }
+
+    return points;
+}
+
+// Expressions of the built-in primitives, batched and one position at a time, within max_error of the hand-written shapes.
+template<SignedDistancePrimitive::Enum sd_primitive>
+bool check_primitive_expression(char const* name, std::vector<float3> const& points)
+{
+    float constexpr max_error = 4e-7f;
+
+    SignedDistanceExpression expression = {};
+    if (!build_signed_distance_primitive_expression(sd_primitive, expression))
+    {
+        std::printf("FAIL %s: no expression\n", name);
+        return false;
+    }
+
+    SignedDistanceProgram const program = expression.compile();
+    if (program.is_empty())
+    {
+        std::printf("FAIL %s: expression does not compile\n", name);
+        return false;
+    }
+
+    std::vector<float> distances(points.size());
+    program.evaluate(points, distances);
+
+    float batch_error = 0.0f;
+    float single_error = 0.0f;
+    for (u32 i = 0; i < points.size(); i++)
+    {
+        float const expected = get_distance_from_signed_distance_primitive<sd_primitive>(points[i]);
+        batch_error = std::max(batch_error, std::abs(distances[i] - expected));
+        single_error = std::max(single_error, std::abs(program.get_distance(points[i]) - expected));
+    }
+
+    bool const passed = batch_error <= max_error && single_error <= max_error;
+    std::printf("%s %s: max error %g batched, %g single\n", passed ? "ok  " : "FAIL", name, batch_error, single_error);
+    return passed;
+}
+
+// The example of parse_signed_distance_expression()'s comment parses into the IntersectedRoundCube.
+bool check_parsed_expression(std::vector<float3> const& points)
+{
+    char const* text = "(subtract (subtract (round-box p 0.75 0.75 0.75 0.2) (sphere p 1.2)) (- (sphere p 1.32)))";
+
+    SignedDistanceExpression expression = {};
+    std::string error = {};
+    if (!parse_signed_distance_expression(text, expression, error))
+    {
+        std::printf("FAIL parsed IntersectedRoundCube: %s\n", error.c_str());
+        return false;
+    }
+
+    SignedDistanceProgram const program = expression.compile();
+    float max_error = 0.0f;
+    for (float3 const& point : points)
+    {
+        float const expected = get_distance_from_signed_distance_primitive<SignedDistancePrimitive::IntersectedRoundCube>(point);
+        max_error = std::max(max_error, std::abs(program.get_distance(point) - expected));
+    }
+
+    bool const passed = max_error <= 4e-7f;
+    std::printf("%s parsed IntersectedRoundCube: max error %g\n", passed ? "ok  " : "FAIL", max_error);
+    return passed;
+}
+
+// Programs pruned to the octree's cells give exactly the whole program's distances, inside of the AABB and out.
+template<SignedDistancePrimitive::Enum sd_primitive>
+bool check_pruned_expression(char const* name, std::vector<float3> const& points)
+{
+    SignedDistanceExpression expression = {};
+    SignedDistanceProgramOctree octree = {};
+    if (!build_signed_distance_primitive_expression(sd_primitive, expression) || !octree.build(expression))
+    {
+        std::printf("FAIL pruned %s: expression does not compile\n", name);
+        return false;
+    }
+
+    u32 mismatch_count = 0;
+    for (float3 const& point : points)
+    {
+        mismatch_count += octree.get_distance(point) != octree.get_program().get_distance(point);
+    }
+
+    bool const passed = mismatch_count == 0;
+    std::printf("%s pruned %s: %u programs, %u of %u distances differ\n", passed ? "ok  " : "FAIL", name, octree.get_program_count(),
+                mismatch_count, static_cast<u32>(points.size()));
+    return passed;
+}
+
+// The octree's batches, each position evaluated by the program of its cell, give the distances of those programs up to the
+// rounding differences between batched and single evaluation.
+template<SignedDistancePrimitive::Enum sd_primitive>
+bool check_octree_batch(char const* name, std::vector<float3> const& points)
+{
+    float constexpr max_error = 4e-7f;
+
+    SignedDistanceExpression expression = {};
+    SignedDistanceProgramOctree octree = {};
+    if (!build_signed_distance_primitive_expression(sd_primitive, expression) || !octree.build(expression))
+    {
+        std::printf("FAIL octree batch %s: expression does not compile\n", name);
+        return false;
+    }
+
+    std::vector<float> distances(points.size());
+    octree.evaluate(points, distances);
+
+    u32 mismatch_count = 0;
+    for (u32 i = 0; i < points.size(); i++)
+    {
+        mismatch_count += std::abs(distances[i] - octree.get_distance(points[i])) > max_error;
+    }
+
+    bool const passed = mismatch_count == 0;
+    std::printf("%s octree batch %s: %u of %u distances differ\n", passed ? "ok  " : "FAIL", name, mismatch_count,
+                static_cast<u32>(points.size()));
+    return passed;
+}
+
+// Rays stepped together as packets hit where they do one at a time. The rounding of the batched evaluation may take a ray along
+// other steps, which end anywhere within the hit threshold of the surface, further along t for grazing rays.
+template<SignedDistancePrimitive::Enum sd_primitive>
+bool check_packet_trace(char const* name)
+{
+    u32 constexpr PACKET_WIDTH = 8;
+    u32 constexpr RESOLUTION = 128;
+    float constexpr max_error = 1e-3f;
+
+    SignedDistanceExpression expression = {};
+    SignedDistanceProgramOctree octree = {};
+    if (!build_signed_distance_primitive_expression(sd_primitive, expression) || !octree.build(expression))
+    {
+        std::printf("FAIL packet trace %s: expression does not compile\n", name);
+        return false;
+    }
+
+    // Packets of 4x2 neighbouring rays from a pinhole camera in front of the AABB.
+    float3 const origin = {0.3f, 0.4f, -3.0f};
+    RayState states[PACKET_WIDTH] = {};
+    RayCone const cones[PACKET_WIDTH] = {};
+    SphereTraceWarmStart* const warm_starts[PACKET_WIDTH] = {};
+    for (RayState& state : states)
+    {
+        state = {0.0f, 100.0f, 0};
+    }
+
+    u32 mismatch_count = 0;
+    for (u32 y = 0; y < RESOLUTION; y += 2)
+    {
+        for (u32 x = 0; x < RESOLUTION; x += 4)
+        {
+            Ray rays[PACKET_WIDTH] = {};
+            for (u32 lane = 0; lane < PACKET_WIDTH; lane++)
+            {
+                float3 const target = {(static_cast<float>(x + lane % 4) + 0.5f) / RESOLUTION * 2.4f - 1.2f,
+                                       (static_cast<float>(y + lane / 4) + 0.5f) / RESOLUTION * 2.4f - 1.2f, 0.0f};
+                rays[lane] = {origin, normalize(target - origin)};
+            }
+
+            float thits[PACKET_WIDTH] = {};
+            ProceduralPrimitiveAttributes attrs[PACKET_WIDTH] = {};
+            u32 const hit_mask =
+                ray_signed_distance_program_packet_test(rays, 0xFF, octree, thits, attrs, states, 1.0f, 1.0f, cones, nullptr, warm_starts);
+
+            for (u32 lane = 0; lane < PACKET_WIDTH; lane++)
+            {
+                float thit = 0.0f;
+                ProceduralPrimitiveAttributes attr = {};
+                bool const is_hit = ray_signed_distance_program_test(rays[lane], octree, thit, attr, states[lane]);
+                bool const is_packet_hit = (hit_mask & (1u << lane)) != 0;
+                mismatch_count += is_hit != is_packet_hit || (is_hit && std::abs(thits[lane] - thit) > max_error);
+            }
+        }
+    }
+
+    bool const passed = mismatch_count == 0;
+    std::printf("%s packet trace %s: %u of %u hits differ\n", passed ? "ok  " : "FAIL", name, mismatch_count, RESOLUTION * RESOLUTION);
+    return passed;
+}
+
+}
+
+int main()
+{
+    using namespace SignedDistancePrimitive;
+
+    std::vector<float3> const points = generate_points(1u << 16, 1.2f);
+
+    // The FractalPyramid has no expression, see build_signed_distance_primitive_expression().
+    bool passed = true;
+    passed &= check_primitive_expression<MiniSpheres>("MiniSpheres", points);
+    passed &= check_primitive_expression<IntersectedRoundCube>("IntersectedRoundCube", points);
+    passed &= check_primitive_expression<SquareTorus>("SquareTorus", points);
+    passed &= check_primitive_expression<TwistedTorus>("TwistedTorus", points);
+    passed &= check_primitive_expression<Cog>("Cog", points);
+    passed &= check_primitive_expression<Cylinder>("Cylinder", points);
+    passed &= check_parsed_expression(points);
+
+    std::vector<float3> const pruning_points = generate_points(1u << 18, 1.2f);
+    passed &= check_pruned_expression<MiniSpheres>("MiniSpheres", pruning_points);
+    passed &= check_pruned_expression<IntersectedRoundCube>("IntersectedRoundCube", pruning_points);
+    passed &= check_pruned_expression<SquareTorus>("SquareTorus", pruning_points);
+    passed &= check_pruned_expression<TwistedTorus>("TwistedTorus", pruning_points);
+    passed &= check_pruned_expression<Cog>("Cog", pruning_points);
+    passed &= check_pruned_expression<Cylinder>("Cylinder", pruning_points);
+
+    passed &= check_octree_batch<MiniSpheres>("MiniSpheres", pruning_points);
+    passed &= check_octree_batch<IntersectedRoundCube>("IntersectedRoundCube", pruning_points);
+    passed &= check_octree_batch<SquareTorus>("SquareTorus", pruning_points);
+    passed &= check_octree_batch<TwistedTorus>("TwistedTorus", pruning_points);
+    passed &= check_octree_batch<Cog>("Cog", pruning_points);
+    passed &= check_octree_batch<Cylinder>("Cylinder", pruning_points);
+
+    passed &= check_packet_trace<MiniSpheres>("MiniSpheres");
+    passed &= check_packet_trace<IntersectedRoundCube>("IntersectedRoundCube");
+    passed &= check_packet_trace<SquareTorus>("SquareTorus");
+    passed &= check_packet_trace<TwistedTorus>("TwistedTorus");
+    passed &= check_packet_trace<Cog>("Cog");
+    passed &= check_packet_trace<Cylinder>("Cylinder");
+
+    return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,114 @@
+#include "AK/Types.h"
+#include "CPU/ProceduralPrimitivesLibrary.h"
+#include "CPU/RaytracingShaderHelper.h"
+#include "CPU/SparseDistanceField.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+// Checks that sparse distance fields bound their primitives' distances, and that sphere tracing with them
+// finds the same surface as without them.
+// Usage: SparseDistanceFieldTests, exits with a failure if any check fails.
+
+namespace
+{
+
+using namespace CPU;
+
+// Lookups at points scattered over the AABB never exceed the distance, at any fractal iterations, nor 0 inside of the primitive.
+// From a fixed seed, so failures reproduce.
+template<SignedDistancePrimitive::Enum sd_primitive>
+bool check_lower_bound(char const* name, SparseDistanceField const& distance_field, u32 const point_count)
+{
+    std::mt19937 generator(1);
+    std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+
+    u32 overestimate_count = 0;
+    float max_overestimate = 0.0f;
+    for (u32 i = 0; i < point_count; i++)
+    {
+        float3 const point = {distribution(generator), distribution(generator), distribution(generator)};
+        for (float const iterations : {FRACTAL_MIN_ITERATIONS_COUNT, FRACTAL_ITERATIONS_COUNT, FRACTAL_MAX_ITERATIONS_COUNT})
+        {
+            FractalDetail fractal_detail = {};
+            fractal_detail.iterations = iterations;
+            float const distance = get_distance_from_signed_distance_primitive<sd_primitive>(point, fractal_detail);
+            float const overestimate = distance_field.get_distance(point) - std::max(0.0f, distance);
+            overestimate_count += overestimate > 1e-6f;
+            max_overestimate = std::max(max_overestimate, overestimate);
+        }
+    }
+
+    bool const passed = overestimate_count == 0;
+    std::printf("%s %s: %u bricks, %u of %u lookups overestimate, by up to %g\n", passed ? "ok  " : "FAIL", name,
+                distance_field.get_brick_count(), overestimate_count, 3 * point_count, max_overestimate);
+    return passed;
+}
+
+// Rays from around the AABB at points in it. Every one has to hit or miss with the field as without it,
+// and hit within max_error of the same t.
+template<SignedDistancePrimitive::Enum sd_primitive>
+bool check_cached_hits(char const* name, SparseDistanceField const& distance_field, float const step_scale, u32 const ray_count)
+{
+    float constexpr max_error = 1e-3f;
+
+    std::mt19937 generator(1);
+    std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+
+    u32 hit_count = 0;
+    u32 mismatch_count = 0;
+    float max_hit_error = 0.0f;
+    for (u32 i = 0; i < ray_count; i++)
+    {
+        float3 const origin = normalize(float3 {distribution(generator), distribution(generator), distribution(generator)}) * 3.0f;
+        float3 const target = float3 {distribution(generator), distribution(generator), distribution(generator)} * 0.9f;
+        Ray const ray = {origin, normalize(target - origin)};
+
+        RayState state = {};
+        state.t_current = 6.0f;
+
+        float exact_t = 0.0f;
+        float cached_t = 0.0f;
+        ProceduralPrimitiveAttributes attr = {};
+        bool const exact_hit = ray_signed_distance_primitive_test<sd_primitive>(ray, exact_t, attr, state, step_scale);
+        bool const cached_hit =
+            ray_signed_distance_primitive_test<sd_primitive>(ray, cached_t, attr, state, step_scale, 1.0f, {}, &distance_field);
+
+        hit_count += exact_hit;
+        float const hit_error = exact_hit && cached_hit ? std::abs(cached_t - exact_t) : 0.0f;
+        mismatch_count += exact_hit != cached_hit || hit_error > max_error;
+        max_hit_error = std::max(max_hit_error, hit_error);
+    }
+
+    bool const passed = mismatch_count == 0;
+    std::printf("%s %s: %u of %u rays hit, %u differ with the field, max hit t error %g\n", passed ? "ok  " : "FAIL", name, hit_count,
+                ray_count, mismatch_count, max_hit_error);
+    return passed;
+}
+
+}
+
+int main()
+{
+    using namespace SignedDistancePrimitive;
+
+    // The primitives the raytracer caches fields of.
+    SparseDistanceField cog_field = {};
+    cog_field.build(Cog);
+    SparseDistanceField fractal_field = {};
+    fractal_field.build(FractalPyramid);
+
+    bool passed = true;
+    passed &= check_lower_bound<Cog>("Cog", cog_field, 1u << 18);
+    passed &= check_lower_bound<FractalPyramid>("FractalPyramid", fractal_field, 1u << 18);
+
+    // The fractal's distance overestimates across its folds, by which whole steps overshoot the surface differently
+    // from wherever they start, with the field or without. Shorter steps land on the surface either way.
+    passed &= check_cached_hits<Cog>("Cog", cog_field, 1.0f, 1u << 14);
+    passed &= check_cached_hits<FractalPyramid>("FractalPyramid", fractal_field, 0.25f, 1u << 14);
+
+    return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
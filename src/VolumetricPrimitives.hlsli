@@ -30,14 +30,12 @@ struct Metaball
     float  radius;
 };
 
-// Calculate a magnitude of an influence from a Metaball charge.
+// Calculate a magnitude of an influence from a Metaball charge at a distance from its center.
 // Return metaball potential range: <0,1>
-// mbRadius - largest possible area of metaball contribution - AKA its bounding sphere.
-float CalculateMetaballPotential(in float3 position, in Metaball blob, out float distance)
+// radius - largest possible area of metaball contribution - AKA its bounding sphere.
+float CalculateMetaballPotentialAtDistance(in float distance, in float radius)
 {
-    distance = length(position - blob.center);
-    
-    if (distance <= blob.radius)
+    if (distance <= radius)
     {
         float d = distance;
 
@@ -46,9 +44,9 @@ float CalculateMetaballPotential(in float3 position, in Metaball blob, out float
         // second derivative may result in a sharp and visually unpleasant normal vector jump.
         // The field function should return 1 at distance 0 from a center, and 1 at radius distance,
         // but this one gives f(0) = 0, f(radius) = 1, so we use the distance to radius instead.
-        d = blob.radius - d;
+        d = radius - d;
 
-        float r = blob.radius;
+        float r = radius;
         return 6 * (d*d*d*d*d) / (r*r*r*r*r)
             - 15 * (d*d*d*d) / (r*r*r*r)
             + 10 * (d*d*d) / (r*r*r);
@@ -56,6 +54,12 @@ float CalculateMetaballPotential(in float3 position, in Metaball blob, out float
     return 0;
 }
 
+float CalculateMetaballPotential(in float3 position, in Metaball blob, out float distance)
+{
+    distance = length(position - blob.center);
+    return CalculateMetaballPotentialAtDistance(distance, blob.radius);
+}
+
 // Calculate field potential from all active metaballs.
 float CalculateMetaballsPotential(in float3 position, in Metaball blobs[METABALLS_COUNT], in UINT nActiveMetaballs)
 {
@@ -72,17 +76,41 @@ float CalculateMetaballsPotential(in float3 position, in Metaball blobs[METABALL
     return sumFieldPotential;
 }
 
-// Calculate a normal via central differences.
+// Gradient of a metaball's potential. With u = (radius - distance) / radius, the quintic falls off at 30 * u^2 * (1 - u)^2 / radius
+// per unit of distance from the center.
+float3 CalculateMetaballPotentialGradient(in float3 position, in Metaball blob)
+{
+    float3 offset = position - blob.center;
+    float distance = length(offset);
+
+    if (distance <= blob.radius && distance > 0)
+    {
+        float u = (blob.radius - distance) / blob.radius;
+        float w = u * (1 - u);
+        return offset * (-30 * w * w / (blob.radius * distance));
+    }
+    return 0;
+}
+
+// Calculate field potential gradient from all active metaballs.
+float3 CalculateMetaballsGradient(in float3 position, in Metaball blobs[METABALLS_COUNT], in UINT nActiveMetaballs)
+{
+    float3 gradient = 0;
+#if USE_DYNAMIC_LOOPS 
+    for (UINT j = 0; j < nActiveMetaballs; j++)
+#else
+    for (UINT j = 0; j < METABALLS_COUNT; j++)
+#endif
+    {
+        gradient += CalculateMetaballPotentialGradient(position, blobs[j]);
+    }
+    return gradient;
+}
+
+// Calculate a normal from the analytic gradient. The potential grows inwards, so the normal points down the gradient.
 float3 CalculateMetaballsNormal(in float3 position, in Metaball blobs[METABALLS_COUNT], in UINT nActiveMetaballs)
 {
-    float e = 0.5773 * 0.00001;
-    return normalize(float3(
-        CalculateMetaballsPotential(position + float3(-e, 0, 0), blobs, nActiveMetaballs) -
-        CalculateMetaballsPotential(position + float3(e, 0, 0), blobs, nActiveMetaballs),
-        CalculateMetaballsPotential(position + float3(0, -e, 0), blobs, nActiveMetaballs) -
-        CalculateMetaballsPotential(position + float3(0, e, 0), blobs, nActiveMetaballs),
-        CalculateMetaballsPotential(position + float3(0, 0, -e), blobs, nActiveMetaballs) -
-        CalculateMetaballsPotential(position + float3(0, 0, e), blobs, nActiveMetaballs)));
+    return normalize(-CalculateMetaballsGradient(position, blobs, nActiveMetaballs));
 }
 
 void InitializeAnimatedMetaballs(out Metaball blobs[METABALLS_COUNT], in float elapsedTime, in float cycleDuration)
@@ -146,8 +174,61 @@ void FindIntersectingMetaballs(in Ray ray, out float tmin, out float tmax, inout
     tmax = min(tmax, RayTCurrent());
 }
 
+// Bounds of the field potential over the ray segment <t0, t1>. A metaball's potential only falls off with the distance
+// from its center, so over the segment it peaks at the point closest to the center, and bottoms out at one of the ends.
+void CalculateMetaballsPotentialBounds(in Ray ray, in float t0, in float t1, in Metaball blobs[METABALLS_COUNT], in UINT nActiveMetaballs,
+                                       out float minPotential, out float maxPotential)
+{
+    minPotential = 0;
+    maxPotential = 0;
+    float directionLengthSquared = dot(ray.direction, ray.direction);
+#if USE_DYNAMIC_LOOPS 
+    for (UINT j = 0; j < nActiveMetaballs; j++)
+#else
+    for (UINT j = 0; j < METABALLS_COUNT; j++)
+#endif
+    {
+        float tClosest = clamp(dot(blobs[j].center - ray.origin, ray.direction) / directionLengthSquared, t0, t1);
+        float minDistance = length(ray.origin + tClosest * ray.direction - blobs[j].center);
+        float maxDistance = max(length(ray.origin + t0 * ray.direction - blobs[j].center),
+                                length(ray.origin + t1 * ray.direction - blobs[j].center));
+        minPotential += CalculateMetaballPotentialAtDistance(maxDistance, blobs[j].radius);
+        maxPotential += CalculateMetaballPotentialAtDistance(minDistance, blobs[j].radius);
+    }
+}
+
+// Find where the ray crosses the isosurface within <t0, t1>, given the crossing is there, with Newton's method.
+// Steps that would leave the segment known to hold the crossing bisect it instead.
+float FindMetaballsIsosurfaceCrossing(in Ray ray, in float t0, in float t1, in bool isInsideAtT0, in float threshold,
+                                      in Metaball blobs[METABALLS_COUNT], in UINT nActiveMetaballs)
+{
+    const UINT MAX_STEPS = 8;
+    float t = 0.5 * (t0 + t1);
+    for (UINT iStep = 0; iStep < MAX_STEPS; iStep++)
+    {
+        float3 position = ray.origin + t * ray.direction;
+        float potential = CalculateMetaballsPotential(position, blobs, nActiveMetaballs) - threshold;
+        if ((potential >= 0) == isInsideAtT0)
+        {
+            t0 = t;
+        }
+        else
+        {
+            t1 = t;
+        }
+
+        float derivative = dot(CalculateMetaballsGradient(position, blobs, nActiveMetaballs), ray.direction);
+        float tNewton = t - potential / derivative;
+        t = (tNewton > t0 && tNewton < t1) ? tNewton : 0.5 * (t0 + t1);
+    }
+    return t;
+}
+
 // Test if a ray with RayFlags and segment <RayTMin(), RayTCurrent()> intersects metaball field.
-// The test sphere traces through the metaball field until it hits a threshold isosurface. 
+// The test searches the ray's extent through the metaballs for crossings of a threshold isosurface, front to back.
+// Segments where bounds of the potential rule out a crossing are skipped whole, the rest are halved down to MAX_DEPTH,
+// and a segment whose ends lie on different sides of the isosurface has its crossing refined.
+// Ref: Mitchell, "Robust Ray Intersection with Interval Arithmetic", Graphics Interface 1990
 bool RayMetaballsIntersectionTest(in Ray ray, inout float thit, inout ProceduralPrimitiveAttributes attr, in float elapsedTime)
 {
     Metaball blobs[METABALLS_COUNT];
@@ -156,46 +237,66 @@ bool RayMetaballsIntersectionTest(in Ray ray, inout float thit, inout Procedural
     float tmin, tmax;   // Ray extents to first and last metaball intersections.
     UINT nActiveMetaballs = 0;  // Number of metaballs's that the ray intersects.
     FindIntersectingMetaballs(ray, tmin, tmax, blobs, nActiveMetaballs);
+    if (tmin > tmax)
+    {
+        return false;
+    }
+
+    // Field potential threshold defining the isosurface.
+    // Threshold - valid range is (0, 1>, the larger the threshold the smaller the blob.
+    const float Threshold = 0.25f;
 
-    UINT MAX_STEPS = 128;
-    float t = tmin;
-    float minTStep = (tmax - tmin) / (MAX_STEPS / 1);
-    UINT iStep = 0;
+    bool isInside = CalculateMetaballsPotential(ray.origin + tmin * ray.direction, blobs, nActiveMetaballs) >= Threshold;
 
-    while (iStep++ < MAX_STEPS)
+    // Segments are visited in order as the nodes of a binary tree over <tmin, tmax>, without a stack:
+    // the index-th of the 2^depth equal segments at a depth.
+    const UINT MAX_DEPTH = 8;
+    UINT depth = 0;
+    UINT index = 0;
+    while (true)
     {
-        float3 position = ray.origin + t * ray.direction;
-        float fieldPotentials[METABALLS_COUNT];    // Field potentials for each metaball.
-        float sumFieldPotential = 0;           // Sum of all metaball field potentials.
-            
-        // Calculate field potentials from all metaballs.
-#if USE_DYNAMIC_LOOPS
-        for (UINT j = 0; j < nActiveMetaballs; j++)
-#else
-        for (UINT j = 0; j < METABALLS_COUNT; j++)
-#endif
-        {
-            float distance;
-            fieldPotentials[j] = CalculateMetaballPotential(position, blobs[j], distance);
-            sumFieldPotential += fieldPotentials[j];
-         }
+        float segmentLength = (tmax - tmin) / (1u << depth);
+        float t0 = tmin + index * segmentLength;
+        float t1 = t0 + segmentLength;
 
-        // Field potential threshold defining the isosurface.
-        // Threshold - valid range is (0, 1>, the larger the threshold the smaller the blob.
-        const float Threshold = 0.25f;
+        float minPotential, maxPotential;
+        CalculateMetaballsPotentialBounds(ray, t0, t1, blobs, nActiveMetaballs, minPotential, maxPotential);
+        bool mayCross = isInside ? minPotential < Threshold : maxPotential >= Threshold;
+        if (mayCross && depth < MAX_DEPTH)
+        {
+            depth++;
+            index *= 2;
+            continue;
+        }
 
-        // Have we crossed the isosurface?
-        if (sumFieldPotential >= Threshold)
+        if (mayCross)
         {
-            float3 normal = CalculateMetaballsNormal(position, blobs, nActiveMetaballs);
-            if (IsAValidHit(ray, t, normal))
+            bool isInsideAtT1 = CalculateMetaballsPotential(ray.origin + t1 * ray.direction, blobs, nActiveMetaballs) >= Threshold;
+            if (isInsideAtT1 != isInside)
             {
-                thit = t;
-                attr.normal = normal;
-                return true;
+                float t = FindMetaballsIsosurfaceCrossing(ray, t0, t1, isInside, Threshold, blobs, nActiveMetaballs);
+                float3 normal = CalculateMetaballsNormal(ray.origin + t * ray.direction, blobs, nActiveMetaballs);
+                if (IsAValidHit(ray, t, normal))
+                {
+                    thit = t;
+                    attr.normal = normal;
+                    return true;
+                }
+                isInside = isInsideAtT1;
             }
         }
-        t += minTStep;
+
+        // Move on to the next segment, up the tree past the last segments of their parents.
+        index++;
+        while ((index & 1) == 0 && depth > 0)
+        {
+            index >>= 1;
+            depth--;
+        }
+        if (depth == 0)
+        {
+            break;
+        }
     }
 
     return false;